@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/adaptive.h"
+#include "core/eval.h"
+
+// Adaptive precision benchmark: the tree's plain double evaluate, against evaluation with a running error bound at the
+// default tolerance (subtrees re-evaluated only on cancellation), and at a tolerance no double result meets (every
+// sum re-evaluated in double-double).
+
+namespace {
+
+constexpr double kSeconds = 0.5;
+constexpr std::size_t kPoints = 1 << 14;
+
+// Runs a sweep over all points repeatedly, returning nanoseconds per point
+template <typename Sweep>
+double time_per_point(Sweep sweep) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        sink += sweep();
+        count += kPoints;
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+void run(const std::string& expression) {
+    auto tree = eval::try_parse(expression);
+    if (!tree) {
+        std::cerr << types::error_message(tree.error()) << std::endl;
+        return;
+    }
+    adaptive::Program program(*tree.value());
+    std::vector<double> xs(kPoints);
+    for (std::size_t i = 0; i < kPoints; ++i) xs[i] = 1.0 + 0.001 * static_cast<double>(i);
+
+    SymbolTable symbols = {{"x", 1.0}};
+    double tree_ns = time_per_point([&] {
+        double sum = 0;
+        for (std::size_t i = 0; i < kPoints; ++i) {
+            symbols["x"] = xs[i];
+            sum += tree.value()->evaluate(symbols);
+        }
+        return sum;
+    });
+    std::size_t refined = 0;
+    auto adaptive_sweep = [&](double tolerance) {
+        double sum = 0;
+        refined = 0;
+        for (std::size_t i = 0; i < kPoints; ++i) {
+            adaptive::Result result = program.evaluate(&xs[i], tolerance);
+            sum += result.value_ + result.error_;
+            refined += result.refined_;
+        }
+        return sum;
+    };
+    double adaptive_ns = time_per_point([&] { return adaptive_sweep(adaptive::kDefaultTolerance); });
+    double refined_per_point = static_cast<double>(refined) / kPoints;
+    double refine_all_ns = time_per_point([&] { return adaptive_sweep(1e-300); });
+
+    std::printf("%-44s %8.2f %10.2f %8.2f %12.2f\n", expression.c_str(), tree_ns, adaptive_ns, refined_per_point, refine_all_ns);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::cout << "expression                                   tree ns  adaptive ns  refined  all-dd ns\n";
+    if (argc > 1) run(argv[1]);
+    else {
+        run("(x*x - 3*x + 2) / (x*x + 1) + 0.5*x");
+        run("((x + 100000000) * (x + 100000000) - 10000000000000000) / x");
+        run("(x + 10000000000000000) - 10000000000000000 + x*x");
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "functional/constants.h"
+
+// Constant benchmark: pi and e to 10^7 digits (or the digits given as the argument) by binary splitting, timing the
+// series and the decimal conversion on one thread and on every core, and a cached repeat.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t digits = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("%zu digits, %u cores\n", digits, cores);
+    std::vector<unsigned> thread_counts = {1};
+    if (cores > 1) thread_counts.push_back(cores);
+    std::printf("constant  threads   series s  decimal s\n");
+    for (constants::Constant constant : {constants::Constant::Pi, constants::Constant::E}) {
+        for (unsigned threads : thread_counts) {
+            types::BigInteger value;
+            double series = seconds([&] { value = constants::scaled(constant, digits, threads); });
+            std::string text;
+            double decimal = seconds([&] { text = value.toString(); });
+            std::printf("%-8s %8u %10.3f %10.3f\n", constants::constant_name(constant).c_str(), threads, series, decimal);
+        }
+        std::string text;
+        double first = seconds([&] { text = constants::digits(constant, digits); });
+        double cached = seconds([&] { text = constants::digits(constant, digits / 2); });
+        std::printf("%-8s digits() %.3f s, then %.6f s for half as many from the cache, ending ...%s\n",
+            constants::constant_name(constant).c_str(), first, cached, text.substr(text.size() - 10).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/csv_input.h"
+#include "core/eval.h"
+
+// CSV input benchmark: writes a file of price,qty,disc,note rows (256 MiB by default, or the MiB given as the first
+// argument), then times price*qty*(1-disc) over it with one thread and with every core, against a plain pass that
+// only reads the bytes, with the output discarded.
+
+namespace {
+
+// Discards what is written, like /dev/null without the system calls
+class NullBuffer : public std::streambuf {
+protected:
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+    int_type overflow(int_type ch) override { return ch; }
+};
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+    const std::string path = "bench_csv_input.csv";
+    std::size_t bytes = 0;
+    {
+        std::ofstream file(path, std::ios::binary);
+        std::mt19937_64 engine(42);
+        std::uniform_int_distribution<int> cents(100, 99999), quantity(1, 500), discount(0, 30);
+        std::string chunk = "price,qty,disc,note\n";
+        char line[96];
+        while (bytes < megabytes << 20) {
+            int length = std::snprintf(line, sizeof(line), "%d.%02d,%d,0.%02d,item\n", cents(engine) / 100, cents(engine) % 100,
+                quantity(engine), discount(engine));
+            chunk.append(line, static_cast<std::size_t>(length));
+            if (chunk.size() > (1 << 20)) {
+                file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+                bytes += chunk.size();
+                chunk.clear();
+            }
+        }
+        file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        bytes += chunk.size();
+    }
+
+    // Reading every byte once, from the page cache, bounds the throughput
+    std::vector<char> buffer(1 << 20);
+    std::size_t lines = 0;
+    double read = seconds([&] {
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        for (std::size_t n; (n = std::fread(buffer.data(), 1, buffer.size(), file)) > 0; ) lines += std::count(buffer.data(), buffer.data() + n, '\n');
+        std::fclose(file);
+    });
+    std::printf("%.0f MiB, %zu rows\n", static_cast<double>(bytes) / (1 << 20), lines - 1);
+    std::printf("%-28s %8.3f s %8.2f GB/s\n", "read and count lines", read, static_cast<double>(bytes) / read / 1e9);
+
+    auto tree = eval::try_parse("price * qty * (1 - disc)").value();
+    NullBuffer null;
+    std::ostream discard(&null);
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    for (csv::OutputFormat format : {csv::OutputFormat::Csv, csv::OutputFormat::Binary}) {
+        std::vector<unsigned> thread_counts = {1};
+        if (cores > 1) thread_counts.push_back(cores);
+        for (unsigned threads : thread_counts) {
+            csv::CsvOptions options;
+            options.threads_ = threads;
+            options.format_ = format;
+            csv::CsvReport report;
+            double time = seconds([&] { report = csv::evaluate_file(path, *tree, discard, options); });
+            char label[64];
+            std::snprintf(label, sizeof(label), "%s output, %u threads", format == csv::OutputFormat::Csv ? "csv" : "binary", threads);
+            std::printf("%-28s %8.3f s %8.2f GB/s %8.1f ns/row\n", label, time, static_cast<double>(bytes) / time / 1e9,
+                time * 1e9 / static_cast<double>(report.rows_));
+        }
+    }
+    std::remove(path.c_str());
+    return 0;
+}
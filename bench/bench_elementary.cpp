@@ -0,0 +1,143 @@
+#include <cstdio>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "functional/elementary.h"
+
+// Elementary function benchmark: accuracy in ulp against long double, and throughput of libm called point by point,
+// of the fast kernels point by point, and of the fast array kernels (AVX2 if the CPU has it).
+
+namespace {
+
+constexpr double kSeconds = 0.3;
+constexpr std::size_t kPoints = 1 << 14;
+
+// Runs a sweep over all points repeatedly, returning nanoseconds per point
+template <typename Sweep>
+double time_per_point(Sweep sweep) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        sink += sweep();
+        count += kPoints;
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+// Distance from the long double reference, in ulp of the correctly rounded double
+long double ulps(double value, long double reference) {
+    double rounded = static_cast<double>(reference);
+    if (value == rounded || (std::isnan(value) && std::isnan(rounded))) return 0;
+    return std::fabs(value - reference) / (std::nextafter(std::fabs(rounded), INFINITY) - std::fabs(rounded));
+}
+
+struct Accuracy {
+    long double max_ = 0;
+    long double sum_ = 0;
+};
+
+void add(Accuracy& accuracy, double value, long double reference) {
+    long double error = ulps(value, reference);
+    accuracy.max_ = std::max(accuracy.max_, error);
+    accuracy.sum_ += error;
+}
+
+// One function: libm, the fast scalar kernel and the fast array kernel, with their references
+struct Case {
+    std::string name_;
+    std::vector<double> x_, y_; // y_ is used by pow only
+    double (*libm_)(double, double);
+    double (*fast_)(double, double);
+    void (*array_)(const double*, const double*, double*, std::size_t);
+    long double (*reference_)(long double, long double);
+};
+
+void run(const Case& c) {
+    const std::size_t n = c.x_.size();
+    std::vector<double> result(n);
+    Accuracy libm, fast, array;
+    c.array_(c.x_.data(), c.y_.data(), result.data(), n);
+    for (std::size_t i = 0; i < n; ++i) {
+        long double reference = c.reference_(c.x_[i], c.y_[i]);
+        add(libm, c.libm_(c.x_[i], c.y_[i]), reference);
+        add(fast, c.fast_(c.x_[i], c.y_[i]), reference);
+        add(array, result[i], reference);
+    }
+
+    double libm_ns = time_per_point([&] {
+        double sum = 0;
+        for (std::size_t i = 0; i < n; ++i) sum += c.libm_(c.x_[i], c.y_[i]);
+        return sum;
+    });
+    double fast_ns = time_per_point([&] {
+        double sum = 0;
+        for (std::size_t i = 0; i < n; ++i) sum += c.fast_(c.x_[i], c.y_[i]);
+        return sum;
+    });
+    double array_ns = time_per_point([&] {
+        c.array_(c.x_.data(), c.y_.data(), result.data(), n);
+        return result[n / 2];
+    });
+
+    auto mean = [n](const Accuracy& a) { return static_cast<double>(a.sum_ / n); };
+    std::printf("%-20s %6.2f %6.3f  %6.2f %6.3f  %6.2f %6.3f  %8.2f %8.2f %8.2f %7.1fx\n", c.name_.c_str(),
+        static_cast<double>(libm.max_), mean(libm), static_cast<double>(fast.max_), mean(fast),
+        static_cast<double>(array.max_), mean(array), libm_ns, fast_ns, array_ns, libm_ns / array_ns);
+}
+
+std::vector<double> uniform(double from, double to, std::mt19937_64& engine) {
+    std::uniform_real_distribution<double> distribution(from, to);
+    std::vector<double> values(kPoints);
+    for (double& value : values) value = distribution(engine);
+    return values;
+}
+
+} // namespace
+
+int main() {
+    std::mt19937_64 engine(42);
+    std::vector<double> none(kPoints);
+    std::vector<double> log_args = uniform(-300, 300, engine);
+    for (double& arg : log_args) arg = std::pow(10.0, arg);
+
+    std::vector<Case> cases = {
+        {"exp [-700, 700]", uniform(-700, 700, engine), none,
+            [](double x, double) { return std::exp(x); }, [](double x, double) { return elementary::fast::exp(x); },
+            [](const double* x, const double*, double* r, std::size_t n) { elementary::fast::evaluate(elementary::Function::Exp, x, r, n); },
+            [](long double x, long double) { return expl(x); }},
+        {"log [1e-300, 1e300]", log_args, none,
+            [](double x, double) { return std::log(x); }, [](double x, double) { return elementary::fast::log(x); },
+            [](const double* x, const double*, double* r, std::size_t n) { elementary::fast::evaluate(elementary::Function::Log, x, r, n); },
+            [](long double x, long double) { return logl(x); }},
+        {"sin [-100, 100]", uniform(-100, 100, engine), none,
+            [](double x, double) { return std::sin(x); }, [](double x, double) { return elementary::fast::sin(x); },
+            [](const double* x, const double*, double* r, std::size_t n) { elementary::fast::evaluate(elementary::Function::Sin, x, r, n); },
+            [](long double x, long double) { return sinl(x); }},
+        {"cos [-100, 100]", uniform(-100, 100, engine), none,
+            [](double x, double) { return std::cos(x); }, [](double x, double) { return elementary::fast::cos(x); },
+            [](const double* x, const double*, double* r, std::size_t n) { elementary::fast::evaluate(elementary::Function::Cos, x, r, n); },
+            [](long double x, long double) { return cosl(x); }},
+        {"pow [0,100]^[-50,50]", uniform(0, 100, engine), uniform(-50, 50, engine),
+            [](double x, double y) { return std::pow(x, y); }, [](double x, double y) { return elementary::fast::pow(x, y); },
+            [](const double* x, const double* y, double* r, std::size_t n) { elementary::fast::pow(x, y, r, n); },
+            [](long double x, long double y) { return powl(x, y); }},
+        {"sqrt [0, 1e6]", uniform(0, 1e6, engine), none,
+            [](double x, double) { return std::sqrt(x); }, [](double x, double) { return std::sqrt(x); },
+            [](const double* x, const double*, double* r, std::size_t n) { elementary::fast::evaluate(elementary::Function::Sqrt, x, r, n); },
+            [](long double x, long double) { return sqrtl(x); }},
+    };
+
+    std::printf("array kernels: %s\n", elementary::has_avx2() ? "AVX2" : "scalar");
+    std::cout << "                     libm ulp        fast ulp        array ulp       libm ns  fast ns  array ns  speedup\n"
+              << "function              max   mean     max   mean     max   mean\n";
+    for (const Case& c : cases) run(c);
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cstdio>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "functional/numbers.h"
+
+// Factorial benchmark: exact n! by prime swing and its decimal conversion, the accuracy of gamma against long double,
+// and the throughput of binomial queries answered from cached log-factorials against the scalar function.
+
+namespace {
+
+constexpr double kSeconds = 0.3;
+constexpr std::size_t kQueries = 1 << 14;
+constexpr std::uint64_t kMaxN = 1000000;
+
+// Runs a sweep over all queries repeatedly, returning nanoseconds per query
+template <typename Sweep>
+double time_per_query(Sweep sweep) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        sink += sweep();
+        count += kQueries;
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// Distance from the long double reference, in ulp of the correctly rounded double
+long double ulps(double value, long double reference) {
+    double rounded = static_cast<double>(reference);
+    if (value == rounded || (std::isnan(value) && std::isnan(rounded))) return 0;
+    return std::fabs(value - reference) / (std::nextafter(std::fabs(rounded), INFINITY) - std::fabs(rounded));
+}
+
+} // namespace
+
+int main() {
+    std::cout << "exact n!        product s   decimal s     digits\n";
+    for (std::uint64_t n : {10000ull, 100000ull, 1000000ull}) {
+        types::BigInteger value;
+        double product = seconds([&] { value = numbers::factorial_exact(n); });
+        std::size_t digits = 0;
+        double decimal = seconds([&] { digits = value.toString().size(); });
+        std::printf("%-12llu %11.4f %11.4f %10zu\n", static_cast<unsigned long long>(n), product, decimal, digits);
+    }
+
+    std::mt19937_64 engine(42);
+    std::uniform_real_distribution<double> argument(-170, 171.5);
+    long double worst = 0, total = 0;
+    for (std::size_t i = 0; i < kQueries; ++i) {
+        double x = argument(engine);
+        long double error = ulps(numbers::gamma(x), tgammal(x));
+        worst = std::max(worst, error);
+        total += error;
+    }
+    std::printf("\ngamma on [-170, 171.5]: max %.2f ulp, mean %.3f ulp\n", static_cast<double>(worst), static_cast<double>(total / kQueries));
+
+    std::vector<std::uint64_t> n(kQueries), k(kQueries);
+    std::uniform_int_distribution<std::uint64_t> upper(0, kMaxN);
+    for (std::size_t i = 0; i < kQueries; ++i) {
+        n[i] = upper(engine);
+        k[i] = std::uniform_int_distribution<std::uint64_t>(0, n[i])(engine) % 200; // Mostly finite values
+    }
+    numbers::BinomialTable table(0);
+    double build = seconds([&] { table = numbers::BinomialTable(kMaxN); });
+    std::vector<double> result(kQueries);
+    double scalar_ns = time_per_query([&] {
+        double sum = 0;
+        for (std::size_t i = 0; i < kQueries; ++i) sum += numbers::binomial(static_cast<double>(n[i]), static_cast<double>(k[i]));
+        return sum;
+    });
+    double table_ns = time_per_query([&] {
+        table.evaluate(n.data(), k.data(), result.data(), kQueries);
+        return result[kQueries / 2];
+    });
+    std::printf("binomials up to n = %llu: table built in %.4f s, scalar %.1f ns, table %.1f ns per query (%.1fx)\n",
+        static_cast<unsigned long long>(kMaxN), build, scalar_ns, table_ns, scalar_ns / table_ns);
+    return 0;
+}
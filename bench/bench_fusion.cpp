@@ -0,0 +1,65 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "core/eval.h"
+#include "core/fusion_pass.h"
+
+// Fusion benchmark: a sum of 50 terms of the forms a*b + c, x*k, x + k and x/k (or the number given as the first
+// argument), which reads a symbol every few operations, and a chain of as many steps y*0.5 + k/4 in Horner form, which
+// reads one, each evaluated with evaluateChecked at 10^5 values of x and y before and after fusion::fuse_operations.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int terms = argc > 1 ? std::atoi(argv[1]) : 50;
+    const std::size_t points = 100000;
+    std::string expression = "0";
+    for (int k = 1; k <= terms; ++k) {
+        std::string n = std::to_string(k);
+        expression += " + x*" + n + " * (y + " + n + ") - z/4 + (x - " + n + ") * y";
+    }
+    std::string chain = "y";
+    for (int k = 1; k <= terms; ++k) chain = "(" + chain + ") * 0.5 + " + std::to_string(k) + "/4";
+
+    bool agree = true;
+    for (const auto& [name, text] : {std::pair<const char*, const std::string&>{"terms", expression}, {"chain", chain}}) {
+        auto plain = eval::try_parse(text).value();
+        auto fused = plain->clone();
+        fusion::FusionCounts counts = fusion::fuse_operations(fused);
+
+        SymbolTable symbols{{"x", 0}, {"y", 0.7}, {"z", -0.2}};
+        auto run = [&](const expr::ExprNode& tree, double& sum) {
+            return seconds([&] {
+                for (std::size_t i = 0; i < points; ++i) {
+                    symbols.insert_or_assign("x", -2 + 4 * static_cast<double>(i) / points);
+                    symbols.insert_or_assign("y", 2 - 4 * static_cast<double>(i) / points);
+                    expr::EvalStatus status;
+                    sum += tree.evaluateChecked(symbols, status);
+                }
+            });
+        };
+        double plain_sum = 0, fused_sum = 0;
+        double plain_time = run(*plain, plain_sum);
+        double fused_time = run(*fused, fused_sum);
+
+        std::printf("%s: %zu rewrites, %zu fma, %zu scaled, %zu shifted, %zu reciprocals\n", name, counts.total(),
+            counts.fma_, counts.scaled_, counts.shifted_, counts.reciprocals_);
+        std::printf("  %-8s %8.3f s %8.2f M evaluations/s\n", "plain", plain_time, static_cast<double>(points) / plain_time / 1e6);
+        std::printf("  %-8s %8.3f s %8.2f M evaluations/s\n", "fused", fused_time, static_cast<double>(points) / fused_time / 1e6);
+        const double relative = std::fabs(fused_sum - plain_sum) / std::fabs(plain_sum);
+        std::printf("  speedup %.2fx, relative difference of the sums %.1e\n", plain_time / fused_time, relative);
+        agree = agree && relative < 1e-12;
+    }
+    return agree ? 0 : 1;
+}
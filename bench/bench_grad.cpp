@@ -0,0 +1,94 @@
+#include <cmath>
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/eval.h"
+#include "core/grad.h"
+#include "core/parser.h"
+#include "utils/symbol_table.h"
+
+// Gradient benchmark: central finite differences through evaluateAt (2N evaluations) against forward mode
+// (N dual evaluations) and reverse mode (one recorded evaluation and one sweep), for N variables.
+
+namespace {
+
+constexpr double kSeconds = 0.5;
+
+// Runs a gradient computation repeatedly, returning nanoseconds per gradient
+template <typename Compute>
+double time_per_gradient(Compute compute) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        for (int i = 0; i < 16; ++i, ++count) sink += compute();
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::size_t> variable_counts = {2, 8, 32, 128};
+    if (argc > 1) {
+        variable_counts.clear();
+        for (int i = 1; i < argc; ++i) variable_counts.push_back(std::stoul(argv[i]));
+    }
+
+    std::cout << "variables  tape-size   finite-diff ns  max-error     forward ns   reverse ns   reverse/eval\n";
+    for (std::size_t n : variable_counts) {
+        // sum of (x_i - i)^2 / 2 + x_i * x_{i+1} / (1 + x_i * x_i)
+        std::string expression;
+        std::vector<types::Symbol> variables;
+        SymbolTable symbols;
+        for (std::size_t i = 0; i < n; ++i) {
+            std::string x = "x" + std::to_string(i);
+            std::string next = "x" + std::to_string((i + 1) % n);
+            std::string c = std::to_string(i);
+            if (i) expression += " + ";
+            expression += "(" + x + "-" + c + ")*(" + x + "-" + c + ")*0.5 + " + x + "*" + next + "/(1 + " + x + "*" + x + ")";
+            variables.push_back(x);
+            symbols.insert_or_assign(x, 0.5 + 0.01 * i);
+        }
+        auto tokens = parser::tokenize(expression);
+        auto tree = eval::build_expr_tree(tokens.begin(), tokens.end());
+
+        // Central differences, the way gradients were estimated before
+        std::unordered_map<types::Symbol, types::Numeral> at;
+        std::vector<types::Numeral> differences(n);
+        auto finite_difference = [&] {
+            for (std::size_t i = 0; i < n; ++i) {
+                types::Numeral x = symbols.at(variables[i]);
+                types::Numeral h = 1e-6 * std::max(1.0, std::fabs(x));
+                at[variables[i]] = x + h;
+                types::Numeral up = tree->evaluateAt(symbols, at);
+                at[variables[i]] = x - h;
+                types::Numeral down = tree->evaluateAt(symbols, at);
+                at.erase(variables[i]);
+                differences[i] = (up - down) / (2 * h);
+            }
+            return differences[0];
+        };
+        expr::Tape tape;
+        double evaluate_ns = time_per_gradient([&] { return tree->evaluate(symbols); });
+        double finite_ns = time_per_gradient(finite_difference);
+        double forward_ns = time_per_gradient([&] { return grad::forward(*tree, symbols, variables).partials_[0]; });
+        double reverse_ns = time_per_gradient([&] { return grad::reverse(*tree, symbols, variables, &tape).partials_[0]; });
+
+        grad::Gradient exact = grad::reverse(*tree, symbols, variables);
+        finite_difference();
+        double max_error = 0;
+        for (std::size_t i = 0; i < n; ++i) max_error = std::max(max_error, std::fabs(differences[i] - exact.partials_[i]));
+
+        std::printf("%9zu  %9zu  %15.0f  %9.2e  %13.0f  %11.0f  %13.1fx\n", n, tape.size(),
+            finite_ns, max_error, forward_ns, reverse_ns, reverse_ns / evaluate_ns);
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "core/eval.h"
+#include "core/matrix_eval.h"
+#include "functional/elementary.h"
+#include "functional/linalg.h"
+
+// Linear algebra benchmark: GFLOP/s of n x n products by the triple loop and by linalg::multiply on one thread and on
+// every hardware thread, for n up to 1024 (or the number given as the first argument); of linalg::lu_factor; and the
+// time of `A*2 + B - A/4` over 1000 x 1000 matrices by matrix_eval::evaluate, which fuses it into one pass, against
+// the same chain computed an operation at a time into temporaries.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+std::vector<double> filled(std::size_t size, std::size_t seed) {
+    std::vector<double> values(size);
+    for (std::size_t i = 0; i < size; ++i) values[i] = static_cast<double>((i * 7919 + seed * 104729) % 2003) / 1001.0 - 1;
+    return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t largest = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1024;
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("AVX2 kernel: %s, %u hardware threads\n", elementary::has_avx2() ? "yes" : "no", threads);
+    std::printf("%6s %12s %12s %12s %12s %10s\n", "n", "naive", "blocked", "threaded", "lu", "max error");
+
+    for (std::size_t n = 64; n <= largest; n *= 2) {
+        auto a = filled(n * n, 1), b = filled(n * n, 2);
+        std::vector<double> naive(n * n), blocked(n * n), threaded(n * n);
+        const double flops = 2.0 * static_cast<double>(n) * static_cast<double>(n) * static_cast<double>(n);
+        const int repeats = static_cast<int>(std::max<std::size_t>(1, (std::size_t(1) << 27) / (n * n * n)));
+
+        double naive_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    for (std::size_t j = 0; j < n; ++j) {
+                        double sum = 0;
+                        for (std::size_t p = 0; p < n; ++p) sum += a[i * n + p] * b[p * n + j];
+                        naive[i * n + j] = sum;
+                    }
+                }
+            }
+        });
+        double blocked_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) linalg::multiply(a.data(), b.data(), blocked.data(), n, n, n, 1);
+        });
+        double threaded_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) linalg::multiply(a.data(), b.data(), threaded.data(), n, n, n, threads);
+        });
+        std::vector<double> lu;
+        std::vector<std::size_t> pivots(n);
+        double lu_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                lu = a;
+                for (std::size_t i = 0; i < n; ++i) lu[i * n + i] += 4;
+                linalg::lu_factor(lu.data(), n, pivots.data());
+            }
+        });
+
+        double error = 0;
+        for (std::size_t i = 0; i < n * n; ++i) error = std::max(error, std::fabs(blocked[i] - naive[i]) + std::fabs(threaded[i] - blocked[i]));
+        auto gflops = [&](double flop_count, double time) { return flop_count * repeats / time / 1e9; };
+        std::printf("%6zu %7.2f GF/s %7.2f GF/s %7.2f GF/s %7.2f GF/s %10.1e\n", n, gflops(flops, naive_time),
+            gflops(flops, blocked_time), gflops(flops, threaded_time), gflops(flops / 3, lu_time), error);
+    }
+
+    // Element-wise chain, fused against a pass per operation
+    const std::size_t side = 1000, size = side * side;
+    dispatcher::Bindings values = {{"A", types::Matrix(side, side, filled(size, 3))}, {"B", types::Matrix(side, side, filled(size, 4))}};
+    auto tree = eval::try_parse("A*2 + B - A/4").value();
+    const int repeats = 20;
+    dispatcher::Result fused;
+    double fused_time = seconds([&] {
+        for (int r = 0; r < repeats; ++r) fused = matrix_eval::evaluate(*tree, {}, values);
+    });
+    const double* a = std::get<types::Matrix>(values["A"]).data();
+    const double* b = std::get<types::Matrix>(values["B"]).data();
+    std::vector<double> result;
+    double unfused_time = seconds([&] {
+        for (int r = 0; r < repeats; ++r) {
+            std::vector<double> scaled(size), sum(size), quarter(size);
+            for (std::size_t i = 0; i < size; ++i) scaled[i] = a[i] * 2;
+            for (std::size_t i = 0; i < size; ++i) sum[i] = scaled[i] + b[i];
+            for (std::size_t i = 0; i < size; ++i) quarter[i] = a[i] / 4;
+            result.resize(size);
+            for (std::size_t i = 0; i < size; ++i) result[i] = sum[i] - quarter[i];
+        }
+    });
+    const double* f = std::get<types::Matrix>(fused).data();
+    bool same = true;
+    for (std::size_t i = 0; i < size; ++i) same = same && f[i] == result[i];
+    std::printf("A*2 + B - A/4 over %zux%zu: fused %.2f ms, a pass per operation %.2f ms (%.2fx), %s\n", side, side,
+        fused_time / repeats * 1e3, unfused_time / repeats * 1e3, unfused_time / fused_time, same ? "same values" : "VALUES DIFFER");
+    return same ? 0 : 1;
+}
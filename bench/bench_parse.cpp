@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+#include "core/eval.h"
+#include "core/parser.h"
+
+// Parse benchmark: one generated expression of 20 MiB (or the MiB given as the first argument), a sum of bracketed
+// groups of terms as emitted by code generators, tokenized, built from the tokens and parsed sequentially, then with
+// try_parse_parallel on 1, 8 and 64 threads, checking that every tree is the sequential one.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+bool same_tree(const expr::ExprNode& a, const expr::ExprNode& b) {
+    if (typeid(a) != typeid(b) || a.getPosition() != b.getPosition() || a.childCount() != b.childCount()) return false;
+    for (std::size_t i = 0; i < a.childCount(); ++i) {
+        if (!same_tree(*a.child(i), *b.child(i))) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20;
+    const char* terms[] = {"1.25 * x ^ 2", "sin(y + 0.5) * x", "-(x - 3) / 7", "if(x < y, x, y)", "sqrt(x * x + y * y)",
+        "pow(x, 3) - 2 * y", "exp(-x) * 4.5", "(x + 1) * (y - 1)"};
+    std::string expression;
+    for (std::size_t group = 0; expression.size() < megabytes << 20; ++group) {
+        if (group > 0) expression += " + ";
+        expression += "c" + std::to_string(group % 100) + " * (";
+        for (std::size_t k = 0; k < 64; ++k) expression += std::string(k > 0 ? (k % 3 ? " + " : " - ") : "") + terms[(group + k) % 8];
+        expression += ")";
+    }
+    std::printf("%.1f MiB expression, %u cores\n", static_cast<double>(expression.size()) / (1 << 20),
+        std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<std::size_t> positions;
+    {
+        std::vector<parser::Token> tokens;
+        double tokenize = seconds([&] { tokens = parser::try_tokenize(expression, &positions).value(); });
+        std::printf("%-24s %8.3f s %8.1f MB/s, %zu tokens\n", "try_tokenize", tokenize, static_cast<double>(expression.size()) / tokenize / 1e6,
+            tokens.size());
+        double build = seconds([&] { eval::try_build_expr_tree(tokens.begin(), tokens.end(), positions.data()).value(); });
+        std::printf("%-24s %8.3f s %8.1f M tokens/s\n", "try_build_expr_tree", build, static_cast<double>(tokens.size()) / build / 1e6);
+    }
+    std::unique_ptr<expr::ExprNode> sequential;
+    double parse = seconds([&] { sequential = eval::try_parse(expression).value(); });
+    std::printf("%-24s %8.3f s %8.1f MB/s\n", "try_parse", parse, static_cast<double>(expression.size()) / parse / 1e6);
+
+    for (unsigned threads : {1u, 8u, 64u}) {
+        double tokens = seconds([&] { parser::try_tokenize_parallel(expression, threads, &positions); });
+        std::unique_ptr<expr::ExprNode> tree;
+        double time = seconds([&] { tree = eval::try_parse_parallel(expression, threads).value(); });
+        char label[64];
+        std::snprintf(label, sizeof(label), "parallel, %u threads", threads);
+        std::printf("%-24s %8.3f s %8.1f MB/s, %.2fx, tokenize %.3f s, %s tree\n", label, time,
+            static_cast<double>(expression.size()) / time / 1e6, parse / time, tokens,
+            same_tree(*tree, *sequential) ? "same" : "DIFFERENT");
+    }
+    return 0;
+}
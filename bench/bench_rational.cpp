@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include "core/eval.h"
+#include "core/typed_program.h"
+#include "data/rational.h"
+
+// Exact arithmetic benchmark: types::Rational against double, for small values that stay inline (the common case),
+// through an expression in bulk, and for a harmonic sum whose terms spill to big integers.
+
+namespace {
+
+constexpr double kSeconds = 0.5;
+constexpr std::size_t kValues = 4096;
+
+// Runs a loop over kValues repeatedly, returning nanoseconds per value
+template <typename Loop>
+double time_per_value(Loop loop) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        sink += loop();
+        count += kValues;
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+// Arithmetic of the kind prices and shares see: small numerators over small denominators
+template <typename T>
+double arithmetic(const std::vector<T>& a, const std::vector<T>& b) {
+    T sum = 0;
+    for (std::size_t i = 0; i < kValues; ++i) sum = sum + a[i] * b[i] - a[i] / b[i];
+    if constexpr (std::is_same_v<T, types::Rational>) return sum.toDouble();
+    else return sum;
+}
+
+template <typename T>
+double bulk(const typed::Program<T>& program, const std::vector<T>& x, const std::vector<T>& y, std::vector<T>& results) {
+    const T* columns[] = {x.data(), y.data()};
+    program.evaluateBulk(columns, kValues, results.data());
+    if constexpr (std::is_same_v<T, types::Rational>) return results[kValues / 2].toDouble();
+    else return results[kValues / 2];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<types::Rational> ra(kValues), rb(kValues), results(kValues);
+    std::vector<double> da(kValues), db(kValues), dresults(kValues);
+    for (std::size_t i = 0; i < kValues; ++i) {
+        auto numerator = static_cast<std::int64_t>(i % 97 + 1), denominator = static_cast<std::int64_t>(i % 8 + 1);
+        ra[i] = types::Rational(numerator, denominator);
+        rb[i] = types::Rational(denominator, 4);
+        da[i] = static_cast<double>(numerator) / static_cast<double>(denominator);
+        db[i] = static_cast<double>(denominator) / 4;
+    }
+
+    std::cout << "case                          double ns   rational ns   ratio\n";
+    // The running sum's denominator stays at 840 (lcm of 1..8), so every operation stays inline
+    double double_ns = time_per_value([&] { return arithmetic(da, db); });
+    double rational_ns = time_per_value([&] { return arithmetic(ra, rb); });
+    std::printf("%-28s  %9.2f  %12.2f  %6.1fx\n", "a*b - a/b, summed", double_ns, rational_ns, rational_ns / double_ns);
+
+    auto tree = eval::try_parse("(x + 1/3) * y - x / 7 + if(x > y, 1/2, 0)");
+    typed::Program<double> double_program(*tree.value());
+    typed::Program<types::Rational> rational_program(*tree.value());
+    double_ns = time_per_value([&] { return bulk(double_program, da, db, dresults); });
+    rational_ns = time_per_value([&] { return bulk(rational_program, ra, rb, results); });
+    std::printf("%-28s  %9.2f  %12.2f  %6.1fx\n", "expression, bulk", double_ns, rational_ns, rational_ns / double_ns);
+
+    // Harmonic numbers outgrow 64 bits past H_46, so the tail runs on big integers
+    std::cout << "\nterms   harmonic ns/term   inline\n";
+    for (std::int64_t n : {20, 40, 80, 160, 320}) {
+        types::Rational harmonic;
+        auto begin = std::chrono::steady_clock::now();
+        for (std::int64_t k = 1; k <= n; ++k) harmonic += types::Rational(1, k);
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - begin).count() / n;
+        std::printf("%5lld   %16.1f   %s\n", static_cast<long long>(n), ns, harmonic.isInline() ? "yes" : "no");
+    }
+    return 0;
+}
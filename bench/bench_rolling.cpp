@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "functional/stats.h"
+
+// Rolling statistics benchmark: mean, sd, min, max and median over a window of 1000 samples (or the window given as
+// the first argument) of 10^6 samples, with the accumulators of functional/stats against recomputing every window.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t window = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000;
+    const std::size_t count = 1000000;
+    std::vector<double> samples(count);
+    std::mt19937_64 engine(42);
+    std::normal_distribution<double> normal(100, 15);
+    for (double& sample : samples) sample = normal(engine);
+
+    double checksum = 0;
+    double incremental = seconds([&] {
+        stats::RollingMoments moments(window);
+        stats::RollingExtremes extremes(window);
+        stats::RollingMedian median(window);
+        for (double sample : samples) {
+            moments.add(sample);
+            extremes.add(sample);
+            median.add(sample);
+            checksum += moments.mean() + moments.stddev() + extremes.min() + extremes.max() + median.median();
+        }
+    });
+
+    // Recomputing is O(window) per sample, so time a slice and scale it
+    const std::size_t slice = std::min(count, std::max<std::size_t>(window, 20000000 / window));
+    double naive_checksum = 0;
+    double naive = seconds([&] {
+        std::vector<double> sorted;
+        for (std::size_t i = 0; i < slice; ++i) {
+            std::size_t first = i + 1 > window ? i + 1 - window : 0;
+            double n = static_cast<double>(i + 1 - first), sum = 0, squares = 0;
+            for (std::size_t j = first; j <= i; ++j) sum += samples[j];
+            double mean = sum / n;
+            for (std::size_t j = first; j <= i; ++j) squares += (samples[j] - mean) * (samples[j] - mean);
+            sorted.assign(samples.begin() + static_cast<std::ptrdiff_t>(first), samples.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+            std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(sorted.size() / 2), sorted.end());
+            auto [low, high] = std::minmax_element(samples.begin() + static_cast<std::ptrdiff_t>(first), samples.begin() + static_cast<std::ptrdiff_t>(i) + 1);
+            naive_checksum += mean + (n > 1 ? std::sqrt(squares / (n - 1)) : 0) + *low + *high + sorted[sorted.size() / 2];
+        }
+    }) * static_cast<double>(count) / static_cast<double>(slice);
+
+    std::printf("%zu samples, window %zu\n", count, window);
+    std::printf("%-22s %8.3f s %8.1f M samples/s\n", "incremental", incremental, static_cast<double>(count) / incremental / 1e6);
+    std::printf("%-22s %8.3f s %8.3f M samples/s (from %zu samples)\n", "recompute each window", naive,
+        static_cast<double>(count) / naive / 1e6, slice);
+    std::printf("speedup %.0fx (%g, %g)\n", naive / incremental, checksum, naive_checksum);
+    return 0;
+}
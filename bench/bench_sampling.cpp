@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+#include "core/eval.h"
+#include "core/sampling.h"
+#include "functional/random.h"
+
+// Monte Carlo benchmark: draws 10^7 uniform and normal deviates (or the number given as the first argument) from the Philox
+// streams against std::mt19937_64 with std::normal_distribution, then summarizes exp(x) * (1 + y) over as many samples
+// with one thread and with every core, checking that the summaries are the same bits.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::uint64_t samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    std::vector<double> values(sampling::kSampleBlock);
+    double sink = 0;
+
+    double uniform = seconds([&] {
+        for (std::uint64_t first = 0; first < samples; first += values.size()) {
+            prng::uniform(1, 0, first, values.size(), values.data());
+            sink += values[0];
+        }
+    });
+    double philox = seconds([&] {
+        for (std::uint64_t first = 0; first < samples; first += values.size()) {
+            prng::normal(1, 0, first, values.size(), values.data());
+            sink += values[0];
+        }
+    });
+    double library = seconds([&] {
+        std::mt19937_64 engine(1);
+        std::normal_distribution<double> normal;
+        for (std::uint64_t first = 0; first < samples; first += values.size()) {
+            for (double& value : values) value = normal(engine);
+            sink += values[0];
+        }
+    });
+    std::printf("%-30s %8.3f s %8.1f M/s\n", "philox uniform", uniform, static_cast<double>(samples) / uniform / 1e6);
+    std::printf("%-30s %8.3f s %8.1f M/s\n", "philox normal", philox, static_cast<double>(samples) / philox / 1e6);
+    std::printf("%-30s %8.3f s %8.1f M/s\n", "mt19937_64 normal_distribution", library, static_cast<double>(samples) / library / 1e6);
+
+    auto tree = eval::try_parse("exp(x) * (1 + y)").value();
+    std::vector<std::pair<types::Symbol, sampling::Distribution>> distributions{
+        sampling::parse_distribution("x ~ normal(0, 0.25)"), sampling::parse_distribution("y ~ uniform(0, 1)")};
+    const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> thread_counts = {1};
+    if (cores > 1) thread_counts.push_back(cores);
+    std::vector<double> means;
+    for (unsigned threads : thread_counts) {
+        sampling::SamplingOptions options;
+        options.samples_ = samples;
+        options.threads_ = threads;
+        sampling::SamplingSummary summary{stats::Moments(), stats::QuantileSketch(), 0};
+        double elapsed = seconds([&] { summary = sampling::sample(*tree, distributions, {}, options); });
+        means.push_back(summary.moments_.mean());
+        std::printf("sample, %2u threads %11s %8.3f s %8.1f M/s  mean %.17g  p99 %.6g\n", threads, "", elapsed,
+            static_cast<double>(samples) / elapsed / 1e6, summary.moments_.mean(), summary.quantiles_.quantile(0.99));
+    }
+    bool same = std::all_of(means.begin(), means.end(), [&](double mean) { return mean == means.front(); });
+    std::printf("summaries %s across thread counts (%g)\n", same ? "identical" : "DIFFER", sink);
+    return same ? 0 : 1;
+}
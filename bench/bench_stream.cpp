@@ -0,0 +1,83 @@
+#include <sys/resource.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include "core/eval.h"
+
+// Streamed evaluation benchmark: a sum of 20000 terms (or the number given as the first argument), 50 bytes each, read
+// with eval::evaluate_stream from a stream that generates it as it goes, then held in a string, parsed into a tree with
+// eval::try_parse and evaluated. The peak resident memory is sampled after each. The tree is skipped past 20000 terms,
+// as its recursive evaluation overflows the stack of a sum some 10^5 terms long; the stream has no such limit.
+
+namespace {
+
+constexpr std::size_t kTreeTerms = 20000; // Longest sum parsed into a tree
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+// A stream buffer giving the same term a number of times, as a pipe would
+class RepeatBuffer : public std::streambuf {
+private:
+    std::string term_;
+    std::size_t left_;
+
+protected:
+    int_type underflow() override {
+        if (left_ == 0) return traits_type::eof();
+        --left_;
+        setg(term_.data(), term_.data(), term_.data() + term_.size());
+        return traits_type::to_int_type(term_[0]);
+    }
+
+public:
+    RepeatBuffer(std::string term, std::size_t count) : term_(std::move(term)), left_(count) {}
+};
+
+double peak_megabytes() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<double>(usage.ru_maxrss) / 1024;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t terms = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kTreeTerms;
+    const std::string term = "+ sin(x * 0.5) * (1 - x / 3) - (x + 1)^2 / 7.25 ";
+    const double megabytes = static_cast<double>(term.size() * terms) / 1e6;
+    SymbolTable symbols{{"x", 0.3}};
+
+    RepeatBuffer buffer(term, terms);
+    std::istream in(&buffer);
+    eval::StreamStats stats;
+    types::Expected<types::Numeral> streamed = types::Error{};
+    double stream_time = seconds([&] { streamed = eval::evaluate_stream(in, symbols, nullptr, expr::NumericMode::Strict, &stats); });
+    const double stream_peak = peak_megabytes();
+    std::printf("%.1f MB, %llu tokens, at most %zu operators and values held\n", megabytes,
+        static_cast<unsigned long long>(stats.tokens_), stats.depth_);
+    std::printf("%-8s %8.3f s %8.1f MB/s, peak resident %8.1f MB\n", "stream", stream_time, megabytes / stream_time, stream_peak);
+    if (terms > kTreeTerms) return streamed ? 0 : 1;
+
+    std::string expression;
+    expression.reserve(term.size() * terms);
+    for (std::size_t i = 0; i < terms; ++i) expression += term;
+    types::Expected<types::Numeral> evaluated = types::Error{};
+    double tree_time = seconds([&] {
+        auto tree = eval::try_parse(expression);
+        if (tree) evaluated = eval::try_evaluate(*tree.value(), symbols);
+    });
+    const double tree_peak = peak_megabytes();
+
+    const bool same = streamed && evaluated && streamed.value() == evaluated.value();
+    std::printf("%-8s %8.3f s %8.1f MB/s, peak resident %8.1f MB\n", "tree", tree_time, megabytes / tree_time, tree_peak);
+    std::printf("values %s\n", same ? "identical" : "DIFFER");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "functional/stats.h"
+
+// Summation benchmark: ns per value of summing 10^7 doubles (or the number given as the first argument) by the naive
+// loop, by a Neumaier-compensated loop, and by stats::ExactSum one value at a time and by arrays, and of
+// stats::Moments by arrays against a naive loop of the sums of the values and of their squares, for values in [0, 1)
+// and values spread over 2^-30 to 2^30 with both signs; then the exact sum of the values reversed and split over 1 to
+// 8 threads merged in turn, which must be the same bits.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+std::vector<double> generate(std::size_t count, bool spread) {
+    std::vector<double> values(count);
+    std::uint64_t state = 7;
+    for (auto& value : values) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        const double unit = static_cast<double>(state >> 11) / 9007199254740992.0;
+        value = spread ? std::ldexp(unit, static_cast<int>(state % 61) - 30) * (state & 1024 ? 1 : -1) : unit;
+    }
+    return values;
+}
+
+double exact_sum(const std::vector<double>& values, unsigned threads) {
+    std::vector<stats::ExactSum> sums(threads);
+    std::vector<std::thread> workers;
+    const std::size_t part = (values.size() + threads - 1) / threads;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            const std::size_t first = std::min(values.size(), t * part);
+            sums[t].add(values.data() + first, std::min(part, values.size() - first));
+        });
+    }
+    for (auto& worker : workers) worker.join();
+    for (unsigned t = 1; t < threads; ++t) sums[0].merge(sums[t]);
+    return sums[0].value();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    const int repeats = 5;
+    std::printf("%-8s %10s %12s %12s %12s %7s %12s %12s %7s\n", "values", "naive", "compensated", "exact each", "exact array",
+        "ratio", "naive sum^2", "moments", "ratio");
+
+    bool same = true;
+    for (bool spread : {false, true}) {
+        const std::vector<double> values = generate(count, spread);
+        double naive = 0, compensated = 0, each = 0, array = 0, sum = 0, squares = 0;
+        stats::Moments moments;
+        double naive_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                double total = 0;
+                for (double value : values) total += value;
+                naive = total;
+            }
+        });
+        double compensated_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                double total = 0, compensation = 0;
+                for (double value : values) {
+                    double next = total + value;
+                    compensation += std::fabs(total) >= std::fabs(value) ? (total - next) + value : (value - next) + total;
+                    total = next;
+                }
+                compensated = total + compensation;
+            }
+        });
+        double each_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                stats::ExactSum exact;
+                for (double value : values) exact.add(value);
+                each = exact.value();
+            }
+        });
+        double array_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                stats::ExactSum exact;
+                exact.add(values.data(), values.size());
+                array = exact.value();
+            }
+        });
+        double squares_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                sum = squares = 0;
+                for (double value : values) {
+                    sum += value;
+                    squares += value * value;
+                }
+            }
+        });
+        double moments_time = seconds([&] {
+            for (int r = 0; r < repeats; ++r) {
+                moments = stats::Moments();
+                moments.add(values.data(), values.size());
+            }
+        });
+        auto ns = [&](double time) { return time / repeats / static_cast<double>(count) * 1e9; };
+        std::printf("%-8s %7.2f ns %9.2f ns %9.2f ns %9.2f ns %6.2fx %9.2f ns %9.2f ns %6.2fx\n", spread ? "spread" : "[0, 1)",
+            ns(naive_time), ns(compensated_time), ns(each_time), ns(array_time), array_time / naive_time, ns(squares_time),
+            ns(moments_time), moments_time / squares_time);
+        same = same && each == array && std::fabs(compensated - array) <= 1e-12 * std::fabs(array)
+            && std::fabs(moments.mean() - sum / static_cast<double>(count)) <= 1e-9 * std::fabs(moments.mean());
+        std::printf("%-8s exact sum %.17g, naive %.17g\n", "", array, naive);
+    }
+
+    // Order and thread count
+    std::vector<double> values = generate(count, true);
+    const double forward = exact_sum(values, 1);
+    std::reverse(values.begin(), values.end());
+    bool stable = true;
+    for (unsigned threads = 1; threads <= 8; ++threads) stable = stable && exact_sum(values, threads) == forward;
+    double naive_reversed = 0;
+    for (double value : values) naive_reversed += value;
+    std::printf("reversed and over 1 to 8 threads: %s (the naive sum moves by %.3g)%s\n", stable ? "same bits" : "BITS DIFFER",
+        naive_reversed - forward, same ? "" : ", VALUES DIFFER");
+    return same && stable ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/eval.h"
+#include "core/incremental.h"
+
+// Parameter sweep benchmark: a formula of 200 terms in y and z (or the number given as the first argument) plus a few
+// nodes in x, evaluated at 10^5 values of x with evaluateAt on the whole tree, and with incremental::Evaluator.
+
+namespace {
+
+template <typename Function>
+double seconds(Function function) {
+    auto begin = std::chrono::steady_clock::now();
+    function();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int terms = argc > 1 ? std::atoi(argv[1]) : 200;
+    const std::size_t points = 100000;
+    std::string expression = "x * x - 3 * x"; // Deepest in the left-associative sums, so the path to the root is long
+    for (int k = 1; k <= terms; ++k) {
+        expression += " + sin(y * " + std::to_string(k) + ") * cos(z + " + std::to_string(k) + ") / " + std::to_string(k);
+    }
+    auto tree = eval::try_parse(expression).value();
+    SymbolTable symbols{{"y", 0.7}, {"z", -0.2}};
+
+    double full_sum = 0;
+    double full = seconds([&] {
+        std::unordered_map<types::Symbol, types::Numeral> variables{{"x", 0}};
+        for (std::size_t i = 0; i < points; ++i) {
+            variables["x"] = incremental::sweep_point(-2, 2, points, i);
+            full_sum += tree->evaluateAt(symbols, variables);
+        }
+    });
+
+    incremental::Evaluator evaluator(*tree, symbols);
+    double incremental_sum = 0;
+    double swept = seconds([&] {
+        for (const auto& value : evaluator.sweep("x", -2, 2, points)) incremental_sum += value.value();
+    });
+
+    std::printf("%zu nodes, %zu recomputed per point, %zu points\n", evaluator.nodes(), evaluator.recomputed(), points);
+    std::printf("%-12s %8.3f s %8.2f M points/s\n", "evaluateAt", full, static_cast<double>(points) / full / 1e6);
+    std::printf("%-12s %8.3f s %8.2f M points/s\n", "incremental", swept, static_cast<double>(points) / swept / 1e6);
+    std::printf("speedup %.1fx, sums %s\n", full / swept, full_sum == incremental_sum ? "identical" : "DIFFER");
+    return full_sum == incremental_sum ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include <cstdio>
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/eval.h"
+#include "core/parser.h"
+#include "utils/symbol_table.h"
+#include "utils/versioned_symbol_table.h"
+
+// Contention benchmark: one writer keeps updating the symbols while N readers evaluate an expression.
+// Compares the lock-free VersionedSymbolTable against a SymbolTable guarded by a std::shared_mutex.
+
+namespace {
+
+constexpr double kSeconds = 1.0;
+
+struct RunResult {
+    double reads_per_second_;
+    double writes_per_second_;
+};
+
+template <typename Read, typename Write>
+RunResult run(unsigned readers, Read read, Write write) {
+    std::atomic<bool> stop{false};
+    std::vector<std::uint64_t> reads(readers, 0);
+    std::uint64_t writes = 0;
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < readers; ++i) {
+        threads.emplace_back([&, i] {
+            std::uint64_t count = 0;
+            double sink = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                sink += read();
+                ++count;
+            }
+            reads[i] = count + (sink == -1.0); // Keep the evaluation observable
+        });
+    }
+    threads.emplace_back([&] {
+        std::uint64_t count = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            write(count);
+            ++count;
+        }
+        writes = count;
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(kSeconds));
+    stop = true;
+    for (auto& thread : threads) thread.join();
+
+    std::uint64_t total_reads = 0;
+    for (auto count : reads) total_reads += count;
+    return {total_reads / kSeconds, writes / kSeconds};
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<unsigned> reader_counts = {1, 2, 4, 8};
+    if (argc > 1) {
+        reader_counts.clear();
+        for (int i = 1; i < argc; ++i) reader_counts.push_back(static_cast<unsigned>(std::stoul(argv[i])));
+    }
+
+    const std::string expression = "rate*(price+fee)*0.5+rate*fee/2";
+    auto tokens = parser::tokenize(expression);
+    auto tree = eval::build_expr_tree(tokens.begin(), tokens.end());
+    SymbolTable initial = {{"rate", 1.1}, {"price", 100.0}, {"fee", 2.5}};
+
+    std::cout << "expression: " << expression << "\n"
+              << "readers  versioned reads/s  writes/s   shared_mutex reads/s  writes/s\n";
+    for (unsigned readers : reader_counts) {
+        VersionedSymbolTable versioned(initial);
+        auto lock_free = run(readers,
+            [&] { auto snapshot = versioned.snapshot(); return tree->evaluate(*snapshot); },
+            [&](std::uint64_t i) { versioned.insert_or_assign("rate", 1.0 + (i % 100) * 0.001); });
+
+        SymbolTable guarded(initial);
+        std::shared_mutex mutex;
+        auto locked = run(readers,
+            [&] { std::shared_lock<std::shared_mutex> lock(mutex); return tree->evaluate(guarded); },
+            [&](std::uint64_t i) { std::unique_lock<std::shared_mutex> lock(mutex); guarded["rate"] = 1.0 + (i % 100) * 0.001; });
+
+        std::printf("%7u  %17.0f  %8.0f   %20.0f  %8.0f\n", readers,
+            lock_free.reads_per_second_, lock_free.writes_per_second_, locked.reads_per_second_, locked.writes_per_second_);
+    }
+    return 0;
+}
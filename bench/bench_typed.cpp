@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "core/eval.h"
+#include "core/typed_program.h"
+
+// Typed evaluation benchmark: the tree's evaluate point by point, against the compiled program in each numeric type,
+// point by point and in bulk (kLanes points per instruction, where float has twice the SIMD lanes of double).
+
+namespace {
+
+constexpr double kSeconds = 0.5;
+constexpr std::size_t kPoints = 1 << 16;
+
+// Runs a sweep over all points repeatedly, returning nanoseconds per point
+template <typename Sweep>
+double time_per_point(Sweep sweep) {
+    using Clock = std::chrono::steady_clock;
+    std::uint64_t count = 0;
+    double sink = 0;
+    auto begin = Clock::now();
+    auto end = begin;
+    do {
+        sink += sweep();
+        count += kPoints;
+        end = Clock::now();
+    } while (std::chrono::duration<double>(end - begin).count() < kSeconds);
+    if (sink == -1.0) std::cout << ""; // Keep the computation observable
+    return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+template <typename T>
+void run(const char* name, const expr::ExprNode& tree) {
+    typed::Program<T> program(tree);
+    std::vector<T> xs(kPoints), ys(kPoints), results(kPoints);
+    for (std::size_t i = 0; i < kPoints; ++i) {
+        xs[i] = static_cast<T>(0.001 * static_cast<double>(i));
+        ys[i] = static_cast<T>(1.0 + 0.5 * static_cast<double>(i % 7));
+    }
+    std::vector<const T*> columns; // In the order of symbols(), which is the order of their first use
+    for (const auto& symbol : program.symbols()) columns.push_back(symbol == "x" ? xs.data() : ys.data());
+
+    double scalar_ns = time_per_point([&] {
+        expr::EvalStatus status;
+        T sum = 0;
+        std::vector<T> values(columns.size());
+        for (std::size_t i = 0; i < kPoints; ++i) {
+            for (std::size_t s = 0; s < columns.size(); ++s) values[s] = columns[s][i];
+            sum += program.evaluate(values.data(), status);
+        }
+        return static_cast<double>(sum);
+    });
+    double bulk_ns = time_per_point([&] {
+        program.evaluateBulk(columns.data(), kPoints, results.data());
+        return static_cast<double>(results[kPoints / 2]);
+    });
+    std::printf("%-12s  %10.2f  %10.2f  %12.1f\n", name, scalar_ns, bulk_ns, 1e3 / bulk_ns);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string expression = argc > 1 ? argv[1] : "(x*x - 3*x*y + 2) / (y*y + 1) + if(x > y, x - y, y - x) * 0.5";
+    auto tree = eval::try_parse(expression);
+    if (!tree) {
+        std::cerr << types::error_message(tree.error()) << std::endl;
+        return 1;
+    }
+
+    SymbolTable symbols = {{"x", 0.5}, {"y", 1.5}};
+    double tree_ns = time_per_point([&] {
+        double sum = 0;
+        for (std::size_t i = 0; i < kPoints; ++i) {
+            symbols["x"] = 0.001 * static_cast<double>(i);
+            sum += tree.value()->evaluate(symbols);
+        }
+        return sum;
+    });
+
+    std::cout << expression << "\n";
+    std::printf("tree (double) %10.2f ns/point\n", tree_ns);
+    std::cout << "type           scalar ns     bulk ns  bulk Mpoints/s\n";
+    run<float>("float", *tree.value());
+    run<double>("double", *tree.value());
+    run<long double>("long-double", *tree.value());
+#ifdef CALC_HAS_FLOAT128
+    run<__float128>("float128", *tree.value());
+#endif
+    return 0;
+}
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "utils/latency_histogram.h"
+
+// Load generator for `cli-calc --serve`: opens several connections, keeps a fixed number of
+// pipelined requests in flight on each, and reports throughput and latency percentiles.
+
+struct LoadOptions {
+    std::string socket_path_ = "/tmp/cli-calc.sock";
+    unsigned connections_ = 4;
+    unsigned depth_ = 16;
+    std::size_t requests_ = 100000; // Per connection
+    bool binary_ = false;           // Length-prefixed framing instead of newline-delimited
+    std::vector<std::string> expressions_ = {"1+2*3-4/5*(6+7)"};
+};
+
+struct ConnectionResult {
+    utils::LatencyHistogram latency_;
+    std::size_t errors_ = 0;
+    bool failed_ = false;
+};
+
+void run_connection(const LoadOptions& options, unsigned index, ConnectionResult& result) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, options.socket_path_.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        std::cerr << "connection " << index << ": cannot connect to " << options.socket_path_ << std::endl;
+        result.failed_ = true;
+        return;
+    }
+
+    std::string out;
+    if (options.binary_) out.push_back('\0'); // Select length-prefixed framing
+    std::string in;
+    std::vector<char> buffer(64 * 1024);
+    std::deque<std::chrono::steady_clock::time_point> sent_at;
+    std::size_t sent = 0, received = 0;
+
+    while (received < options.requests_) {
+        // Top up the pipeline
+        while (sent < options.requests_ && sent_at.size() < options.depth_) {
+            const std::string& expression = options.expressions_[(index + sent) % options.expressions_.size()];
+            if (options.binary_) {
+                auto size = static_cast<std::uint32_t>(expression.size());
+                char header[4] = {static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+                    static_cast<char>(size >> 8), static_cast<char>(size)};
+                out.append(header, 4);
+                out += expression;
+            }
+            else {
+                out += expression;
+                out += '\n';
+            }
+            sent_at.push_back(std::chrono::steady_clock::now());
+            ++sent;
+        }
+        for (std::size_t offset = 0; offset < out.size(); ) {
+            ssize_t written = ::send(fd, out.data() + offset, out.size() - offset, MSG_NOSIGNAL);
+            if (written <= 0) {
+                result.failed_ = true;
+                ::close(fd);
+                return;
+            }
+            offset += static_cast<std::size_t>(written);
+        }
+        out.clear();
+
+        // Collect whatever responses have arrived
+        ssize_t count = ::recv(fd, buffer.data(), buffer.size(), 0);
+        if (count <= 0) {
+            result.failed_ = true;
+            break;
+        }
+        in.append(buffer.data(), static_cast<std::size_t>(count));
+        auto now = std::chrono::steady_clock::now();
+
+        std::size_t begin = 0;
+        while (true) {
+            std::size_t end, next;
+            if (options.binary_) {
+                if (in.size() - begin < 4) break;
+                auto byte = [&in, begin](std::size_t i) { return static_cast<std::uint32_t>(static_cast<unsigned char>(in[begin + i])); };
+                std::uint32_t size = (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+                if (in.size() - begin - 4 < size) break;
+                begin += 4;
+                end = begin + size;
+                next = end;
+            }
+            else {
+                end = in.find('\n', begin);
+                if (end == std::string::npos) break;
+                next = end + 1;
+            }
+            if (in.compare(begin, 6, "error:") == 0) ++result.errors_;
+            result.latency_.record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent_at.front()).count()));
+            sent_at.pop_front();
+            ++received;
+            begin = next;
+        }
+        in.erase(0, begin);
+    }
+    ::close(fd);
+}
+
+int main(int argc, char* argv[]) {
+    static struct option long_options[] = {
+        {"socket",      required_argument, 0, 's'},
+        {"connections", required_argument, 0, 'c'},
+        {"depth",       required_argument, 0, 'd'},
+        {"requests",    required_argument, 0, 'n'},
+        {"expression",  required_argument, 0, 'e'},
+        {"file",        required_argument, 0, 'f'},
+        {"binary",      no_argument,       0, 'b'},
+        {0, 0, 0, 0}
+    };
+
+    LoadOptions options;
+    bool custom_expressions = false;
+    int opt;
+    try {
+        while ((opt = getopt_long(argc, argv, "s:c:d:n:e:f:b", long_options, nullptr)) != -1) {
+            switch (opt) {
+            case 's': options.socket_path_ = optarg; break;
+            case 'c': options.connections_ = static_cast<unsigned>(std::stoul(optarg)); break;
+            case 'd': options.depth_ = static_cast<unsigned>(std::stoul(optarg)); break;
+            case 'n': options.requests_ = std::stoul(optarg); break;
+            case 'b': options.binary_ = true; break;
+            case 'e': case 'f': {
+                if (!custom_expressions) options.expressions_.clear();
+                custom_expressions = true;
+                if (opt == 'e') options.expressions_.push_back(optarg);
+                else {
+                    std::ifstream file(optarg);
+                    std::string line;
+                    while (std::getline(file, line)) if (!line.empty()) options.expressions_.push_back(line);
+                }
+                break;
+            }
+            default:
+                std::cerr << "usage: calc_loadgen [-s socket] [-c connections] [-d depth] [-n requests] "
+                          << "[-e expression]... [-f file] [-b]" << std::endl;
+                return 1;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        std::cerr << "calc_loadgen: invalid numeric argument" << std::endl;
+        return 1;
+    }
+    if (options.expressions_.empty() || options.connections_ == 0 || options.depth_ == 0) {
+        std::cerr << "calc_loadgen: nothing to send" << std::endl;
+        return 1;
+    }
+
+    std::vector<ConnectionResult> results(options.connections_);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < options.connections_; ++i) threads.emplace_back(run_connection, std::cref(options), i, std::ref(results[i]));
+    for (auto& thread : threads) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    utils::LatencyHistogram latency;
+    std::size_t errors = 0;
+    for (const auto& result : results) {
+        if (result.failed_) std::cerr << "calc_loadgen: a connection failed early" << std::endl;
+        latency.merge(result.latency_);
+        errors += result.errors_;
+    }
+
+    std::cout << "connections " << options.connections_ << ", depth " << options.depth_
+              << ", framing " << (options.binary_ ? "length-prefixed" : "newline") << "\n"
+              << "requests    " << latency.count() << " in " << seconds << " s ("
+              << static_cast<std::uint64_t>(latency.count() / seconds) << " req/s), " << errors << " errors\n"
+              << "latency ns  p50 " << latency.value_at_percentile(50.0)
+              << "  p90 " << latency.value_at_percentile(90.0)
+              << "  p99 " << latency.value_at_percentile(99.0)
+              << "  p99.9 " << latency.value_at_percentile(99.9)
+              << "  max " << latency.max() << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace adaptive {
+
+constexpr double kDefaultTolerance = 1e-12; // Relative error bound above which a sum is re-evaluated in double-double
+
+/**
+ * @struct Result
+ *
+ * @brief The value of an expression with a guaranteed bound on its error.
+ * @note The bound is against the exact value of the expression over its literals and symbols as doubles (the literal
+ *       0.1 stands for the double nearest 0.1), with pi and e exact. Underflow is not accounted for.
+ */
+struct Result {
+    types::Numeral value_ = 0;
+    types::Numeral error_ = 0; // |value_ - exact value| <= error_, infinite if nothing can be guaranteed
+    std::size_t refined_ = 0;  // Subtrees re-evaluated in double-double
+};
+
+/**
+ * @struct DoubleDouble
+ *
+ * @brief A double-double value, the unevaluated sum of two doubles, with a bound on its error.
+ */
+struct DoubleDouble {
+    double hi_ = 0;
+    double lo_ = 0;    // At most half an ulp of hi_
+    double error_ = 0; // |hi_ + lo_ - exact value| <= error_
+};
+
+/**
+ * @class Program
+ *
+ * @brief An arithmetic expression compiled for evaluation in double with a running error bound.
+ * @note Each operation computes its exact rounding error with TwoSum/TwoProd and propagates the bounds of its operands,
+ *       which costs a few flops on top of plain double. When the bound of a sum exceeds the tolerance relative to its
+ *       value, which is how catastrophic cancellation shows, only the subtree of that sum is re-evaluated in
+ *       double-double. The code of a subtree is contiguous, so re-evaluating it is rerunning a range of the code.
+ */
+class Program {
+public:
+    // Operations of the stack code
+    enum class Op : std::uint8_t {
+        Constant, Load,                      // Push constants_, a symbol
+        Negate, Add, Subtract, Multiply, Divide,
+        Polynomial                           // Horner's scheme on polynomials_
+    };
+
+    struct Instruction {
+        Op op_;
+        std::uint32_t operand_ = 0; // Index into constants_, symbols_ or polynomials_
+        std::uint32_t begin_ = 0;   // First instruction of the subtree this instruction completes
+    };
+
+private:
+    std::vector<Instruction> code_;
+    std::vector<DoubleDouble> constants_;          // lo_ is 0 except for pi and e
+    std::vector<std::vector<double>> polynomials_; // Coefficients, lowest power first
+    std::vector<types::Symbol> symbols_;           // Symbols, in the order of their values
+    std::size_t stack_size_ = 1;
+
+    void compile(const expr::ExprNode& node, std::size_t depth);
+
+    /**
+     * @brief Evaluates the code in [begin, end), a subtree, in double-double.
+     */
+    DoubleDouble refine(const double* values, std::size_t begin, std::size_t end) const;
+
+public:
+    /**
+     * @brief Compiles an expression tree.
+     *
+     * @param tree the root of the expression tree
+     * @throws std::invalid_argument if the tree has a node other than a number, symbol, pi, e, + - * / or a polynomial
+     */
+    explicit Program(const expr::ExprNode& tree);
+
+    /**
+     * @brief Acquires the symbols of the expression, in the order evaluate expects their values.
+     */
+    const std::vector<types::Symbol>& symbols() const noexcept { return symbols_; }
+
+    /**
+     * @brief Evaluates the expression with an error bound, re-evaluating cancelling sums in double-double.
+     *
+     * @param values the values of symbols(), in order
+     * @param tolerance the relative error bound a sum may have before its subtree is re-evaluated
+     * @returns the value, its error bound, and the number of subtrees re-evaluated
+     * @throws std::runtime_error if attempts to divide by 0
+     * @note A subtree whose double-double bound still exceeds the tolerance is kept, and its ancestors are not
+     *       re-evaluated for it, as double-double would give them the same operand.
+     */
+    Result evaluate(const double* values, double tolerance = kDefaultTolerance) const;
+
+    /**
+     * @brief Evaluates the expression with the values of the symbol table.
+     *
+     * @throws std::runtime_error if a symbol is undefined, or attempts to divide by 0
+     */
+    Result evaluate(const SymbolTable& symbols, double tolerance = kDefaultTolerance) const;
+};
+
+/**
+ * @brief Compiles and evaluates an expression tree with an error bound.
+ *
+ * @param tree the root of the expression tree
+ * @param symbols the symbol table
+ * @param tolerance the relative error bound a sum may have before its subtree is re-evaluated
+ * @returns the value, its error bound, and the number of subtrees re-evaluated
+ * @throws std::invalid_argument if the tree has a node without an error bound
+ * @throws std::runtime_error if a symbol is undefined, or attempts to divide by 0
+ */
+Result evaluate(const expr::ExprNode& tree, const SymbolTable& symbols, double tolerance = kDefaultTolerance);
+
+} // namespace adaptive
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "data/expected.h"
+#include "utils/expr_node.h"
+#include "utils/latency_histogram.h"
+#include "utils/symbol_table.h"
+#include "core/functions.h"
+#include "core/fusion_pass.h"
+#include "core/summation_pass.h"
+#include "core/polynomial_pass.h"
+#include "core/typed_program.h"
+
+namespace batch {
+
+constexpr std::uint64_t kMaxBinomialTable = std::uint64_t(1) << 22; // Largest n of the log-factorial table of run_binomials
+constexpr std::size_t kRollingWindow = 20; // Default window of run_rolling
+
+// Format of the latency report
+enum class ReportFormat { None, Text, Json };
+
+/**
+ * @struct BatchOptions
+ *
+ * @brief Options of a batch run.
+ */
+struct BatchOptions {
+    unsigned threads_ = 1;                     // Number of worker threads
+    ReportFormat report_ = ReportFormat::None; // Format of the latency report, None to skip it
+    std::size_t slowest_ = 10;                 // Number of slowest expressions to report
+    expr::NumericMode numeric_mode_ = expr::NumericMode::Strict; // Whether numerical errors propagate as inf/NaN
+    const functions::FunctionRegistry* functions_ = nullptr;     // User-defined functions the expressions may call (not run_stream)
+    bool memo_stats_ = false;                  // Whether to report the memo cache hit rates of run_stream
+    poly::PolynomialMode polynomials_ = poly::PolynomialMode::Off; // Polynomial subtrees to collect after parsing
+    fusion::FusionMode fusion_ = fusion::FusionMode::Off;          // Patterns to fuse after parsing, in double only
+    bool exact_sums_ = false;                  // Whether to sum chains of + and - exactly after parsing, in double only
+    typed::NumericType numeric_type_ = typed::NumericType::Double; // Type to evaluate in, compiled per expression unless double
+    unsigned workers_ = 0;                     // Worker processes of run_stream (see workers::run), 0 for threads only
+};
+
+/**
+ * @struct BatchReport
+ *
+ * @brief Latency statistics of a batch run, merged from all worker threads.
+ */
+struct BatchReport {
+    utils::LatencyHistogram parse_;    // tokenize + build_expr_tree (+ rewrite passes)
+    utils::LatencyHistogram evaluate_; // evaluate
+    utils::LatencyHistogram total_;    // Whole expression, including failed ones
+    utils::SlowestList slowest_;       // Slowest expressions by total latency
+    std::size_t errors_ = 0;           // Number of expressions that failed
+    std::size_t restarts_ = 0;         // Worker processes restarted after a crash (workers::run)
+};
+
+/**
+ * @struct LineResult
+ *
+ * @brief Output and latency of one expression.
+ */
+struct LineResult {
+    std::string output_;            // The result, or "error: <message> at position <n>"
+    std::uint64_t parse_ns_ = 0;    // tokenize + build_expr_tree (+ rewrite passes)
+    std::uint64_t evaluate_ns_ = 0; // evaluate and format, 0 if it did not parse
+    bool parsed_ = false;
+    bool failed_ = false;
+};
+
+/**
+ * @brief Parses and evaluates one expression as run does.
+ *
+ * @param expression the expression
+ * @param symbols the symbol table
+ * @param options the batch options
+ * @param parse_threads the threads to parse a long expression on (see eval::try_parse_parallel)
+ * @returns the output line and the latencies
+ */
+LineResult evaluate_line(const std::string& expression, const SymbolTable& symbols, const BatchOptions& options,
+    unsigned parse_threads = 1);
+
+/**
+ * @brief Evaluates every expression, recording per-expression parse and evaluate latency.
+ *
+ * @param expressions the expressions, one per input line
+ * @param symbols the symbol table shared (read-only) by all expressions
+ * @param options the batch options
+ * @param outputs filled with one output line per expression, either the result or the error message
+ * @returns the merged latency report
+ */
+BatchReport run(const std::vector<std::string>& expressions, const SymbolTable& symbols,
+    const BatchOptions& options, std::vector<std::string>& outputs);
+
+/**
+ * @brief Reads the whole input and evaluates it line by line.
+ *
+ * @param in the input stream, one expression per line
+ * @param out the output stream for the results
+ * @param report_out the output stream for the latency report
+ * @param options the batch options
+ * @param functions if not nullptr, the functions defined so far, extended by the definitions in the input
+ * @returns the number of expressions that failed
+ * @note Function definitions (`f(x, y) = ...`) are taken first, in order, and are visible to every expression;
+ *       their output line is "defined f(x, y)" or the error. With options.workers_ set, the expressions are evaluated
+ *       by that many worker processes (see workers::run) instead of threads.
+ */
+std::size_t run_stream(std::istream& in, std::ostream& out, std::ostream& report_out, const BatchOptions& options,
+    functions::FunctionRegistry* functions = nullptr);
+
+/**
+ * @brief Answers binomial queries, one "n k" pair of non-negative integers per line.
+ *
+ * @param in the input stream, one query per line
+ * @param out the output stream, one coefficient or "error: <message> at line <n>" per line
+ * @returns the number of invalid queries
+ * @note The log-factorials up to the largest n (at most kMaxBinomialTable) are computed once for all queries, see
+ *       numbers::BinomialTable; queries beyond go through numbers::binomial.
+ */
+std::size_t run_binomials(std::istream& in, std::ostream& out);
+
+/**
+ * @struct RollingOptions
+ *
+ * @brief Options of a rolling statistics run.
+ */
+struct RollingOptions {
+    std::size_t window_ = kRollingWindow; // Samples of the rolling window
+    double alpha_ = 0;                    // Weight of the EWMA, 0 for 2 / (window + 1)
+};
+
+/**
+ * @brief Writes rolling statistics of a stream of numbers, one line per input line as it arrives.
+ *
+ * @param in the input stream, one number per line (nan and inf allowed)
+ * @param out the output stream, "value,mean,sd,min,max,median,ewma" over the last options.window_ samples, or
+ *        "error: <message> at line <n>" for a line that is not a number, which is not a sample
+ * @param options the window and EWMA weight
+ * @returns the number of invalid lines
+ * @throws std::invalid_argument if the window is 0 or the weight is outside (0, 1]
+ * @note Each sample updates stats::RollingMoments, stats::RollingExtremes, stats::RollingMedian and stats::Ewma,
+ *       O(log window) in all, so the input can be unbounded. Output is written whenever no more input is buffered,
+ *       so results keep pace with a pipe.
+ */
+std::size_t run_rolling(std::istream& in, std::ostream& out, const RollingOptions& options);
+
+/**
+ * @brief Writes a latency report (p50/p90/p99/p99.9/max and the slowest expressions).
+ *
+ * @param out the output stream
+ * @param report the report to write
+ * @param format text or JSON
+ */
+void write_report(std::ostream& out, const BatchReport& report, ReportFormat format);
+
+/**
+ * @brief Formats an error of the non-throwing path as an output line.
+ *
+ * @param error the error
+ * @returns "error: <message> at position <n>"
+ */
+std::string format_error(const types::Error& error);
+
+/**
+ * @brief Formats a numeral as the shortest string that round-trips.
+ *
+ * @param value the value to format
+ */
+std::string format_numeral(types::Numeral value);
+
+} // namespace batch
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include "utils/expr_node.h"
+
+namespace csv {
+
+constexpr std::size_t kBlockSize = std::size_t(1) << 20; // Bytes of rows parsed and evaluated by a worker at a time
+
+// Format of the result column
+enum class OutputFormat { Csv, Binary };
+
+/**
+ * @struct CsvOptions
+ *
+ * @brief Options of a CSV run.
+ */
+struct CsvOptions {
+    unsigned threads_ = 1;                      // Number of worker threads
+    OutputFormat format_ = OutputFormat::Csv;   // Text with a "result" header, or native doubles without one
+    std::size_t block_size_ = kBlockSize;       // Bytes per block, rounded to whole rows
+    expr::NumericMode numeric_mode_ = expr::NumericMode::Strict; // Whether numerical errors propagate as inf/NaN
+};
+
+/**
+ * @struct CsvReport
+ *
+ * @brief Counts of a CSV run.
+ */
+struct CsvReport {
+    std::size_t rows_ = 0;      // Rows evaluated, excluding the header and blank lines
+    std::size_t malformed_ = 0; // Rows with a used field missing or not a number, evaluated with NaN for it
+    std::size_t failed_ = 0;    // Rows whose evaluation failed, in NumericMode::Strict
+};
+
+/**
+ * @brief Evaluates an expression on every row of CSV text, with one column per symbol.
+ *
+ * @param data the text, a header line of column names then one row per line
+ * @param size the length of the text
+ * @param tree the root of the expression tree
+ * @param out the output stream for the result column
+ * @param options the CSV options
+ * @returns the counts of rows
+ * @throws std::invalid_argument if the text has no header line or a symbol of the expression names no column, or if
+ *         the tree has a node without a typed counterpart
+ * @note Header names are matched with the expression's symbols once. The rows are cut into blocks of about
+ *       options.block_size_ bytes, which the workers claim in turn: each parses the fields of the used columns in
+ *       place into one array per symbol, evaluates the block with typed::Program<double>::evaluateBulk and formats its
+ *       results. The blocks are written in order, and a worker gets at most a few blocks ahead of the writer, so the
+ *       output streams in bounded memory. Fields may be quoted; unused columns are skipped without parsing. In
+ *       NumericMode::Strict the result of a row whose evaluation fails is its error, "error: <message> at position <n>"
+ *       as in batch mode (NaN in the binary format); in NumericMode::IEEE numerical errors propagate as inf/NaN.
+ */
+CsvReport evaluate(const char* data, std::size_t size, const expr::ExprNode& tree, std::ostream& out, const CsvOptions& options);
+
+/**
+ * @brief Evaluates an expression on every row of a CSV file, mapped into memory.
+ *
+ * @param path the path of the file
+ * @param tree the root of the expression tree
+ * @param out the output stream for the result column
+ * @param options the CSV options
+ * @returns the counts of rows
+ * @throws std::invalid_argument if the file cannot be opened and mapped, or as evaluate above
+ */
+CsvReport evaluate_file(const std::string& path, const expr::ExprNode& tree, std::ostream& out, const CsvOptions& options);
+
+} // namespace csv
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <unordered_map>
 #include <variant>
 #include "globals.h"
 #include "data/datatype_decl.h"
@@ -11,7 +12,8 @@
 
 namespace dispatcher {
 
-typedef std::variant<types::Numeral> Result;
+typedef std::variant<types::Numeral, types::Vector, types::Matrix> Result;
+typedef std::unordered_map<types::Symbol, Result> Bindings; // Values of symbols that may be vectors or matrices
 
 /**
  * @brief Acquires the result from the tokens with the given mode.
@@ -20,9 +22,13 @@ typedef std::variant<types::Numeral> Result;
  * @param symbols a SymbolTable for the variables
  * @param tokens_begin an iterator to the begin of a token vector
  * @param tokens_end an iterator to the end of a token vector
+ * @param functions if not nullptr, the user-defined functions the tokens may call
+ * @param values if not nullptr nor empty, the vectors and matrices the tokens may use, evaluated by matrix_eval::evaluate
+ * @param threads the number of threads of large matrix products
  * @returns a Result for the result of calculation
  */
 Result get_result(Mode mode, const SymbolTable& symbols,
-        std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end);
+        std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+        const functions::FunctionRegistry* functions = nullptr, const Bindings* values = nullptr, unsigned threads = 1);
 
 } // namespace dispatcher
@@ -1,16 +1,21 @@
 #pragma once
 
+#include <cstdint>
+#include <istream>
 #include <vector>
 #include <memory>
 #include <stack>
 #include <queue>
 #include <stdexcept>
 #include "data/datatype_decl.h"
+#include "data/expected.h"
 #include "utils/expr_node.h"
 #include "utils/operator_table.h"
 #include "utils/symbol_table.h"
 #include "core/parser.h"
 
+namespace functions { class FunctionRegistry; }
+
 namespace eval {
 
 /**
@@ -18,11 +23,115 @@ namespace eval {
  * 
  * @param tokens_begin the iterator for the beginning of the token vector
  * @param tokens_end the iterator for the end of the token vector
+ * @param functions if not nullptr, the user-defined functions the tokens may call (see FunctionRegistry::recognize)
  * @returns a std::unique_ptr pointing to the root node of the expression tree generated
  * @throw std::runtime_error if has syntax errors or invalid numbers
  */
 std::unique_ptr<expr::ExprNode> build_expr_tree(
-    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end);
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const functions::FunctionRegistry* functions = nullptr);
+
+/**
+ * @brief Builds an expression tree from a std::vector of tokens, without throwing.
+ * 
+ * @param tokens_begin the iterator for the beginning of the token vector
+ * @param tokens_end the iterator for the end of the token vector
+ * @param positions if not nullptr, the source positions of the tokens (parallel to the tokens), used for
+ *        error reports and stored in the nodes; otherwise the token indices are used
+ * @param functions if not nullptr, the user-defined functions the tokens may call; small ones are inlined
+ * @param source if not nullptr, the text positions are offsets in, from which long literals keep their text (see
+ *        expr::NumeralNode::text)
+ * @returns the root node of the expression tree, or the error
+ * @note The tree is built in one pass over the tokens by precedence climbing on the OperatorInfo of each operator. The
+ *       first syntax error in reading order is reported, except that an unpaired bracket anywhere is reported first.
+ */
+types::Expected<std::unique_ptr<expr::ExprNode>> try_build_expr_tree(
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const std::size_t* positions = nullptr, const functions::FunctionRegistry* functions = nullptr,
+    const std::string* source = nullptr);
+
+/**
+ * @brief Tokenizes and builds the expression tree of an expression, without throwing.
+ * 
+ * @param expression the expression
+ * @param functions if not nullptr, the user-defined functions the expression may call
+ * @returns the root node of the expression tree, or the error with its position in expression
+ */
+types::Expected<std::unique_ptr<expr::ExprNode>> try_parse(const std::string& expression,
+    const functions::FunctionRegistry* functions = nullptr);
+
+/**
+ * @brief Tokenizes and builds the expression tree of a long expression on several threads, without throwing.
+ * 
+ * @param expression the expression
+ * @param threads the number of threads
+ * @param functions if not nullptr, the user-defined functions the expression may call
+ * @returns the same tree as try_parse, or the same error
+ * @note The expression is tokenized in chunks (see parser::try_tokenize_parallel), and the brackets are paired per
+ *       chunk then across chunks. A long range of tokens is then split into independent subexpressions, the operands
+ *       of its loosest binary operators outside brackets or the arguments of a call, which are built on separate
+ *       threads and joined as the sequential builder would. Ranges with no such split, and expressions with an error,
+ *       are built sequentially. Expressions under 64 KiB are parsed on this thread.
+ */
+types::Expected<std::unique_ptr<expr::ExprNode>> try_parse_parallel(const std::string& expression, unsigned threads,
+    const functions::FunctionRegistry* functions = nullptr);
+
+/**
+ * @brief Finds a node of a tree nested too deep for the passes that recurse into it, without recursing.
+ * 
+ * @param tree the root node of the expression tree
+ * @returns the first node in depth-first order more than 10000 levels below the root, or nullptr
+ * @note The tree builder bounds its own recursion, but a chain of left-associative operators (1+1+...+1) deepens the
+ *       tree without it. Evaluation and destruction take such trees; the rewrite passes and typed programs check first.
+ */
+const expr::ExprNode* find_too_deep(const expr::ExprNode& tree);
+
+/**
+ * @brief Evaluates an expression tree, without throwing.
+ * 
+ * @param tree the root node of the expression tree
+ * @param symbols the symbol table
+ * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+ * @returns the result, or the first error met
+ */
+types::Expected<types::Numeral> try_evaluate(const expr::ExprNode& tree, const SymbolTable& symbols,
+    expr::NumericMode mode = expr::NumericMode::Strict);
+
+constexpr std::size_t kStreamBuffer = std::size_t(1) << 16; // Bytes evaluate_stream reads at a time
+
+/**
+ * @struct StreamStats
+ *
+ * @brief Counters of a streamed evaluation.
+ */
+struct StreamStats {
+    std::uint64_t bytes_ = 0;  // Bytes read
+    std::uint64_t tokens_ = 0; // Tokens evaluated
+    std::size_t depth_ = 0;    // Most operators and values held at once
+    std::size_t buffer_ = 0;   // Most bytes tokenized at once
+};
+
+/**
+ * @brief Evaluates one expression read from a stream without building its tree, without throwing.
+ * 
+ * @param in the stream, read to its end
+ * @param symbols the symbol table
+ * @param functions if not nullptr, the user-defined functions the expression may call
+ * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+ * @param stats if not nullptr, filled with the counters of the evaluation
+ * @returns the value try_evaluate gives for the tree of try_parse, or the error with its position in the stream
+ * @note The stream is read kStreamBuffer bytes at a time, each buffer tokenized up to the last place a token ends
+ *       whatever follows, after a space, bracket or comma or between an operator and a numeral or symbol, and the rest
+ *       carried over. Shunting-yard runs on the tokens as they come, and an operator leaving the operator
+ *       stack is applied at once to the top of a value stack, so memory grows with the nesting depth and not the
+ *       length. An operator is applied by evaluating a node built once over leaves standing for its operands, and an
+ *       operand in error hands its error to the operator that evaluates it, so values and errors are those of the tree,
+ *       lazy branches and inlined calls included. Syntax errors are found in reading order: unlike try_parse, which
+ *       pairs the brackets first, an unpaired bracket after another syntax error is not the one reported.
+ */
+types::Expected<types::Numeral> evaluate_stream(std::istream& in, const SymbolTable& symbols,
+    const functions::FunctionRegistry* functions = nullptr, expr::NumericMode mode = expr::NumericMode::Strict,
+    StreamStats* stats = nullptr);
 
 /**
  * @brief Checks whether the brackets are paired correctly in the expression
@@ -33,6 +142,13 @@ std::unique_ptr<expr::ExprNode> build_expr_tree(
  */
 bool check_bracket_matching(std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end);
 
+/**
+ * @brief Checks whether a bracket is an opening one.
+ * 
+ * @param bracket a std::string of the bracket
+ */
+inline bool is_opening_bracket(const std::string& bracket) { return bracket == "(" || bracket == "[" || bracket == "{"; }
+
 /**
  * @brief Checks whether two brackets are paired.
  * 
@@ -0,0 +1,307 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "data/expected.h"
+#include "utils/expr_node.h"
+#include "utils/operator_table.h"
+#include "utils/symbol_table.h"
+#include "core/parser.h"
+
+namespace functions {
+
+constexpr std::size_t kMaxParameters = 8;     // Parameters of a user-defined function
+constexpr std::size_t kMaxMemoParameters = 4; // Parameters of a function whose calls are memoized
+constexpr std::size_t kMemoEntries = 4096;    // Entries of the memo cache of one function (a power of 2)
+constexpr std::size_t kInlineNodes = 16;      // Largest body, in nodes, that is inlined into its callers
+constexpr unsigned kMaxCallDepth = 2000;      // Nested calls of user-defined functions before evaluation fails
+
+/**
+ * @struct MemoStats
+ *
+ * @brief Memo cache statistics of one function.
+ */
+struct MemoStats {
+    std::string name_;
+    std::uint64_t hits_ = 0;
+    std::uint64_t misses_ = 0;
+
+    double hit_rate() const noexcept { return hits_ + misses_ == 0 ? 0 : static_cast<double>(hits_) / (hits_ + misses_); }
+};
+
+/**
+ * @class UserFunction
+ *
+ * @brief A function defined as `f(x, y) = <expression>`.
+ * @note Calls of a pure function (no free symbols, calling only pure functions) that is recursive or too large to
+ *       inline go through a bounded, direct-mapped memo cache shared by all threads. Each entry is guarded by a
+ *       sequence counter, so lookups take no lock and a colliding insert simply replaces the older entry.
+ */
+class UserFunction {
+private:
+    // One memo entry; seq_ is odd while the entry is being written
+    struct alignas(64) MemoEntry {
+        std::atomic<std::uint64_t> seq_{0};
+        std::array<std::atomic<std::uint64_t>, kMaxMemoParameters> arguments_{};
+        std::atomic<std::uint64_t> value_{0};
+    };
+
+    std::string name_;
+    std::vector<std::string> parameters_;
+    std::string source_;                     // The definition, as written
+    std::unique_ptr<expr::ExprNode> body_;
+    expr::OperatorInfo info_;                // How calls are parsed
+    bool pure_ = true;
+    bool recursive_ = false;
+    std::size_t body_nodes_ = 0;
+    std::vector<unsigned> uses_;             // Occurrences of each parameter in the body
+    std::vector<bool> lazy_uses_;            // Whether a parameter occurs in a lazily evaluated operand
+    std::unique_ptr<MemoEntry[]> memo_;      // nullptr if calls are not memoized
+    mutable std::atomic<std::uint64_t> hits_{0};
+    mutable std::atomic<std::uint64_t> misses_{0};
+
+    friend class FunctionRegistry;
+
+    bool memoLookup(const types::Numeral* arguments, types::Numeral& value) const noexcept;
+    void memoStore(const types::Numeral* arguments, types::Numeral value) const noexcept;
+
+public:
+    /**
+     * @brief Constructor for UserFunction, the body is set once parsed.
+     *
+     * @param name name of the function
+     * @param parameters names of the parameters
+     * @param source the definition
+     */
+    UserFunction(std::string name, std::vector<std::string> parameters, std::string source);
+
+    const std::string& name() const noexcept { return name_; }
+    const std::vector<std::string>& parameters() const noexcept { return parameters_; }
+    std::size_t arity() const noexcept { return parameters_.size(); }
+    const std::string& source() const noexcept { return source_; }
+    const expr::ExprNode& body() const noexcept { return *body_; }
+    const expr::OperatorInfo& info() const noexcept { return info_; }
+    bool pure() const noexcept { return pure_; }
+    bool recursive() const noexcept { return recursive_; }
+    bool memoized() const noexcept { return memo_ != nullptr; }
+    unsigned uses(std::size_t index) const noexcept { return uses_[index]; }
+    bool usedLazily(std::size_t index) const noexcept { return lazy_uses_[index]; }
+
+    /**
+     * @brief Whether calls may be replaced by the body, with the arguments substituted.
+     */
+    bool inlinable() const noexcept { return body_ && !recursive_ && body_nodes_ <= kInlineNodes; }
+
+    /**
+     * @brief Calls the function, without throwing.
+     *
+     * @param arguments the values of the parameters
+     * @param symbols the symbol table, for the free symbols of the body
+     * @param status records the first error met
+     * @param position position of the call, reported for the errors met in the body
+     * @returns the result
+     */
+    types::Numeral call(const types::Numeral* arguments, const SymbolTable& symbols, expr::EvalStatus& status,
+        std::size_t position) const noexcept;
+
+    /**
+     * @brief Calls the function with some symbols' values explicitly provided, bypassing the memo cache.
+     *
+     * @param arguments the values of the parameters
+     * @param symbols the symbol table, for the free symbols of the body
+     * @param variables the provided values of some symbols
+     * @returns the result
+     * @throws std::runtime_error if the calls nest too deep
+     */
+    types::Numeral callAt(const types::Numeral* arguments, const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const;
+
+    /**
+     * @brief Calls the function in a forward-mode pass, bypassing the memo cache.
+     *
+     * @param arguments the values and derivatives of the parameters
+     * @param symbols the symbol table, for the free symbols of the body
+     * @param context the forward-mode pass
+     * @returns the value and derivative of the result
+     * @throws std::runtime_error if the calls nest too deep
+     */
+    expr::Dual callDual(const expr::Dual* arguments, const SymbolTable& symbols, expr::ForwardContext& context) const;
+
+    /**
+     * @brief Calls the function, recording the body on a tape; the memo cache is bypassed.
+     *
+     * @param arguments the recorded parameters
+     * @param symbols the symbol table, for the free symbols of the body
+     * @param tape the tape
+     * @returns the recorded result
+     * @throws std::runtime_error if the calls nest too deep
+     */
+    expr::TapeValue record(const expr::TapeValue* arguments, const SymbolTable& symbols, expr::Tape& tape) const;
+
+    /**
+     * @brief Acquires the memo cache statistics.
+     */
+    MemoStats memoStats() const noexcept;
+};
+
+/**
+ * @class CallNode
+ *
+ * @brief Node of a call of a user-defined function, the arguments being the children in source order.
+ */
+class CallNode : public expr::MultinaryNode {
+private:
+    const UserFunction* function_;
+
+public:
+    /**
+     * @brief Constructor for CallNode.
+     *
+     * @param function the function called
+     * @param arguments rvalue reference to the arguments, in source order
+     */
+    CallNode(const UserFunction* function, std::vector<std::unique_ptr<expr::ExprNode>>&& arguments);
+
+    const UserFunction& function() const noexcept { return *function_; }
+
+    /**
+     * @brief Takes the arguments out of the node.
+     */
+    std::vector<std::unique_ptr<expr::ExprNode>> releaseArguments() noexcept { return std::move(children_); }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final;
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final;
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final;
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final;
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final;
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final;
+};
+
+/**
+ * @class ParameterNode
+ *
+ * @brief Node of a parameter in the body of a user-defined function, reading the arguments of the innermost call.
+ */
+class ParameterNode : public expr::NullaryNode {
+private:
+    std::size_t index_;
+
+public:
+    /**
+     * @brief Constructor for ParameterNode.
+     *
+     * @param index index of the parameter
+     */
+    explicit ParameterNode(std::size_t index) : NullaryNode(), index_(index) {}
+
+    std::size_t index() const noexcept { return index_; }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final;
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final;
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final;
+
+    virtual bool isCheap() const noexcept override final { return true; }
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final;
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final;
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final;
+};
+
+/**
+ * @class FunctionRegistry
+ *
+ * @brief The user-defined functions, looked up by the parser like operators.
+ * @note Define every function before the registry is shared between threads; lookups and calls are then
+ *       safe from any number of threads. Redefining a function affects only expressions parsed afterwards.
+ */
+class FunctionRegistry {
+private:
+    std::deque<UserFunction> functions_;                      // Every definition, kept alive for parsed trees
+    std::unordered_map<std::string, UserFunction*> by_name_;  // The latest definition of each name
+
+public:
+    FunctionRegistry() = default;
+    FunctionRegistry(const FunctionRegistry& other) = delete;
+    FunctionRegistry& operator=(const FunctionRegistry& other) = delete;
+
+    /**
+     * @brief Defines a function from `name(p1, p2, ...) = expression`.
+     *
+     * @param definition the definition
+     * @returns the function, or the error with its position in definition
+     */
+    types::Expected<const UserFunction*> define(const std::string& definition);
+
+    /**
+     * @brief Finds a function by name.
+     *
+     * @returns the function, or nullptr if undefined
+     */
+    const UserFunction* find(const std::string& name) const noexcept;
+
+    /**
+     * @brief Finds how calls of a function are parsed.
+     *
+     * @returns the operator info, or nullptr if undefined
+     */
+    const expr::OperatorInfo* find_operator(const std::string& name) const noexcept;
+
+    /**
+     * @brief Marks the symbols naming functions as operators.
+     *
+     * @param tokens the tokens, already recognized by parser::recognize
+     */
+    void recognize(std::vector<parser::Token>& tokens) const;
+
+    /**
+     * @brief Acquires the memo cache statistics of the memoized functions.
+     */
+    std::vector<MemoStats> memo_stats() const;
+
+    /**
+     * @brief Writes the memo cache statistics, one line per memoized function.
+     *
+     * @param out the output stream
+     */
+    void write_memo_stats(std::ostream& out) const;
+
+    bool empty() const noexcept { return by_name_.empty(); }
+};
+
+/**
+ * @brief Checks whether a line is a function definition rather than an expression.
+ *
+ * @param line the line
+ * @returns `true` if it has the form `name(...) = ...`
+ */
+bool is_definition(const std::string& line);
+
+/**
+ * @brief Replaces the calls of inlinable functions by their bodies, with the arguments substituted.
+ *
+ * @param tree the root of the expression tree, possibly replaced
+ * @returns the number of calls inlined
+ * @note A call stays a call if inlining would evaluate a costly argument more than once, not at all,
+ *       or only conditionally.
+ */
+std::size_t inline_calls(std::unique_ptr<expr::ExprNode>& tree);
+
+} // namespace functions
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "utils/autodiff.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace fusion {
+
+// Which patterns fuse_operations rewrites
+enum class FusionMode {
+    Off,   // None
+    Exact, // Division only by powers of 2, whose reciprocal is exact
+    Fast   // Division by any constant, by multiplying by its rounded reciprocal (--fast-math)
+};
+
+/**
+ * @class FmaNode
+ *
+ * @brief Node of a product plus an addend, a*b + c, c + a*b, a*b - c or c - a*b, rounded once by std::fma.
+ * @note The children are the factors and the addend in source order, which is the order they are evaluated in. The
+ *       pass makes a subclass that inlines the instruction on CPUs with FMA, as std::fma is otherwise a library call.
+ */
+class FmaNode : public expr::MultinaryNode {
+protected:
+    bool addend_first_;           // Whether the addend is the first child (c + a*b) rather than the last (a*b + c)
+    types::Numeral product_sign_; // -1 for c - a*b
+    types::Numeral addend_sign_;  // -1 for a*b - c
+
+    /**
+     * @brief Arranges the values of the children as the operands of std::fma.
+     */
+    void arrange(types::Numeral first, types::Numeral second, types::Numeral third,
+        types::Numeral& a, types::Numeral& b, types::Numeral& c) const noexcept {
+        a = product_sign_ * (addend_first_ ? second : first);
+        b = addend_first_ ? third : second;
+        c = addend_sign_ * (addend_first_ ? first : third);
+    }
+
+public:
+    /**
+     * @brief Constructor for FmaNode.
+     *
+     * @param children rvalue reference to the factors and the addend, in source order
+     * @param addend_first whether the addend is the first child rather than the last
+     * @param negate_product whether the product is subtracted from the addend
+     * @param negate_addend whether the addend is subtracted from the product
+     */
+    FmaNode(std::vector<std::unique_ptr<expr::ExprNode>>&& children, bool addend_first, bool negate_product, bool negate_addend);
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override;
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override;
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override;
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final;
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final;
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override;
+};
+
+// Operations of a symbol with a constant
+enum class SymbolOperation { Multiply, Add };
+
+/**
+ * @class SymbolConstantNode
+ *
+ * @brief Leaf node of a symbol times a constant (ScaledSymbolNode) or plus a constant (ShiftedSymbolNode), which
+ *        looks the symbol up and applies the operation in one call.
+ *
+ * @tparam Op the operation
+ */
+template <SymbolOperation Op>
+class SymbolConstantNode : public expr::NullaryNode {
+private:
+    types::Symbol symbol_;
+    types::Numeral constant_;
+    std::size_t symbol_position_; // Position of the symbol, where an undefined one is reported
+
+    static constexpr types::Numeral apply(types::Numeral x, types::Numeral constant) noexcept {
+        return Op == SymbolOperation::Multiply ? x * constant : x + constant;
+    }
+
+    static constexpr types::Numeral partial(types::Numeral constant) noexcept {
+        return Op == SymbolOperation::Multiply ? constant : 1;
+    }
+
+public:
+    /**
+     * @brief Constructor for SymbolConstantNode.
+     *
+     * @param symbol the symbol
+     * @param constant the constant
+     * @param symbol_position the position of the symbol in the source expression
+     */
+    SymbolConstantNode(const types::Symbol& symbol, types::Numeral constant, std::size_t symbol_position) :
+        NullaryNode(), symbol_(symbol), constant_(constant), symbol_position_(symbol_position) {}
+
+    const types::Symbol& symbol() const noexcept { return symbol_; }
+
+    types::Numeral constant() const noexcept { return constant_; }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { return apply(symbols.at(symbol_), constant_); }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        auto it = variables.find(symbol_);
+        return apply(it != variables.end() ? it->second : symbols.at(symbol_), constant_);
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final {
+        const types::Numeral* value = symbols.find(symbol_);
+        if (value) return apply(*value, constant_);
+        if (status.ok()) status.symbol_ = &symbol_;
+        status.fail(types::ErrorCode::UndefinedSymbol, symbol_position_);
+        return std::numeric_limits<types::Numeral>::quiet_NaN();
+    }
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final {
+        types::Numeral x = symbols.at(symbol_);
+        return expr::Dual{apply(x, constant_), symbol_ == context.variable_ ? partial(constant_) : 0.0};
+    }
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final {
+        expr::TapeValue x = tape.variable(symbol_, symbols.at(symbol_));
+        return tape.unary(apply(x.value_, constant_), x, partial(constant_));
+    }
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final {
+        return positioned(std::make_unique<SymbolConstantNode>(symbol_, constant_, symbol_position_));
+    }
+};
+
+using ScaledSymbolNode = SymbolConstantNode<SymbolOperation::Multiply>;
+using ShiftedSymbolNode = SymbolConstantNode<SymbolOperation::Add>;
+
+/**
+ * @struct FusionCounts
+ *
+ * @brief Rewrites made by fuse_operations, by kind.
+ */
+struct FusionCounts {
+    std::size_t fma_ = 0;         // Products plus an addend into FmaNode
+    std::size_t scaled_ = 0;      // Symbols times a constant into ScaledSymbolNode
+    std::size_t shifted_ = 0;     // Symbols plus or minus a constant into ShiftedSymbolNode
+    std::size_t reciprocals_ = 0; // Divisions by a constant into multiplications by its reciprocal
+
+    std::size_t total() const noexcept { return fma_ + scaled_ + shifted_ + reciprocals_; }
+};
+
+/**
+ * @brief Rewrites the common arithmetic patterns into fused nodes that evaluate them in fewer calls.
+ *
+ * @param tree the root of the expression tree, possibly replaced
+ * @param mode which patterns are rewritten
+ * @returns the number of rewrites of each kind
+ * @note Division by a constant is rewritten first, so x/4 goes on to become a scaled symbol and a/4 + c a fused
+ *       multiply-add. Division by 0 is kept for its error. Operands are evaluated in the order of the tree and errors
+ *       keep their positions; values differ from the tree in the last bit where std::fma skips the rounding of the
+ *       product, or where FusionMode::Fast rounds a reciprocal. The fused nodes have no counterpart in typed programs, so
+ *       the pass is for evaluation in double.
+ */
+FusionCounts fuse_operations(std::unique_ptr<expr::ExprNode>& tree, FusionMode mode = FusionMode::Exact);
+
+} // namespace fusion
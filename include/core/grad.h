@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "utils/autodiff.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace grad {
+
+constexpr std::size_t kForwardVariables = 2; // Largest gradient computed in forward mode by gradient()
+
+/**
+ * @struct Gradient
+ *
+ * @brief The value of an expression and its partial derivatives.
+ */
+struct Gradient {
+    types::Numeral value_ = 0;
+    std::vector<types::Numeral> partials_; // One per variable, in the order requested
+};
+
+/**
+ * @brief Differentiates in reverse mode: one recorded evaluation and one backward sweep, whatever the variable count.
+ *
+ * @param tree the root node of the expression tree
+ * @param symbols the symbol table, holding the point to differentiate at
+ * @param variables the symbols to differentiate against; the others are held constant
+ * @param tape if not nullptr, a tape to reuse; it holds the recording afterwards
+ * @returns the value and the partial derivatives
+ * @throws std::runtime_error on the errors ExprNode::evaluate throws for
+ */
+Gradient reverse(const expr::ExprNode& tree, const SymbolTable& symbols, const std::vector<types::Symbol>& variables,
+    expr::Tape* tape = nullptr);
+
+/**
+ * @brief Differentiates in forward mode with dual numbers, one evaluation per variable.
+ *
+ * @param tree the root node of the expression tree
+ * @param symbols the symbol table, holding the point to differentiate at
+ * @param variables the symbols to differentiate against; the others are held constant
+ * @returns the value and the partial derivatives
+ * @throws std::runtime_error on the errors ExprNode::evaluate throws for
+ */
+Gradient forward(const expr::ExprNode& tree, const SymbolTable& symbols, const std::vector<types::Symbol>& variables);
+
+/**
+ * @brief Differentiates in forward mode for up to kForwardVariables variables, in reverse mode otherwise.
+ *
+ * @param tree the root node of the expression tree
+ * @param symbols the symbol table, holding the point to differentiate at
+ * @param variables the symbols to differentiate against; the others are held constant
+ * @returns the value and the partial derivatives
+ */
+Gradient gradient(const expr::ExprNode& tree, const SymbolTable& symbols, const std::vector<types::Symbol>& variables);
+
+/**
+ * @brief Parses a point such as `x=1,y=2.5`.
+ *
+ * @param point the point
+ * @param symbols the symbol table to add the coordinates to
+ * @returns the variables, in order
+ * @throws std::invalid_argument if the point is malformed or gives a symbol twice
+ */
+std::vector<types::Symbol> parse_point(const std::string& point, SymbolTable& symbols);
+
+} // namespace grad
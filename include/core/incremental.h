@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "data/expected.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace incremental {
+
+/**
+ * @class Evaluator
+ *
+ * @brief Evaluates an expression again and again as some of its symbols change, recomputing only what they reach.
+ * @note Each node of the tree knows the set of symbols below it. Evaluation runs on a residual tree: the nodes whose
+ *       set meets the changing symbols are copied, and every other subtree under them is replaced by a node that
+ *       caches its last value. Evaluating the residual thus recomputes the paths from the changed symbols to the root
+ *       only. A cached subtree is evaluated the first time it is reached, so untaken branches stay unevaluated and
+ *       errors surface where they would in the tree. The residual is rebuilt when a symbol outside its changing set
+ *       changes. Calls of impure user-defined functions, which read symbols the tree does not show, are never cached.
+ *       Values computed in NumericMode::IEEE are cached for that mode only, as they may hide errors. Not thread-safe;
+ *       the tree must outlive the evaluator.
+ */
+class Evaluator {
+public:
+    // Cached value of a node; state_ tells the modes it holds for
+    struct Slot {
+        enum class State : std::uint8_t { Empty, Strict, IEEE };
+        types::Numeral value_ = 0;
+        State state_ = State::Empty;
+    };
+
+private:
+    SymbolTable symbols_;
+    std::unordered_map<types::Symbol, std::size_t> symbol_indices_; // Bit of each symbol of the tree
+    std::size_t words_ = 1;                        // Words of a symbol set
+    std::vector<const expr::ExprNode*> nodes_;     // Nodes in preorder
+    std::vector<std::size_t> subtree_ends_;        // One past the last node of the subtree of each node
+    std::vector<std::uint64_t> dependencies_;      // Symbol set of each node, words_ words each
+    std::vector<bool> impure_;                     // Whether a node calls an impure function
+    std::unique_ptr<Slot[]> slots_;                // Cached value of each node
+    std::vector<std::uint64_t> changing_;          // Symbols the residual recomputes
+    std::vector<std::uint64_t> changed_;           // Symbols set since the last evaluation
+    std::unique_ptr<expr::ExprNode> residual_;
+    std::size_t residual_nodes_ = 0;               // Nodes of the tree copied into the residual
+
+    bool meets(std::size_t node, const std::vector<std::uint64_t>& set) const noexcept;
+    void prune(expr::ExprNode& copy, std::size_t node);
+    void prepare();
+
+public:
+    /**
+     * @brief Constructor for Evaluator.
+     *
+     * @param tree the root of the expression tree
+     * @param symbols the initial values of the symbols
+     */
+    Evaluator(const expr::ExprNode& tree, const SymbolTable& symbols);
+
+    Evaluator(const Evaluator& other) = delete;
+    Evaluator& operator=(const Evaluator& other) = delete;
+
+    /**
+     * @brief Changes the value of a symbol for the next evaluations.
+     *
+     * @param symbol name of the symbol
+     * @param value value of the symbol
+     */
+    void set(const types::Symbol& symbol, types::Numeral value);
+
+    const SymbolTable& symbols() const noexcept { return symbols_; }
+
+    /**
+     * @brief Evaluates the expression at the current values, as ExprNode::evaluate does.
+     *
+     * @returns the value
+     * @throws std::runtime_error on the errors ExprNode::evaluate throws for
+     */
+    types::Numeral evaluate();
+
+    /**
+     * @brief Evaluates the expression at the current values, without throwing, as eval::try_evaluate does.
+     *
+     * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+     * @returns the value, or the first error met
+     */
+    types::Expected<types::Numeral> try_evaluate(expr::NumericMode mode = expr::NumericMode::Strict);
+
+    /**
+     * @brief Evaluates the expression at evenly spaced values of one symbol, the others held at their values.
+     *
+     * @param symbol the symbol swept
+     * @param first the first value of the symbol
+     * @param last the last value of the symbol, reached exactly
+     * @param steps the number of values, first only if 1
+     * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+     * @returns the value or the error at each point; the symbol keeps the last value
+     */
+    std::vector<types::Expected<types::Numeral>> sweep(const types::Symbol& symbol, types::Numeral first, types::Numeral last,
+        std::size_t steps, expr::NumericMode mode = expr::NumericMode::IEEE);
+
+    /**
+     * @brief Acquires the number of nodes of the tree.
+     */
+    std::size_t nodes() const noexcept { return nodes_.size(); }
+
+    /**
+     * @brief Acquires the number of nodes recomputed by each evaluation, for the symbols changing last.
+     */
+    std::size_t recomputed() const noexcept { return residual_nodes_; }
+};
+
+/**
+ * @brief Acquires value i of a sweep of steps values from first to last, evenly spaced, as Evaluator::sweep sets them.
+ */
+types::Numeral sweep_point(types::Numeral first, types::Numeral last, std::size_t steps, std::size_t i) noexcept;
+
+/**
+ * @struct Sweep
+ *
+ * @brief A symbol and the values to sweep it through.
+ */
+struct Sweep {
+    types::Symbol symbol_;
+    types::Numeral first_ = 0;
+    types::Numeral last_ = 0;
+    std::size_t steps_ = 1;
+};
+
+/**
+ * @brief Parses a sweep such as `x=0:1:11,y=2`: a symbol from 0 to 1 in 11 values, and fixed values of others.
+ *
+ * @param text the sweep, then the fixed values
+ * @param symbols the symbol table to add the fixed values to
+ * @returns the sweep
+ * @throws std::invalid_argument if the text is malformed or gives a symbol twice
+ */
+Sweep parse_sweep(const std::string& text, SymbolTable& symbols);
+
+} // namespace incremental
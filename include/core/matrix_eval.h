@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include "core/dispatcher.h"
+#include "data/datatype_decl.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace matrix_eval {
+
+constexpr std::size_t kElementBlock = 1024; // Elements an element-wise expression computes at a time
+
+/**
+ * @brief Evaluates an expression over scalars, vectors and matrices.
+ *
+ * @param tree the root of the expression tree
+ * @param symbols the values of the scalar symbols
+ * @param values the values of the vector and matrix symbols, which hide scalar symbols of the same name
+ * @param threads the number of threads of large matrix products (see linalg::multiply)
+ * @returns the value, a scalar if no vector or matrix reaches the root
+ * @throws std::runtime_error on the errors ExprNode::evaluate throws for, at any element, if the shapes of the
+ *         operands do not fit, if solve meets a singular matrix, or if an operation that takes scalars only meets a
+ *         vector or matrix
+ * @note A * B is the matrix product when both are vectors or matrices, except that vectors multiply element-wise;
+ *       dot(u, v) is the inner product, solve(A, b) the solution of A x = b, transpose(A) and det(A) what they say.
+ *       The other arithmetic operators and the elementary functions apply element by element, broadcasting as numpy
+ *       does: a scalar goes with every element, and a vector of n elements acts as a 1 x n matrix, whose single row
+ *       goes with every row. Comparisons, logic, if, binom and user-defined functions take scalars only.
+ *
+ *       Element-wise operations are not computed node by node. A tree of them is evaluated kElementBlock elements at
+ *       a time, each node filling a block from the blocks of its operands, so `A*2 + B` makes one pass over A and B
+ *       and allocates its result only.
+ */
+dispatcher::Result evaluate(const expr::ExprNode& tree, const SymbolTable& symbols, const dispatcher::Bindings& values,
+    unsigned threads = 1);
+
+/**
+ * @brief Reads a vector or matrix from a file, a row per line of numbers separated by commas or white space.
+ *
+ * @param path the path of the file; empty lines and lines starting with '#' are skipped
+ * @returns a vector if the file holds one row or one column, a matrix otherwise
+ * @throws std::invalid_argument if the file cannot be read, holds no numbers, a malformed number, or rows of
+ *         different lengths
+ */
+dispatcher::Result load(const std::string& path);
+
+/**
+ * @brief Parses a binding such as `A=a.txt` and loads its file.
+ *
+ * @param text the symbol, an equals sign and the path
+ * @returns the symbol and its value
+ * @throws std::invalid_argument if the text is malformed or the file cannot be loaded
+ */
+std::pair<types::Symbol, dispatcher::Result> parse_binding(const std::string& text);
+
+/**
+ * @brief Converts a value to text: a vector as [a, b, c], a matrix as such a row per line.
+ */
+std::string to_string(const dispatcher::Result& value);
+
+} // namespace matrix_eval
@@ -8,6 +8,7 @@
 #include <stdexcept>
 #include "globals.h"
 #include "data/datatype_decl.h"
+#include "data/expected.h"
 #include "utils/expr_node.h"
 #include "utils/operator_table.h"
 
@@ -32,9 +33,33 @@ typedef std::pair<TokenType, TokenContent> Token;
  * 
  * @param expression the expression, a single std::string
  * @returns a std::vector containing the tokens
+ * @throw std::runtime_error if the expression is empty or encounters an invalid number
+ * @note Spaces separate tokens, so that `1 < 2 and x` splits at `and`.
  */
 std::vector<Token> tokenize(std::string expression);
 
+/**
+ * @brief Splits the expression into tokens without throwing.
+ * 
+ * @param expression the expression
+ * @param positions if not nullptr, filled with the offset in expression of each token
+ * @returns the tokens, or the error with its position in expression
+ */
+types::Expected<std::vector<Token>> try_tokenize(const std::string& expression, std::vector<std::size_t>* positions = nullptr);
+
+/**
+ * @brief Splits a long expression into tokens on several threads, without throwing.
+ * 
+ * @param expression the expression
+ * @param threads the number of threads
+ * @param positions if not nullptr, filled with the offset in expression of each token
+ * @returns the same tokens as try_tokenize, or the same error
+ * @note The expression is cut into one chunk per thread, each cut moved forward to just after a space, bracket or
+ *       comma, where the sequential scan ends a token as well. Expressions under 64 KiB are tokenized on this thread.
+ */
+types::Expected<std::vector<Token>> try_tokenize_parallel(const std::string& expression, unsigned threads,
+    std::vector<std::size_t>* positions = nullptr);
+
 /**
  * @brief Removes the spaces in a given expression.
  * 
@@ -47,9 +72,9 @@ void remove_spaces(std::string& expression);
  * 
  * @param token_begin the iterator pointing to the begin of the token
  * @param expr_end the iterator pointing to the end of the expression
- * @returns a std::pair, first item std::string::iterator pointing to the end of the token (next place, by STL convention), second item token type
+ * @returns a std::pair, first item std::string::const_iterator pointing to the end of the token (next place, by STL convention), second item token type
  */
-std::pair<std::string::iterator, TokenType> find_token_end(std::string::iterator token_begin, std::string::iterator expr_end);
+std::pair<std::string::const_iterator, TokenType> find_token_end(std::string::const_iterator token_begin, std::string::const_iterator expr_end);
 
 /**
  * @brief Converts a string of a token to a Token.
@@ -60,7 +85,7 @@ std::pair<std::string::iterator, TokenType> find_token_end(std::string::iterator
  * @returns the Token converted from the std::string
  * @throw std::runtime_error if encounters an invalid number
  */
-Token string_to_token(std::string::iterator token_begin, std::string::iterator token_end, TokenType token_type);
+Token string_to_token(std::string::const_iterator token_begin, std::string::const_iterator token_end, TokenType token_type);
 
 /**
  * @brief Recognizes the brackets and operators in the token array.
@@ -100,4 +125,16 @@ inline bool is_symbol_middle(char ch) { return is_symbol_start(ch) || std::isdig
  */
 inline bool is_bracket(const std::string& str) { return str == "(" || str == ")" || str == "[" || str == "]" || str == "{" || str == "}"; }
 
+/**
+ * @brief Checks whether two characters form an operator written as one token.
+ *
+ * @param first the first character
+ * @param second the second character
+ * @note Only the comparisons <=, >=, == and !=; the prefix ++ and -- of the operator table are internal names, so
+ *       that `2--3` is 2 - (-3).
+ */
+inline bool is_two_character_operator(char first, char second) {
+    return second == '=' && (first == '<' || first == '>' || first == '=' || first == '!');
+}
+
 }; // namespace parser
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "data/datatype_decl.h"
+#include "functional/polynomial.h"
+#include "utils/autodiff.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace poly {
+
+// Which subtrees collect_polynomials rewrites
+enum class PolynomialMode {
+    Off,     // None
+    Collect, // Sums of terms, multiplying out only products with a single-term factor (such as 3*x*x*x + 2*x - 7)
+    Expand   // Also products of sums (such as (x+1)*(x-1)), which may cancel catastrophically
+};
+
+/**
+ * @class PolynomialNode
+ *
+ * @brief Node of a polynomial in one variable, its child being the variable (a symbol or a function parameter).
+ */
+class PolynomialNode : public expr::UnaryNode {
+private:
+    Polynomial polynomial_;
+    Polynomial derivative_; // For automatic differentiation
+
+public:
+    /**
+     * @brief Constructor for PolynomialNode.
+     *
+     * @param variable rvalue reference to a std::unique_ptr to the variable
+     * @param polynomial the polynomial
+     */
+    PolynomialNode(std::unique_ptr<expr::ExprNode>&& variable, Polynomial polynomial);
+
+    const Polynomial& polynomial() const noexcept { return polynomial_; }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final;
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final;
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final;
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final;
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final;
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final;
+};
+
+/**
+ * @brief Replaces the polynomial subtrees in one variable by PolynomialNodes.
+ *
+ * @param tree the root of the expression tree, possibly replaced
+ * @param mode which subtrees are rewritten
+ * @returns the number of subtrees rewritten
+ * @note A subtree is rewritten only if its polynomial has fewer operations than the subtree. Division is folded
+ *       only by a power of 2, whose reciprocal is exact. Results may differ from the tree in the last bits.
+ */
+std::size_t collect_polynomials(std::unique_ptr<expr::ExprNode>& tree, PolynomialMode mode = PolynomialMode::Collect);
+
+} // namespace poly
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "functional/stats.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace sampling {
+
+constexpr std::size_t kSampleBlock = 4096; // Samples drawn and evaluated together, whichever thread takes them
+
+// Families of distributions
+enum class Family { Normal, Uniform, LogNormal, Exponential };
+
+/**
+ * @struct Distribution
+ *
+ * @brief A distribution to draw the values of a symbol from.
+ */
+struct Distribution {
+    Family family_ = Family::Normal;
+    double a_ = 0; // Mean (normal, mean of the logarithm for lognormal), lower bound (uniform) or rate (exponential)
+    double b_ = 1; // Standard deviation (normal, of the logarithm for lognormal) or upper bound (uniform)
+};
+
+/**
+ * @brief Parses a distribution such as `x ~ normal(0, 1)`.
+ *
+ * @param text the symbol, a tilde and the distribution: normal(mean, sd), uniform(low, high), lognormal(mean, sd)
+ *        or exponential(rate)
+ * @returns the symbol and its distribution
+ * @throws std::invalid_argument if the text is malformed or the parameters are out of range
+ */
+std::pair<types::Symbol, Distribution> parse_distribution(const std::string& text);
+
+/**
+ * @struct SamplingOptions
+ *
+ * @brief Options of a sampling run.
+ */
+struct SamplingOptions {
+    std::uint64_t samples_ = 1000000;            // Number of samples
+    std::uint64_t seed_ = 0;                     // Key of the random streams
+    unsigned threads_ = 1;                       // Number of worker threads
+    double accuracy_ = stats::kQuantileAccuracy; // Relative error of the quantiles
+};
+
+/**
+ * @struct SamplingSummary
+ *
+ * @brief Summaries of the values of an expression over the samples.
+ */
+struct SamplingSummary {
+    stats::Moments moments_;          // Of the finite values
+    stats::QuantileSketch quantiles_; // Of the values other than NaN
+    std::uint64_t non_finite_ = 0;    // Values that are infinite or NaN
+};
+
+/**
+ * @brief Evaluates an expression at samples of its symbols drawn from distributions.
+ *
+ * @param tree the root of the expression tree
+ * @param distributions the distributions of the random symbols
+ * @param symbols the values of the other symbols
+ * @param options the sampling options
+ * @returns the summaries of the values
+ * @throws std::invalid_argument if a symbol has neither a distribution nor a value, or two distributions, or if the
+ *         tree has a node without a typed counterpart
+ * @note The samples are cut into blocks of kSampleBlock, which the workers claim in turn. Each random symbol draws
+ *       from its own Philox stream, the one of its index in distributions, so the value of a symbol at a sample
+ *       depends on the seed only. A block is evaluated with typed::Program<double>::evaluateBulk into the moments
+ *       and the quantile sketch of its worker, which are merged at the end; both sum exactly, so the summaries are
+ *       the same bits for any number of threads and whichever blocks each worker claimed. Numerical errors propagate as in
+ *       NumericMode::IEEE.
+ */
+SamplingSummary sample(const expr::ExprNode& tree, const std::vector<std::pair<types::Symbol, Distribution>>& distributions,
+    const SymbolTable& symbols, const SamplingOptions& options);
+
+} // namespace sampling
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <string>
+#include "core/batch.h"
+#include "utils/symbol_table.h"
+
+namespace server {
+
+/**
+ * @struct ServerOptions
+ *
+ * @brief Options of the evaluation server.
+ */
+struct ServerOptions {
+    std::string socket_path_;          // Path of the Unix domain socket to listen on
+    unsigned workers_ = 1;             // Number of evaluation worker threads
+    std::size_t max_in_flight_ = 1024; // Pipelined requests per connection before reading is paused
+    batch::BatchOptions evaluation_;   // How requests are evaluated, as batch::evaluate_line does (threads_, report_,
+                                       // slowest_, memo_stats_ and workers_ are not used)
+};
+
+/**
+ * @brief Serves evaluation requests over a Unix domain socket until SIGINT or SIGTERM.
+ *
+ * @param options the server options
+ * @param symbols the initial values of the symbols, shared by all requests
+ * @throws std::runtime_error if the socket cannot be set up, or something other than a socket exists at its path
+ * @note Protocol: the first byte a client sends selects the framing of the whole connection.
+ *       A zero byte selects length-prefixed frames (4-byte big-endian length followed by the payload),
+ *       anything else selects newline-delimited frames. Requests are expressions; every request gets one
+ *       response in the same framing, either the result or "error: <message> at position <n>". A client may
+ *       pipeline any number of requests; responses always come back in request order.
+ *       A request "name = expression" sets the symbol to the value of the expression in double, and responds with
+ *       that value once the requests before it on the connection have been evaluated. Those see the old value, the
+ *       requests after it and those read later on any connection the new one; requests of other connections read
+ *       meanwhile may see either. Every other request is evaluated against one consistent version of the symbols.
+ *       A request whose evaluation throws is answered with "error: <message>", and the server carries on.
+ */
+void serve(const ServerOptions& options, const SymbolTable& symbols);
+
+/**
+ * @brief Serves the requests of one connected client, as serve does, until the client shuts down its writing side and
+ *        every response has been written.
+ *
+ * @param fd the connected stream socket, closed on return
+ * @param options the server options (socket_path_ is not used)
+ * @param symbols the initial values of the symbols
+ * @throws std::runtime_error if the event loop cannot be set up
+ */
+void serve_connection(int fd, const ServerOptions& options, const SymbolTable& symbols);
+
+/**
+ * @brief Evaluates a single request.
+ *
+ * @param expression the expression to evaluate
+ * @param symbols the symbol table
+ * @param options the numeric mode, type, functions and rewrite passes to evaluate with
+ * @returns the formatted result, or "error: <message> at position <n>"
+ */
+std::string evaluate_request(const std::string& expression, const SymbolTable& symbols, const batch::BatchOptions& options);
+
+} // namespace server
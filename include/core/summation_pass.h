@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "utils/autodiff.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace summation {
+
+/**
+ * @class ExactSumNode
+ *
+ * @brief Node of a chain of additions and subtractions, a + b - c + ..., summed exactly by stats::ExactSum and
+ *        rounded once, so its value does not depend on the order or the grouping of the terms.
+ * @note The children are the terms in source order, which is the order they are evaluated in; the first is added,
+ *       the others added or subtracted by their signs. Derivatives are the exact sums of the derivatives of the terms.
+ */
+class ExactSumNode : public expr::MultinaryNode {
+private:
+    std::vector<types::Numeral> signs_; // 1 or -1 per term
+
+public:
+    /**
+     * @brief Constructor for ExactSumNode.
+     *
+     * @param children rvalue reference to the terms, in source order
+     * @param signs the sign of each term
+     */
+    ExactSumNode(std::vector<std::unique_ptr<expr::ExprNode>>&& children, std::vector<types::Numeral> signs);
+
+    types::Numeral sign(std::size_t index) const noexcept { return signs_[index]; }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final;
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final;
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final;
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final;
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final;
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final;
+};
+
+/**
+ * @brief Rewrites every chain of at least three terms joined by + and - into an ExactSumNode.
+ *
+ * @param tree the root of the expression tree, possibly replaced
+ * @returns the number of chains rewritten
+ * @note Nested additions and subtractions join the chain of the node above them whatever the brackets, with the signs
+ *       of the subtractions distributed over them, so `a - (b - c)` is a - b + c. Two terms are left alone, as a + b
+ *       is already rounded once. Values differ from the tree where its intermediate sums round; a zero sum is +0.
+ *       ExactSumNode has no counterpart in typed programs, so the pass is for evaluation in double.
+ */
+std::size_t collect_sums(std::unique_ptr<expr::ExprNode>& tree);
+
+} // namespace summation
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "data/expected.h"
+#include "data/rational.h"
+#include "utils/expr_node.h"
+#include "utils/symbol_table.h"
+
+namespace typed {
+
+// Numeric types an expression can be evaluated in
+enum class NumericType {
+    Float,      // float, twice the SIMD lanes of double in bulk evaluation
+    Double,     // double, the type of types::Numeral
+    LongDouble, // long double (x87 extended precision on x86)
+    Float128,   // __float128 (quadruple precision in software), if CALC_HAS_FLOAT128 is defined
+    Rational    // types::Rational, exact
+};
+
+constexpr std::size_t kLanes = 256; // Points evaluated together by each instruction of Program::evaluateBulk
+
+/**
+ * @brief Acquires the numeric type of a name (float, double, long-double, float128 or rational).
+ *
+ * @throws std::invalid_argument if the name is unknown, or the type is not available in this build
+ */
+NumericType parse_numeric_type(const std::string& name);
+
+/**
+ * @brief Acquires the name of a numeric type, as accepted by parse_numeric_type.
+ */
+const char* numeric_type_name(NumericType type) noexcept;
+
+/**
+ * @brief Parses a number in the numeric type T, rounding the decimal string once.
+ *
+ * @throws std::invalid_argument if str is not a number
+ */
+template <typename T>
+T from_string(const std::string& str);
+
+/**
+ * @brief Formats a number of the numeric type T with the digits needed to tell it apart from its neighbours.
+ */
+template <typename T>
+std::string to_string(T value);
+
+/**
+ * @brief Converts a numeral to the numeric type T through its shortest decimal representation.
+ *
+ * @note The literal 0.1 is parsed as a double; converting that double exactly would carry its rounding error into
+ *       the wider types, whereas its shortest decimal "0.1" rounds to the nearest value of T. Literals with more digits
+ *       than a double keeps are compiled from their text instead (see expr::NumeralNode::text).
+ */
+template <typename T>
+T from_numeral(types::Numeral value);
+
+/**
+ * @class Program
+ *
+ * @brief An expression tree compiled for evaluation in the numeric type T.
+ * @note The tree is flattened into stack code once, with its constants and symbols converted to T, so that evaluation
+ *       runs entirely in T without converting or dispatching on the type. The numeric type is chosen by instantiating
+ *       the class (see evaluate_as), never inside the evaluation loop.
+ *
+ * @tparam T float, double, long double, __float128 or types::Rational
+ */
+template <typename T>
+class Program {
+public:
+    // Operations of the stack code
+    enum class Op : std::uint8_t {
+        Constant, Load, Parameter,                                     // Push constants_, a symbol, a parameter
+        Negate, Add, Subtract, Multiply, DivideReversed,               // Arithmetic on the top of the stack, the last
+                                                                       // dividing the top by the value under it
+        Less, LessEqual, Greater, GreaterEqual, Equal, NotEqual, Not,  // Comparisons and logic, giving 1 or 0
+        Truth, And, Or, Select,                                        // Eager logic and conditional (bulk code)
+        Polynomial,                                                    // Horner's scheme on polynomials_
+        Elementary, Power, Binomial,                                   // elementary::Function in operand_, x^y, binom(n, k)
+        Jump, JumpIfZero, JumpIfNonZero,                               // Lazy logic and conditional (scalar code)
+        Call, Return, Halt                                             // User-defined functions
+    };
+
+    struct Instruction {
+        Op op_;
+        std::uint32_t operand_ = 0; // Index into constants_, symbols_, polynomials_, functions_, a jump target, or a function
+        std::size_t position_ = 0;  // Position of the node in the source expression, for errors
+    };
+
+private:
+    struct Function {
+        std::string name_;
+        std::size_t arity_ = 0;
+        std::size_t entry_ = 0; // First instruction of the body in code_
+    };
+
+    std::vector<Instruction> code_;          // Lazy code: branches jump, function bodies follow the expression
+    std::vector<Instruction> bulk_code_;     // Eager branchless code, empty if the expression calls functions
+    std::vector<T> constants_;
+    std::vector<std::vector<T>> polynomials_; // Coefficients, lowest power first
+    std::vector<types::Symbol> symbols_;      // Symbols, in the order of their values
+    std::vector<std::size_t> symbol_positions_; // Position of the first occurrence of each symbol
+    std::vector<Function> functions_;
+    std::size_t stack_size_ = 1;             // Deepest stack of the expression, excluding function calls
+    types::Error error_;                     // Why the tree could not be compiled, code_ None if it was
+
+    std::uint32_t constant(T value);
+    std::uint32_t symbol(const types::Symbol& name, std::size_t position);
+    void compile(const expr::ExprNode& node, bool lazy, std::size_t depth, std::vector<Instruction>& code,
+        std::vector<const expr::ExprNode*>& bodies);
+
+public:
+    /**
+     * @brief Compiles an expression tree.
+     *
+     * @param tree the root of the expression tree
+     * @note A tree T cannot evaluate, such as an irrational constant (pi, e) or function (sqrt, exp, log, sin, cos)
+     *       or an infinite literal when T is exact, compiles to a program whose evaluations report the error.
+     */
+    explicit Program(const expr::ExprNode& tree);
+
+    /**
+     * @brief Checks whether the tree compiled, so that evaluations can succeed.
+     */
+    bool compiled() const noexcept { return error_.code_ == types::ErrorCode::None; }
+
+    /**
+     * @brief Acquires why the tree could not be compiled.
+     */
+    const types::Error& error() const noexcept { return error_; }
+
+    /**
+     * @brief Acquires the symbols of the expression, in the order evaluate expects their values.
+     */
+    const std::vector<types::Symbol>& symbols() const noexcept { return symbols_; }
+
+    /**
+     * @brief Evaluates the expression, without throwing.
+     *
+     * @param values the values of symbols(), in order
+     * @param status records the first error met, and selects how numerical errors are handled
+     * @returns the result, meaningless if status reports an error
+     * @note Like ExprNode::evaluateChecked, only the branch taken by if, and and or is evaluated. A type without
+     *       infinities (types::Rational) reports division by 0 in either mode. Calls are not memoized.
+     */
+    T evaluate(const T* values, expr::EvalStatus& status) const noexcept;
+
+    /**
+     * @brief Evaluates the expression with the values of the symbol table, converted to T.
+     *
+     * @param symbols the symbol table
+     * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+     * @returns the result, or the first error met
+     */
+    types::Expected<T> evaluate(const SymbolTable& symbols, expr::NumericMode mode = expr::NumericMode::Strict) const;
+
+    /**
+     * @brief Evaluates the expression at many points, kLanes points per instruction.
+     *
+     * @param columns for each symbol of symbols(), in order, its values at the points
+     * @param count the number of points
+     * @param results receives the value at each point
+     * @param errors if not nullptr, receives the first error at each point, code None if there is none, as evaluate
+     *        gives it in NumericMode::Strict; the value at a point with an error is meaningless
+     * @note Numerical errors propagate as in NumericMode::IEEE, and both branches of if, and and or are evaluated and
+     *       selected per point, so the loop over the points of each instruction vectorizes. Expressions that call
+     *       non-inlined functions are evaluated point by point. For a type without infinities, division by 0 and
+     *       fractional powers throw std::domain_error, as do all evaluations of a program that did not compile.
+     *       With errors, the points where an instruction gave an infinity or NaN are evaluated again by evaluate, so
+     *       that only the errors of the branches taken are reported; a type without infinities goes point by point.
+     */
+    void evaluateBulk(const T* const* columns, std::size_t count, T* results, types::Error* errors = nullptr) const;
+};
+
+/**
+ * @brief Compiles and evaluates an expression tree in a numeric type.
+ *
+ * @param type the numeric type
+ * @param tree the root of the expression tree
+ * @param symbols the symbol table
+ * @param mode whether numerical errors are errors, or propagate as infinities and NaNs
+ * @returns the result formatted by to_string, or the first error met, including a tree the type cannot evaluate
+ */
+types::Expected<std::string> evaluate_as(NumericType type, const expr::ExprNode& tree, const SymbolTable& symbols,
+    expr::NumericMode mode = expr::NumericMode::Strict);
+
+extern template class Program<float>;
+extern template class Program<double>;
+extern template class Program<long double>;
+extern template class Program<types::Rational>;
+#ifdef CALC_HAS_FLOAT128
+extern template class Program<__float128>;
+#endif
+
+} // namespace typed
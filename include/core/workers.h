@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "utils/symbol_table.h"
+#include "core/batch.h"
+
+namespace workers {
+
+constexpr std::size_t kRingBytes = std::size_t(1) << 20; // Bytes of each ring between the coordinator and a worker
+constexpr std::size_t kMaxInFlight = 256; // Records sent to a worker and not answered yet
+constexpr unsigned kMaxAttempts = 3;      // Workers a record may crash before it is reported as an error
+
+/**
+ * @struct WorkerOptions
+ *
+ * @brief Options of a multi-process batch run.
+ */
+struct WorkerOptions {
+    unsigned workers_ = 1;                  // Number of worker processes, at most kMaxWorkers
+    std::size_t ring_bytes_ = kRingBytes;   // Bytes of each ring, rounded up to a power of 2
+    unsigned max_attempts_ = kMaxAttempts;  // Attempts at a record that crashes its worker
+    std::function<void(std::size_t index, unsigned attempt)> fault_hook_; // Called by a worker before each record, for tests
+};
+
+/**
+ * @brief Evaluates every expression in forked worker processes, as batch::run does with threads.
+ *
+ * @param expressions the expressions, one per input line
+ * @param symbols the symbol table, inherited by the workers
+ * @param options the batch options, inherited by the workers (threads_ is ignored)
+ * @param worker_options the worker options
+ * @param outputs filled with one output line per expression, either the result or the error message
+ * @returns the merged latency report, with the number of workers restarted
+ * @throws std::runtime_error if the shared memory cannot be set up or a worker cannot be forked
+ * @note Each worker shares two single-producer single-consumer rings with this process in POSIX shared memory, one
+ *       for the expression records it is sent and one for its results, each indexed by a head and a tail counter
+ *       that only one side writes. This process hands out records to the workers with room, at most kMaxInFlight
+ *       each, and writes the results in input order. A worker that dies is forked again, and the records it had not
+ *       answered are sent again; a record that crashes max_attempts_ workers gets an error line instead. Expressions
+ *       longer than a quarter of a ring are evaluated in this process.
+ */
+batch::BatchReport run(const std::vector<std::string>& expressions, const SymbolTable& symbols, const batch::BatchOptions& options,
+    const WorkerOptions& worker_options, std::vector<std::string>& outputs);
+
+} // namespace workers
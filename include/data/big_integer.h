@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace types {
+
+/**
+ * @class BigInteger
+ *
+ * @brief Arbitrary-precision signed integer, stored as sign and magnitude in base 2^32 limbs.
+ * @note Used by Rational once a value no longer fits in 64 bits, and by the exact factorials and binomials of
+ *       functional/numbers.h. Multiplication is schoolbook for small operands, Karatsuba from 32 limbs and a
+ *       number-theoretic transform over three primes from 1536 limbs; division is Knuth's long division, or
+ *       multiplication by a Newton reciprocal for large divisors and quotients; decimal conversion splits by powers
+ *       of 10^9 from 128 limbs. gcd stays Euclid's; isqrt doubles the precision of its root by Newton steps.
+ */
+class BigInteger {
+private:
+    std::vector<std::uint32_t> limbs_; // Magnitude, least significant limb first, without leading zero limbs
+    bool negative_ = false;            // Never set for 0
+
+    void trim() noexcept;
+    static int compareMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) noexcept;
+    static std::vector<std::uint32_t> addMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b);
+    static std::vector<std::uint32_t> subtractMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b);
+    static std::vector<std::uint32_t> multiplyMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b);
+
+    // The value times B^count, or divided by B^-count truncating toward 0 if count is negative (B = 2^32)
+    BigInteger shiftLimbs(std::ptrdiff_t count) const;
+
+    // floor(B^2n / divisor) for a positive divisor of n limbs whose top limb has its high bit set
+    static BigInteger reciprocal(const BigInteger& divisor);
+
+    // floor(B^precision / (divisor 2^s)) for a positive divisor, with s the shift setting the high bit of its top limb;
+    // precision is at least twice its length
+    static BigInteger normalizedInverse(const BigInteger& divisor, std::size_t precision);
+
+    // Quotient and remainder of non-negative values by multiplying with normalizedInverse(divisor, precision), where
+    // the dividend times 2^s is below B^precision
+    BigInteger divideNewton(const BigInteger& divisor, const BigInteger& inverse, std::size_t precision, BigInteger& remainder) const;
+
+    // Appends the decimal digits of a non-negative value, padded with zeros to the given number of digits;
+    // inverses caches the normalizedInverse of the powers of 10 used as divisors
+    static void appendDecimal(const BigInteger& value, const std::vector<BigInteger>& powers, std::vector<BigInteger>& inverses,
+        std::size_t digits, std::string& out);
+
+    friend BigInteger isqrt(const BigInteger& value);
+
+public:
+    /**
+     * @brief Default constructor, 0.
+     */
+    BigInteger() = default;
+
+    /**
+     * @brief Constructor from a 64-bit integer.
+     */
+    BigInteger(std::int64_t value);
+
+    /**
+     * @brief Parses a decimal integer with an optional sign.
+     *
+     * @throws std::invalid_argument if str is not an integer
+     */
+    static BigInteger fromString(const std::string& str);
+
+    bool isZero() const noexcept { return limbs_.empty(); }
+    bool isNegative() const noexcept { return negative_; }
+    int sign() const noexcept { return negative_ ? -1 : (limbs_.empty() ? 0 : 1); }
+
+    /**
+     * @brief Whether the value fits in std::int64_t.
+     */
+    bool fitsInt64() const noexcept;
+
+    /**
+     * @brief Acquires the value as std::int64_t, meaningful only if fitsInt64().
+     */
+    std::int64_t toInt64() const noexcept;
+
+    /**
+     * @brief Acquires the nearest double (truncating beyond 64 significant bits).
+     */
+    double toDouble() const noexcept;
+
+    /**
+     * @brief Formats the value in decimal.
+     */
+    std::string toString() const;
+
+    BigInteger operator-() const;
+    BigInteger operator+(const BigInteger& other) const;
+    BigInteger operator-(const BigInteger& other) const;
+    BigInteger operator*(const BigInteger& other) const;
+
+    /**
+     * @brief Divides, truncating toward zero.
+     *
+     * @param divisor the divisor, not 0
+     * @param remainder if not nullptr, receives the remainder, with the sign of the dividend
+     * @returns the quotient
+     * @throws std::domain_error if divisor is 0
+     */
+    BigInteger divide(const BigInteger& divisor, BigInteger* remainder = nullptr) const;
+
+    /**
+     * @brief Compares two integers.
+     *
+     * @returns a negative value, 0 or a positive value as this is less than, equal to or greater than other
+     */
+    int compare(const BigInteger& other) const noexcept;
+
+    bool operator==(const BigInteger& other) const noexcept { return compare(other) == 0; }
+    bool operator!=(const BigInteger& other) const noexcept { return compare(other) != 0; }
+    bool operator<(const BigInteger& other) const noexcept { return compare(other) < 0; }
+};
+
+/**
+ * @brief Acquires the greatest common divisor, which is never negative.
+ */
+BigInteger gcd(BigInteger a, BigInteger b);
+
+/**
+ * @brief Acquires the integer square root, the largest integer whose square is at most value.
+ *
+ * @throws std::domain_error if value is negative
+ */
+BigInteger isqrt(const BigInteger& value);
+
+} // namespace types
@@ -1,7 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <initializer_list>
 #include <string>
+#include <utility>
 #include <variant>
+#include <vector>
 #include <stdexcept>
 #include "data/big_decimal.h"
 
@@ -11,6 +15,104 @@ typedef double Numeral;
 typedef std::string Symbol;
 typedef std::variant<Numeral, Symbol> Parameter;
 
+/**
+ * @class Vector
+ * 
+ * @brief Dense vector of numerals.
+ * @note In element-wise operations with a matrix, a vector of n numerals acts as a 1 x n matrix (a row).
+ */
+class Vector {
+private:
+    std::vector<Numeral> values_;
+
+public:
+    /**
+     * @brief Default constructor, of the empty vector.
+     */
+    Vector() = default;
+
+    /**
+     * @brief Constructor of a vector with every element equal.
+     * 
+     * @param size the number of elements
+     * @param value the value of each element
+     */
+    explicit Vector(std::size_t size, Numeral value = 0) : values_(size, value) {}
+
+    /**
+     * @brief Constructor of a vector from its elements.
+     */
+    Vector(std::initializer_list<Numeral> values) : values_(values) {}
+
+    /**
+     * @brief Constructor of a vector from its elements.
+     */
+    explicit Vector(std::vector<Numeral>&& values) : values_(std::move(values)) {}
+
+    std::size_t size() const noexcept { return values_.size(); }
+    Numeral* data() noexcept { return values_.data(); }
+    const Numeral* data() const noexcept { return values_.data(); }
+    Numeral& operator[](std::size_t i) noexcept { return values_[i]; }
+    const Numeral& operator[](std::size_t i) const noexcept { return values_[i]; }
+
+    bool operator==(const Vector& other) const noexcept { return values_ == other.values_; }
+    bool operator!=(const Vector& other) const noexcept { return values_ != other.values_; }
+};
+
+/**
+ * @class Matrix
+ * 
+ * @brief Dense matrix of numerals, stored by rows.
+ */
+class Matrix {
+private:
+    std::size_t rows_ = 0;
+    std::size_t columns_ = 0;
+    std::vector<Numeral> values_; // Row after row
+
+public:
+    /**
+     * @brief Default constructor, of the empty matrix.
+     */
+    Matrix() = default;
+
+    /**
+     * @brief Constructor of a matrix with every element equal.
+     * 
+     * @param rows the number of rows
+     * @param columns the number of columns
+     * @param value the value of each element
+     */
+    Matrix(std::size_t rows, std::size_t columns, Numeral value = 0) : rows_(rows), columns_(columns), values_(rows * columns, value) {}
+
+    /**
+     * @brief Constructor of a matrix from its elements.
+     * 
+     * @param rows the number of rows
+     * @param columns the number of columns
+     * @param values the elements, row after row
+     * @throws std::invalid_argument if there are not rows * columns elements
+     */
+    Matrix(std::size_t rows, std::size_t columns, std::vector<Numeral>&& values)
+        : rows_(rows), columns_(columns), values_(std::move(values)) {
+        if (values_.size() != rows * columns) throw std::invalid_argument("Matrix of " + std::to_string(rows) + "x"
+            + std::to_string(columns) + " given " + std::to_string(values_.size()) + " elements");
+    }
+
+    std::size_t rows() const noexcept { return rows_; }
+    std::size_t columns() const noexcept { return columns_; }
+    std::size_t size() const noexcept { return values_.size(); }
+    Numeral* data() noexcept { return values_.data(); }
+    const Numeral* data() const noexcept { return values_.data(); }
+    Numeral& operator()(std::size_t row, std::size_t column) noexcept { return values_[row * columns_ + column]; }
+    const Numeral& operator()(std::size_t row, std::size_t column) const noexcept { return values_[row * columns_ + column]; }
+
+    bool operator==(const Matrix& other) const noexcept {
+        return rows_ == other.rows_ && columns_ == other.columns_ && values_ == other.values_;
+    }
+    bool operator!=(const Matrix& other) const noexcept { return !(*this == other); }
+};
+
 /**
  * @brief Converts a string to a numeral.
  * 
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace types {
+
+// Kinds of errors reported by the non-throwing parse and evaluate path
+enum class ErrorCode {
+    None,
+    EmptyExpression,
+    InvalidNumber,
+    UnpairedBrackets,
+    MisplacedSeparator,
+    UndefinedOperator,
+    ArgumentCount,
+    MissingArguments,
+    UndefinedSymbol,
+    DivisionByZero,
+    InvalidDefinition,
+    CallDepth,
+    OutOfDomain,
+    Inexact,
+    TooLarge,
+    NoExactValue,
+    TooDeep,
+};
+
+/**
+ * @struct Error
+ *
+ * @brief An error of the non-throwing path, with its position in the source expression.
+ */
+struct Error {
+    ErrorCode code_ = ErrorCode::None;
+    std::size_t position_ = 0; // Offset of the offending token in the source expression
+    std::string detail_;       // Offending token (symbol, operator, number or function), if any
+    int expected_args_ = 0;    // For ArgumentCount, the arity of the operator
+    int received_args_ = 0;    // For ArgumentCount, the arguments available
+};
+
+/**
+ * @brief Describes an error with the same message the throwing path uses.
+ *
+ * @param error the error to describe
+ * @returns the message
+ */
+inline std::string error_message(const Error& error) {
+    switch (error.code_) {
+    case ErrorCode::None: return "No error";
+    case ErrorCode::EmptyExpression: return "Syntax error: Empty expression";
+    case ErrorCode::InvalidNumber: return "Numerical error: '" + error.detail_ + "' is not a valid number";
+    case ErrorCode::UnpairedBrackets: return "Syntax error: Unpaired brackets";
+    case ErrorCode::MisplacedSeparator: return "Syntax error: Misplaced comma or unpaired brackets";
+    case ErrorCode::UndefinedOperator: return "Syntax error: Operator '" + error.detail_ + "' undefined";
+    case ErrorCode::ArgumentCount:
+        return "Syntax error: Operator '" + error.detail_ + "' expects " + std::to_string(error.expected_args_)
+            + " arguments, received " + std::to_string(error.received_args_);
+    case ErrorCode::MissingArguments: return "Syntax error: Missing or redundant arguments";
+    case ErrorCode::UndefinedSymbol: return "Syntax error: Symbol '" + error.detail_ + "' undefined";
+    case ErrorCode::DivisionByZero: return "Numerical error: Cannot divide by 0";
+    case ErrorCode::InvalidDefinition:
+        if (error.detail_.empty()) return "Syntax error: Invalid function definition";
+        return "Syntax error: Cannot define '" + error.detail_ + "'";
+    case ErrorCode::CallDepth: return "Numerical error: Calls of '" + error.detail_ + "' nest too deep";
+    case ErrorCode::OutOfDomain: return "Numerical error: Argument outside the domain of '" + error.detail_ + "'";
+    case ErrorCode::Inexact: return "Numerical error: '" + error.detail_ + "' has no exact value at this argument";
+    case ErrorCode::TooLarge: return "Numerical error: '" + error.detail_ + "' is too large to compute exactly";
+    case ErrorCode::NoExactValue: return "Numerical error: " + error.detail_ + " has no exact value";
+    case ErrorCode::TooDeep: return "Syntax error: Expression nests too deep";
+    default: return "Internal error";
+    } // switch (error.code_)
+}
+
+/**
+ * @class Expected
+ *
+ * @brief Either a value or an Error, returned instead of throwing.
+ */
+template <typename T>
+class Expected {
+private:
+    std::variant<T, Error> storage_;
+
+public:
+    Expected(const T& value) : storage_(std::in_place_index<0>, value) {}
+    Expected(T&& value) : storage_(std::in_place_index<0>, std::move(value)) {}
+    Expected(Error error) : storage_(std::in_place_index<1>, std::move(error)) {}
+
+    bool has_value() const noexcept { return storage_.index() == 0; }
+    explicit operator bool() const noexcept { return has_value(); }
+
+    T& value() & { return std::get<0>(storage_); }
+    const T& value() const& { return std::get<0>(storage_); }
+    T&& value() && { return std::get<0>(std::move(storage_)); }
+
+    const Error& error() const { return std::get<1>(storage_); }
+};
+
+} // namespace types
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include "data/big_integer.h"
+
+namespace types {
+
+/**
+ * @class Rational
+ *
+ * @brief Exact rational number, kept in lowest terms with a positive denominator.
+ * @note Values whose numerator and denominator fit in int64_t are stored inline, and their arithmetic is checked
+ *       with __builtin_*_overflow. Only an operation that overflows spills to heap-allocated BigIntegers, and a big
+ *       result that fits again returns to the inline form. Dividing by 0 throws, there being no infinities.
+ */
+class Rational {
+private:
+    struct Big {
+        BigInteger numerator_;
+        BigInteger denominator_;
+    };
+
+    std::int64_t numerator_ = 0;
+    std::int64_t denominator_ = 1;
+    std::shared_ptr<const Big> big_; // Set if the value does not fit inline, numerator_ and denominator_ are unused then
+
+    struct Raw {};
+    Rational(std::int64_t numerator, std::int64_t denominator, Raw) noexcept : numerator_(numerator), denominator_(denominator) {}
+
+    BigInteger bigNumerator() const { return big_ ? big_->numerator_ : BigInteger(numerator_); }
+    BigInteger bigDenominator() const { return big_ ? big_->denominator_ : BigInteger(denominator_); }
+
+    /**
+     * @brief Normalizes a big fraction, storing it inline if it fits.
+     */
+    static Rational fromBig(BigInteger numerator, BigInteger denominator);
+
+public:
+    /**
+     * @brief Default constructor, 0.
+     */
+    Rational() = default;
+
+    /**
+     * @brief Constructor from an integer.
+     */
+    Rational(std::int64_t value) noexcept : numerator_(value) {}
+
+    /**
+     * @brief Constructor from a big integer, stored inline if it fits.
+     */
+    explicit Rational(const BigInteger& value) : Rational(fromBig(value, BigInteger(1))) {}
+
+    /**
+     * @brief Constructor from a fraction, reduced to lowest terms.
+     *
+     * @throws std::domain_error if the denominator is 0
+     */
+    Rational(std::int64_t numerator, std::int64_t denominator);
+
+    /**
+     * @brief Parses an integer, a decimal ("-1.25", "2e-3") or a fraction ("3/4"), exactly.
+     *
+     * @throws std::invalid_argument if str is not a number
+     */
+    static Rational fromString(const std::string& str);
+
+    bool isInline() const noexcept { return !big_; }
+    bool isInteger() const noexcept { return big_ ? big_->denominator_ == BigInteger(1) : denominator_ == 1; }
+    int sign() const noexcept { return big_ ? big_->numerator_.sign() : (numerator_ > 0) - (numerator_ < 0); }
+
+    /**
+     * @brief Formats the value as "n" or "n/d".
+     */
+    std::string toString() const;
+
+    /**
+     * @brief Acquires the nearest double, approximately for big values.
+     */
+    double toDouble() const noexcept;
+
+    Rational operator-() const;
+    Rational operator+(const Rational& other) const;
+    Rational operator-(const Rational& other) const;
+    Rational operator*(const Rational& other) const;
+
+    /**
+     * @throws std::domain_error if other is 0
+     */
+    Rational operator/(const Rational& other) const;
+
+    Rational& operator+=(const Rational& other) { return *this = *this + other; }
+    Rational& operator-=(const Rational& other) { return *this = *this - other; }
+    Rational& operator*=(const Rational& other) { return *this = *this * other; }
+    Rational& operator/=(const Rational& other) { return *this = *this / other; }
+
+    /**
+     * @brief Compares two rationals.
+     *
+     * @returns a negative value, 0 or a positive value as this is less than, equal to or greater than other
+     */
+    int compare(const Rational& other) const;
+
+    bool operator==(const Rational& other) const { return compare(other) == 0; }
+    bool operator!=(const Rational& other) const { return compare(other) != 0; }
+    bool operator<(const Rational& other) const { return compare(other) < 0; }
+    bool operator<=(const Rational& other) const { return compare(other) <= 0; }
+    bool operator>(const Rational& other) const { return compare(other) > 0; }
+    bool operator>=(const Rational& other) const { return compare(other) >= 0; }
+};
+
+} // namespace types
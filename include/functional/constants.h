@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "data/big_integer.h"
+
+namespace constants {
+
+// Constants computed to any number of digits
+enum class Constant { Pi, E };
+
+/**
+ * @brief Acquires the name of a constant as the parser spells it.
+ */
+const std::string& constant_name(Constant constant) noexcept;
+
+/**
+ * @brief Computes floor(c 10^digits) for a constant c, up to a few units.
+ *
+ * @param constant the constant
+ * @param digits the number of decimal digits after the point
+ * @param threads the number of threads splitting the series, 0 for one per core
+ * @note Binary splitting: pi by the Chudnovsky series, 426880 sqrt(10005) Q / T, and e by the factorial series,
+ *       1 + P / Q, where P, Q and T are the exact sums and products of a range of terms, merged from halves. The
+ *       halves of the top levels are split on separate threads, as are the products of each merge. Not cached.
+ */
+types::BigInteger scaled(Constant constant, std::size_t digits, unsigned threads = 0);
+
+/**
+ * @brief Formats a constant with the given number of digits after the point, truncated.
+ *
+ * @param constant the constant
+ * @param digits the number of decimal digits after the point
+ * @param threads the number of threads splitting the series, 0 for one per core
+ * @note The digits are computed with guard digits, and again with more of them when those leave the truncation in
+ *       doubt. The longest expansion of each constant so far is cached, and shorter ones are its prefixes, so only
+ *       a longer one computes anything.
+ */
+std::string digits(Constant constant, std::size_t digits, unsigned threads = 0);
+
+} // namespace constants
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace elementary {
+
+// Unary elementary functions, and the special functions of functional/numbers.h that share their nodes
+enum class Function : std::uint8_t { Sqrt, Exp, Log, Sin, Cos, Gamma, LogGamma, Factorial };
+
+// How elementary functions are computed
+enum class Accuracy {
+    Precise, // libm, within an ulp
+    Fast     // Range reduction and polynomials, within a few ulp, four arguments per AVX2 instruction in arrays
+};
+
+/**
+ * @brief Selects the accuracy of the elementary functions for the whole process (--fast-math).
+ */
+void set_accuracy(Accuracy accuracy) noexcept;
+
+/**
+ * @brief Acquires the accuracy of the elementary functions.
+ */
+Accuracy accuracy() noexcept;
+
+/**
+ * @brief Whether the CPU runs the AVX2 array kernels of Accuracy::Fast.
+ */
+bool has_avx2() noexcept;
+
+/**
+ * @brief Acquires the name of a function, as written in expressions.
+ *
+ * @note The name outlives every caller, so EvalStatus::symbol_ may point at it.
+ */
+const std::string& function_name(Function function) noexcept;
+
+/**
+ * @brief Whether a function is defined at a point; NaN arguments are in every domain, giving NaN.
+ */
+bool in_domain(Function function, double x) noexcept;
+
+/**
+ * @brief Whether x^y is defined: a negative base needs an integer exponent, and 0 a non-negative one.
+ */
+bool pow_in_domain(double x, double y) noexcept;
+
+/**
+ * @brief Evaluates a function at the accuracy selected by set_accuracy.
+ */
+double evaluate(Function function, double x) noexcept;
+
+/**
+ * @brief Evaluates x^y at the accuracy selected by set_accuracy.
+ */
+double pow(double x, double y) noexcept;
+
+/**
+ * @brief Evaluates a function at many points, at the accuracy selected by set_accuracy.
+ *
+ * @param function the function
+ * @param x the arguments
+ * @param result receives the values, may be x
+ * @param count the number of points
+ */
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept;
+
+/**
+ * @brief Evaluates x^y at many points, at the accuracy selected by set_accuracy.
+ *
+ * @param x the bases
+ * @param y the exponents
+ * @param result receives the powers, may be x or y
+ * @param count the number of points
+ */
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept;
+
+// The kernels of Accuracy::Fast, whatever the selected accuracy. Arguments outside their reduced ranges (huge, tiny,
+// non-finite, or where libm must handle overflow and signs) are passed to libm. The special functions have no fast
+// kernels and are computed as at Accuracy::Precise.
+namespace fast {
+
+double exp(double x) noexcept;
+double log(double x) noexcept;
+double sin(double x) noexcept;
+double cos(double x) noexcept;
+double pow(double x, double y) noexcept;
+
+/**
+ * @brief Evaluates a function at many points with the fast kernels, with AVX2 if has_avx2().
+ */
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept;
+
+/**
+ * @brief Evaluates x^y at many points with the fast kernel, with AVX2 if has_avx2().
+ */
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept;
+
+} // namespace fast
+
+} // namespace elementary
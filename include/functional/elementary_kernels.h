@@ -0,0 +1,194 @@
+#pragma once
+
+// The fast kernels of elementary.h, written once for double and for a GCC vector of four doubles. They are included
+// by elementary.cpp, and by elementary_avx2.cpp, which is compiled with -mavx2 -mfma. The anonymous namespace gives
+// each translation unit its own instances, so code built for AVX2 never replaces the portable scalar code at link time.
+//
+// Every kernel expects its argument inside its reduced range; the callers send other arguments to libm.
+
+#include <cmath>
+#include <cstdint>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace elementary {
+namespace {
+
+// Integer type with the layout of a (vector of) double
+template <typename V>
+struct Lanes;
+
+template <>
+struct Lanes<double> {
+    using Int = std::int64_t;
+};
+
+inline double fused(double a, double b, double c) noexcept { return std::fma(a, b, c); }
+
+#ifdef __AVX2__
+typedef double Double4 __attribute__((vector_size(32)));
+typedef std::int64_t Int4 __attribute__((vector_size(32)));
+
+template <>
+struct Lanes<Double4> {
+    using Int = Int4;
+};
+
+inline Double4 fused(Double4 a, Double4 b, Double4 c) noexcept {
+    return reinterpret_cast<Double4>(_mm256_fmadd_pd(reinterpret_cast<__m256d>(a), reinterpret_cast<__m256d>(b),
+        reinterpret_cast<__m256d>(c)));
+}
+
+// Whether any lane of a comparison result is set
+inline bool any(Int4 mask) noexcept { return _mm256_movemask_pd(reinterpret_cast<__m256d>(mask)) != 0; }
+#endif
+
+constexpr double kShifter = 0x1.8p52;                   // Adding it rounds to an integer, found in the low bits
+constexpr std::int64_t kShifterBits = 0x4338000000000000;
+constexpr std::int64_t kExponentMask = -0x10000000000000; // 0xfff0000000000000, the sign and exponent bits
+constexpr std::int64_t kSqrtHalfBits = 0x3fe6a09e667f3bcd; // sqrt(1/2)
+
+// ln 2 in two parts, the first with 32 trailing zero bits so that k ln2_hi is exact (from fdlibm)
+constexpr double kLn2Hi = 6.93147180369123816490e-01;
+constexpr double kLn2Lo = 1.90821492927058770002e-10;
+constexpr double kLog2E = 1.44269504088896338700e+00;
+
+// pi/2 in four parts, the first three of 33 bits so that k times each is exact for |k| < 2^20 (from fdlibm)
+constexpr double kTwoOverPi = 6.36619772367581382433e-01;
+constexpr double kHalfPi1 = 1.57079632673412561417e+00;
+constexpr double kHalfPi2 = 6.07710050630396597660e-11;
+constexpr double kHalfPi3 = 2.02226624871116645580e-21;
+constexpr double kHalfPi3Tail = 8.47842766036889956997e-32;
+
+// Taylor coefficients, lowest power first. The first omitted term is below 2^-60 of the value on the reduced ranges.
+constexpr double kExpCoefficients[] = { // 1/n!, |r| <= ln2/2
+    1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040, 1.0 / 40320, 1.0 / 362880,
+    1.0 / 3628800, 1.0 / 39916800, 1.0 / 479001600, 1.0 / 6227020800};
+constexpr double kLogCoefficients[] = { // 2/(2j+1), log((1+s)/(1-s)) = 2s + 2s^3/3 + ..., |s| <= 0.172
+    2.0 / 3, 2.0 / 5, 2.0 / 7, 2.0 / 9, 2.0 / 11, 2.0 / 13, 2.0 / 15, 2.0 / 17, 2.0 / 19, 2.0 / 21};
+constexpr double kSinCoefficients[] = { // (-1)^j/(2j+1)! from j = 1, |r| <= pi/4
+    -1.0 / 6, 1.0 / 120, -1.0 / 5040, 1.0 / 362880, -1.0 / 39916800, 1.0 / 6227020800,
+    -1.0 / 1307674368000, 1.0 / 355687428096000};
+constexpr double kCosCoefficients[] = { // (-1)^j/(2j)! from j = 2
+    1.0 / 24, -1.0 / 720, 1.0 / 40320, -1.0 / 3628800, 1.0 / 479001600, -1.0 / 87178291200, 1.0 / 20922789888000};
+
+template <typename V>
+inline typename Lanes<V>::Int bits(V x) noexcept { return __builtin_bit_cast(typename Lanes<V>::Int, x); }
+
+template <typename V>
+inline V from_bits(typename Lanes<V>::Int i) noexcept { return __builtin_bit_cast(V, i); }
+
+template <typename V>
+inline V magnitude(V x) noexcept { return from_bits<V>(bits(x) & 0x7fffffffffffffff); }
+
+// The reduced ranges, as a bool or a lane mask
+constexpr double kExpLimit = 708.0;                         // e^x and 2^k stay normal
+constexpr double kTrigLimit = 0x1p20 * 1.57079632679489661; // k pi/2 exact in three parts
+constexpr double kMinNormal = 0x1p-1022;
+constexpr double kMaxFinite = 0x1.fffffffffffffp1023;
+
+template <typename V>
+inline auto exp_in_range(V x) noexcept { return magnitude(x) <= kExpLimit; }
+
+template <typename V>
+inline auto log_in_range(V x) noexcept { return (x >= kMinNormal) & (x <= kMaxFinite); }
+
+template <typename V>
+inline auto trig_in_range(V x) noexcept { return magnitude(x) <= kTrigLimit; }
+
+// For pow_kernel, which also needs its product y log x within kExpLimit
+template <typename V>
+inline auto pow_in_range(V x, V y) noexcept { return log_in_range(x) & (magnitude(y) <= kMaxFinite); }
+
+template <typename V, std::size_t N>
+inline V horner(V x, const double (&coefficients)[N]) noexcept {
+    V result = V{} + coefficients[N - 1];
+    for (std::size_t k = N - 1; k-- > 0; ) result = result * x + coefficients[k];
+    return result;
+}
+
+// e^x for |x| <= 708: x = k ln2 + r with |r| <= ln2/2, then e^r times 2^k
+template <typename V>
+inline V exp_kernel(V x) noexcept {
+    V shifted = x * kLog2E + kShifter;
+    V k = shifted - kShifter;
+    auto exponent = bits(shifted) - kShifterBits;
+    V r = x - k * kLn2Hi;
+    r = r - k * kLn2Lo;
+    return horner(r, kExpCoefficients) * from_bits<V>((exponent + 1023) << 52);
+}
+
+// Splits a positive normal x into 2^k m with m in [sqrt(1/2), sqrt(2)), returning m - 1 (exact) and k as a double
+template <typename V>
+inline V log_reduce(V x, V& k) noexcept {
+    auto ix = bits(x);
+    auto offset = ix - kSqrtHalfBits;
+    k = from_bits<V>((offset >> 52) + kShifterBits) - kShifter;
+    return from_bits<V>(ix - (offset & kExponentMask)) - 1.0;
+}
+
+// log x for positive normal x, with f = m - 1 and s = f/(2+f): log(1+f) = 2s + s R (the formula of fdlibm)
+template <typename V>
+inline V log_kernel(V x) noexcept {
+    V k;
+    V f = log_reduce(x, k);
+    V s = f / (f + 2.0);
+    V z = s * s;
+    V r = z * horner(z, kLogCoefficients);
+    V half_f_squared = 0.5 * f * f;
+    return k * kLn2Hi - ((half_f_squared - (s * (r + half_f_squared) + k * kLn2Lo)) - f);
+}
+
+// log x as hi + lo to about 2^-59 relative, for x^y = e^(y log x) with large y log x
+template <typename V>
+inline V log_extended(V x, V& lo) noexcept {
+    V k;
+    V f = log_reduce(x, k);
+    V d = f + 2.0;
+    V d_lo = (2.0 - d) + f; // d + d_lo = 2 + f exactly
+    V s = f / d;
+    V s_lo = (fused(-s, d, f) - s * d_lo) / d;
+    V z = s * s;
+    V tail = s * z * horner(z, kLogCoefficients) + (s_lo + s_lo) + k * kLn2Lo;
+
+    // k ln2_hi + 2s with TwoSum, the tail added to the error
+    V head = k * kLn2Hi;
+    V two_s = s + s;
+    V sum = head + two_s;
+    V two_s_virtual = sum - head;
+    V error = (head - (sum - two_s_virtual)) + (two_s - two_s_virtual) + tail;
+    V hi = sum + error;
+    lo = error - (hi - sum);
+    return hi;
+}
+
+// x^y = e^(y log x) for positive normal x and finite y; product receives y log x, which must be within +-708
+template <typename V>
+inline V pow_kernel(V x, V y, V& product) noexcept {
+    V log_lo;
+    V log_hi = log_extended(x, log_lo);
+    product = y * log_hi;
+    V product_lo = fused(y, log_hi, -product) + y * log_lo;
+    V power = exp_kernel(product);
+    return power + power * product_lo;
+}
+
+// sin x (offset 0) or cos x (offset 1) for |x| <= 2^20 pi/2: x = k pi/2 + r, |r| <= pi/4, and the quadrant k selects
+// +-sin r or +-cos r
+template <typename V>
+inline V sin_kernel(V x, std::int64_t offset) noexcept {
+    V shifted = x * kTwoOverPi + kShifter;
+    V k = shifted - kShifter;
+    auto quadrant = bits(shifted) - kShifterBits + offset;
+    V r = (((x - k * kHalfPi1) - k * kHalfPi2) - k * kHalfPi3) - k * kHalfPi3Tail;
+
+    V z = r * r;
+    V sine = r + r * z * horner(z, kSinCoefficients);
+    V cosine = (1.0 - 0.5 * z) + z * z * horner(z, kCosCoefficients);
+    V value = (quadrant & 1) == 0 ? sine : cosine;
+    return (quadrant & 2) == 0 ? value : -value;
+}
+
+} // namespace
+} // namespace elementary
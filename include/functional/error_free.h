@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cmath>
+
+// Error-free transformations of doubles, shared by the adaptive evaluation and the exact statistics: sums and products
+// written as a rounded result and its exact rounding error.
+
+namespace error_free {
+
+constexpr double kSplitLimit = 0x1p995; // Magnitude below which Veltkamp's split does not overflow
+
+/**
+ * @brief a + b = s + t exactly, for any finite a and b (Knuth).
+ */
+inline void two_sum(double a, double b, double& s, double& t) noexcept {
+    s = a + b;
+    double b_virtual = s - a;
+    t = (a - (s - b_virtual)) + (b - b_virtual);
+}
+
+/**
+ * @brief a + b = s + t exactly, for |a| >= |b| (Dekker).
+ */
+inline void fast_two_sum(double a, double b, double& s, double& t) noexcept {
+    s = a + b;
+    t = b - (s - a);
+}
+
+/**
+ * @brief Splits x into halves of 26 bits, whose products are exact (Veltkamp).
+ *
+ * @note Overflows for |x| of kSplitLimit or more.
+ */
+inline void split(double x, double& high, double& low) noexcept {
+    const double scaled = 134217729.0 * x; // 2^27 + 1
+    high = scaled - (scaled - x);
+    low = x - high;
+}
+
+/**
+ * @brief a b = p + t exactly by Dekker's product, branch-free so that loops over it vectorize.
+ *
+ * @note Only for |a| and |b| below kSplitLimit, and exact unless p overflows or t underflows.
+ */
+inline void dekker_product(double a, double b, double& p, double& t) noexcept {
+    double a_high, a_low, b_high, b_low;
+    split(a, a_high, a_low);
+    split(b, b_high, b_low);
+    p = a * b;
+    t = ((a_high * b_high - p) + a_high * b_low + a_low * b_high) + a_low * b_low;
+}
+
+/**
+ * @brief a b = p + t exactly, unless p overflows or t underflows.
+ *
+ * @note One fused multiply-add with hardware FMA. Otherwise Dekker's product, with std::fma, a library call then,
+ *       past kSplitLimit, where splitting would overflow.
+ */
+inline void two_product(double a, double b, double& p, double& t) noexcept {
+#ifdef __FP_FAST_FMA
+    p = a * b;
+    t = std::fma(a, b, -p);
+#else
+    if (std::fabs(a) < kSplitLimit && std::fabs(b) < kSplitLimit) return dekker_product(a, b, p, t);
+    p = a * b;
+    t = std::fma(a, b, -p);
+#endif
+}
+
+} // namespace error_free
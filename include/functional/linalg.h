@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+
+namespace linalg {
+
+constexpr std::size_t kParallelWork = std::size_t(1) << 24; // Multiply-adds from which a product is split over threads
+constexpr std::size_t kPanelWidth = 64;                     // Columns of the panels of the blocked LU factorization
+
+/**
+ * @brief Adds alpha A B to C, for row-major matrices with leading dimensions.
+ *
+ * @param m the rows of A and C
+ * @param n the columns of B and C
+ * @param k the columns of A and the rows of B
+ * @param alpha the factor of the product
+ * @param a A, with lda numerals between the starts of its rows
+ * @param b B, with ldb numerals between the starts of its rows
+ * @param c C, with ldc numerals between the starts of its rows
+ * @note Packs panels of B and blocks of A to stay in cache and computes tiles of C in registers, with AVX2 and fused
+ *       multiply-adds if elementary::has_avx2(). C must not overlap A or B.
+ */
+void multiply_add(std::size_t m, std::size_t n, std::size_t k, double alpha, const double* a, std::size_t lda,
+    const double* b, std::size_t ldb, double* c, std::size_t ldc);
+
+/**
+ * @brief Multiplies row-major matrices, C = A B.
+ *
+ * @param a A, m x k
+ * @param b B, k x n
+ * @param c receives C, m x n, which must not overlap A or B
+ * @param threads the number of threads, used if the product takes at least kParallelWork multiply-adds
+ * @note The threads take bands of rows of C each, so the result is the same bits for any number of threads.
+ */
+void multiply(const double* a, const double* b, double* c, std::size_t m, std::size_t k, std::size_t n, unsigned threads = 1);
+
+/**
+ * @brief Transposes a row-major matrix by tiles, so both matrices are read and written a cache line at a time.
+ *
+ * @param a the matrix, rows x columns
+ * @param t receives the transpose, columns x rows, which must not overlap a
+ */
+void transpose(const double* a, double* t, std::size_t rows, std::size_t columns) noexcept;
+
+/**
+ * @brief Factors a square row-major matrix in place as P A = L U, with partial pivoting.
+ *
+ * @param a the matrix, n x n, which receives U on and above the diagonal and L, without its unit diagonal, below
+ * @param n the order of the matrix
+ * @param pivots receives n row indices: row i was swapped with row pivots[i] at step i
+ * @returns false if the matrix is singular, leaving a partly factored
+ * @note Blocked by panels of kPanelWidth columns: a panel is factored column by column, and the rest of the matrix is
+ *       updated by one product through multiply_add.
+ */
+bool lu_factor(double* a, std::size_t n, std::size_t* pivots);
+
+/**
+ * @brief Solves A X = B from the factors of lu_factor.
+ *
+ * @param lu the factors of A, n x n
+ * @param pivots the row swaps of the factorization
+ * @param n the order of A
+ * @param b B, n x columns row-major, which receives X
+ * @param columns the number of right-hand sides
+ */
+void lu_solve(const double* lu, const std::size_t* pivots, std::size_t n, double* b, std::size_t columns) noexcept;
+
+/**
+ * @brief Acquires the determinant of A from the factors of lu_factor.
+ */
+double lu_determinant(const double* lu, const std::size_t* pivots, std::size_t n) noexcept;
+
+} // namespace linalg
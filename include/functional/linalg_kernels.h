@@ -0,0 +1,119 @@
+#pragma once
+
+// The matrix product of linalg.h, written once over a GCC vector of doubles. It is included by linalg.cpp with
+// vectors of two doubles, and by linalg_avx2.cpp, which is compiled with -mavx2 -mfma, with vectors of four. The
+// anonymous namespace gives each translation unit its own instances, as for elementary_kernels.h.
+//
+// The product follows Goto's layering: a kDepthBlock x kColumnBlock panel of B is packed to stay in the last level
+// cache, a kRowBlock x kDepthBlock block of A to stay in L2, and a micro-kernel keeps an MR x NR tile of C in
+// registers while it streams a strip of each from L1.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace linalg {
+namespace {
+
+typedef double Double2 __attribute__((vector_size(16)));
+typedef double Double4 __attribute__((vector_size(32)));
+
+constexpr std::size_t kDepthBlock = 256;   // Depth of the packed panels, so a strip of B (kDepthBlock x NR) fits L1
+constexpr std::size_t kRowBlock = 96;      // Rows of the packed block of A, a multiple of every MR
+constexpr std::size_t kColumnBlock = 2048; // Columns of the packed panel of B
+
+/**
+ * @brief C += alpha A B for row-major matrices with leading dimensions, by MR x NR tiles of NV vectors V per row.
+ */
+template <typename V, std::size_t MR, std::size_t NV>
+struct Gemm {
+    static constexpr std::size_t kLanes = sizeof(V) / sizeof(double);
+    static constexpr std::size_t NR = NV * kLanes;
+
+    // Packs rows x depth of A as strips of MR rows, column after column, padding the last strip with zeros
+    static void packA(const double* a, std::size_t lda, std::size_t rows, std::size_t depth, double* packed) noexcept {
+        for (std::size_t first = 0; first < rows; first += MR) {
+            const std::size_t height = std::min(MR, rows - first);
+            for (std::size_t p = 0; p < depth; ++p) {
+                for (std::size_t i = 0; i < MR; ++i) *packed++ = i < height ? a[(first + i) * lda + p] : 0;
+            }
+        }
+    }
+
+    // Packs depth x columns of B as strips of NR columns, row after row, padding the last strip with zeros
+    static void packB(const double* b, std::size_t ldb, std::size_t depth, std::size_t columns, double* packed) noexcept {
+        for (std::size_t first = 0; first < columns; first += NR) {
+            const std::size_t width = std::min(NR, columns - first);
+            for (std::size_t p = 0; p < depth; ++p) {
+                const double* row = b + p * ldb + first;
+                if (width == NR) std::memcpy(packed, row, NR * sizeof(double));
+                else {
+                    std::copy(row, row + width, packed);
+                    std::fill(packed + width, packed + NR, 0.0);
+                }
+                packed += NR;
+            }
+        }
+    }
+
+    // The tile of C at c, of which rows x columns are inside the matrix, plus alpha times a strip of A by a strip of B
+    static void tile(std::size_t depth, const double* a, const double* b, double alpha, double* c, std::size_t ldc,
+        std::size_t rows, std::size_t columns) noexcept {
+
+        V acc[MR][NV] = {};
+        for (std::size_t p = 0; p < depth; ++p) {
+            V bv[NV];
+            std::memcpy(bv, b + p * NR, sizeof(bv));
+            for (std::size_t i = 0; i < MR; ++i) {
+                const double ai = a[p * MR + i];
+                for (std::size_t j = 0; j < NV; ++j) acc[i][j] += ai * bv[j];
+            }
+        }
+        if (rows == MR && columns == NR) {
+            for (std::size_t i = 0; i < MR; ++i) {
+                for (std::size_t j = 0; j < NV; ++j) {
+                    V cv;
+                    std::memcpy(&cv, c + i * ldc + j * kLanes, sizeof(cv));
+                    cv += alpha * acc[i][j];
+                    std::memcpy(c + i * ldc + j * kLanes, &cv, sizeof(cv));
+                }
+            }
+            return;
+        }
+        double values[MR][NR];
+        std::memcpy(values, acc, sizeof(values));
+        for (std::size_t i = 0; i < rows; ++i) {
+            for (std::size_t j = 0; j < columns; ++j) c[i * ldc + j] += alpha * values[i][j];
+        }
+    }
+
+    static void run(std::size_t m, std::size_t n, std::size_t k, double alpha, const double* a, std::size_t lda,
+        const double* b, std::size_t ldb, double* c, std::size_t ldc) {
+
+        if (m == 0 || n == 0 || k == 0) return;
+        const std::size_t panel_columns = (std::min(n, kColumnBlock) + NR - 1) / NR * NR;
+        std::vector<double> packed_a(kRowBlock * kDepthBlock);
+        std::vector<double> packed_b(kDepthBlock * panel_columns);
+        for (std::size_t jc = 0; jc < n; jc += kColumnBlock) {
+            const std::size_t nc = std::min(kColumnBlock, n - jc);
+            for (std::size_t pc = 0; pc < k; pc += kDepthBlock) {
+                const std::size_t kc = std::min(kDepthBlock, k - pc);
+                packB(b + pc * ldb + jc, ldb, kc, nc, packed_b.data());
+                for (std::size_t ic = 0; ic < m; ic += kRowBlock) {
+                    const std::size_t mc = std::min(kRowBlock, m - ic);
+                    packA(a + ic * lda + pc, lda, mc, kc, packed_a.data());
+                    for (std::size_t jr = 0; jr < nc; jr += NR) {
+                        for (std::size_t ir = 0; ir < mc; ir += MR) {
+                            tile(kc, packed_a.data() + ir * kc, packed_b.data() + jr * kc, alpha,
+                                c + (ic + ir) * ldc + jc + jr, ldc, std::min(MR, mc - ir), std::min(NR, nc - jr));
+                        }
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+} // namespace linalg
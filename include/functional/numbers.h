@@ -1,3 +1,134 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "data/big_integer.h"
 
+namespace numbers {
+
+constexpr std::uint64_t kMaxFactorial64 = 20;          // Largest n with n! in std::uint64_t
+constexpr std::uint64_t kMaxFactorialDouble = 170;     // Largest n with n! finite in double
+constexpr std::uint64_t kMaxExactFactorial = 10000000; // Largest n whose exact n! or binomials of n are computed
+
+/**
+ * @brief Acquires n! from a table.
+ *
+ * @param n the argument, at most kMaxFactorial64
+ */
+std::uint64_t factorial64(std::uint64_t n) noexcept;
+
+/**
+ * @brief Acquires x! = gamma(x + 1).
+ *
+ * @note Non-negative integers come from a table, correctly rounded, and overflow to infinity above
+ *       kMaxFactorialDouble. Negative integers are poles, giving NaN.
+ */
+double factorial(double x) noexcept;
+
+/**
+ * @brief Acquires the gamma function.
+ *
+ * @note Integers come from the factorial table. Other arguments use Stirling's series in long double, after shifting
+ *       the argument to at least 10 by the recurrence, within an ulp or two, with the reflection formula below 1/2.
+ *       Poles give NaN, and arguments above about 171.62 overflow to infinity.
+ */
+double gamma(double x) noexcept;
+
+/**
+ * @brief Acquires log|gamma(x)|.
+ *
+ * @note Stirling's series in long double, which never overflows, from 10, the logarithm of gamma below, and the
+ *       reflection formula for negative arguments. Poles give infinity.
+ */
+double lgamma(double x) noexcept;
+
+/**
+ * @brief Acquires the digamma function, the derivative of log gamma(x).
+ *
+ * @note The asymptotic series in long double after shifting the argument to at least 10, and the reflection formula below 0.
+ */
+double digamma(double x) noexcept;
+
+/**
+ * @brief Acquires the binomial coefficient.
+ *
+ * @param n the upper argument, real
+ * @param k the lower argument, real
+ * @note Integer arguments follow the combinatorial convention: 0 for k < 0, and (-1)^k binom(k - n - 1, k) for
+ *       negative n. Exact while the value fits in 64 bits, then a falling product in long double. Other arguments
+ *       use gamma(n + 1) / (gamma(k + 1) gamma(n - k + 1)). NaN where n is a negative integer and k is not.
+ */
+double binomial(double n, double k) noexcept;
+
+/**
+ * @brief Whether binomial(n, k) is defined: a negative integer n needs an integer k.
+ */
+bool binomial_in_domain(double n, double k) noexcept;
+
+/**
+ * @brief Computes n! exactly.
+ *
+ * @note Luschny's prime-swing algorithm: n! = (n/2)!^2 swing(n), where the swing n! / (n/2)!^2 is the product of
+ *       prime powers read off a sieve, multiplied as a balanced product tree so that BigInteger's Karatsuba and
+ *       transform products apply.
+ */
+types::BigInteger factorial_exact(std::uint64_t n);
+
+/**
+ * @brief Computes the binomial coefficient exactly, 0 if k > n.
+ *
+ * @note The product tree of the prime powers dividing it, with exponents by Kummer's theorem.
+ */
+types::BigInteger binomial_exact(std::uint64_t n, std::uint64_t k);
+
+/**
+ * @class BinomialTable
+ *
+ * @brief Answers many binomial queries with arguments up to a bound in constant time each.
+ * @note Caches log n! up to the bound in long double. A query whose value is below 2^63 is computed exactly by the
+ *       multiplicative formula, which takes at most about 35 steps then; larger values are exp(log n! - log k! -
+ *       log (n - k)!), within about 1e-12 relatively for n near 10^6 and more closely for smaller n.
+ */
+class BinomialTable {
+private:
+    std::vector<long double> log_factorials_; // log_factorials_[n] = log n!
+
+public:
+    /**
+     * @brief Constructor, caching the log-factorials.
+     *
+     * @param max_n the largest upper argument of the queries
+     */
+    explicit BinomialTable(std::uint64_t max_n);
+
+    std::uint64_t maxN() const noexcept { return log_factorials_.size() - 1; }
+
+    /**
+     * @brief Acquires log binom(n, k), -infinity if k > n.
+     *
+     * @param n the upper argument, at most maxN()
+     * @param k the lower argument
+     */
+    long double logBinomial(std::uint64_t n, std::uint64_t k) const noexcept;
+
+    /**
+     * @brief Acquires binom(n, k), 0 if k > n.
+     *
+     * @param n the upper argument, at most maxN()
+     * @param k the lower argument
+     */
+    double operator()(std::uint64_t n, std::uint64_t k) const noexcept;
+
+    /**
+     * @brief Answers many queries.
+     *
+     * @param n the upper arguments, each at most maxN()
+     * @param k the lower arguments
+     * @param result receives the coefficients
+     * @param count the number of queries
+     */
+    void evaluate(const std::uint64_t* n, const std::uint64_t* k, double* result, std::size_t count) const noexcept;
+};
+
+} // namespace numbers
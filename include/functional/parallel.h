@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// Fork-join helper shared by the parallel parse and the digits of the constants.
+
+namespace parallel {
+
+/**
+ * @brief Runs the tasks, spread over at most threads threads including this one.
+ *
+ * @param tasks the tasks, independent of each other
+ * @param threads the most threads to use
+ * @note Task i runs on thread i % threads; returns once every task has run.
+ */
+inline void run_tasks(const std::vector<std::function<void()>>& tasks, unsigned threads) {
+    const std::size_t stride = std::clamp<std::size_t>(threads, 1, tasks.size());
+    std::vector<std::thread> workers;
+    for (std::size_t first = 1; first < stride; ++first) {
+        workers.emplace_back([&tasks, first, stride] {
+            for (std::size_t i = first; i < tasks.size(); i += stride) tasks[i]();
+        });
+    }
+    for (std::size_t i = 0; i < tasks.size(); i += stride) tasks[i]();
+    for (auto& worker : workers) worker.join();
+}
+
+} // namespace parallel
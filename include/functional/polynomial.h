@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "data/datatype_decl.h"
+
+namespace poly {
+
+constexpr std::size_t kEstrinDegree = 8;   // Lowest degree evaluated with Estrin's scheme rather than Horner's
+constexpr std::size_t kEstrinBlock = 16;   // Coefficients per Estrin block (4 levels of independent operations)
+constexpr std::size_t kFftDegree = 64;     // Lowest degree of both factors for which multiply() uses an FFT
+
+/**
+ * @class Polynomial
+ *
+ * @brief A polynomial in one variable with numeral coefficients.
+ * @note Evaluation uses Horner's scheme below kEstrinDegree. From there it uses Estrin's scheme on blocks of
+ *       kEstrinBlock coefficients, whose independent multiply-adds pipeline and vectorize, with Horner's
+ *       scheme in x^kEstrinBlock across the blocks.
+ */
+class Polynomial {
+private:
+    std::vector<types::Numeral> coefficients_; // coefficients_[k] multiplies x^k; padded with zeros for Estrin blocks
+    std::size_t degree_ = 0;
+
+    /**
+     * @brief Drops the leading zero coefficients and pads for the evaluation scheme.
+     */
+    void normalize();
+
+public:
+    /**
+     * @brief Default constructor, the zero polynomial.
+     */
+    Polynomial();
+
+    /**
+     * @brief Constructor for Polynomial.
+     *
+     * @param coefficients the coefficients, lowest power first
+     */
+    explicit Polynomial(std::vector<types::Numeral> coefficients);
+
+    /**
+     * @brief The constant polynomial.
+     */
+    static Polynomial constant(types::Numeral value) { return Polynomial({value}); }
+
+    /**
+     * @brief The polynomial x.
+     */
+    static Polynomial identity() { return Polynomial({0, 1}); }
+
+    std::size_t degree() const noexcept { return degree_; }
+    types::Numeral coefficient(std::size_t power) const noexcept { return power <= degree_ ? coefficients_[power] : 0; }
+    bool isConstant() const noexcept { return degree_ == 0; }
+
+    /**
+     * @brief Acquires the coefficients, lowest power first, without padding.
+     */
+    std::vector<types::Numeral> coefficients() const;
+
+    /**
+     * @brief Evaluates the polynomial.
+     *
+     * @param x the value of the variable
+     */
+    types::Numeral evaluate(types::Numeral x) const noexcept;
+
+    /**
+     * @brief Acquires the derivative.
+     */
+    Polynomial derivative() const;
+
+    Polynomial operator+(const Polynomial& other) const;
+    Polynomial operator-(const Polynomial& other) const;
+    Polynomial operator-() const;
+    Polynomial operator*(types::Numeral factor) const;
+
+    /**
+     * @brief Multiplies, see poly::multiply.
+     */
+    Polynomial operator*(const Polynomial& other) const;
+
+    /**
+     * @brief Formats the polynomial, such as `3*x^2 - x + 7`.
+     *
+     * @param variable the name of the variable
+     */
+    std::string toString(const std::string& variable) const;
+};
+
+/**
+ * @brief Multiplies two polynomials.
+ *
+ * @param a the first factor
+ * @param b the second factor
+ * @returns the product
+ * @note Uses the schoolbook product for small degrees, and a floating-point FFT in O(n log n) once both degrees
+ *       reach kFftDegree. The FFT rounds each coefficient with an absolute error of about
+ *       eps * log2(n) * max|a| * max|b| * n, so coefficients much smaller than the largest ones lose precision.
+ */
+Polynomial multiply(const Polynomial& a, const Polynomial& b);
+
+/**
+ * @brief Multiplies two coefficient vectors with the schoolbook product.
+ */
+std::vector<types::Numeral> multiply_schoolbook(const std::vector<types::Numeral>& a, const std::vector<types::Numeral>& b);
+
+/**
+ * @brief Multiplies two coefficient vectors with a floating-point FFT.
+ */
+std::vector<types::Numeral> multiply_fft(const std::vector<types::Numeral>& a, const std::vector<types::Numeral>& b);
+
+} // namespace poly
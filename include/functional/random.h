@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace prng {
+
+/**
+ * @brief Acquires a block of the Philox4x32-10 counter-based generator (Salmon et al., SC'11).
+ *
+ * @param counter the 128-bit counter, lowest word first
+ * @param key the 64-bit key, lowest word first
+ * @returns four independent uniform 32-bit words
+ * @note Ten rounds of two 32x32->64 multiplications, keyed by a Weyl sequence. Any counter can be computed directly,
+ *       so every sample has a fixed place in its stream whichever thread draws it.
+ */
+std::array<std::uint32_t, 4> philox4x32(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key) noexcept;
+
+/**
+ * @brief Draws uniform doubles in (0, 1), the samples first, first + 1, ... of a stream.
+ *
+ * @param seed the seed, the key of every stream
+ * @param stream the stream, the high half of the counter
+ * @param first the index of the first sample in the stream
+ * @param count the number of samples
+ * @param values receives the samples
+ * @note Samples 2k and 2k + 1 take the 53 high bits of the two halves of the block at counter k, plus half a unit in
+ *       the last place, so that neither 0 nor 1 is drawn. The blocks are computed several at a time in independent
+ *       lanes, which vectorizes.
+ */
+void uniform(std::uint64_t seed, std::uint64_t stream, std::uint64_t first, std::size_t count, double* values) noexcept;
+
+/**
+ * @brief Draws standard normal doubles, the samples first, first + 1, ... of a stream.
+ *
+ * @note The Box-Muller transform of the uniform samples 2k and 2k + 1 gives the normal samples 2k and 2k + 1.
+ */
+void normal(std::uint64_t seed, std::uint64_t stream, std::uint64_t first, std::size_t count, double* values) noexcept;
+
+} // namespace prng
@@ -1,3 +1,299 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <set>
+#include <utility>
+#include <vector>
 
+namespace stats {
+
+constexpr double kQuantileAccuracy = 0.005; // Relative error of the quantiles of QuantileSketch
+
+constexpr std::size_t kSumDigits = 68;    // 32-bit digits of ExactSum, from 2^-1074 to past the largest double
+constexpr std::size_t kSumBlock = 1024;   // Values ExactSum::add extracts at a time
+constexpr std::uint32_t kCarryInterval = std::uint32_t(1) << 30; // Additions between carry propagations of ExactSum
+
+/**
+ * @class ExactSum
+ *
+ * @brief Exact sum of a stream of doubles, rounded to the nearest double only when read, so it is the same bits for
+ *        any order of the values and any grouping of merges.
+ * @note A superaccumulator: a fixed-point number of kSumDigits digits of 32 bits, 2^-1074 the unit of the lowest,
+ *       each held in an int64_t so additions need not carry; the carries are propagated every kCarryInterval
+ *       additions. A value adds its 53-bit mantissa to the three digits it spans. An array goes kSumBlock values at a
+ *       time by Rump's extraction instead: with every |x| < 2^e and sigma = 2^(e + 11), q = (sigma + x) - sigma is
+ *       x rounded to a multiple of 2^(e - 42), so the q of a block sum exactly in any order, in vector lanes, into
+ *       one value for the digits. The remainders x - q, below 2^(e - 41), go the same way: three levels run in one
+ *       pass, which covers 126 bits below the largest value, and any remainders left take further levels, then go
+ *       value by value. NaNs and infinities are counted apart: the sum is NaN after a NaN or infinities of both
+ *       signs, and an exact zero is +0.
+ */
+class ExactSum {
+private:
+    std::array<std::int64_t, kSumDigits> digits_{};
+    std::uint32_t pending_ = 0; // Additions since the carries were propagated
+    bool nan_ = false;
+    bool positive_infinity_ = false;
+    bool negative_infinity_ = false;
+
+    void addFinite(double value) noexcept;
+    void addBlock(const double* values, std::size_t count) noexcept;
+    void normalize() noexcept;
+
+public:
+    void add(double value) noexcept;
+
+    /**
+     * @brief Adds count values, vectorized, to the same sum as adding them one by one.
+     */
+    void add(const double* values, std::size_t count) noexcept;
+
+    void merge(const ExactSum& other) noexcept;
+
+    /**
+     * @brief Acquires the sum rounded to the nearest double, ties to even; infinite if it overflows.
+     */
+    double value() const noexcept;
+
+    /**
+     * @brief Acquires the sum as an unevaluated pair, high the rounded sum and low the rounded rest.
+     */
+    void value(double& high, double& low) const noexcept;
+};
+
+/**
+ * @class Moments
+ *
+ * @brief Running count, mean, variance and extremes of a stream of values.
+ * @note Exact sums of the values and of their squares, each square split exactly into two doubles, from which the
+ *       mean and the variance are computed in double-double when read. Adding or merging the same values in any
+ *       order and any grouping gives the same bits. Squares overflow beyond 2^511 in magnitude, which makes the
+ *       variance infinite.
+ */
+class Moments {
+private:
+    std::uint64_t count_ = 0;
+    ExactSum sum_;
+    ExactSum squares_;
+    double min_ = 0;
+    double max_ = 0;
+
+    void extend(double min, double max) noexcept;
+
+public:
+    void add(double value) noexcept;
+
+    /**
+     * @brief Adds count values, faster than one by one for the same moments.
+     */
+    void add(const double* values, std::size_t count) noexcept;
+
+    /**
+     * @brief Adds the values of another stream.
+     */
+    void merge(const Moments& other) noexcept;
+
+    std::uint64_t count() const noexcept { return count_; }
+    double mean() const noexcept;
+    double min() const noexcept { return min_; }
+    double max() const noexcept { return max_; }
+
+    /**
+     * @brief Acquires the sample variance, with n - 1 degrees of freedom, 0 for fewer than 2 values.
+     */
+    double variance() const noexcept;
+
+    double stddev() const noexcept;
+};
+
+/**
+ * @class QuantileSketch
+ *
+ * @brief Quantiles of a stream of values within a relative error, in memory logarithmic in their range.
+ * @note A DDSketch: a value x goes to the bucket ceil(log(|x|) / log(gamma)), gamma = (1 + a) / (1 - a) for the
+ *       accuracy a, counted separately for each sign; magnitudes below 1e-300 count as zeros, and infinities apart.
+ *       Every value of a bucket is within a of its estimate 2 gamma^i / (gamma + 1). Counts add exactly, so merging
+ *       sketches in any order gives the same sketch. NaNs are not counted.
+ */
+class QuantileSketch {
+private:
+    double accuracy_;
+    double gamma_;
+    double log_gamma_;
+    std::vector<std::uint64_t> positive_; // Counts from bucket positive_offset_ up
+    std::vector<std::uint64_t> negative_; // Counts of the negative values by the bucket of their magnitude
+    int positive_offset_ = 0;
+    int negative_offset_ = 0;
+    std::uint64_t zeros_ = 0;
+    std::uint64_t positive_infinities_ = 0;
+    std::uint64_t negative_infinities_ = 0;
+    std::uint64_t count_ = 0;
+
+    int bucket(double magnitude) const noexcept;
+    double estimate(int bucket) const noexcept;
+
+public:
+    explicit QuantileSketch(double accuracy = kQuantileAccuracy);
+
+    void add(double value);
+
+    /**
+     * @brief Adds the counts of another sketch.
+     *
+     * @throws std::invalid_argument if the sketches have different accuracies
+     */
+    void merge(const QuantileSketch& other);
+
+    std::uint64_t count() const noexcept { return count_; }
+    double accuracy() const noexcept { return accuracy_; }
+
+    /**
+     * @brief Acquires the value of rank q (count - 1), rounded down, within the relative accuracy.
+     *
+     * @param q the quantile, from 0 to 1
+     * @returns the estimate, NaN if no value was added
+     */
+    double quantile(double q) const noexcept;
+};
+
+/**
+ * @class RollingMoments
+ *
+ * @brief Mean and variance of the last window values of a stream, in O(1) per value.
+ * @note Keeps exact sums (see ExactSum) of the finite values of the window and of their squares, adding the value
+ *       that enters and subtracting the one that leaves, so the moments of a window are the same bits whatever came
+ *       before it and no rounding builds up over an unbounded stream. While the window holds a NaN, or infinities of
+ *       both signs, the mean is NaN; while it holds an infinity the variance is NaN, and while it holds a value beyond
+ *       2^511 in magnitude, whose square overflows, the variance is infinite.
+ */
+class RollingMoments {
+private:
+    std::vector<double> values_;  // The window, value i at slot i % window
+    std::uint64_t index_ = 0;     // Values added so far
+    ExactSum sum_;                // Of the finite values of the window
+    ExactSum squares_;            // Of their squares
+    std::uint64_t finite_ = 0;    // Finite values in the window
+    std::uint64_t overflows_ = 0; // Those whose square overflows, left out of squares_
+    std::uint64_t last_nan_ = 0, last_positive_infinity_ = 0, last_negative_infinity_ = 0; // Index + 1 of the last ones
+
+    bool in_window(std::uint64_t last) const noexcept { return last > 0 && last + values_.size() > index_; }
+    void accumulate(double value, double sign) noexcept;
+
+public:
+    /**
+     * @throws std::invalid_argument if the window is 0
+     */
+    explicit RollingMoments(std::size_t window);
+
+    void add(double value) noexcept;
+
+    std::size_t window() const noexcept { return values_.size(); }
+
+    // Values in the window, fewer than window() until it fills
+    std::size_t count() const noexcept { return static_cast<std::size_t>(std::min<std::uint64_t>(index_, values_.size())); }
+
+    double mean() const noexcept;
+
+    /**
+     * @brief Acquires the sample variance of the window, with n - 1 degrees of freedom, 0 for fewer than 2 values.
+     */
+    double variance() const noexcept;
+
+    double stddev() const noexcept;
+};
+
+/**
+ * @class RollingExtremes
+ *
+ * @brief Minimum and maximum of the last window values of a stream, in O(1) amortized per value.
+ * @note Two monotonic deques of (index, value): a new value pops the values it dominates from the back, and the front
+ *       is dropped once it leaves the window, so the front is the extreme. NaNs are kept out of the deques, and make
+ *       both extremes NaN while they are in the window.
+ */
+class RollingExtremes {
+private:
+    std::size_t window_;
+    std::uint64_t index_ = 0;
+    std::uint64_t last_nan_ = 0; // Index + 1 of the last NaN
+    std::deque<std::pair<std::uint64_t, double>> minima_; // Increasing values
+    std::deque<std::pair<std::uint64_t, double>> maxima_; // Decreasing values
+
+public:
+    /**
+     * @throws std::invalid_argument if the window is 0
+     */
+    explicit RollingExtremes(std::size_t window);
+
+    void add(double value);
+
+    // NaN before the first value
+    double min() const noexcept;
+    double max() const noexcept;
+};
+
+/**
+ * @class RollingMedian
+ *
+ * @brief Median of the last window values of a stream, in O(log window) per value.
+ * @note Two balanced trees hold the lower and the upper half of the window, the lower one holding the extra value of
+ *       an odd count. The value that leaves the window is found in its half and erased, then one value moves between
+ *       the halves if needed. Unlike a pair of heaps, the trees erase any value directly, without lazy deletion. NaNs
+ *       are kept out of the halves, and make the median NaN while they are in the window.
+ */
+class RollingMedian {
+private:
+    std::vector<double> values_; // The window, value i at slot i % window
+    std::uint64_t index_ = 0;
+    std::uint64_t last_nan_ = 0; // Index + 1 of the last NaN
+    std::multiset<double> lower_;
+    std::multiset<double> upper_;
+
+    void balance();
+
+public:
+    /**
+     * @throws std::invalid_argument if the window is 0
+     */
+    explicit RollingMedian(std::size_t window);
+
+    void add(double value);
+
+    // The middle value of the window, the mean of the two middle ones for an even count, NaN before the first value
+    double median() const noexcept;
+};
+
+/**
+ * @class Ewma
+ *
+ * @brief Exponentially weighted moving mean and variance of a stream.
+ * @note After the first value, mean += alpha (x - mean) and variance = (1 - alpha) (variance + alpha (x - mean)^2),
+ *       with the mean before the update. NaNs and infinities are skipped, as they would stay in the mean forever.
+ */
+class Ewma {
+private:
+    double alpha_;
+    double mean_ = 0;
+    double variance_ = 0;
+    std::uint64_t count_ = 0;
+
+public:
+    /**
+     * @param alpha the weight of the newest value, 2 / (n + 1) for a span of n values
+     * @throws std::invalid_argument if alpha is not in (0, 1]
+     */
+    explicit Ewma(double alpha);
+
+    void add(double value) noexcept;
+
+    std::uint64_t count() const noexcept { return count_; }
+
+    // NaN before the first value
+    double mean() const noexcept;
+    double variance() const noexcept;
+};
+
+} // namespace stats
@@ -0,0 +1,183 @@
+#pragma once
+
+// The array loops of stats::ExactSum and stats::Moments, written once over a GCC vector of doubles. It is included by
+// stats.cpp with vectors of two doubles, and by stats_avx2.cpp, which is compiled with -mavx2 -mfma, with vectors of
+// four. The loops multiply nothing, so contraction into fused multiply-adds cannot change them, and the sums they
+// return are exact, so both give the same bits. The anonymous namespace gives each translation unit its own
+// instances, as for linalg_kernels.h.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace stats {
+namespace {
+
+typedef double Double2 __attribute__((vector_size(16)));
+typedef double Double4 __attribute__((vector_size(32)));
+
+/**
+ * @brief Rump's extraction over arrays, two vectors V at a time.
+ */
+template <typename V>
+struct Extraction {
+    static constexpr std::size_t kLanes = sizeof(V) / sizeof(double);
+    static constexpr std::size_t kStep = 2 * kLanes;
+
+    static V load(const double* values) noexcept {
+        V vector;
+        std::memcpy(&vector, values, sizeof(vector));
+        return vector;
+    }
+
+    static V splat(double value) noexcept {
+        V vector;
+        for (std::size_t l = 0; l < kLanes; ++l) vector[l] = value;
+        return vector;
+    }
+
+    // |x| of a finite x, as the larger of x and -x, which compiles to a maximum
+    static V magnitude(V x) noexcept {
+        const V negated = -x;
+        return x > negated ? x : negated;
+    }
+
+    static double largest_lane(V x) noexcept {
+        double largest = x[0];
+        for (std::size_t l = 1; l < kLanes; ++l) largest = std::max(largest, x[l]);
+        return largest;
+    }
+
+    static double sum_lanes(V x) noexcept {
+        double sum = x[0];
+        for (std::size_t l = 1; l < kLanes; ++l) sum += x[l];
+        return sum;
+    }
+
+    // The largest magnitude of values, NaN if one of them is not finite
+    static double largest(const double* values, std::size_t count) noexcept {
+        V largest0 = splat(0), largest1 = largest0, check0 = largest0, check1 = largest0; // x - x is NaN for NaN and infinities
+        std::size_t i = 0;
+        for (; i + kStep <= count; i += kStep) {
+            const V a = load(values + i), b = load(values + i + kLanes);
+            check0 += a - a;
+            check1 += b - b;
+            largest0 = magnitude(a) > largest0 ? magnitude(a) : largest0;
+            largest1 = magnitude(b) > largest1 ? magnitude(b) : largest1;
+        }
+        double largest = std::max(largest_lane(largest0), largest_lane(largest1));
+        double check = sum_lanes(check0) + sum_lanes(check1);
+        for (; i < count; ++i) {
+            check += values[i] - values[i];
+            largest = std::max(largest, std::fabs(values[i]));
+        }
+        return check == 0 ? largest : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Rounds values to multiples of ulp(sigma) / 2, returning the sum of those, which is exact for values below
+    // sigma / kSumBlock, and writing the remainders, the largest of which goes to largest; remainders may be values
+    static double extract(const double* values, double* remainders, std::size_t count, double sigma, double& largest) noexcept {
+        const V s = splat(sigma);
+        V sum0 = splat(0), sum1 = sum0, largest0 = sum0, largest1 = sum0;
+        std::size_t i = 0;
+        for (; i + kStep <= count; i += kStep) {
+            V a = load(values + i), b = load(values + i + kLanes);
+            const V qa = (s + a) - s, qb = (s + b) - s;
+            sum0 += qa;
+            sum1 += qb;
+            a -= qa;
+            b -= qb;
+            std::memcpy(remainders + i, &a, sizeof(a));
+            std::memcpy(remainders + i + kLanes, &b, sizeof(b));
+            largest0 = magnitude(a) > largest0 ? magnitude(a) : largest0;
+            largest1 = magnitude(b) > largest1 ? magnitude(b) : largest1;
+        }
+        largest = std::max(largest_lane(largest0), largest_lane(largest1));
+        double sum = sum_lanes(sum0) + sum_lanes(sum1);
+        for (; i < count; ++i) {
+            const double q = (sigma + values[i]) - sigma;
+            sum += q;
+            remainders[i] = values[i] - q;
+            largest = std::max(largest, std::fabs(remainders[i]));
+        }
+        return sum;
+    }
+
+    // Three levels of extract in one pass, by sigma, sigma 2^-41 and sigma 2^-82, each remainder below the next
+    // sigma / kSumBlock: writes the exact sums of the levels to sums and returns the largest final remainder, writing
+    // the remainders too if Store
+    template <bool Store>
+    static double extract3(const double* values, double* remainders, std::size_t count, double sigma, double sums[3]) noexcept {
+        const double sigmas[3] = {sigma, std::ldexp(sigma, -41), std::ldexp(sigma, -82)};
+        const V s0 = splat(sigmas[0]), s1 = splat(sigmas[1]), s2 = splat(sigmas[2]);
+        V sum[3][2] = {}, largest0 = splat(0), largest1 = largest0;
+        std::size_t i = 0;
+        for (; i + kStep <= count; i += kStep) {
+            V a = load(values + i), b = load(values + i + kLanes);
+            V qa = (s0 + a) - s0, qb = (s0 + b) - s0;
+            sum[0][0] += qa;
+            sum[0][1] += qb;
+            a -= qa;
+            b -= qb;
+            qa = (s1 + a) - s1;
+            qb = (s1 + b) - s1;
+            sum[1][0] += qa;
+            sum[1][1] += qb;
+            a -= qa;
+            b -= qb;
+            qa = (s2 + a) - s2;
+            qb = (s2 + b) - s2;
+            sum[2][0] += qa;
+            sum[2][1] += qb;
+            a -= qa;
+            b -= qb;
+            if (Store) {
+                std::memcpy(remainders + i, &a, sizeof(a));
+                std::memcpy(remainders + i + kLanes, &b, sizeof(b));
+            }
+            largest0 = magnitude(a) > largest0 ? magnitude(a) : largest0;
+            largest1 = magnitude(b) > largest1 ? magnitude(b) : largest1;
+        }
+        double largest = std::max(largest_lane(largest0), largest_lane(largest1));
+        for (std::size_t level = 0; level < 3; ++level) sums[level] = sum_lanes(sum[level][0]) + sum_lanes(sum[level][1]);
+        for (; i < count; ++i) {
+            double x = values[i];
+            for (std::size_t level = 0; level < 3; ++level) {
+                const double q = (sigmas[level] + x) - sigmas[level];
+                sums[level] += q;
+                x -= q;
+            }
+            if (Store) remainders[i] = x;
+            largest = std::max(largest, std::fabs(x));
+        }
+        return largest;
+    }
+
+    // The least and the greatest of count > 0 values, either zero where they are zeros, NaNs left out but for a first one
+    static void extremes(const double* values, std::size_t count, double& min, double& max) noexcept {
+        V min0 = splat(values[0]), min1 = min0, max0 = min0, max1 = min0;
+        std::size_t i = 0;
+        for (; i + kStep <= count; i += kStep) {
+            const V a = load(values + i), b = load(values + i + kLanes);
+            min0 = a < min0 ? a : min0;
+            min1 = b < min1 ? b : min1;
+            max0 = a > max0 ? a : max0;
+            max1 = b > max1 ? b : max1;
+        }
+        min = values[0];
+        max = values[0];
+        for (std::size_t l = 0; l < kLanes; ++l) {
+            min = std::min({min, min0[l], min1[l]});
+            max = std::max({max, max0[l], max1[l]});
+        }
+        for (; i < count; ++i) {
+            min = std::min(min, values[i]);
+            max = std::max(max, values[i]);
+        }
+    }
+};
+
+} // namespace
+} // namespace stats
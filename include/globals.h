@@ -1,7 +1,12 @@
 #pragma once
 
 #include <getopt.h>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <stdexcept>
 
@@ -11,21 +16,128 @@
 #define UNDERLINE "\033[4m"
 #define RESET "\033[0m"
 
-enum class Mode { Evaluate, Statistics, NumberTheory };
+enum class Mode { Evaluate, Statistics, NumberTheory, Batch, Serve, Binomials };
 
 class CliHelp : public std::exception {};
 class CliVersion : public std::exception {};
 
+constexpr std::uint64_t kMaxThreads = 1024;   // Most threads -j accepts
+constexpr std::uint64_t kMaxSlowest = 100000; // Most slowest expressions --slowest accepts
+constexpr std::uint64_t kMaxWorkers = 256;    // Most worker processes --workers accepts, and workers::run forks
+constexpr std::uint64_t kMaxDigits = 100000000; // Most digits --digits accepts
+constexpr std::uint64_t kMaxSamples = 1000000000000; // Most samples --sample accepts
+constexpr std::uint64_t kMaxWindow = 10000000; // Most values in the window --window accepts
+
 /**
  * @struct CliArgs
  * 
  * @brief Struct containing the parsed command line interface arguments
  */
 struct CliArgs {
-    Mode mode_;       // Mode to compute
-    std::string str_; // String to compute
+    Mode mode_;                // Mode to compute
+    std::string str_;          // String to compute, the input file in batch modes ("-" for stdin), or the socket path
+    unsigned threads_ = 1;     // Number of worker threads
+    std::string latency_;      // Format of the latency report ("text" or "json"), empty to skip it
+    std::size_t slowest_ = 10; // Number of slowest expressions in the latency report
+    bool ieee_ = false;        // Propagate numerical errors as inf/NaN instead of reporting them
+    std::vector<std::string> definitions_; // Function definitions, in order
+    bool memo_stats_ = false;  // Report the memo cache hit rates of the user-defined functions
+    std::string grad_;         // Point to differentiate at ("x=1,y=2"), empty to only evaluate
+    std::string poly_;         // Polynomial subtrees to collect ("collect" or "expand"), empty for none
+    std::string type_;         // Numeric type to evaluate in (see typed::parse_numeric_type), empty for double
+    double tolerance_ = 0;     // Relative error bound of adaptive evaluation, 0 to evaluate without a bound
+    bool fast_math_ = false;   // Compute elementary functions with the fast kernels instead of libm
+    std::size_t digits_ = 0;   // Digits after the point to print pi or e with, 0 to evaluate in double
+    std::string input_;        // CSV file whose rows give the values of the symbols of -e, empty for none
+    std::string format_ = "csv"; // Format of the result column of --input ("csv" or "binary")
+    unsigned workers_ = 0;     // Worker processes of batch mode, 0 to evaluate in this process
+    std::uint64_t samples_ = 0; // Samples of the symbols drawn from distributions_, 0 to evaluate once
+    std::vector<std::string> distributions_; // Distributions of the symbols ("x ~ normal(0, 1)"), in order
+    std::uint64_t seed_ = 0;   // Seed of the samples
+    std::size_t window_ = 20;  // Window of the rolling statistics
+    double alpha_ = 0;         // Weight of the rolling EWMA, 0 for 2 / (window + 1)
+    std::string sweep_;        // Symbol to sweep and fixed values ("x=0:1:11,y=2"), empty to evaluate once
+    bool fuse_ = false;        // Rewrite a*b+c, x*k, x+k and x/k into fused nodes before evaluating in double
+    bool stream_ = false;      // Evaluate str_ as a file ('-' for stdin) holding one expression, without building its tree
+    std::vector<std::string> matrices_; // Vectors and matrices of -e read from files ("A=a.txt"), in order
+    bool exact_sum_ = false;   // Sum chains of + and - exactly before evaluating in double
+    std::string symbols_;      // Values of the symbols of server requests ("x=1,y=2"), empty for none
+};
+
+// Values of the long-only options
+enum CliLongOption : int {
+    kOptLatency = 256,
+    kOptSlowest,
+    kOptServe,
+    kOptIeee,
+    kOptMemoStats,
+    kOptGrad,
+    kOptPoly,
+    kOptType,
+    kOptExact,
+    kOptAdaptive,
+    kOptFastMath,
+    kOptBinomials,
+    kOptDigits,
+    kOptInput,
+    kOptFormat,
+    kOptWorkers,
+    kOptSample,
+    kOptDist,
+    kOptSeed,
+    kOptRolling,
+    kOptWindow,
+    kOptEwma,
+    kOptSweep,
+    kOptStream,
+    kOptFuse,
+    kOptMatrix,
+    kOptExactSum,
+    kOptSymbols,
 };
 
+/**
+ * @brief Parses the whole number value of a command line option.
+ *
+ * @param text the value
+ * @param option the option, for the message
+ * @param min the least value accepted
+ * @param max the greatest value accepted
+ * @throws std::invalid_argument if text is not only digits, or the value is outside [min, max]
+ * @note Unlike std::stoul, signs and trailing characters are rejected, so -1 does not wrap to a huge count.
+ */
+inline std::uint64_t parse_count(const char* text, const char* option, std::uint64_t min, std::uint64_t max) {
+    const char* end = text + std::strlen(text);
+    std::uint64_t value = 0;
+    auto [parsed_end, ec] = std::from_chars(text, end, value);
+    if (ec != std::errc() || parsed_end != end || text == end || value < min || value > max) {
+        throw std::invalid_argument(std::string("Invalid command line argument: ") + option + " expects a whole number from "
+            + std::to_string(min) + " to " + std::to_string(max));
+    }
+    return value;
+}
+
+/**
+ * @brief Parses the real number value of a command line option.
+ *
+ * @param text the value
+ * @param option the option, for the message
+ * @param expects what the option expects, for the message
+ * @param above the value must be greater than this
+ * @param max the greatest value accepted
+ * @throws std::invalid_argument if text is not only a decimal number, or the value is outside (above, max]
+ * @note Unlike std::stod, trailing characters are rejected, so 1e-6x is not taken as 1e-6.
+ */
+inline double parse_real(const char* text, const char* option, const char* expects, double above, double max) {
+    const char* end = text + std::strlen(text);
+    double value = 0;
+    auto [parsed_end, ec] = std::from_chars(text, end, value);
+    if (ec != std::errc() || parsed_end != end || text == end || !(value > above && value <= max)) {
+        throw std::invalid_argument(std::string("Invalid command line argument: ") + option + " expects " + expects);
+    }
+    return value;
+}
+
 /**
  * @brief Acquires the evaluation string from the command line arguments.
  * 
@@ -39,6 +151,37 @@ inline CliArgs get_cli_args(int argc, char* argv[]) {
         {"help",    no_argument,       0, 'h'},
         {"version", no_argument,       0, 'v'},
         {"eval",    required_argument, 0, 'e'},
+        {"batch",   required_argument, 0, 'b'},
+        {"threads", required_argument, 0, 'j'},
+        {"latency", optional_argument, 0, kOptLatency},
+        {"slowest", required_argument, 0, kOptSlowest},
+        {"serve",   required_argument, 0, kOptServe},
+        {"ieee",    no_argument,       0, kOptIeee},
+        {"define",  required_argument, 0, 'd'},
+        {"memo-stats", no_argument,    0, kOptMemoStats},
+        {"grad",    required_argument, 0, kOptGrad},
+        {"poly",    optional_argument, 0, kOptPoly},
+        {"type",    required_argument, 0, kOptType},
+        {"exact",   no_argument,       0, kOptExact},
+        {"adaptive", optional_argument, 0, kOptAdaptive},
+        {"fast-math", no_argument,     0, kOptFastMath},
+        {"binomials", required_argument, 0, kOptBinomials},
+        {"digits",  required_argument, 0, kOptDigits},
+        {"input",   required_argument, 0, kOptInput},
+        {"format",  required_argument, 0, kOptFormat},
+        {"workers", required_argument, 0, kOptWorkers},
+        {"sample",  required_argument, 0, kOptSample},
+        {"dist",    required_argument, 0, kOptDist},
+        {"seed",    required_argument, 0, kOptSeed},
+        {"rolling", required_argument, 0, kOptRolling},
+        {"window",  required_argument, 0, kOptWindow},
+        {"ewma",    required_argument, 0, kOptEwma},
+        {"sweep",   required_argument, 0, kOptSweep},
+        {"stream",  required_argument, 0, kOptStream},
+        {"fuse",    no_argument,       0, kOptFuse},
+        {"matrix",  required_argument, 0, kOptMatrix},
+        {"exact-sum", no_argument,     0, kOptExactSum},
+        {"symbols", required_argument, 0, kOptSymbols},
         {0, 0, 0, 0}
     };
 
@@ -46,12 +189,120 @@ inline CliArgs get_cli_args(int argc, char* argv[]) {
     int option_index = 0;
     CliArgs result;
     
-    while ((opt = getopt_long(argc, argv, "hve:", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hve:b:j:d:", long_options, &option_index)) != -1) {
         switch (opt) {
         case 'e':
             result.mode_ = Mode::Evaluate;
             result.str_ = optarg;
             break;
+        case 'b':
+            result.mode_ = Mode::Batch;
+            result.str_ = optarg;
+            break;
+        case 'j':
+            result.threads_ = static_cast<unsigned>(parse_count(optarg, "--threads", 1, kMaxThreads));
+            break;
+        case kOptLatency:
+            result.latency_ = optarg ? optarg : "text";
+            if (result.latency_ != "text" && result.latency_ != "json") {
+                throw std::invalid_argument("Invalid command line argument: --latency expects 'text' or 'json'");
+            }
+            break;
+        case kOptSlowest:
+            result.slowest_ = parse_count(optarg, "--slowest", 0, kMaxSlowest);
+            break;
+        case kOptServe:
+            result.mode_ = Mode::Serve;
+            result.str_ = optarg;
+            break;
+        case kOptIeee:
+            result.ieee_ = true;
+            break;
+        case 'd':
+            result.definitions_.emplace_back(optarg);
+            break;
+        case kOptMemoStats:
+            result.memo_stats_ = true;
+            break;
+        case kOptGrad:
+            result.grad_ = optarg;
+            break;
+        case kOptPoly:
+            result.poly_ = optarg ? optarg : "collect";
+            if (result.poly_ != "collect" && result.poly_ != "expand") {
+                throw std::invalid_argument("Invalid command line argument: --poly expects 'collect' or 'expand'");
+            }
+            break;
+        case kOptType:
+            result.type_ = optarg;
+            break;
+        case kOptExact:
+            result.type_ = "rational";
+            break;
+        case kOptAdaptive:
+            result.tolerance_ = optarg ? parse_real(optarg, "--adaptive", "a positive tolerance", 0, std::numeric_limits<double>::max()) : 1e-12;
+            break;
+        case kOptFastMath:
+            result.fast_math_ = true;
+            break;
+        case kOptBinomials:
+            result.mode_ = Mode::Binomials;
+            result.str_ = optarg;
+            break;
+        case kOptDigits:
+            result.digits_ = parse_count(optarg, "--digits", 1, kMaxDigits);
+            break;
+        case kOptInput:
+            result.input_ = optarg;
+            break;
+        case kOptFormat:
+            result.format_ = optarg;
+            if (result.format_ != "csv" && result.format_ != "binary") {
+                throw std::invalid_argument("Invalid command line argument: --format expects 'csv' or 'binary'");
+            }
+            break;
+        case kOptWorkers:
+            result.workers_ = static_cast<unsigned>(parse_count(optarg, "--workers", 1, kMaxWorkers));
+            break;
+        case kOptSample:
+            result.samples_ = parse_count(optarg, "--sample", 1, kMaxSamples);
+            break;
+        case kOptDist:
+            result.distributions_.emplace_back(optarg);
+            break;
+        case kOptSeed:
+            result.seed_ = parse_count(optarg, "--seed", 0, std::numeric_limits<std::uint64_t>::max());
+            break;
+        case kOptRolling:
+            result.mode_ = Mode::Statistics;
+            result.str_ = optarg;
+            break;
+        case kOptWindow:
+            result.window_ = parse_count(optarg, "--window", 1, kMaxWindow);
+            break;
+        case kOptEwma:
+            result.alpha_ = parse_real(optarg, "--ewma", "a weight in (0, 1]", 0, 1);
+            break;
+        case kOptSweep:
+            result.sweep_ = optarg;
+            break;
+        case kOptStream:
+            result.mode_ = Mode::Evaluate;
+            result.str_ = optarg;
+            result.stream_ = true;
+            break;
+        case kOptFuse:
+            result.fuse_ = true;
+            break;
+        case kOptMatrix:
+            result.matrices_.emplace_back(optarg);
+            break;
+        case kOptExactSum:
+            result.exact_sum_ = true;
+            break;
+        case kOptSymbols:
+            result.symbols_ = optarg;
+            break;
         case 'h':
             throw CliHelp();
         case 'v':
@@ -68,8 +319,42 @@ inline CliArgs get_cli_args(int argc, char* argv[]) {
  * @brief Displays help.
  */
 inline void show_help() {
-    // TODO
-    std::cout << "cli-calc help" << std::endl;
+    std::cout << "cli-calc help\n"
+        << "  -e, --eval <expr>         evaluate a single expression\n"
+        << "  -b, --batch <file>        evaluate one expression per line ('-' for stdin)\n"
+        << "  -j, --threads <n>         worker threads for batch and server mode\n"
+        << "      --latency[=text|json] report per-expression latency percentiles to stderr\n"
+        << "      --slowest <n>         number of slowest expressions in the latency report\n"
+        << "      --serve <socket>      serve pipelined requests over a Unix domain socket\n"
+        << "      --symbols <x=1,y=2>   values of the symbols the requests of --serve may use\n"
+        << "      --ieee                let numerical errors propagate as inf/nan (batch, server and --input mode)\n"
+        << "  -d, --define <f(x)=expr>  define a function, may be repeated (batch input may define them too)\n"
+        << "      --memo-stats          report the memo cache hit rates of the functions to stderr\n"
+        << "      --grad <x=1,y=2>      evaluate at a point, with the partial derivatives of the variables\n"
+        << "      --poly[=collect|expand] evaluate polynomial subtrees by Horner/Estrin (expand multiplies out sums)\n"
+        << "      --type <type>         evaluate in float, double, long-double, float128 or rational (-e, batch and server mode)\n"
+        << "      --exact               evaluate exactly in rationals, same as --type rational\n"
+        << "      --adaptive[=<tol>]    evaluate with a guaranteed error bound, redoing cancelling sums in double-double\n"
+        << "      --fast-math           compute exp, log, pow, sin and cos with fast kernels (a few ulp) instead of libm\n"
+        << "      --binomials <file>    answer one 'n k' binomial query per line from cached log-factorials ('-' for stdin)\n"
+        << "      --digits <n>          print pi or e (-e pi, -e e) with n digits after the point\n"
+        << "      --input <file.csv>    evaluate -e on every row of a CSV file with a column per symbol (threads: -j)\n"
+        << "      --format <csv|binary> write the results of --input as a CSV column or as native doubles\n"
+        << "      --workers <n>         evaluate batch mode in n worker processes, restarted if they crash\n"
+        << "      --sample <n>          evaluate -e at n samples of the symbols, reporting mean, sd and quantiles\n"
+        << "      --dist <x~dist(a,b)>  distribution of a symbol for --sample: normal, uniform, lognormal, exponential\n"
+        << "      --seed <n>            seed of --sample, which gives the same summaries for any number of threads\n"
+        << "      --rolling <file>      rolling value,mean,sd,min,max,median,ewma of one number per line ('-' for stdin)\n"
+        << "      --window <n>          window of --rolling, 20 by default\n"
+        << "      --ewma <alpha>        weight of the newest value in the EWMA of --rolling, 2/(window+1) by default\n"
+        << "      --sweep <x=0:1:11,y=2> evaluate -e at n values of x from first to last, recomputing only what x reaches\n"
+        << "      --stream <file>       evaluate one expression of any length read from a file ('-' for stdin) in bounded memory\n"
+        << "      --fuse                evaluate a*b+c by fma and x*k, x+k, x/k by fused nodes, reporting the rewrites (-e, batch and server mode)\n"
+        << "      --matrix <A=a.txt>    read a vector or matrix for -e from a file with a row per line, may be repeated;\n"
+        << "                            * multiplies matrices, dot, solve, transpose and det do linear algebra (threads: -j)\n"
+        << "      --exact-sum           sum chains of three or more terms of + and - exactly, rounding once (-e, batch and server mode)\n"
+        << "  -h, --help                show this help\n"
+        << "  -v, --version             show the version" << std::endl;
 }
 
 /**
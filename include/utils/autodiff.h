@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "data/datatype_decl.h"
+
+namespace expr {
+
+/**
+ * @struct Dual
+ *
+ * @brief A value and its derivative with respect to one variable, for forward-mode differentiation.
+ */
+struct Dual {
+    types::Numeral value_ = 0;
+    types::Numeral tangent_ = 0; // Derivative of value_ with respect to the variable of the pass
+};
+
+/**
+ * @struct ForwardContext
+ *
+ * @brief State of a forward-mode pass, threaded through ExprNode::evaluateDual.
+ */
+struct ForwardContext {
+    types::Symbol variable_;          // The variable differentiated against
+    const Dual* arguments_ = nullptr; // Arguments of the innermost user-defined function call
+    unsigned depth_ = 0;              // Nested calls of user-defined functions
+};
+
+/**
+ * @struct TapeValue
+ *
+ * @brief A value recorded on a Tape, and the entry its derivatives flow back to.
+ */
+struct TapeValue {
+    types::Numeral value_ = 0;
+    std::size_t index_ = std::numeric_limits<std::size_t>::max(); // Tape::kConstant if no variable affects the value
+};
+
+/**
+ * @class Tape
+ *
+ * @brief Wengert list of one evaluation, for reverse-mode differentiation.
+ * @note ExprNode::record appends one entry per operation that depends on a variable, with the local partial
+ *       derivatives towards its (at most two) operands. A single backward sweep then yields the derivatives of
+ *       the result with respect to every variable. Constant subexpressions leave no entries.
+ */
+class Tape {
+public:
+    static constexpr std::size_t kConstant = std::numeric_limits<std::size_t>::max();
+
+    const TapeValue* arguments_ = nullptr; // Arguments of the innermost user-defined function call
+    unsigned depth_ = 0;                   // Nested calls of user-defined functions
+
+private:
+    struct Entry {
+        std::size_t first_;
+        std::size_t second_;
+        types::Numeral first_partial_;
+        types::Numeral second_partial_;
+    };
+
+    std::vector<Entry> entries_;
+    std::unordered_map<types::Symbol, std::size_t> variables_; // Entry of each variable met
+
+public:
+    /**
+     * @brief Records a value that no variable affects.
+     */
+    TapeValue constant(types::Numeral value) const noexcept { return TapeValue{value, kConstant}; }
+
+    /**
+     * @brief Records a variable, once per name however often it occurs.
+     *
+     * @param name name of the variable
+     * @param value value of the variable
+     */
+    TapeValue variable(const types::Symbol& name, types::Numeral value) {
+        auto [it, inserted] = variables_.try_emplace(name, entries_.size());
+        if (inserted) entries_.push_back(Entry{kConstant, kConstant, 0, 0});
+        return TapeValue{value, it->second};
+    }
+
+    /**
+     * @brief Records the result of a unary operation.
+     *
+     * @param value the result
+     * @param x the operand
+     * @param partial derivative of the result with respect to the operand
+     */
+    TapeValue unary(types::Numeral value, TapeValue x, types::Numeral partial) {
+        if (x.index_ == kConstant) return constant(value);
+        entries_.push_back(Entry{x.index_, kConstant, partial, 0});
+        return TapeValue{value, entries_.size() - 1};
+    }
+
+    /**
+     * @brief Records the result of a binary operation.
+     *
+     * @param value the result
+     * @param a the first operand
+     * @param a_partial derivative of the result with respect to the first operand
+     * @param b the second operand
+     * @param b_partial derivative of the result with respect to the second operand
+     */
+    TapeValue binary(types::Numeral value, TapeValue a, types::Numeral a_partial, TapeValue b, types::Numeral b_partial) {
+        if (a.index_ == kConstant) return unary(value, b, b_partial);
+        if (b.index_ == kConstant) return unary(value, a, a_partial);
+        entries_.push_back(Entry{a.index_, b.index_, a_partial, b_partial});
+        return TapeValue{value, entries_.size() - 1};
+    }
+
+    /**
+     * @brief Propagates the derivatives of a result back to the variables.
+     *
+     * @param result a value recorded on this tape
+     * @returns the derivative of the result with respect to every variable met
+     */
+    std::unordered_map<types::Symbol, types::Numeral> gradient(TapeValue result) const {
+        std::vector<types::Numeral> adjoints(entries_.size(), 0);
+        if (result.index_ != kConstant) adjoints[result.index_] = 1;
+        for (std::size_t i = adjoints.size(); i-- > 0; ) { // Operands are always recorded before their results
+            types::Numeral adjoint = adjoints[i];
+            if (adjoint == 0) continue;
+            const Entry& entry = entries_[i];
+            if (entry.first_ != kConstant) adjoints[entry.first_] += adjoint * entry.first_partial_;
+            if (entry.second_ != kConstant) adjoints[entry.second_] += adjoint * entry.second_partial_;
+        }
+
+        std::unordered_map<types::Symbol, types::Numeral> result_gradient;
+        for (const auto& [name, index] : variables_) result_gradient.emplace(name, adjoints[index]);
+        return result_gradient;
+    }
+
+    /**
+     * @brief Forgets every entry, keeping the storage for the next evaluation.
+     */
+    void clear() noexcept {
+        entries_.clear();
+        variables_.clear();
+        arguments_ = nullptr;
+        depth_ = 0;
+    }
+
+    std::size_t size() const noexcept { return entries_.size(); }
+};
+
+} // namespace expr
@@ -1,14 +1,55 @@
 #pragma once
 
 #include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
 #include <vector>
 #include <memory>
 #include <utility>
 #include "data/datatype_decl.h"
+#include "data/expected.h"
+#include "functional/elementary.h"
+#include "functional/numbers.h"
+#include "utils/autodiff.h"
 #include "utils/symbol_table.h"
 
 namespace expr {
 
+// How numerical errors are handled by the non-throwing evaluation
+enum class NumericMode {
+    Strict, // Numerical errors (such as division by 0) are reported as errors
+    IEEE    // Numerical errors propagate as IEEE infinities and NaNs
+};
+
+/**
+ * @struct EvalStatus
+ *
+ * @brief Error state threaded through ExprNode::evaluateChecked.
+ * @note Only the first error is kept; evaluation carries on (with NaN where a value is missing) instead of unwinding.
+ */
+struct EvalStatus {
+    NumericMode mode_ = NumericMode::Strict;
+    types::ErrorCode code_ = types::ErrorCode::None;
+    std::size_t position_ = 0;            // Position of the node that failed
+    const types::Symbol* symbol_ = nullptr; // The undefined symbol, for ErrorCode::UndefinedSymbol
+
+    /**
+     * @brief Records an error, unless one has been recorded already.
+     *
+     * @param code the error code
+     * @param position position of the failing node in the source expression
+     */
+    void fail(types::ErrorCode code, std::size_t position) noexcept {
+        if (code_ != types::ErrorCode::None) return;
+        code_ = code;
+        position_ = position;
+    }
+
+    bool ok() const noexcept { return code_ == types::ErrorCode::None; }
+};
+
 /**
  * @class ExprNode
  * 
@@ -17,8 +58,42 @@ namespace expr {
  */
 class ExprNode {
 protected:
+    std::size_t position_ = 0; // Position of the node's token in the source expression
+
     ExprNode() = default; // Default constructor
 
+    /**
+     * @brief Gives a freshly cloned node the position of this node.
+     * 
+     * @param node rvalue reference to a std::unique_ptr to the clone
+     * @returns the clone
+     */
+    std::unique_ptr<ExprNode> positioned(std::unique_ptr<ExprNode>&& node) const {
+        node->position_ = position_;
+        return std::move(node);
+    }
+
+    /**
+     * @brief Destroys the subtree of a child without recursing, so that trees of any depth can be freed.
+     * 
+     * @param subtree the child, left empty
+     * @note Called by the destructors of the nodes with children: the descendants are taken out by replaceChild
+     *       onto a work list, and each node is destroyed once its remaining children are leaves.
+     */
+    static void release(std::unique_ptr<ExprNode>& subtree) noexcept {
+        if (!subtree || subtree->childCount() == 0) return;
+        std::vector<std::unique_ptr<ExprNode>> pending;
+        pending.push_back(std::move(subtree));
+        while (!pending.empty()) {
+            std::unique_ptr<ExprNode> node = std::move(pending.back());
+            pending.pop_back();
+            for (std::size_t i = 0; i < node->childCount(); ++i) {
+                const ExprNode* child = node->child(i);
+                if (child && child->childCount() > 0) pending.push_back(node->replaceChild(i, nullptr));
+            }
+        }
+    }
+
 public:
     virtual ~ExprNode() = default;
 
@@ -39,6 +114,87 @@ public:
      */
     virtual types::Numeral evaluateAt(const SymbolTable& symbols, const std::unordered_map<types::Symbol, types::Numeral>& variables) const = 0;
 
+    /**
+     * @brief Evaluates the expression subtree with the provided symbol table, without throwing.
+     * 
+     * @param symbols the symbol table
+     * @param status records the first error met, and selects how numerical errors are handled
+     * @return the evaluated result, meaningless if status reports an error
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept = 0;
+
+    /**
+     * @brief Evaluates the expression subtree and its derivative with respect to one variable (forward mode).
+     * 
+     * @param symbols the symbol table
+     * @param context the variable differentiated against
+     * @return the value and the derivative
+     * @throws std::runtime_error on the errors evaluate throws for
+     * @note Comparisons and logical operators are piecewise constant, so their derivative is 0.
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const = 0;
+
+    /**
+     * @brief Evaluates the expression subtree, recording the operations that depend on symbols (reverse mode).
+     * 
+     * @param symbols the symbol table
+     * @param tape the tape to record on; every symbol is a variable
+     * @return the value, and its entry on the tape
+     * @throws std::runtime_error on the errors evaluate throws for
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const = 0;
+
+    /**
+     * @brief Whether the node is cheap to evaluate and has no effect other than its value.
+     * 
+     * @note Lazy nodes may evaluate cheap children unconditionally and select between them without branching.
+     */
+    virtual bool isCheap() const noexcept { return false; }
+
+    /**
+     * @brief Acquires the number of children of the node.
+     */
+    virtual std::size_t childCount() const noexcept { return 0; }
+
+    /**
+     * @brief Acquires a child of the node, in source order (the first operand has index 0).
+     * 
+     * @param index the index of the child
+     * @returns a pointer to the child, or nullptr if index is out of range
+     */
+    virtual const ExprNode* child(std::size_t index) const noexcept { return nullptr; }
+
+    /**
+     * @brief Replaces a child of the node, in source order.
+     * 
+     * @param index the index of the child
+     * @param node rvalue reference to a std::unique_ptr to the new child
+     * @returns the replaced child
+     * @throws std::out_of_range if index is out of range
+     */
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) {
+        throw std::out_of_range("Internal error: Node has no child " + std::to_string(index));
+    }
+
+    /**
+     * @brief Creates a deep copy of the expression subtree.
+     * 
+     * @returns a std::unique_ptr to the root of the copy
+     */
+    virtual std::unique_ptr<ExprNode> clone() const = 0;
+
+    /**
+     * @brief Acquires the position of the node's token in the source expression.
+     */
+    std::size_t getPosition() const noexcept { return position_; }
+
+    /**
+     * @brief Sets the position of the node's token in the source expression.
+     * 
+     * @param position the offset in the source expression
+     */
+    void setPosition(std::size_t position) noexcept { position_ = position; }
+
     // Delete copy constructors, default move constructors
     ExprNode(const ExprNode& other) = delete;
     ExprNode& operator=(const ExprNode& other) = delete;
@@ -86,7 +242,17 @@ protected:
     UnaryNode(std::unique_ptr<ExprNode>&& child) : ExprNode(), child_(std::move(child)) {}
 
 public:
-    virtual ~UnaryNode() = default;
+    virtual ~UnaryNode() { release(child_); }
+
+    virtual std::size_t childCount() const noexcept override { return 1; }
+
+    virtual const ExprNode* child(std::size_t index) const noexcept override { return index == 0 ? child_.get() : nullptr; }
+
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) override {
+        if (index != 0) return ExprNode::replaceChild(index, std::move(node));
+        std::swap(child_, node);
+        return std::move(node);
+    }
 };
 
 /**
@@ -115,7 +281,25 @@ protected:
         ExprNode(), left_(std::move(left)), right_(std::move(right)) {}
 
 public:
-    virtual ~BinaryNode() = default;
+    virtual ~BinaryNode() {
+        release(left_);
+        release(right_);
+    }
+
+    virtual std::size_t childCount() const noexcept override { return 2; }
+
+    /**
+     * @note right_ holds the first operand, so it is child 0.
+     */
+    virtual const ExprNode* child(std::size_t index) const noexcept override {
+        return index == 0 ? right_.get() : (index == 1 ? left_.get() : nullptr);
+    }
+
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) override {
+        if (index > 1) return ExprNode::replaceChild(index, std::move(node));
+        std::swap(index == 0 ? right_ : left_, node);
+        return std::move(node);
+    }
 };
 
 /**
@@ -140,8 +324,35 @@ protected:
      */
     MultinaryNode(std::vector<std::unique_ptr<ExprNode>>&& children) : ExprNode(), children_(std::move(children)) {}
 
+    /**
+     * @brief Clones all children.
+     */
+    std::vector<std::unique_ptr<ExprNode>> cloneChildren() const {
+        std::vector<std::unique_ptr<ExprNode>> children;
+        children.reserve(children_.size());
+        for (const auto& child : children_) children.push_back(child->clone());
+        return children;
+    }
+
 public:
-    virtual ~MultinaryNode() = default;
+    virtual ~MultinaryNode() {
+        for (auto& child : children_) release(child);
+    }
+
+    virtual std::size_t childCount() const noexcept override { return children_.size(); }
+
+    /**
+     * @note Derived classes keep children_ in source order.
+     */
+    virtual const ExprNode* child(std::size_t index) const noexcept override {
+        return index < children_.size() ? children_[index].get() : nullptr;
+    }
+
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) override {
+        if (index >= children_.size()) return ExprNode::replaceChild(index, std::move(node));
+        std::swap(children_[index], node);
+        return std::move(node);
+    }
 };
 
 /**
@@ -152,6 +363,7 @@ public:
 class NumeralNode : public ExprNode {
 private:
     types::Numeral value_;
+    std::string text_; // The literal as written, if its value may not round-trip through value_
 
 public:
     /**
@@ -163,9 +375,17 @@ public:
      * @brief Constructor for the Numeral.
      * 
      * @param value the value of the numeral
+     * @param text the literal as written, or empty
      */
-    NumeralNode(const types::Numeral& value) : ExprNode(), value_(value) {};
+    NumeralNode(const types::Numeral& value, std::string text = std::string()) : ExprNode(), value_(value), text_(std::move(text)) {};
 
+    /**
+     * @brief Acquires the literal as written, for evaluation in types wider than types::Numeral.
+     *
+     * @note Empty if the node was not parsed from a literal, or the literal has at most 15 characters, which is all
+     *       digits and a point: its value is then the shortest decimal of value_.
+     */
+    const std::string& text() const noexcept { return text_; }
 
     virtual ~NumeralNode() = default;
 
@@ -175,6 +395,20 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return value_;    
     }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return value_;
+    }
+
+    virtual bool isCheap() const noexcept override final { return true; }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final { return Dual{value_, 0}; }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final { return tape.constant(value_); }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<NumeralNode>(value_, text_));
+    }
 };
 
 /**
@@ -213,18 +447,44 @@ public:
         return symbols.at(symbol_);
     }
 
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        const types::Numeral* value = symbols.find(symbol_);
+        if (value) return *value;
+        if (status.ok()) status.symbol_ = &symbol_;
+        status.fail(types::ErrorCode::UndefinedSymbol, position_);
+        return std::numeric_limits<types::Numeral>::quiet_NaN();
+    }
+
+    /**
+     * @note A symbol only ever fails by being undefined, which evaluateChecked reports without side effects.
+     */
+    virtual bool isCheap() const noexcept override final { return true; }
+
     /**
      * @brief Acquire the name of the symbol.
      * 
      * @returns a types::Symbol with the name of the symbol.
      */
     types::Symbol getSymbolName() const { return symbol_; }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        return Dual{symbols.at(symbol_), symbol_ == context.variable_ ? 1.0 : 0.0};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        return tape.variable(symbol_, symbols.at(symbol_));
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<SymbolNode>(symbol_));
+    }
 };
 
 /**
  * @class PiNode
  * 
  * @brief Class for the constant pi (3.1415926...)
+ * @note Evaluates to the nearest double; constants::digits computes any number of digits (--digits).
  */
 class PiNode : public NullaryNode {
 private:
@@ -242,16 +502,31 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return kValue;    
     }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return kValue;
+    }
+
+    virtual bool isCheap() const noexcept override final { return true; }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final { return Dual{kValue, 0}; }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final { return tape.constant(kValue); }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<PiNode>());
+    }
 };
 
 /**
  * @class ENode
  * 
  * @brief Class for the constant e (2.718281828...)
+ * @note Evaluates to the nearest double; constants::digits computes any number of digits (--digits).
  */
 class ENode : public NullaryNode {
 private:
-    static constexpr types::Numeral kValue = 2.71828182845904532;
+    static constexpr types::Numeral kValue = 2.71828182845904523536;
 
 public:
     /**
@@ -265,6 +540,20 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return kValue;    
     }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return kValue;
+    }
+
+    virtual bool isCheap() const noexcept override final { return true; }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final { return Dual{kValue, 0}; }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final { return tape.constant(kValue); }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<ENode>());
+    }
 };
 
 /**
@@ -294,6 +583,21 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return child_->evaluateAt(symbols, variables);
     }
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return child_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        return child_->evaluateDual(symbols, context);
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        return child_->record(symbols, tape);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<PositiveNode>(child_->clone()));
+    }
 };
 
 /**
@@ -323,6 +627,23 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return -child_->evaluateAt(symbols, variables);
     }
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return -child_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual x = child_->evaluateDual(symbols, context);
+        return Dual{-x.value_, -x.tangent_};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue x = child_->record(symbols, tape);
+        return tape.unary(-x.value_, x, -1);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<NegativeNode>(child_->clone()));
+    }
 };
 
 /**
@@ -353,6 +674,25 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return right_->evaluateAt(symbols, variables) + left_->evaluateAt(symbols, variables);   
     }
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return right_->evaluateChecked(symbols, status) + left_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual a = right_->evaluateDual(symbols, context);
+        Dual b = left_->evaluateDual(symbols, context);
+        return Dual{a.value_ + b.value_, a.tangent_ + b.tangent_};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue a = right_->record(symbols, tape);
+        TapeValue b = left_->record(symbols, tape);
+        return tape.binary(a.value_ + b.value_, a, 1, b, 1);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<AdditionNode>(left_->clone(), right_->clone()));
+    }
 };
 
 /**
@@ -383,6 +723,25 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return right_->evaluateAt(symbols, variables) - left_->evaluateAt(symbols, variables);   
     }
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return right_->evaluateChecked(symbols, status) - left_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual a = right_->evaluateDual(symbols, context);
+        Dual b = left_->evaluateDual(symbols, context);
+        return Dual{a.value_ - b.value_, a.tangent_ - b.tangent_};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue a = right_->record(symbols, tape);
+        TapeValue b = left_->record(symbols, tape);
+        return tape.binary(a.value_ - b.value_, a, 1, b, -1);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<SubtractionNode>(left_->clone(), right_->clone()));
+    }
 };
 
 /**
@@ -413,6 +772,25 @@ public:
         const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
         return right_->evaluateAt(symbols, variables) * left_->evaluateAt(symbols, variables);   
     }
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return right_->evaluateChecked(symbols, status) * left_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual a = right_->evaluateDual(symbols, context);
+        Dual b = left_->evaluateDual(symbols, context);
+        return Dual{a.value_ * b.value_, a.tangent_ * b.value_ + a.value_ * b.tangent_};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue a = right_->record(symbols, tape);
+        TapeValue b = left_->record(symbols, tape);
+        return tape.binary(a.value_ * b.value_, a, b.value_, b, a.value_);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<MultiplicationNode>(left_->clone(), right_->clone()));
+    }
 };
 
 /**
@@ -453,6 +831,903 @@ public:
         if (divisor == 0) throw std::runtime_error("Numerical error: Cannot divide by 0"); // Cannot divide by zero
         return right_->evaluateAt(symbols, variables) / divisor;
     }
+    /**
+     * @note In NumericMode::IEEE a zero divisor yields an infinity or NaN instead of an error.
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        auto divisor = left_->evaluateChecked(symbols, status);
+        if (divisor == 0 && status.mode_ == NumericMode::Strict) status.fail(types::ErrorCode::DivisionByZero, position_);
+        return right_->evaluateChecked(symbols, status) / divisor;
+    }
+
+    /**
+     * @throws std::runtime_error if attempts to divide by 0
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual b = left_->evaluateDual(symbols, context);
+        if (b.value_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0"); // Cannot divide by zero
+        Dual a = right_->evaluateDual(symbols, context);
+        types::Numeral quotient = a.value_ / b.value_;
+        return Dual{quotient, (a.tangent_ - quotient * b.tangent_) / b.value_};
+    }
+
+    /**
+     * @throws std::runtime_error if attempts to divide by 0
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue b = left_->record(symbols, tape);
+        if (b.value_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0"); // Cannot divide by zero
+        TapeValue a = right_->record(symbols, tape);
+        types::Numeral quotient = a.value_ / b.value_;
+        return tape.binary(quotient, a, 1 / b.value_, b, -quotient / b.value_);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<DivisionNode>(left_->clone(), right_->clone()));
+    }
+};
+
+/**
+ * @class ElementaryNode
+ * 
+ * @brief Unary node of an elementary function, such as sqrt, exp, sin, or of gamma, lgamma and the factorial.
+ * @note Values come from functional/elementary.h, at the accuracy selected by elementary::set_accuracy (--fast-math),
+ *       and from functional/numbers.h for the special functions.
+ * 
+ * @tparam F the function
+ */
+template <elementary::Function F>
+class ElementaryNode : public UnaryNode {
+private:
+    /**
+     * @throws std::runtime_error if x is outside the domain of the function
+     */
+    static void checkDomain(types::Numeral x) {
+        if (!elementary::in_domain(F, x)) {
+            throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::OutOfDomain, 0, elementary::function_name(F)}));
+        }
+    }
+
+    // Derivative at x, where the function has the value
+    static types::Numeral derivative(types::Numeral x, types::Numeral value) noexcept {
+        switch (F) {
+        case elementary::Function::Sqrt: return 0.5 / value;
+        case elementary::Function::Exp: return value;
+        case elementary::Function::Log: return 1 / x;
+        case elementary::Function::Sin: return elementary::evaluate(elementary::Function::Cos, x);
+        case elementary::Function::Cos: return -elementary::evaluate(elementary::Function::Sin, x);
+        case elementary::Function::Gamma: return value * numbers::digamma(x);
+        case elementary::Function::LogGamma: return numbers::digamma(x);
+        case elementary::Function::Factorial: return value * numbers::digamma(x + 1);
+        } // switch (F)
+        return 0;
+    }
+
+public:
+    /**
+     * @brief Default constructor.
+     */
+    ElementaryNode() : UnaryNode() {}
+
+    /**
+     * @brief Constructor of the ElementaryNode.
+     * 
+     * @param child rvalue reference to a std::unique_ptr to the argument
+     */
+    ElementaryNode(std::unique_ptr<ExprNode>&& child) : UnaryNode(std::move(child)) {}
+
+    /**
+     * @throws std::runtime_error if the argument is outside the domain
+     */
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        types::Numeral x = child_->evaluate(symbols);
+        checkDomain(x);
+        return elementary::evaluate(F, x);
+    }
+
+    /**
+     * @throws std::runtime_error if the argument is outside the domain
+     */
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        types::Numeral x = child_->evaluateAt(symbols, variables);
+        checkDomain(x);
+        return elementary::evaluate(F, x);
+    }
+
+    /**
+     * @note In NumericMode::IEEE an argument outside the domain yields a NaN or infinity instead of an error.
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        types::Numeral x = child_->evaluateChecked(symbols, status);
+        if (status.mode_ == NumericMode::Strict && !elementary::in_domain(F, x)) {
+            if (status.ok()) status.symbol_ = &elementary::function_name(F);
+            status.fail(types::ErrorCode::OutOfDomain, position_);
+        }
+        return elementary::evaluate(F, x);
+    }
+
+    /**
+     * @throws std::runtime_error if the argument is outside the domain
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual x = child_->evaluateDual(symbols, context);
+        checkDomain(x.value_);
+        types::Numeral value = elementary::evaluate(F, x.value_);
+        return Dual{value, derivative(x.value_, value) * x.tangent_};
+    }
+
+    /**
+     * @throws std::runtime_error if the argument is outside the domain
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue x = child_->record(symbols, tape);
+        checkDomain(x.value_);
+        types::Numeral value = elementary::evaluate(F, x.value_);
+        return tape.unary(value, x, derivative(x.value_, value));
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<ElementaryNode>(child_->clone()));
+    }
 };
 
+typedef ElementaryNode<elementary::Function::Sqrt> SqrtNode;
+typedef ElementaryNode<elementary::Function::Exp> ExpNode;
+typedef ElementaryNode<elementary::Function::Log> LogNode;
+typedef ElementaryNode<elementary::Function::Sin> SinNode;
+typedef ElementaryNode<elementary::Function::Cos> CosNode;
+typedef ElementaryNode<elementary::Function::Gamma> GammaNode;
+typedef ElementaryNode<elementary::Function::LogGamma> LogGammaNode;
+typedef ElementaryNode<elementary::Function::Factorial> FactorialNode;
+
+/**
+ * @class PowerNode
+ * 
+ * @brief Binary node of the power x^y, also written pow(x, y).
+ * @note Values come from functional/elementary.h, at the accuracy selected by elementary::set_accuracy (--fast-math).
+ */
+class PowerNode : public BinaryNode {
+private:
+    /**
+     * @throws std::runtime_error if 0 has a negative exponent, or a negative base a fractional one
+     */
+    static void checkDomain(types::Numeral base, types::Numeral exponent) {
+        if (base == 0 && exponent < 0) throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::DivisionByZero}));
+        if (!elementary::pow_in_domain(base, exponent)) {
+            throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::OutOfDomain, 0, name()}));
+        }
+    }
+
+    // Partial derivatives with respect to the base and the exponent; the latter is taken as 0 where log(base) is undefined
+    static std::pair<types::Numeral, types::Numeral> partials(types::Numeral base, types::Numeral exponent, types::Numeral value) noexcept {
+        types::Numeral by_base = exponent == 0 ? 0 : exponent * elementary::pow(base, exponent - 1);
+        types::Numeral by_exponent = base > 0 ? value * elementary::evaluate(elementary::Function::Log, base) : 0;
+        return {by_base, by_exponent};
+    }
+
+public:
+    /**
+     * @brief Acquires the name errors report the operation by.
+     * @note The name outlives every caller, so EvalStatus::symbol_ may point at it.
+     */
+    static const std::string& name() noexcept {
+        static const std::string name = "^";
+        return name;
+    }
+
+    /**
+     * @brief Default constructor.
+     */
+    PowerNode() : BinaryNode() {}
+
+    /**
+     * @brief Constructor of the PowerNode.
+     * 
+     * @param left rvalue reference to a std::unique_ptr to the exponent
+     * @param right rvalue reference to a std::unique_ptr to the base
+     */
+    PowerNode(std::unique_ptr<ExprNode>&& left, std::unique_ptr<ExprNode>&& right) : BinaryNode(std::move(left), std::move(right)) {}
+
+    /**
+     * @throws std::runtime_error if the power is undefined
+     */
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        types::Numeral base = right_->evaluate(symbols);
+        types::Numeral exponent = left_->evaluate(symbols);
+        checkDomain(base, exponent);
+        return elementary::pow(base, exponent);
+    }
+
+    /**
+     * @throws std::runtime_error if the power is undefined
+     */
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        types::Numeral base = right_->evaluateAt(symbols, variables);
+        types::Numeral exponent = left_->evaluateAt(symbols, variables);
+        checkDomain(base, exponent);
+        return elementary::pow(base, exponent);
+    }
+
+    /**
+     * @note In NumericMode::IEEE an undefined power yields a NaN or infinity instead of an error.
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        types::Numeral base = right_->evaluateChecked(symbols, status);
+        types::Numeral exponent = left_->evaluateChecked(symbols, status);
+        if (status.mode_ == NumericMode::Strict) {
+            if (base == 0 && exponent < 0) status.fail(types::ErrorCode::DivisionByZero, position_);
+            else if (!elementary::pow_in_domain(base, exponent)) {
+                if (status.ok()) status.symbol_ = &name();
+                status.fail(types::ErrorCode::OutOfDomain, position_);
+            }
+        }
+        return elementary::pow(base, exponent);
+    }
+
+    /**
+     * @throws std::runtime_error if the power is undefined
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual base = right_->evaluateDual(symbols, context);
+        Dual exponent = left_->evaluateDual(symbols, context);
+        checkDomain(base.value_, exponent.value_);
+        types::Numeral value = elementary::pow(base.value_, exponent.value_);
+        auto [by_base, by_exponent] = partials(base.value_, exponent.value_, value);
+        return Dual{value, by_base * base.tangent_ + by_exponent * exponent.tangent_};
+    }
+
+    /**
+     * @throws std::runtime_error if the power is undefined
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue base = right_->record(symbols, tape);
+        TapeValue exponent = left_->record(symbols, tape);
+        checkDomain(base.value_, exponent.value_);
+        types::Numeral value = elementary::pow(base.value_, exponent.value_);
+        auto [by_base, by_exponent] = partials(base.value_, exponent.value_, value);
+        return tape.binary(value, base, by_base, exponent, by_exponent);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<PowerNode>(left_->clone(), right_->clone()));
+    }
+};
+
+/**
+ * @class BinomialNode
+ * 
+ * @brief Binary node of the binomial coefficient binom(n, k).
+ * @note Values come from numbers::binomial, real arguments through the gamma function.
+ */
+class BinomialNode : public BinaryNode {
+private:
+    /**
+     * @throws std::runtime_error if n is a negative integer and k is not
+     */
+    static void checkDomain(types::Numeral n, types::Numeral k) {
+        if (!numbers::binomial_in_domain(n, k)) throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::OutOfDomain, 0, name()}));
+    }
+
+    // Partial derivatives with respect to n and k, from the digamma function
+    static std::pair<types::Numeral, types::Numeral> partials(types::Numeral n, types::Numeral k, types::Numeral value) noexcept {
+        if (value == 0) return {0, 0};
+        types::Numeral rest = numbers::digamma(n - k + 1);
+        return {value * (numbers::digamma(n + 1) - rest), value * (rest - numbers::digamma(k + 1))};
+    }
+
+public:
+    /**
+     * @brief Acquires the name errors report the operation by.
+     * @note The name outlives every caller, so EvalStatus::symbol_ may point at it.
+     */
+    static const std::string& name() noexcept {
+        static const std::string name = "binom";
+        return name;
+    }
+
+    /**
+     * @brief Default constructor.
+     */
+    BinomialNode() : BinaryNode() {}
+
+    /**
+     * @brief Constructor of the BinomialNode.
+     * 
+     * @param left rvalue reference to a std::unique_ptr to k
+     * @param right rvalue reference to a std::unique_ptr to n
+     */
+    BinomialNode(std::unique_ptr<ExprNode>&& left, std::unique_ptr<ExprNode>&& right) : BinaryNode(std::move(left), std::move(right)) {}
+
+    /**
+     * @throws std::runtime_error if the coefficient is undefined
+     */
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        types::Numeral n = right_->evaluate(symbols);
+        types::Numeral k = left_->evaluate(symbols);
+        checkDomain(n, k);
+        return numbers::binomial(n, k);
+    }
+
+    /**
+     * @throws std::runtime_error if the coefficient is undefined
+     */
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        types::Numeral n = right_->evaluateAt(symbols, variables);
+        types::Numeral k = left_->evaluateAt(symbols, variables);
+        checkDomain(n, k);
+        return numbers::binomial(n, k);
+    }
+
+    /**
+     * @note In NumericMode::IEEE an undefined coefficient yields a NaN instead of an error.
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        types::Numeral n = right_->evaluateChecked(symbols, status);
+        types::Numeral k = left_->evaluateChecked(symbols, status);
+        if (status.mode_ == NumericMode::Strict && !numbers::binomial_in_domain(n, k)) {
+            if (status.ok()) status.symbol_ = &name();
+            status.fail(types::ErrorCode::OutOfDomain, position_);
+        }
+        return numbers::binomial(n, k);
+    }
+
+    /**
+     * @throws std::runtime_error if the coefficient is undefined
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual n = right_->evaluateDual(symbols, context);
+        Dual k = left_->evaluateDual(symbols, context);
+        checkDomain(n.value_, k.value_);
+        types::Numeral value = numbers::binomial(n.value_, k.value_);
+        auto [by_n, by_k] = partials(n.value_, k.value_, value);
+        return Dual{value, by_n * n.tangent_ + by_k * k.tangent_};
+    }
+
+    /**
+     * @throws std::runtime_error if the coefficient is undefined
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue n = right_->record(symbols, tape);
+        TapeValue k = left_->record(symbols, tape);
+        checkDomain(n.value_, k.value_);
+        types::Numeral value = numbers::binomial(n.value_, k.value_);
+        auto [by_n, by_k] = partials(n.value_, k.value_, value);
+        return tape.binary(value, n, by_n, k, by_k);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<BinomialNode>(left_->clone(), right_->clone()));
+    }
+};
+
+/**
+ * @class ComparisonNode
+ * 
+ * @brief Binary node of a comparison, evaluating to 1 if it holds and 0 otherwise.
+ * 
+ * @tparam Compare the comparison function object, such as std::less<types::Numeral>
+ */
+template <typename Compare>
+class ComparisonNode : public BinaryNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    ComparisonNode() : BinaryNode() {}
+
+    /**
+     * @brief Constructor of the ComparisonNode.
+     * 
+     * @param left rvalue reference to a std::unique_ptr to its left children
+     * @param right rvalue reference to a std::unique_ptr to its right children
+     */
+    ComparisonNode(std::unique_ptr<ExprNode>&& left, std::unique_ptr<ExprNode>&& right) : BinaryNode(std::move(left), std::move(right)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { 
+        return Compare()(right_->evaluate(symbols), left_->evaluate(symbols)) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return Compare()(right_->evaluateAt(symbols, variables), left_->evaluateAt(symbols, variables)) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return Compare()(right_->evaluateChecked(symbols, status), left_->evaluateChecked(symbols, status)) ? 1 : 0;
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        types::Numeral a = right_->evaluateDual(symbols, context).value_;
+        return Dual{Compare()(a, left_->evaluateDual(symbols, context).value_) ? 1.0 : 0.0, 0};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        types::Numeral a = right_->record(symbols, tape).value_;
+        return tape.constant(Compare()(a, left_->record(symbols, tape).value_) ? 1 : 0);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<ComparisonNode>(left_->clone(), right_->clone()));
+    }
+};
+
+typedef ComparisonNode<std::less<types::Numeral>> LessNode;
+typedef ComparisonNode<std::less_equal<types::Numeral>> LessEqualNode;
+typedef ComparisonNode<std::greater<types::Numeral>> GreaterNode;
+typedef ComparisonNode<std::greater_equal<types::Numeral>> GreaterEqualNode;
+typedef ComparisonNode<std::equal_to<types::Numeral>> EqualNode;
+typedef ComparisonNode<std::not_equal_to<types::Numeral>> NotEqualNode;
+
+/**
+ * @class NotNode
+ * 
+ * @brief Unary node of the logical negation, evaluating to 1 if its child is 0 and 0 otherwise.
+ */
+class NotNode : public UnaryNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    NotNode() : UnaryNode() {}
+
+    /**
+     * @brief Constructor of the NotNode.
+     * 
+     * @param child rvalue reference to a std::unique_ptr to the child
+     */
+    NotNode(std::unique_ptr<ExprNode>&& child) : UnaryNode(std::move(child)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { 
+        return child_->evaluate(symbols) == 0 ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return child_->evaluateAt(symbols, variables) == 0 ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return child_->evaluateChecked(symbols, status) == 0 ? 1 : 0;
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        return Dual{child_->evaluateDual(symbols, context).value_ == 0 ? 1.0 : 0.0, 0};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        return tape.constant(child_->record(symbols, tape).value_ == 0 ? 1 : 0);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<NotNode>(child_->clone()));
+    }
+};
+
+/**
+ * @class ShortCircuitNode
+ * 
+ * @brief Base class for binary operations that evaluate their second operand only when needed, such as and, or.
+ * @note Unlike BinaryNode, the operands are stored in source order, and the second one may never be evaluated.
+ *       This class is intended to be abstract. It should never be directly instantiated.
+ */
+class ShortCircuitNode : public ExprNode {
+protected:
+    std::unique_ptr<ExprNode> first_;  // Operand evaluated first
+    std::unique_ptr<ExprNode> second_; // Operand evaluated only if the first does not decide the result
+
+    /**
+     * @brief Default constructor for the short-circuit node.
+     */
+    ShortCircuitNode() : ExprNode(), first_(nullptr), second_(nullptr) {}
+
+    /**
+     * @brief Constructor of the short-circuit node.
+     * 
+     * @param first rvalue reference to the pointer to the operand evaluated first
+     * @param second rvalue reference to the pointer to the operand evaluated only when needed
+     */
+    ShortCircuitNode(std::unique_ptr<ExprNode>&& first, std::unique_ptr<ExprNode>&& second) : 
+        ExprNode(), first_(std::move(first)), second_(std::move(second)) {}
+
+public:
+    virtual ~ShortCircuitNode() {
+        release(first_);
+        release(second_);
+    }
+
+    virtual std::size_t childCount() const noexcept override { return 2; }
+
+    virtual const ExprNode* child(std::size_t index) const noexcept override {
+        return index == 0 ? first_.get() : (index == 1 ? second_.get() : nullptr);
+    }
+
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) override {
+        if (index > 1) return ExprNode::replaceChild(index, std::move(node));
+        std::swap(index == 0 ? first_ : second_, node);
+        return std::move(node);
+    }
+};
+
+/**
+ * @class AndNode
+ * 
+ * @brief Short-circuit node of the logical and, evaluating to 1 or 0.
+ */
+class AndNode : public ShortCircuitNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    AndNode() : ShortCircuitNode() {}
+
+    /**
+     * @brief Constructor of the AndNode.
+     * 
+     * @param first rvalue reference to a std::unique_ptr to the operand evaluated first
+     * @param second rvalue reference to a std::unique_ptr to the operand evaluated if the first is true
+     */
+    AndNode(std::unique_ptr<ExprNode>&& first, std::unique_ptr<ExprNode>&& second) : ShortCircuitNode(std::move(first), std::move(second)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { 
+        return (first_->evaluate(symbols) != 0 && second_->evaluate(symbols) != 0) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return (first_->evaluateAt(symbols, variables) != 0 && second_->evaluateAt(symbols, variables) != 0) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return (first_->evaluateChecked(symbols, status) != 0 && second_->evaluateChecked(symbols, status) != 0) ? 1 : 0;
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        bool result = first_->evaluateDual(symbols, context).value_ != 0 && second_->evaluateDual(symbols, context).value_ != 0;
+        return Dual{result ? 1.0 : 0.0, 0};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        bool result = first_->record(symbols, tape).value_ != 0 && second_->record(symbols, tape).value_ != 0;
+        return tape.constant(result ? 1 : 0);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<AndNode>(first_->clone(), second_->clone()));
+    }
+};
+
+/**
+ * @class OrNode
+ * 
+ * @brief Short-circuit node of the logical or, evaluating to 1 or 0.
+ */
+class OrNode : public ShortCircuitNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    OrNode() : ShortCircuitNode() {}
+
+    /**
+     * @brief Constructor of the OrNode.
+     * 
+     * @param first rvalue reference to a std::unique_ptr to the operand evaluated first
+     * @param second rvalue reference to a std::unique_ptr to the operand evaluated if the first is false
+     */
+    OrNode(std::unique_ptr<ExprNode>&& first, std::unique_ptr<ExprNode>&& second) : ShortCircuitNode(std::move(first), std::move(second)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { 
+        return (first_->evaluate(symbols) != 0 || second_->evaluate(symbols) != 0) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return (first_->evaluateAt(symbols, variables) != 0 || second_->evaluateAt(symbols, variables) != 0) ? 1 : 0;
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return (first_->evaluateChecked(symbols, status) != 0 || second_->evaluateChecked(symbols, status) != 0) ? 1 : 0;
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        bool result = first_->evaluateDual(symbols, context).value_ != 0 || second_->evaluateDual(symbols, context).value_ != 0;
+        return Dual{result ? 1.0 : 0.0, 0};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        bool result = first_->record(symbols, tape).value_ != 0 || second_->record(symbols, tape).value_ != 0;
+        return tape.constant(result ? 1 : 0);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<OrNode>(first_->clone(), second_->clone()));
+    }
+};
+
+/**
+ * @class ConditionalNode
+ * 
+ * @brief Node of if(condition, a, b), evaluating only the branch that is taken.
+ * @note When both branches are cheap (see ExprNode::isCheap), both are evaluated and the result is picked
+ *       with a branchless select; a branch failing this way falls back to the lazy evaluation, so the
+ *       untaken branch never raises an error.
+ */
+class ConditionalNode : public ExprNode {
+protected:
+    std::unique_ptr<ExprNode> condition_;  // The condition, true if not 0
+    std::unique_ptr<ExprNode> then_;       // Evaluated if the condition holds
+    std::unique_ptr<ExprNode> else_;       // Evaluated otherwise
+    bool select_;                          // Whether both branches are cheap enough to evaluate unconditionally
+
+    /**
+     * @brief Branchless evaluation of the cheap branches, false if either branch fails.
+     */
+    bool trySelect(const SymbolTable& symbols, types::Numeral condition, types::Numeral& result) const noexcept {
+        EvalStatus branch_status; // Errors of the branches must not surface from here
+        types::Numeral a = then_->evaluateChecked(symbols, branch_status);
+        types::Numeral b = else_->evaluateChecked(symbols, branch_status);
+        result = condition != 0 ? a : b;
+        return branch_status.ok();
+    }
+
+public:
+    /**
+     * @brief Default constructor.
+     */
+    ConditionalNode() : ExprNode(), condition_(nullptr), then_(nullptr), else_(nullptr), select_(false) {}
+
+    /**
+     * @brief Constructor of the ConditionalNode.
+     * 
+     * @param condition rvalue reference to a std::unique_ptr to the condition
+     * @param then_branch rvalue reference to a std::unique_ptr to the branch taken if the condition holds
+     * @param else_branch rvalue reference to a std::unique_ptr to the branch taken otherwise
+     */
+    ConditionalNode(std::unique_ptr<ExprNode>&& condition, std::unique_ptr<ExprNode>&& then_branch, std::unique_ptr<ExprNode>&& else_branch) :
+        ExprNode(), condition_(std::move(condition)), then_(std::move(then_branch)), else_(std::move(else_branch)),
+        select_(then_->isCheap() && else_->isCheap()) {}
+
+    virtual ~ConditionalNode() {
+        release(condition_);
+        release(then_);
+        release(else_);
+    }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        types::Numeral condition = condition_->evaluate(symbols);
+        types::Numeral result;
+        if (select_ && trySelect(symbols, condition, result)) return result;
+        return condition != 0 ? then_->evaluate(symbols) : else_->evaluate(symbols);
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols, 
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return condition_->evaluateAt(symbols, variables) != 0 ? then_->evaluateAt(symbols, variables) : else_->evaluateAt(symbols, variables);
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        types::Numeral condition = condition_->evaluateChecked(symbols, status);
+        types::Numeral result;
+        if (select_ && trySelect(symbols, condition, result)) return result;
+        return condition != 0 ? then_->evaluateChecked(symbols, status) : else_->evaluateChecked(symbols, status);
+    }
+
+    virtual std::size_t childCount() const noexcept override final { return 3; }
+
+    virtual const ExprNode* child(std::size_t index) const noexcept override final {
+        switch (index) {
+        case 0: return condition_.get();
+        case 1: return then_.get();
+        case 2: return else_.get();
+        default: return nullptr;
+        }
+    }
+
+    virtual std::unique_ptr<ExprNode> replaceChild(std::size_t index, std::unique_ptr<ExprNode>&& node) override final {
+        if (index > 2) return ExprNode::replaceChild(index, std::move(node));
+        std::swap(index == 0 ? condition_ : (index == 1 ? then_ : else_), node);
+        select_ = then_ && else_ && then_->isCheap() && else_->isCheap(); // A child may be taken out for rewriting
+        return std::move(node);
+    }
+
+    /**
+     * @note The derivative is the one of the branch taken.
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        bool condition = condition_->evaluateDual(symbols, context).value_ != 0;
+        return condition ? then_->evaluateDual(symbols, context) : else_->evaluateDual(symbols, context);
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        bool condition = condition_->record(symbols, tape).value_ != 0;
+        return condition ? then_->record(symbols, tape) : else_->record(symbols, tape);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<ConditionalNode>(condition_->clone(), then_->clone(), else_->clone()));
+    }
+};
+
+/**
+ * @class DotNode
+ * 
+ * @brief Binary node of the inner product dot(u, v).
+ * @note The inner product of scalars is their product; matrix_eval::evaluate gives it for vectors and matrices.
+ */
+class DotNode : public BinaryNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    DotNode() : BinaryNode() {}
+
+    /**
+     * @brief Constructor of the DotNode.
+     * 
+     * @param left rvalue reference to a std::unique_ptr to v
+     * @param right rvalue reference to a std::unique_ptr to u
+     */
+    DotNode(std::unique_ptr<ExprNode>&& left, std::unique_ptr<ExprNode>&& right) : BinaryNode(std::move(left), std::move(right)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        return right_->evaluate(symbols) * left_->evaluate(symbols);
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return right_->evaluateAt(symbols, variables) * left_->evaluateAt(symbols, variables);
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return right_->evaluateChecked(symbols, status) * left_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual a = right_->evaluateDual(symbols, context);
+        Dual b = left_->evaluateDual(symbols, context);
+        return Dual{a.value_ * b.value_, a.tangent_ * b.value_ + a.value_ * b.tangent_};
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue a = right_->record(symbols, tape);
+        TapeValue b = left_->record(symbols, tape);
+        return tape.binary(a.value_ * b.value_, a, b.value_, b, a.value_);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<DotNode>(left_->clone(), right_->clone()));
+    }
+};
+
+/**
+ * @class SolveNode
+ * 
+ * @brief Binary node of solve(A, b), the x of A x = b.
+ * @note For scalars x is b / a; matrix_eval::evaluate solves linear systems.
+ */
+class SolveNode : public BinaryNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    SolveNode() : BinaryNode() {}
+
+    /**
+     * @brief Constructor of the SolveNode.
+     * 
+     * @param left rvalue reference to a std::unique_ptr to b
+     * @param right rvalue reference to a std::unique_ptr to A
+     */
+    SolveNode(std::unique_ptr<ExprNode>&& left, std::unique_ptr<ExprNode>&& right) : BinaryNode(std::move(left), std::move(right)) {}
+
+    /**
+     * @throws std::runtime_error if a is 0
+     */
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        auto a = right_->evaluate(symbols);
+        if (a == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+        return left_->evaluate(symbols) / a;
+    }
+
+    /**
+     * @throws std::runtime_error if a is 0
+     */
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        auto a = right_->evaluateAt(symbols, variables);
+        if (a == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+        return left_->evaluateAt(symbols, variables) / a;
+    }
+
+    /**
+     * @note In NumericMode::IEEE a zero a yields an infinity or NaN instead of an error.
+     */
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        auto a = right_->evaluateChecked(symbols, status);
+        if (a == 0 && status.mode_ == NumericMode::Strict) status.fail(types::ErrorCode::DivisionByZero, position_);
+        return left_->evaluateChecked(symbols, status) / a;
+    }
+
+    /**
+     * @throws std::runtime_error if a is 0
+     */
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        Dual a = right_->evaluateDual(symbols, context);
+        if (a.value_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+        Dual b = left_->evaluateDual(symbols, context);
+        types::Numeral x = b.value_ / a.value_;
+        return Dual{x, (b.tangent_ - x * a.tangent_) / a.value_};
+    }
+
+    /**
+     * @throws std::runtime_error if a is 0
+     */
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        TapeValue a = right_->record(symbols, tape);
+        if (a.value_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+        TapeValue b = left_->record(symbols, tape);
+        types::Numeral x = b.value_ / a.value_;
+        return tape.binary(x, b, 1 / a.value_, a, -x / a.value_);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<SolveNode>(left_->clone(), right_->clone()));
+    }
+};
+
+/**
+ * @class MatrixUnaryNode
+ * 
+ * @brief Unary node of transpose(A) or det(A), which leave a scalar as it is.
+ * @note matrix_eval::evaluate gives them for vectors and matrices.
+ * 
+ * @tparam Determinant whether the node is det rather than transpose
+ */
+template <bool Determinant>
+class MatrixUnaryNode : public UnaryNode {
+public:
+    /**
+     * @brief Default constructor.
+     */
+    MatrixUnaryNode() : UnaryNode() {}
+
+    /**
+     * @brief Constructor of the MatrixUnaryNode.
+     * 
+     * @param child rvalue reference to a std::unique_ptr to the argument
+     */
+    MatrixUnaryNode(std::unique_ptr<ExprNode>&& child) : UnaryNode(std::move(child)) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        return child_->evaluate(symbols);
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return child_->evaluateAt(symbols, variables);
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, EvalStatus& status) const noexcept override final {
+        return child_->evaluateChecked(symbols, status);
+    }
+
+    virtual Dual evaluateDual(const SymbolTable& symbols, ForwardContext& context) const override final {
+        return child_->evaluateDual(symbols, context);
+    }
+
+    virtual TapeValue record(const SymbolTable& symbols, Tape& tape) const override final {
+        return child_->record(symbols, tape);
+    }
+
+    virtual std::unique_ptr<ExprNode> clone() const override final {
+        return positioned(std::make_unique<MatrixUnaryNode>(child_->clone()));
+    }
+};
+
+typedef MatrixUnaryNode<false> TransposeNode;
+typedef MatrixUnaryNode<true> DeterminantNode;
+
 } // namespace expr
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+/**
+ * @class LatencyHistogram
+ *
+ * @brief Fixed-memory, log-linear (HDR-style) histogram of latencies in nanoseconds.
+ * @note Values below 256 ns are recorded exactly; above that, every power-of-two range is split into
+ *       128 sub-buckets, so any recorded value is reproduced with a relative error below 1%.
+ *       Recording is a handful of integer operations and never allocates.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 7;                                 // log2 of sub-buckets per power of two
+    static constexpr std::uint64_t kSubBucketCount = 1ull << kSubBucketBits; // Sub-buckets per power of two
+    static constexpr int kMaxValueBits = 44;                                 // Largest trackable value is 2^44 ns (~4.9 hours)
+    static constexpr std::size_t kBucketCount =
+        2 * kSubBucketCount + (kMaxValueBits - kSubBucketBits - 1) * kSubBucketCount;
+
+private:
+    std::array<std::uint64_t, kBucketCount> counts_; // Count of each bucket
+    std::uint64_t total_count_;                       // Number of recorded values
+    std::uint64_t min_;                               // Smallest recorded value
+    std::uint64_t max_;                               // Largest recorded value
+    long double sum_;                                 // Sum of the recorded values, for the mean
+
+public:
+    /**
+     * @brief Default constructor, creates an empty histogram.
+     */
+    LatencyHistogram();
+
+    /**
+     * @brief Records a single value.
+     *
+     * @param value_ns the latency in nanoseconds
+     * @note Values larger than the trackable range are clamped into the last bucket.
+     */
+    void record(std::uint64_t value_ns) noexcept;
+
+    /**
+     * @brief Adds all values recorded in another histogram into this one.
+     *
+     * @param other the histogram to merge
+     * @returns A reference to this
+     */
+    LatencyHistogram& merge(const LatencyHistogram& other) noexcept;
+
+    /**
+     * @brief Acquires the value at a given percentile.
+     *
+     * @param percentile the percentile, in [0, 100]
+     * @returns the highest value equivalent to the bucket containing the percentile, or 0 if empty
+     */
+    std::uint64_t value_at_percentile(double percentile) const noexcept;
+
+    std::uint64_t count() const noexcept { return total_count_; }
+    std::uint64_t min() const noexcept { return total_count_ ? min_ : 0; }
+    std::uint64_t max() const noexcept { return max_; }
+    double mean() const noexcept { return total_count_ ? static_cast<double>(sum_ / total_count_) : 0.0; }
+
+    /**
+     * @brief Acquires the bucket index of a value.
+     *
+     * @param value_ns the value in nanoseconds
+     */
+    static std::size_t bucket_index(std::uint64_t value_ns) noexcept;
+
+    /**
+     * @brief Acquires the smallest value falling into a bucket.
+     *
+     * @param index the bucket index
+     */
+    static std::uint64_t bucket_lowest(std::size_t index) noexcept;
+
+    /**
+     * @brief Acquires the largest value falling into a bucket.
+     *
+     * @param index the bucket index
+     */
+    static std::uint64_t bucket_highest(std::size_t index) noexcept;
+};
+
+/**
+ * @struct SlowSample
+ *
+ * @brief A single slow expression kept for reporting.
+ */
+struct SlowSample {
+    std::uint64_t latency_ns_; // Total latency (parse + evaluate)
+    std::size_t line_;         // Line number in the input (1-based)
+    std::string expression_;   // The expression text
+};
+
+/**
+ * @class SlowestList
+ *
+ * @brief Bounded collection of the N slowest samples.
+ * @note The expression text is copied only when a sample enters the list.
+ */
+class SlowestList {
+private:
+    std::size_t capacity_;          // N
+    std::vector<SlowSample> heap_;  // Min-heap on latency, the fastest of the kept samples on top
+
+public:
+    /**
+     * @brief Constructor of the SlowestList.
+     *
+     * @param capacity the number of samples to keep
+     */
+    explicit SlowestList(std::size_t capacity = 0);
+
+    /**
+     * @brief Offers a sample to the list.
+     *
+     * @param latency_ns the total latency of the sample
+     * @param line the line number of the sample
+     * @param expression the expression text
+     */
+    void offer(std::uint64_t latency_ns, std::size_t line, const std::string& expression);
+
+    /**
+     * @brief Offers all samples kept by another list.
+     *
+     * @param other the list to merge
+     * @returns A reference to this
+     */
+    SlowestList& merge(const SlowestList& other);
+
+    /**
+     * @brief Acquires the kept samples, slowest first.
+     */
+    std::vector<SlowSample> sorted() const;
+};
+
+} // namespace utils
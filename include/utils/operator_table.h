@@ -21,6 +21,7 @@ struct OperatorInfo {
     int precedence_;         // Precedence of operator (higher means greater precedence)
     bool right_assoc_;       // Whether the operator is right-associative
     NodeFactory node_func_;  // The factory function for generating the node of the function
+    bool function_ = false;  // Whether it takes bracketed, comma-separated arguments (such as if(c, a, b))
 };
 
 /**
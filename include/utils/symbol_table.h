@@ -61,6 +61,14 @@ public:
      */
     const types::Numeral& at(const types::Symbol& symbol_name) const;
 
+    /**
+     * @brief Looks up the value of a symbol without throwing.
+     *
+     * @param symbol_name name of the symbol
+     * @returns a pointer to the value, or nullptr if symbol_name does not exist
+     */
+    const types::Numeral* find(const types::Symbol& symbol_name) const noexcept;
+
     /**
      * @brief Overload the [] operator for access to data members.
      * 
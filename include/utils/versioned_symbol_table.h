@@ -0,0 +1,131 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "data/datatype_decl.h"
+#include "utils/symbol_table.h"
+
+/**
+ * @class VersionedSymbolTable
+ *
+ * @brief Copy-on-write symbol table for many concurrent readers and occasional writers.
+ * @note Readers take a Snapshot: one epoch announcement and one atomic pointer load, no locks. The snapshot
+ *       stays consistent (all symbols from the same version) for as long as it is held. Writers copy the
+ *       current version, modify the copy and publish it atomically; old versions are reclaimed once no
+ *       reader that could have seen them is still active (epoch-based reclamation).
+ */
+class VersionedSymbolTable {
+private:
+    static constexpr std::size_t kReaderSlots = 128; // Concurrently held snapshots before readers must wait
+
+    struct Version {
+        SymbolTable table_;
+        std::uint64_t number_;
+    };
+
+    // Epoch announced by an active reader, 0 when the slot is free; one per cache line
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> epoch_{0};
+    };
+
+    std::atomic<Version*> current_;                          // The published version
+    std::atomic<std::uint64_t> epoch_;                       // Global epoch, advanced on every publication
+    mutable std::array<ReaderSlot, kReaderSlots> readers_;   // Reader announcements
+    std::mutex writer_mutex_;                                // Serializes writers only
+    std::vector<std::pair<Version*, std::uint64_t>> retired_; // Replaced versions and the epoch they were retired at
+
+    /**
+     * @brief Frees the retired versions no active reader can still hold.
+     *
+     * @note Must be called with writer_mutex_ held.
+     */
+    std::size_t reclaim_locked();
+
+public:
+    /**
+     * @class Snapshot
+     *
+     * @brief A consistent, read-only view of one version of the table.
+     * @note Keeps its version alive until destroyed; hold it only for the duration of an evaluation.
+     */
+    class Snapshot {
+    private:
+        const Version* version_;
+        std::atomic<std::uint64_t>* slot_;
+
+    public:
+        Snapshot(const Version* version, std::atomic<std::uint64_t>* slot) : version_(version), slot_(slot) {}
+        ~Snapshot() { if (slot_) slot_->store(0, std::memory_order_release); }
+
+        Snapshot(const Snapshot& other) = delete;
+        Snapshot& operator=(const Snapshot& other) = delete;
+        Snapshot(Snapshot&& other) noexcept : version_(other.version_), slot_(other.slot_) { other.slot_ = nullptr; }
+        Snapshot& operator=(Snapshot&& other) = delete;
+
+        const SymbolTable& table() const noexcept { return version_->table_; }
+        std::uint64_t version() const noexcept { return version_->number_; }
+        const SymbolTable& operator*() const noexcept { return version_->table_; }
+        const SymbolTable* operator->() const noexcept { return &version_->table_; }
+    };
+
+    /**
+     * @brief Default constructor, starts with an empty table at version 0.
+     */
+    VersionedSymbolTable();
+
+    /**
+     * @brief Constructor for VersionedSymbolTable.
+     *
+     * @param initial the contents of version 0
+     */
+    explicit VersionedSymbolTable(const SymbolTable& initial);
+
+    /**
+     * @note No snapshot may outlive the table.
+     */
+    ~VersionedSymbolTable();
+
+    VersionedSymbolTable(const VersionedSymbolTable& other) = delete;
+    VersionedSymbolTable& operator=(const VersionedSymbolTable& other) = delete;
+
+    /**
+     * @brief Takes a consistent snapshot of the current version, without locking.
+     *
+     * @returns the snapshot
+     */
+    Snapshot snapshot() const;
+
+    /**
+     * @brief Publishes a new version produced by a mutator applied to a copy of the current one.
+     *
+     * @param mutator a function modifying the copy; several symbols may be changed together atomically
+     * @returns the number of the new version
+     */
+    std::uint64_t update(const std::function<void(SymbolTable&)>& mutator);
+
+    /**
+     * @brief Publishes a new version with one symbol added or changed.
+     *
+     * @param symbol_name name of the symbol
+     * @param value value of the symbol
+     * @returns the number of the new version
+     */
+    std::uint64_t insert_or_assign(const types::Symbol& symbol_name, const types::Numeral& value);
+
+    /**
+     * @brief Acquires the number of the current version.
+     */
+    std::uint64_t version() const noexcept;
+
+    /**
+     * @brief Frees the retired versions no reader can still hold.
+     *
+     * @returns the number of versions still waiting for readers
+     */
+    std::size_t reclaim();
+};
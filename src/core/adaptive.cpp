@@ -0,0 +1,272 @@
+#include "core/adaptive.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "core/polynomial_pass.h"
+#include "functional/error_free.h"
+
+namespace {
+
+constexpr double kGrow = 1 + 0x1p-49; // Covers the rounding of the few operations computing each bound
+
+// Relative error of the double-double product and quotient (Joldes, Muller and Popescu, 2017: 5u^2 and 15u^2 + 56u^3
+// for u = 2^-53), rounded up. Sums need no such constant, their rounding errors are computed exactly.
+constexpr double kMultiplyBound = 0x1p-103;
+constexpr double kDivideBound = 0x1p-101;
+
+// pi and e in double-double, within 2^-106
+constexpr adaptive::DoubleDouble kPi{3.141592653589793116, 1.2246467991473532e-16, 0x1p-106};
+constexpr adaptive::DoubleDouble kE{2.718281828459045091, 1.4456468917292502e-16, 0x1p-106};
+
+// A double with a bound on its error
+struct Bounded {
+    double value_;
+    double error_;
+    bool settled_; // Part of a subtree whose double-double bound exceeds the tolerance already
+};
+
+// Evaluation stack, on the machine stack for the usual shallow expressions
+template <typename T>
+class Stack {
+private:
+    static constexpr std::size_t kLocal = 32;
+    T local_[kLocal];
+    std::vector<T> heap_;
+    T* data_;
+    std::size_t size_ = 0;
+
+public:
+    explicit Stack(std::size_t capacity) : data_(capacity <= kLocal ? local_ : (heap_.resize(capacity), heap_.data())) {}
+    void push_back(const T& value) noexcept { data_[size_++] = value; }
+    void pop_back() noexcept { --size_; }
+    T& back() noexcept { return data_[size_ - 1]; }
+};
+
+using error_free::fast_two_sum;
+using error_free::two_product;
+using error_free::two_sum;
+
+inline Bounded add(const Bounded& a, const Bounded& b) noexcept {
+    double s, t;
+    two_sum(a.value_, b.value_, s, t);
+    return Bounded{s, (a.error_ + b.error_ + std::fabs(t)) * kGrow, a.settled_ || b.settled_};
+}
+
+inline Bounded multiply(const Bounded& a, const Bounded& b) noexcept {
+    double p, t;
+    two_product(a.value_, b.value_, p, t);
+    double error = std::fabs(a.value_) * b.error_ + std::fabs(b.value_) * a.error_ + a.error_ * b.error_ + std::fabs(t);
+    return Bounded{p, error * kGrow, a.settled_ || b.settled_};
+}
+
+Bounded divide(const Bounded& a, const Bounded& b) {
+    if (b.value_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+    double q = a.value_ / b.value_;
+    double divisor = std::fabs(b.value_);
+    double p, t;
+    two_product(q, b.value_, p, t);
+    double error = std::fabs((a.value_ - p) - t) / divisor; // The remainder a - p is exact, one rounding follows
+    if (a.error_ != 0 || b.error_ != 0) {
+        // |a'/b' - a/b| <= (ea + |a/b| eb) / (|b| - eb), unbounded if the divisor may be 0
+        error += b.error_ < divisor ? (a.error_ + (std::fabs(q) + error) * b.error_) / (divisor - b.error_)
+                                    : std::numeric_limits<double>::infinity();
+    }
+    return Bounded{q, error * kGrow, a.settled_ || b.settled_};
+}
+
+// Double-double sum of TwoSums only. c and w below are the only rounded results and their errors are computed too, so
+// the bound adds exactly the error made: exact sums keep a bound of 0.
+adaptive::DoubleDouble add(const adaptive::DoubleDouble& a, const adaptive::DoubleDouble& b) noexcept {
+    double sh, sl, th, tl, c, c_error, vh, vl, w, w_error, zh, zl;
+    two_sum(a.hi_, b.hi_, sh, sl);
+    two_sum(a.lo_, b.lo_, th, tl);
+    two_sum(sl, th, c, c_error);
+    two_sum(sh, c, vh, vl);
+    two_sum(tl, vl, w, w_error);
+    two_sum(vh, w, zh, zl);
+    return adaptive::DoubleDouble{zh, zl, (a.error_ + b.error_ + std::fabs(c_error) + std::fabs(w_error)) * kGrow};
+}
+
+adaptive::DoubleDouble negate(const adaptive::DoubleDouble& a) noexcept {
+    return adaptive::DoubleDouble{-a.hi_, -a.lo_, a.error_};
+}
+
+adaptive::DoubleDouble multiply(const adaptive::DoubleDouble& a, const adaptive::DoubleDouble& b) noexcept {
+    double propagated = (std::fabs(a.hi_) + std::fabs(a.lo_)) * b.error_ + (std::fabs(b.hi_) + std::fabs(b.lo_)) * a.error_
+        + a.error_ * b.error_;
+    double ch, cl;
+    two_product(a.hi_, b.hi_, ch, cl);
+    if (a.lo_ == 0 && b.lo_ == 0) return adaptive::DoubleDouble{ch, cl, propagated * kGrow}; // Exact
+
+    double tl = std::fma(a.hi_, b.lo_, a.lo_ * b.lo_);
+    tl = std::fma(a.lo_, b.hi_, tl);
+    double zh, zl;
+    fast_two_sum(ch, cl + tl, zh, zl);
+    return adaptive::DoubleDouble{zh, zl, (propagated + kMultiplyBound * std::fabs(zh)) * kGrow};
+}
+
+adaptive::DoubleDouble divide(const adaptive::DoubleDouble& a, const adaptive::DoubleDouble& b) {
+    if (b.hi_ == 0) throw std::runtime_error("Numerical error: Cannot divide by 0");
+    double th = a.hi_ / b.hi_;
+
+    // r = b * th, then the quotient is corrected by (a - r) / b
+    double rh, rl, zh, zl;
+    two_product(b.hi_, th, rh, rl);
+    fast_two_sum(rh, std::fma(b.lo_, th, rl), rh, rl);
+    double delta = (a.hi_ - rh) + (a.lo_ - rl);
+    fast_two_sum(th, delta / b.hi_, zh, zl);
+
+    double magnitude = std::fabs(zh) + std::fabs(zl);
+    double error = kDivideBound * magnitude;
+    if (a.error_ != 0 || b.error_ != 0) {
+        double divisor = std::fabs(b.hi_) - std::fabs(b.lo_);
+        error += b.error_ < divisor ? (a.error_ + (magnitude + error) * b.error_) / (divisor - b.error_)
+                                    : std::numeric_limits<double>::infinity();
+    }
+    return adaptive::DoubleDouble{zh, zl, error * kGrow};
+}
+
+} // namespace
+
+void adaptive::Program::compile(const expr::ExprNode& node, std::size_t depth) {
+    stack_size_ = std::max(stack_size_, depth + 1);
+    const auto begin = static_cast<std::uint32_t>(code_.size());
+    auto emit = [this, begin](Op op, std::uint32_t operand = 0) { code_.push_back(Instruction{op, operand, begin}); };
+    auto operands = [&](Op op) {
+        for (std::size_t i = 0; i < node.childCount(); ++i) compile(*node.child(i), depth + i);
+        emit(op);
+    };
+    auto constant = [&](DoubleDouble value) {
+        constants_.push_back(value);
+        emit(Op::Constant, static_cast<std::uint32_t>(constants_.size() - 1));
+    };
+
+    if (dynamic_cast<const expr::NumeralNode*>(&node)) constant(DoubleDouble{node.evaluate(SymbolTable()), 0, 0});
+    else if (dynamic_cast<const expr::PiNode*>(&node)) constant(kPi);
+    else if (dynamic_cast<const expr::ENode*>(&node)) constant(kE);
+    else if (auto* symbol_node = dynamic_cast<const expr::SymbolNode*>(&node)) {
+        auto it = std::find(symbols_.begin(), symbols_.end(), symbol_node->getSymbolName());
+        if (it == symbols_.end()) it = symbols_.insert(it, symbol_node->getSymbolName());
+        emit(Op::Load, static_cast<std::uint32_t>(it - symbols_.begin()));
+    }
+    else if (auto* polynomial = dynamic_cast<const poly::PolynomialNode*>(&node)) {
+        compile(*node.child(0), depth);
+        polynomials_.push_back(polynomial->polynomial().coefficients());
+        emit(Op::Polynomial, static_cast<std::uint32_t>(polynomials_.size() - 1));
+    }
+    else if (dynamic_cast<const expr::PositiveNode*>(&node)) compile(*node.child(0), depth);
+    else if (dynamic_cast<const expr::NegativeNode*>(&node)) operands(Op::Negate);
+    else if (dynamic_cast<const expr::AdditionNode*>(&node)) operands(Op::Add);
+    else if (dynamic_cast<const expr::SubtractionNode*>(&node)) operands(Op::Subtract);
+    else if (dynamic_cast<const expr::MultiplicationNode*>(&node)) operands(Op::Multiply);
+    else if (dynamic_cast<const expr::DivisionNode*>(&node)) operands(Op::Divide);
+    else throw std::invalid_argument("Numerical error: Error bounds cover numbers, symbols, pi, e, + - * / and polynomials only");
+}
+
+adaptive::Program::Program(const expr::ExprNode& tree) {
+    compile(tree, 0);
+}
+
+adaptive::DoubleDouble adaptive::Program::refine(const double* values, std::size_t begin, std::size_t end) const {
+    Stack<DoubleDouble> stack(stack_size_);
+    for (std::size_t pc = begin; pc < end; ++pc) {
+        const Instruction& instruction = code_[pc];
+        switch (instruction.op_) {
+        case Op::Constant: stack.push_back(constants_[instruction.operand_]); break;
+        case Op::Load: stack.push_back(DoubleDouble{values[instruction.operand_], 0, 0}); break;
+        case Op::Negate: stack.back() = negate(stack.back()); break;
+        case Op::Polynomial: {
+            const auto& coefficients = polynomials_[instruction.operand_];
+            DoubleDouble x = stack.back();
+            DoubleDouble result{coefficients.back(), 0, 0};
+            for (std::size_t k = coefficients.size() - 1; k-- > 0; ) {
+                result = add(multiply(result, x), DoubleDouble{coefficients[k], 0, 0});
+            }
+            stack.back() = result;
+            break;
+        }
+        default: { // Binary operations
+            DoubleDouble b = stack.back();
+            stack.pop_back();
+            DoubleDouble& a = stack.back();
+            switch (instruction.op_) {
+            case Op::Add: a = add(a, b); break;
+            case Op::Subtract: a = add(a, negate(b)); break;
+            case Op::Multiply: a = multiply(a, b); break;
+            case Op::Divide: a = divide(a, b); break;
+            default: break;
+            } // switch (instruction.op_)
+        }
+        } // switch (instruction.op_)
+    }
+    return stack.back();
+}
+
+adaptive::Result adaptive::Program::evaluate(const double* values, double tolerance) const {
+    Result result;
+    Stack<Bounded> stack(stack_size_);
+
+    // Re-evaluates the subtree completed by the instruction at pc if the bound of its value exceeds the tolerance
+    auto check = [&](std::size_t pc) {
+        Bounded& top = stack.back();
+        if (top.error_ <= tolerance * std::fabs(top.value_) || top.settled_) return; // NaN bounds are refined too
+        DoubleDouble refined = refine(values, code_[pc].begin_, pc + 1);
+        ++result.refined_;
+        top.value_ = refined.hi_;
+        top.error_ = (std::fabs(refined.lo_) + refined.error_) * kGrow; // Rounding to double adds |lo_|
+        top.settled_ = !(refined.error_ <= tolerance * std::fabs(refined.hi_));
+    };
+
+    for (std::size_t pc = 0; pc < code_.size(); ++pc) {
+        const Instruction& instruction = code_[pc];
+        switch (instruction.op_) {
+        case Op::Constant: {
+            const DoubleDouble& constant = constants_[instruction.operand_];
+            double error = constant.lo_ == 0 ? constant.error_ : (std::fabs(constant.lo_) + constant.error_) * kGrow;
+            stack.push_back(Bounded{constant.hi_, error, false});
+            break;
+        }
+        case Op::Load: stack.push_back(Bounded{values[instruction.operand_], 0, false}); break;
+        case Op::Negate: stack.back().value_ = -stack.back().value_; break;
+        case Op::Polynomial: {
+            const auto& coefficients = polynomials_[instruction.operand_];
+            Bounded x = stack.back();
+            Bounded value{coefficients.back(), 0, x.settled_};
+            for (std::size_t k = coefficients.size() - 1; k-- > 0; ) {
+                value = add(multiply(value, x), Bounded{coefficients[k], 0, false});
+            }
+            stack.back() = value;
+            check(pc);
+            break;
+        }
+        default: { // Binary operations
+            Bounded b = stack.back();
+            stack.pop_back();
+            Bounded& a = stack.back();
+            switch (instruction.op_) {
+            case Op::Add: a = add(a, b); check(pc); break;
+            case Op::Subtract: a = add(a, Bounded{-b.value_, b.error_, b.settled_}); check(pc); break;
+            case Op::Multiply: a = multiply(a, b); break;
+            case Op::Divide: a = divide(a, b); break;
+            default: break;
+            } // switch (instruction.op_)
+        }
+        } // switch (instruction.op_)
+    }
+
+    result.value_ = stack.back().value_;
+    result.error_ = std::isnan(stack.back().error_) ? std::numeric_limits<double>::infinity() : stack.back().error_;
+    return result;
+}
+
+adaptive::Result adaptive::Program::evaluate(const SymbolTable& symbols, double tolerance) const {
+    std::vector<double> values;
+    values.reserve(symbols_.size());
+    for (const auto& symbol : symbols_) values.push_back(symbols.at(symbol));
+    return evaluate(values.data(), tolerance);
+}
+
+adaptive::Result adaptive::evaluate(const expr::ExprNode& tree, const SymbolTable& symbols, double tolerance) {
+    return Program(tree).evaluate(symbols, tolerance);
+}
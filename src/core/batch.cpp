@@ -0,0 +1,349 @@
+#include "core/batch.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include "core/eval.h"
+#include "core/workers.h"
+#include "functional/numbers.h"
+#include "functional/stats.h"
+
+namespace {
+
+constexpr std::size_t kChunkSize = 64; // Expressions claimed by a worker at a time
+constexpr std::size_t kRollingFlushBytes = 1 << 16; // Output of run_rolling written at the latest
+
+// Percentiles shown in the report
+constexpr double kPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+constexpr const char* kPercentileNames[] = {"p50", "p90", "p99", "p99.9"};
+
+std::uint64_t elapsed_ns(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+}
+
+std::string json_escape(const std::string& str) {
+    std::string result;
+    result.reserve(str.size());
+    for (char ch : str) {
+        switch (ch) {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(ch) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+                result += buf;
+            }
+            else result += ch;
+        }
+    }
+    return result;
+}
+
+void write_text_row(std::ostream& out, const char* name, const utils::LatencyHistogram& histogram) {
+    char buf[160];
+    std::snprintf(buf, sizeof(buf), "  %-10s%10llu", name, static_cast<unsigned long long>(histogram.count()));
+    out << buf;
+    for (double percentile : kPercentiles) {
+        std::snprintf(buf, sizeof(buf), "%12llu", static_cast<unsigned long long>(histogram.value_at_percentile(percentile)));
+        out << buf;
+    }
+    std::snprintf(buf, sizeof(buf), "%12llu%12.0f\n", static_cast<unsigned long long>(histogram.max()), histogram.mean());
+    out << buf;
+}
+
+void write_json_histogram(std::ostream& out, const char* name, const utils::LatencyHistogram& histogram) {
+    out << "\"" << name << "\":{\"count\":" << histogram.count();
+    for (std::size_t i = 0; i < std::size(kPercentiles); ++i) {
+        out << ",\"" << kPercentileNames[i] << "\":" << histogram.value_at_percentile(kPercentiles[i]);
+    }
+    out << ",\"max\":" << histogram.max() << ",\"mean\":" << batch::format_numeral(histogram.mean()) << "}";
+}
+
+} // namespace
+
+std::string batch::format_error(const types::Error& error) {
+    return "error: " + types::error_message(error) + " at position " + std::to_string(error.position_);
+}
+
+std::string batch::format_numeral(types::Numeral value) {
+    char buf[64];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    return std::string(buf, end);
+}
+
+batch::LineResult batch::evaluate_line(const std::string& expression, const SymbolTable& symbols, const BatchOptions& options,
+    unsigned parse_threads) {
+
+    // The non-throwing path keeps invalid rows as cheap as valid ones
+    LineResult line;
+    auto start = std::chrono::steady_clock::now();
+    auto tree = eval::try_parse_parallel(expression, parse_threads, options.functions_);
+    const bool rewrites = options.polynomials_ != poly::PolynomialMode::Off
+        || (options.numeric_type_ == typed::NumericType::Double && (options.exact_sums_ || options.fusion_ != fusion::FusionMode::Off));
+    if (tree && rewrites) { // The rewrite passes recurse into the tree
+        if (const auto* node = eval::find_too_deep(*tree.value())) tree = types::Error{types::ErrorCode::TooDeep, node->getPosition()};
+    }
+    line.parsed_ = tree.has_value();
+    if (line.parsed_) poly::collect_polynomials(tree.value(), options.polynomials_);
+    if (line.parsed_ && options.numeric_type_ == typed::NumericType::Double) {
+        if (options.exact_sums_) summation::collect_sums(tree.value());
+        fusion::fuse_operations(tree.value(), options.fusion_);
+    }
+    auto parsed = std::chrono::steady_clock::now();
+    line.parse_ns_ = elapsed_ns(start, parsed);
+
+    if (line.parsed_ && options.numeric_type_ != typed::NumericType::Double) {
+        auto value = typed::evaluate_as(options.numeric_type_, *tree.value(), symbols, options.numeric_mode_);
+        line.failed_ = !value;
+        line.output_ = value ? std::move(value.value()) : format_error(value.error());
+    }
+    else if (line.parsed_) {
+        auto value = eval::try_evaluate(*tree.value(), symbols, options.numeric_mode_);
+        line.failed_ = !value;
+        line.output_ = value ? format_numeral(value.value()) : format_error(value.error());
+    }
+    else {
+        line.failed_ = true;
+        line.output_ = format_error(tree.error());
+        return line;
+    }
+    line.evaluate_ns_ = elapsed_ns(parsed, std::chrono::steady_clock::now());
+    return line;
+}
+
+batch::BatchReport batch::run(const std::vector<std::string>& expressions, const SymbolTable& symbols,
+    const BatchOptions& options, std::vector<std::string>& outputs) {
+
+    outputs.assign(expressions.size(), std::string());
+    unsigned thread_count = std::max(1u, options.threads_);
+    std::vector<std::unique_ptr<BatchReport>> reports; // Per-thread reports, merged at the end
+    for (unsigned i = 0; i < thread_count; ++i) {
+        reports.push_back(std::make_unique<BatchReport>());
+        reports.back()->slowest_ = utils::SlowestList(options.slowest_);
+    }
+    std::atomic<std::size_t> next_chunk{0};
+    // One worker claims a batch of a chunk or less, so a long expression in it is parsed on the other threads
+    const unsigned parse_threads = expressions.size() <= kChunkSize ? thread_count : 1;
+
+    auto worker = [&](BatchReport& report) {
+        while (true) {
+            std::size_t begin = next_chunk.fetch_add(kChunkSize, std::memory_order_relaxed);
+            if (begin >= expressions.size()) break;
+            std::size_t end = std::min(begin + kChunkSize, expressions.size());
+
+            for (std::size_t i = begin; i < end; ++i) {
+                const std::string& expression = expressions[i];
+                if (expression.find_first_not_of(" \t\r") == std::string::npos) continue; // Blank line, blank output
+
+                LineResult line = evaluate_line(expression, symbols, options, parse_threads);
+                outputs[i] = std::move(line.output_);
+                report.parse_.record(line.parse_ns_);
+                if (line.parsed_) report.evaluate_.record(line.evaluate_ns_);
+                if (line.failed_) ++report.errors_;
+                std::uint64_t total = line.parse_ns_ + line.evaluate_ns_;
+                report.total_.record(total);
+                report.slowest_.offer(total, i + 1, expression);
+            }
+        }
+    };
+
+    if (thread_count == 1) worker(*reports[0]);
+    else {
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < thread_count; ++i) threads.emplace_back(worker, std::ref(*reports[i]));
+        for (auto& thread : threads) thread.join();
+    }
+
+    // Merge the per-thread reports
+    BatchReport merged;
+    merged.slowest_ = utils::SlowestList(options.slowest_);
+    for (const auto& report : reports) {
+        merged.parse_.merge(report->parse_);
+        merged.evaluate_.merge(report->evaluate_);
+        merged.total_.merge(report->total_);
+        merged.slowest_.merge(report->slowest_);
+        merged.errors_ += report->errors_;
+    }
+    return merged;
+}
+
+std::size_t batch::run_stream(std::istream& in, std::ostream& out, std::ostream& report_out, const BatchOptions& options,
+    functions::FunctionRegistry* functions) {
+
+    std::vector<std::string> expressions;
+    std::string line;
+    while (std::getline(in, line)) expressions.push_back(std::move(line));
+
+    // Take the definitions first, leaving their lines blank for the workers
+    functions::FunctionRegistry local_functions;
+    if (!functions) functions = &local_functions;
+    std::vector<std::pair<std::size_t, std::string>> defined; // Line index and output of each definition
+    std::size_t definition_errors = 0;
+    for (std::size_t i = 0; i < expressions.size(); ++i) {
+        if (!functions::is_definition(expressions[i])) continue;
+        auto function = functions->define(expressions[i]);
+        if (function) {
+            std::string signature = "defined " + function.value()->name() + "(";
+            for (const auto& parameter : function.value()->parameters()) {
+                if (signature.back() != '(') signature += ", ";
+                signature += parameter;
+            }
+            defined.emplace_back(i, signature + ")");
+        }
+        else {
+            defined.emplace_back(i, format_error(function.error()));
+            ++definition_errors;
+        }
+        expressions[i].clear();
+    }
+
+    BatchOptions run_options = options;
+    run_options.functions_ = functions;
+    std::vector<std::string> outputs;
+    auto report = std::make_unique<BatchReport>(options.workers_ > 0
+        ? workers::run(expressions, SymbolTable(), run_options, {options.workers_}, outputs)
+        : run(expressions, SymbolTable(), run_options, outputs));
+    for (auto& [index, output] : defined) outputs[index] = std::move(output);
+
+    std::string buffer; // Write the results in one go
+    for (const auto& output : outputs) {
+        buffer += output;
+        buffer += '\n';
+    }
+    out << buffer << std::flush;
+
+    if (options.report_ != ReportFormat::None) write_report(report_out, *report, options.report_);
+    if (options.memo_stats_) functions->write_memo_stats(report_out);
+    return report->errors_ + definition_errors;
+}
+
+std::size_t batch::run_binomials(std::istream& in, std::ostream& out) {
+    std::vector<std::uint64_t> ns, ks;
+    std::vector<std::size_t> invalid; // Lines that are not a query
+    std::string line;
+    for (std::size_t index = 0; std::getline(in, line); ++index) {
+        std::uint64_t n = 0, k = 0;
+        const char* end = line.data() + line.size();
+        auto skip = [end](const char* p) {
+            while (p != end && (*p == ' ' || *p == '\t' || *p == ',' || *p == '\r')) ++p;
+            return p;
+        };
+        auto [after_n, n_error] = std::from_chars(skip(line.data()), end, n);
+        auto [after_k, k_error] = std::from_chars(n_error == std::errc() ? skip(after_n) : end, end, k);
+        if (n_error != std::errc() || k_error != std::errc() || skip(after_k) != end) invalid.push_back(index);
+        ns.push_back(n);
+        ks.push_back(k);
+    }
+
+    std::uint64_t max_n = 0;
+    for (std::uint64_t n : ns) {
+        if (n <= kMaxBinomialTable) max_n = std::max(max_n, n);
+    }
+    numbers::BinomialTable table(max_n);
+    std::string buffer; // Write the results in one go
+    for (std::size_t i = 0, next_invalid = 0; i < ns.size(); ++i) {
+        if (next_invalid < invalid.size() && invalid[next_invalid] == i) {
+            buffer += "error: Syntax error: Expected two non-negative integers n and k at line " + std::to_string(i + 1) + "\n";
+            ++next_invalid;
+            continue;
+        }
+        double value = ns[i] <= max_n ? table(ns[i], ks[i]) : numbers::binomial(static_cast<double>(ns[i]), static_cast<double>(ks[i]));
+        buffer += format_numeral(value);
+        buffer += '\n';
+    }
+    out << buffer << std::flush;
+    return invalid.size();
+}
+
+std::size_t batch::run_rolling(std::istream& in, std::ostream& out, const RollingOptions& options) {
+    stats::RollingMoments moments(options.window_);
+    stats::RollingExtremes extremes(options.window_);
+    stats::RollingMedian median(options.window_);
+    stats::Ewma ewma(options.alpha_ > 0 ? options.alpha_ : 2.0 / (static_cast<double>(options.window_) + 1));
+
+    std::size_t invalid = 0;
+    std::string line, buffer;
+    for (std::size_t index = 0; std::getline(in, line); ++index) {
+        const char* begin = line.data();
+        const char* end = line.data() + line.size();
+        while (begin != end && (*begin == ' ' || *begin == '\t')) ++begin;
+        while (end != begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) --end;
+        double value = 0;
+        auto [parsed_end, ec] = std::from_chars(begin, end, value);
+        if (begin == end || ec != std::errc() || parsed_end != end) {
+            buffer += "error: Syntax error: Expected a number at line " + std::to_string(index + 1) + "\n";
+            ++invalid;
+        }
+        else {
+            moments.add(value);
+            extremes.add(value);
+            median.add(value);
+            ewma.add(value);
+            for (double column : {value, moments.mean(), moments.stddev(), extremes.min(), extremes.max(), median.median()}) {
+                buffer += format_numeral(column);
+                buffer += ',';
+            }
+            buffer += format_numeral(ewma.mean());
+            buffer += '\n';
+        }
+        if (buffer.size() >= kRollingFlushBytes || in.rdbuf()->in_avail() <= 0) { // Before waiting for more input
+            out << buffer << std::flush;
+            buffer.clear();
+        }
+    }
+    out << buffer << std::flush;
+    return invalid;
+}
+
+void batch::write_report(std::ostream& out, const BatchReport& report, ReportFormat format) {
+    switch (format) {
+    case ReportFormat::Text: {
+        char buf[160];
+        std::snprintf(buf, sizeof(buf), "latency (ns)%10s%12s%12s%12s%12s%12s%12s\n",
+            "count", "p50", "p90", "p99", "p99.9", "max", "mean");
+        out << buf;
+        write_text_row(out, "parse", report.parse_);
+        write_text_row(out, "evaluate", report.evaluate_);
+        write_text_row(out, "total", report.total_);
+        out << "errors: " << report.errors_ << "\n";
+        if (report.restarts_ > 0) out << "worker restarts: " << report.restarts_ << "\n";
+
+        auto slowest = report.slowest_.sorted();
+        if (!slowest.empty()) out << "slowest expressions:\n";
+        for (std::size_t i = 0; i < slowest.size(); ++i) {
+            std::snprintf(buf, sizeof(buf), "  %2zu. line %-8zu %12llu ns  ", i + 1, slowest[i].line_,
+                static_cast<unsigned long long>(slowest[i].latency_ns_));
+            out << buf << slowest[i].expression_ << "\n";
+        }
+        out << std::flush;
+        break;
+    }
+    case ReportFormat::Json: {
+        out << "{\"unit\":\"ns\",\"errors\":" << report.errors_ << ",\"restarts\":" << report.restarts_ << ",";
+        write_json_histogram(out, "parse", report.parse_);
+        out << ",";
+        write_json_histogram(out, "evaluate", report.evaluate_);
+        out << ",";
+        write_json_histogram(out, "total", report.total_);
+        out << ",\"slowest\":[";
+        auto slowest = report.slowest_.sorted();
+        for (std::size_t i = 0; i < slowest.size(); ++i) {
+            if (i) out << ",";
+            out << "{\"line\":" << slowest[i].line_ << ",\"total\":" << slowest[i].latency_ns_
+                << ",\"expression\":\"" << json_escape(slowest[i].expression_) << "\"}";
+        }
+        out << "]}" << std::endl;
+        break;
+    }
+    case ReportFormat::None: default:
+        break;
+    } // switch (format)
+}
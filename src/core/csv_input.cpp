@@ -0,0 +1,346 @@
+#include "core/csv_input.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "core/batch.h"
+#include "core/typed_program.h"
+
+namespace {
+
+constexpr std::size_t kBlocksAhead = 4; // Blocks per worker that may wait for the writer
+constexpr double kMissing = std::numeric_limits<double>::quiet_NaN();
+
+// A file mapped read-only for its lifetime
+class MappedFile {
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::invalid_argument("Cannot open input file '" + path + "'");
+        struct stat status;
+        if (::fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw std::invalid_argument("Cannot open input file '" + path + "'");
+        }
+        size_ = static_cast<std::size_t>(status.st_size);
+        if (size_ > 0) {
+            void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                throw std::invalid_argument("Cannot map input file '" + path + "'");
+            }
+            ::madvise(mapped, size_, MADV_SEQUENTIAL); // Read ahead, as every block is read once in order
+            data_ = static_cast<const char*>(mapped);
+        }
+        ::close(fd); // The mapping keeps the file
+    }
+
+    ~MappedFile() {
+        if (data_) ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+};
+
+// End of the field starting at p: the next comma outside quotes, or the end of the line
+const char* field_end(const char* p, const char* line_end) noexcept {
+    if (p != line_end && *p == '"') {
+        for (++p; p != line_end; ++p) {
+            if (*p != '"') continue;
+            if (p + 1 != line_end && p[1] == '"') ++p; // An escaped quote
+            else {
+                ++p;
+                break;
+            }
+        }
+    }
+    auto* comma = static_cast<const char*>(std::memchr(p, ',', static_cast<std::size_t>(line_end - p)));
+    return comma ? comma : line_end;
+}
+
+// The field without surrounding blanks, a carriage return and quotes
+std::string_view trim(const char* begin, const char* end) noexcept {
+    auto blank = [](char ch) { return ch == ' ' || ch == '\t' || ch == '\r'; };
+    while (begin != end && blank(*begin)) ++begin;
+    while (end != begin && blank(end[-1])) --end;
+    if (end - begin >= 2 && *begin == '"' && end[-1] == '"') {
+        ++begin;
+        --end;
+    }
+    return std::string_view(begin, static_cast<std::size_t>(end - begin));
+}
+
+// Plain decimals of at most 15 significant digits and 22 decimals: both the digits and the power of 10 are exact
+// doubles, so their quotient is correctly rounded (Clinger's fast path)
+bool parse_plain_decimal(std::string_view field, double& value) noexcept {
+    static constexpr double kPowers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    const char* p = field.data();
+    const char* end = p + field.size();
+    bool negative = p != end && *p == '-';
+    if (negative) ++p;
+    std::uint64_t digits = 0;
+    int count = 0, decimals = -1; // Significant digits, and digits after the point if there is one
+    bool any = false;
+    for (; p != end; ++p) {
+        if (*p == '.' && decimals < 0) decimals = 0;
+        else if (static_cast<unsigned>(*p - '0') < 10) {
+            digits = digits * 10 + static_cast<unsigned>(*p - '0');
+            if (digits != 0) ++count;
+            if (decimals >= 0) ++decimals;
+            any = true;
+        }
+        else return false;
+    }
+    if (!any || count > 15 || decimals > 22) return false;
+    value = static_cast<double>(digits) / kPowers[std::max(decimals, 0)];
+    if (negative) value = -value;
+    return true;
+}
+
+bool parse_number(const char* begin, const char* end, double& value) noexcept {
+    std::string_view field = trim(begin, end);
+    if (!field.empty() && field.front() == '+') field.remove_prefix(1);
+    if (field.empty()) return false;
+    if (parse_plain_decimal(field, value)) return true;
+    auto [stop, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+    return error == std::errc() && stop == field.data() + field.size();
+}
+
+bool is_blank(const char* begin, const char* end) noexcept { return trim(begin, end).empty(); }
+
+// Appends text as one field, quoted if it holds a comma or a quote
+void append_field(std::string& out, const std::string& text) {
+    if (text.find_first_of(",\"") == std::string::npos) {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char ch : text) {
+        if (ch == '"') out += '"';
+        out += ch;
+    }
+    out += '"';
+}
+
+// Output and counts of a block
+struct Block {
+    std::string output_;
+    std::size_t rows_ = 0;
+    std::size_t malformed_ = 0;
+    std::size_t failed_ = 0;
+    bool ready_ = false;
+};
+
+// Columns of the block being parsed, reused across the blocks of a worker
+struct Scratch {
+    std::vector<std::vector<double>> columns_; // One per symbol of the program
+    std::vector<const double*> pointers_;
+    std::vector<double> results_;
+    std::vector<types::Error> errors_;
+};
+
+// What the workers share: the program, and for each column of the header up to the last used, its symbol or -1
+struct Layout {
+    const typed::Program<double>* program_;
+    std::vector<int> slots_;
+    csv::OutputFormat format_;
+    expr::NumericMode numeric_mode_;
+};
+
+void process(const char* begin, const char* end, const Layout& layout, Scratch& scratch, Block& block) {
+    const std::size_t symbol_count = layout.program_->symbols().size();
+    scratch.columns_.resize(symbol_count);
+    for (auto& column : scratch.columns_) column.clear();
+
+    std::size_t rows = 0;
+    for (const char* line = begin; line < end; ) {
+        auto* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(end - line)));
+        const char* line_end = newline ? newline : end;
+        if (!is_blank(line, line_end)) {
+            for (auto& column : scratch.columns_) column.push_back(kMissing);
+            std::size_t found = 0;
+            const char* field = line;
+            for (std::size_t column = 0; column < layout.slots_.size(); ++column) {
+                const char* stop = field_end(field, line_end);
+                int slot = layout.slots_[column];
+                if (slot >= 0 && parse_number(field, stop, scratch.columns_[static_cast<std::size_t>(slot)][rows])) ++found;
+                if (stop == line_end) break;
+                field = stop + 1;
+            }
+            if (found != symbol_count) ++block.malformed_;
+            ++rows;
+        }
+        line = newline ? newline + 1 : end;
+    }
+
+    scratch.pointers_.clear();
+    for (const auto& column : scratch.columns_) scratch.pointers_.push_back(column.data());
+    scratch.results_.resize(rows);
+    const bool strict = layout.numeric_mode_ == expr::NumericMode::Strict;
+    scratch.errors_.resize(strict ? rows : 0);
+    layout.program_->evaluateBulk(scratch.pointers_.data(), rows, scratch.results_.data(), strict ? scratch.errors_.data() : nullptr);
+    for (std::size_t row = 0; row < scratch.errors_.size(); ++row) {
+        if (scratch.errors_[row].code_ == types::ErrorCode::None) continue;
+        ++block.failed_;
+        scratch.results_[row] = kMissing;
+    }
+
+    block.rows_ = rows;
+    if (layout.format_ == csv::OutputFormat::Binary) {
+        block.output_.assign(reinterpret_cast<const char*>(scratch.results_.data()), rows * sizeof(double));
+        return;
+    }
+    block.output_.clear();
+    block.output_.reserve(rows * 24);
+    char buf[64];
+    for (std::size_t row = 0; row < rows; ++row) {
+        if (block.failed_ > 0 && scratch.errors_[row].code_ != types::ErrorCode::None) {
+            append_field(block.output_, batch::format_error(scratch.errors_[row]));
+            block.output_ += '\n';
+            continue;
+        }
+        auto [stop, error] = std::to_chars(buf, buf + sizeof(buf) - 1, scratch.results_[row]);
+        *stop++ = '\n';
+        block.output_.append(buf, stop);
+    }
+}
+
+} // namespace
+
+csv::CsvReport csv::evaluate(const char* data, std::size_t size, const expr::ExprNode& tree, std::ostream& out,
+    const CsvOptions& options) {
+
+    const char* end = data + size;
+    if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) data += 3; // A UTF-8 byte order mark
+    if (data == end) throw std::invalid_argument("Syntax error: The input has no header line");
+
+    // Match the header names with the symbols once
+    typed::Program<double> program(tree);
+    auto* newline = static_cast<const char*>(std::memchr(data, '\n', static_cast<std::size_t>(end - data)));
+    const char* header_end = newline ? newline : end;
+    std::vector<std::string_view> names;
+    for (const char* field = data; ; ) {
+        const char* stop = field_end(field, header_end);
+        names.push_back(trim(field, stop));
+        if (stop == header_end) break;
+        field = stop + 1;
+    }
+    Layout layout{&program, {}, options.format_, options.numeric_mode_};
+    std::size_t used = 0; // Columns up to the last one used
+    std::vector<int> slots(names.size(), -1);
+    for (std::size_t s = 0; s < program.symbols().size(); ++s) {
+        const std::string& symbol = program.symbols()[s];
+        auto column = std::find(names.begin(), names.end(), symbol);
+        if (column == names.end()) {
+            throw std::invalid_argument("Syntax error: Symbol '" + symbol + "' undefined, the input has no such column");
+        }
+        slots[static_cast<std::size_t>(column - names.begin())] = static_cast<int>(s);
+        used = std::max(used, static_cast<std::size_t>(column - names.begin()) + 1);
+    }
+    slots.resize(std::max<std::size_t>(used, 1)); // A row needs no field past the last used one
+    layout.slots_ = std::move(slots);
+
+    // Cut the rows into blocks at line ends
+    std::vector<const char*> bounds = {header_end == end ? end : header_end + 1};
+    const std::size_t block_size = std::max<std::size_t>(options.block_size_, 1);
+    while (static_cast<std::size_t>(end - bounds.back()) > block_size) {
+        const char* cut = bounds.back() + block_size;
+        auto* line_end = static_cast<const char*>(std::memchr(cut, '\n', static_cast<std::size_t>(end - cut)));
+        if (!line_end || line_end + 1 == end) break;
+        bounds.push_back(line_end + 1);
+    }
+    bounds.push_back(end);
+    const std::size_t block_count = bounds.size() - 1;
+
+    CsvReport report;
+    if (options.format_ == OutputFormat::Csv) out << "result\n";
+    auto write = [&](Block& block) {
+        out.write(block.output_.data(), static_cast<std::streamsize>(block.output_.size()));
+        report.rows_ += block.rows_;
+        report.malformed_ += block.malformed_;
+        report.failed_ += block.failed_;
+    };
+
+    const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(std::max(1u, options.threads_), block_count));
+    if (workers <= 1) {
+        Scratch scratch;
+        Block block;
+        for (std::size_t k = 0; k < block_count; ++k) {
+            block = Block();
+            process(bounds[k], bounds[k + 1], layout, scratch, block);
+            write(block);
+        }
+        out.flush();
+        return report;
+    }
+
+    // The workers claim blocks in turn and fill a ring of slots, which this thread writes in order
+    const std::size_t window = kBlocksAhead * workers;
+    std::vector<Block> ring(window);
+    std::mutex mutex;
+    std::condition_variable filled, emptied;
+    std::size_t written = 0;
+    std::atomic<std::size_t> next{0};
+    auto worker = [&] {
+        Scratch scratch;
+        for (std::size_t k; (k = next.fetch_add(1, std::memory_order_relaxed)) < block_count; ) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                emptied.wait(lock, [&] { return k < written + window; });
+            }
+            Block block;
+            process(bounds[k], bounds[k + 1], layout, scratch, block);
+            block.ready_ = true;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ring[k % window] = std::move(block);
+            }
+            filled.notify_all();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < workers; ++i) threads.emplace_back(worker);
+    for (std::size_t k = 0; k < block_count; ++k) {
+        Block block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            filled.wait(lock, [&] { return ring[k % window].ready_; });
+            block = std::move(ring[k % window]);
+            ring[k % window].ready_ = false;
+        }
+        write(block);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            written = k + 1;
+        }
+        emptied.notify_all();
+    }
+    for (auto& thread : threads) thread.join();
+    out.flush();
+    return report;
+}
+
+csv::CsvReport csv::evaluate_file(const std::string& path, const expr::ExprNode& tree, std::ostream& out, const CsvOptions& options) {
+    MappedFile file(path);
+    return evaluate(file.data(), file.size(), tree, out, options);
+}
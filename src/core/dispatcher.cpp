@@ -1,11 +1,16 @@
 #include "core/dispatcher.h"
+#include "core/matrix_eval.h"
 
 dispatcher::Result dispatcher::get_result(Mode mode, const SymbolTable& symbols,
-    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end) {
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const functions::FunctionRegistry* functions, const Bindings* values, unsigned threads) {
 
     switch (mode) {
-    case Mode::Evaluate:
-        return eval::build_expr_tree(tokens_begin, tokens_end)->evaluate(symbols);
+    case Mode::Evaluate: {
+        auto tree = eval::build_expr_tree(tokens_begin, tokens_end, functions);
+        if (values && !values->empty()) return matrix_eval::evaluate(*tree, symbols, *values, threads);
+        return tree->evaluate(symbols);
+    }
     case Mode::Statistics:
         return types::Numeral(); // TODO
     case Mode::NumberTheory:
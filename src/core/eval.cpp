@@ -1,172 +1,967 @@
 #include "core/eval.h"
-#include <iostream>
+#include "core/functions.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include "functional/parallel.h"
+
+namespace {
+
+constexpr std::size_t kRoundTripLength = std::numeric_limits<types::Numeral>::digits10; // Longest literal a double keeps
+constexpr std::size_t kMaxNesting = 10000; // Deepest operands, arguments and prefix operators the tree builder recurses into,
+                                           // and deepest tree the passes over it recurse into
+
+/**
+ * Finds the first bracket that is not paired correctly.
+ * Returns the index of that bracket, the end index if an opening bracket is left open, or -1 if all are paired.
+ */
+std::ptrdiff_t find_unpaired_bracket(std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end) {
+    std::stack<std::pair<std::string, std::ptrdiff_t>> brackets;
+
+    for (auto it = tokens_begin; it != tokens_end; ++it) {
+        if (it->first != parser::TokenType::Bracket) continue; // Not a bracket
+        
+        const std::string& bracket = std::get<std::string>(it->second);
+        if (bracket == "(" || bracket == "[" || bracket == "{") brackets.emplace(bracket, it - tokens_begin); // An opening bracket
+        else { // A closing bracket
+            if (brackets.empty() || !eval::is_bracket_match(brackets.top().first, bracket)) return it - tokens_begin; // Not paired
+            brackets.pop();
+        }
+    }
+    return brackets.empty() ? -1 : brackets.top().second; // The innermost bracket left open
+}
+
+// Operator info of a built-in operator, or of a user-defined function
+const expr::OperatorInfo& operator_info(const std::string& name, const functions::FunctionRegistry* functions) {
+    const auto& node_factory_map = expr::get_node_factory_map();
+    auto it = node_factory_map.find(name);
+    if (it != node_factory_map.end()) return it->second;
+    if (functions) {
+        if (const auto* info = functions->find_operator(name)) return *info;
+    }
+    throw std::runtime_error("Syntax error: Operator '" + name + "' undefined");
+}
+
+} // namespace
 
 std::unique_ptr<expr::ExprNode> eval::build_expr_tree(
-    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end) {
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const functions::FunctionRegistry* functions) {
 
-    // Check bracket pairing
-    if (!check_bracket_matching(tokens_begin, tokens_end)) throw std::runtime_error("Syntax error: Unpaired brackets");
+    auto tree = try_build_expr_tree(tokens_begin, tokens_end, nullptr, functions);
+    if (!tree) throw std::runtime_error(types::error_message(tree.error()));
+    return std::move(tree).value();
+}
 
-    // Convert to Reverse Polish Notation
-    std::queue<parser::Token> reverse_polish; // Queue for the reverse polish style tokens
-    std::stack<parser::Token> operators;      // Stack for operators
+types::Expected<std::unique_ptr<expr::ExprNode>> eval::try_parse(const std::string& expression,
+    const functions::FunctionRegistry* functions) {
+    std::vector<std::size_t> positions;
+    auto tokens = parser::try_tokenize(expression, &positions);
+    if (!tokens) return tokens.error();
+    if (functions) functions->recognize(tokens.value());
+    return try_build_expr_tree(tokens.value().begin(), tokens.value().end(), positions.data(), functions, &expression);
+}
 
-    for (auto it = tokens_begin; it != tokens_end; ++it) { // Iterate through the tokens
-        switch (it->first) {
-        case parser::TokenType::Numeral: case parser::TokenType::Symbol: // Number or symbol
-            reverse_polish.push(*it);
-            break;
-        case parser::TokenType::Operator: { // Operator
-            std::string operator_name = std::get<std::string>(it->second);
-            
-            // Disambiguitate between infix +- and prefix +-
-            if (operator_name == "+" || operator_name == "-") {
-                if ((it == tokens_begin)                                    // Beginning of expression
-                    || ((it - 1)->first == parser::TokenType::Bracket)      // Any kind of bracket
-                    || ((it - 1)->first == parser::TokenType::Separator)    // A comma separator
-                    || ((it - 1)->first == parser::TokenType::Operator      // An operator ...
-                        && expr::get_operator_info(std::get<std::string>((it - 1)->second)).arity_ != 0)) { // but not nullary (treated as const)
-                    operator_name += operator_name; // Change + to ++, - to -- to avoid ambiguity
+const expr::ExprNode* eval::find_too_deep(const expr::ExprNode& tree) {
+    std::vector<std::pair<const expr::ExprNode*, std::size_t>> pending{{&tree, 0}};
+    while (!pending.empty()) {
+        auto [node, depth] = pending.back();
+        pending.pop_back();
+        if (depth > kMaxNesting) return node;
+        for (std::size_t i = node->childCount(); i-- > 0; ) { // The first child on top
+            if (const auto* child = node->child(i)) pending.emplace_back(child, depth + 1);
+        }
+    }
+    return nullptr;
+}
+
+types::Expected<types::Numeral> eval::try_evaluate(const expr::ExprNode& tree, const SymbolTable& symbols, expr::NumericMode mode) {
+    expr::EvalStatus status;
+    status.mode_ = mode;
+    types::Numeral value = tree.evaluateChecked(symbols, status);
+    if (status.ok()) return value;
+    return types::Error{status.code_, status.position_, status.symbol_ ? *status.symbol_ : std::string()};
+}
+
+namespace {
+
+/**
+ * Builds the tree of the tokens in one pass by precedence climbing, with the calls of user-defined functions left as
+ * calls. Each operator parses the operands it binds, by the precedence and associativity of its OperatorInfo, and its
+ * node is made as soon as they are read, so the tree is the one shunting-yard gives without the queue of tokens
+ * between. An operator standing where an operand is expected is prefix (+ and - becoming ++ and --), and takes the
+ * arguments in the bracket after it if there is one. The first syntax error in reading order is reported, unless a
+ * bracket is unpaired, which is reported first as the brackets used to be paired before building. Brackets directly
+ * inside brackets are read in a loop, so only operands nested in operators take stack, at most kMaxNesting deep.
+ */
+class TreeBuilder {
+private:
+    using Iterator = std::vector<parser::Token>::const_iterator;
+
+    // The operator whose operand is being parsed; an operator of an enclosing bracket does not limit the binding
+    struct Owner {
+        const std::string* name_ = nullptr;        // nullptr at the top level
+        const expr::OperatorInfo* info_ = nullptr;
+        std::size_t position_ = 0;
+        int received_ = 0;                         // Operands read before this one
+        bool bounded_ = false;                     // Whether the precedence of the operator limits the binding
+    };
+
+    Iterator begin_, it_, end_;
+    const std::size_t* positions_;
+    const functions::FunctionRegistry* functions_;
+    const std::string* source_; // The text the positions are offsets in, or nullptr
+    std::optional<types::Error> error_;
+    std::size_t depth_ = 0;     // Expressions being parsed, one inside the other
+
+    std::size_t position(Iterator it) const noexcept {
+        auto index = static_cast<std::size_t>(it - begin_);
+        return positions_ ? positions_[index] : index;
+    }
+
+    bool at(parser::TokenType type) const noexcept { return it_ != end_ && it_->first == type; }
+
+    bool atOpening() const {
+        if (!at(parser::TokenType::Bracket)) return false;
+        const char bracket = std::get<std::string>(it_->second)[0];
+        return bracket == '(' || bracket == '[' || bracket == '{';
+    }
+
+    std::nullptr_t fail(types::Error error) {
+        error_ = std::move(error);
+        return nullptr;
+    }
+
+    // The operand an owner expects is missing at it_
+    std::nullptr_t missing(const Owner& owner) {
+        if (owner.name_) {
+            return fail({types::ErrorCode::ArgumentCount, owner.position_, *owner.name_, owner.info_->arity_, owner.received_});
+        }
+        return fail({types::ErrorCode::MissingArguments, it_ == end_ ? 0 : position(it_)});
+    }
+
+    std::unique_ptr<expr::ExprNode> make(const expr::OperatorInfo& info, std::vector<std::unique_ptr<expr::ExprNode>>&& children,
+        std::size_t at) {
+        std::reverse(children.begin(), children.end()); // The factories take the last operand first
+        auto node = info.node_func_(std::move(children));
+        node->setPosition(at);
+        return node;
+    }
+
+    // Consumes the closing bracket paired with the opening one at opening
+    bool close(Iterator opening) {
+        if (at(parser::TokenType::Bracket) && eval::is_bracket_match(std::get<std::string>(opening->second), std::get<std::string>(it_->second))) {
+            ++it_;
+            return true;
+        }
+        if (it_ == end_) error_ = types::Error{types::ErrorCode::UnpairedBrackets, position(opening)};
+        else if (it_->first == parser::TokenType::Separator) error_ = types::Error{types::ErrorCode::MisplacedSeparator, position(it_)};
+        else error_ = types::Error{types::ErrorCode::UnpairedBrackets, position(it_)};
+        return false;
+    }
+
+    // Parses the bracketed, comma-separated arguments of an operator at it_, in source order
+    bool parseArguments(const Owner& function, std::vector<std::unique_ptr<expr::ExprNode>>& arguments) {
+        const Iterator opening = it_++;
+        if (at(parser::TokenType::Bracket) && !atOpening()) return close(opening); // No arguments
+        while (true) {
+            Owner argument = function;
+            argument.received_ = static_cast<int>(arguments.size());
+            argument.bounded_ = false;
+            auto node = parseExpression(argument);
+            if (!node) return false;
+            arguments.push_back(std::move(node));
+            if (!at(parser::TokenType::Separator)) return close(opening);
+            ++it_;
+        }
+    }
+
+    // Parses a value, a bracket or a prefix operator with its operands
+    std::unique_ptr<expr::ExprNode> parseOperand(const Owner& owner) {
+        if (it_ == end_) return missing(owner);
+        const Iterator token = it_;
+        switch (token->first) {
+        case parser::TokenType::Numeral: {
+            const std::size_t at_position = position(it_++);
+            std::string text;
+            if (source_ && positions_) { // Literals of more than 15 characters may not round-trip through a double
+                auto end = parser::find_token_end(source_->begin() + static_cast<std::ptrdiff_t>(at_position), source_->end()).first;
+                if (end - source_->begin() > static_cast<std::ptrdiff_t>(at_position + kRoundTripLength)) {
+                    text.assign(source_->begin() + static_cast<std::ptrdiff_t>(at_position), end);
                 }
             }
+            auto node = std::make_unique<expr::NumeralNode>(std::get<types::Numeral>(token->second), std::move(text));
+            node->setPosition(at_position);
+            return node;
+        }
+        case parser::TokenType::Symbol: {
+            auto node = std::make_unique<expr::SymbolNode>(std::get<types::Symbol>(token->second));
+            node->setPosition(position(it_++));
+            return node;
+        }
+        case parser::TokenType::Separator:
+            return missing(owner);
+        case parser::TokenType::Bracket: { // ((x) + y): the inner brackets are closed from the innermost outwards
+            if (!atOpening()) return missing(owner);
+            std::vector<Iterator> openings;
+            while (atOpening()) openings.push_back(it_++);
+            Owner inner = owner;
+            inner.bounded_ = false;
+            auto node = parseExpression(inner);
+            while (node) {
+                if (!close(openings.back())) return nullptr;
+                openings.pop_back();
+                if (openings.empty()) return node;
+                node = parseInfix(std::move(node), inner);
+            }
+            return nullptr;
+        }
+        case parser::TokenType::Operator:
+            break;
+        } // switch (token->first)
+
+        static const std::string kPositive = "++", kNegative = "--";
+        const std::string& spelled = std::get<std::string>(token->second);
+        const std::string& name = spelled == "+" ? kPositive : spelled == "-" ? kNegative : spelled;
+        const auto& info = operator_info(name, functions_);
+        const std::size_t at_position = position(it_++);
+        if (info.arity_ == 0) { // A constant, which may be called with no arguments
+            if (atOpening() && it_ + 1 != end_ && (it_ + 1)->first == parser::TokenType::Bracket
+                && !eval::is_opening_bracket(std::get<std::string>((it_ + 1)->second))) {
+                const Iterator opening = it_++;
+                if (!close(opening)) return nullptr;
+            }
+            return make(info, {}, at_position);
+        }
+        if (info.postfix_) {
+            it_ = token;
+            if (owner.name_) return missing(owner);
+            return fail({types::ErrorCode::ArgumentCount, at_position, name, info.arity_, 0});
+        }
 
-            // Normal logic
-            auto info = expr::get_operator_info(operator_name);
-            if (info.arity_ == 0) reverse_polish.push(*it); // Treat it as a number or a symbol
-            else if (info.arity_ == 1) {// Unary operator 
-                if (!info.postfix_) operators.push(parser::Token(parser::TokenType::Operator, operator_name)); // Prefix operator
-                else { // Postfix operator
-                    while (true) {
-                        // Empty or bracket top, break directly
-                        if (operators.empty() || operators.top().first == parser::TokenType::Bracket) break; 
-
-                        std::string op_str = std::get<std::string>(operators.top().second);                     
-                        auto top_info = expr::get_operator_info(op_str); // Operator info at operator stack top
-                        if (top_info.precedence_ > info.precedence_) {
-                            reverse_polish.push(std::move(operators.top())); // Push the top of the operators stack into RPN queue
-                            operators.pop(); // Pop the operator stack
-                        }
-                        else break; // Exit the loop
-                    }
-                    reverse_polish.push(*it); // Push this operator into the RPN queue
-                }
+        const Owner self{&name, &info, at_position, 0, true};
+        std::vector<std::unique_ptr<expr::ExprNode>> operands;
+        if (atOpening()) {
+            if (!parseArguments(self, operands)) return nullptr;
+            if (static_cast<int>(operands.size()) != info.arity_) {
+                return fail({types::ErrorCode::ArgumentCount, at_position, name, info.arity_, static_cast<int>(operands.size())});
             }
-            else if (info.arity_ == 2) { // Binary operator
-                while (true) {
-                    if (operators.empty() || operators.top().first == parser::TokenType::Bracket) break; // Empty or bracket top, directly break
-
-                    std::string op_str = std::get<std::string>(operators.top().second);                     
-                    auto top_info = expr::get_operator_info(op_str); // Operator info at operator stack top
-                    if (((top_info.precedence_ > info.precedence_)                                      // Higher precedence
-                        || (top_info.precedence_ == info.precedence_ && !top_info.right_assoc_))        // Equal precedence and left assoc
-                        && operators.top().first != parser::TokenType::Bracket) {                       // Not a parenthesis, not empty
-                        
-                        reverse_polish.push(std::move(operators.top())); // Push the top of the operators stack into RPN queue
-                        operators.pop(); // Pop the operator stack
-                    }
-                    else break; // Exit the loop
-                }
-                operators.push(*it); // Push this operator into the operators stack
+            if (info.arity_ == 1) { // Like a prefix operator over a bracket, which the operators after it may bind into
+                operands[0] = parseInfix(std::move(operands[0]), self);
+                if (!operands[0]) return nullptr;
             }
-            else { // Multinary operator
-                // TODO
+        }
+        else if (info.arity_ == 1) {
+            auto operand = parseExpression(self);
+            if (!operand) return nullptr;
+            operands.push_back(std::move(operand));
+        }
+        else return fail({types::ErrorCode::ArgumentCount, at_position, name, info.arity_, 0});
+        return make(info, std::move(operands), at_position);
+    }
+
+    // Extends left with the binary and postfix operators that bind tighter than the owner
+    std::unique_ptr<expr::ExprNode> parseInfix(std::unique_ptr<expr::ExprNode> left, const Owner& owner) {
+        while (it_ != end_) {
+            if (it_->first == parser::TokenType::Separator || (it_->first == parser::TokenType::Bracket && !atOpening())) break;
+            if (it_->first != parser::TokenType::Operator) return fail({types::ErrorCode::MissingArguments, position(it_)});
+            const std::string& name = std::get<std::string>(it_->second);
+            const auto& info = operator_info(name, functions_);
+            const bool binary = info.arity_ == 2 && !info.postfix_ && !info.function_;
+            if (!binary && !(info.arity_ == 1 && info.postfix_)) return fail({types::ErrorCode::MissingArguments, position(it_)});
+
+            if (owner.bounded_) { // Shunting-yard would apply the owner first if it binds at least as tight
+                const auto& owner_info = *owner.info_;
+                const bool binds = info.postfix_ ? info.precedence_ >= owner_info.precedence_
+                    : info.precedence_ > owner_info.precedence_ || (info.precedence_ == owner_info.precedence_ && owner_info.right_assoc_);
+                if (!binds) break;
             }
-            break;
+            const std::size_t at_position = position(it_++);
+            std::vector<std::unique_ptr<expr::ExprNode>> operands;
+            operands.push_back(std::move(left));
+            if (binary) {
+                auto right = parseExpression(Owner{&name, &info, at_position, 1, true});
+                if (!right) return nullptr;
+                operands.push_back(std::move(right));
+            }
+            left = make(info, std::move(operands), at_position);
+        }
+        return left;
+    }
+
+    std::unique_ptr<expr::ExprNode> parseExpression(const Owner& owner) {
+        if (depth_ == kMaxNesting) return fail({types::ErrorCode::TooDeep, it_ == end_ ? 0 : position(it_)});
+        ++depth_;
+        auto left = parseOperand(owner);
+        if (left) left = parseInfix(std::move(left), owner);
+        --depth_;
+        return left;
+    }
+
+public:
+    TreeBuilder(Iterator tokens_begin, Iterator tokens_end, const std::size_t* positions, const functions::FunctionRegistry* functions,
+        const std::string* source)
+        : begin_(tokens_begin), it_(tokens_begin), end_(tokens_end), positions_(positions), functions_(functions), source_(source) {}
+
+    types::Expected<std::unique_ptr<expr::ExprNode>> build() {
+        auto tree = parseExpression(Owner());
+        if (tree && it_ != end_) {
+            if (it_->first == parser::TokenType::Separator) error_ = types::Error{types::ErrorCode::MisplacedSeparator, position(it_)};
+            else error_ = types::Error{types::ErrorCode::UnpairedBrackets, position(it_)};
         }
-        case parser::TokenType::Bracket: {
-            std::string paren = std::get<std::string>(it->second);
-            if (paren == "(" || paren == "[" || paren == "{") operators.push(*it); // Opening parenthesis
-            else { // Closing parenthesis
-                std::string opening_paren;
-                if (paren == ")") opening_paren = "(";
-                else if (paren == "]") opening_paren = "[";
-                else opening_paren = "{";
-
-                while (!operators.empty() && std::get<std::string>(operators.top().second) != opening_paren) { // Push every operator to the queue
-                    reverse_polish.push(std::move(operators.top())); // Push the top of the operators stack into RPN queue
-                    operators.pop(); // Pop the operator stack
+        if (!error_) return tree;
+        auto unpaired = find_unpaired_bracket(begin_, end_);
+        if (unpaired >= 0) return types::Error{types::ErrorCode::UnpairedBrackets, position(begin_ + unpaired)};
+        return *error_;
+    }
+};
+
+// The tree of the tokens, with the calls of user-defined functions left as calls
+types::Expected<std::unique_ptr<expr::ExprNode>> build_tree(
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const std::size_t* positions, const functions::FunctionRegistry* functions, const std::string* source) {
+
+    return TreeBuilder(tokens_begin, tokens_end, positions, functions, source).build();
+}
+
+} // namespace
+
+types::Expected<std::unique_ptr<expr::ExprNode>> eval::try_build_expr_tree(
+    std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end,
+    const std::size_t* positions, const functions::FunctionRegistry* functions, const std::string* source) {
+
+    auto tree = build_tree(tokens_begin, tokens_end, positions, functions, source);
+    if (tree && functions) functions::inline_calls(tree.value());
+    return tree;
+}
+
+bool eval::check_bracket_matching(std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end) {
+    return find_unpaired_bracket(tokens_begin, tokens_end) < 0; // Negative means all correctly paired
+}
+
+namespace {
+
+using parallel::run_tasks;
+
+constexpr std::size_t kParallelParseLength = std::size_t(1) << 16; // Shortest expression parsed on several threads
+constexpr std::size_t kParallelTokens = 4096; // Fewest tokens of a range split into subexpressions
+constexpr std::size_t kUnpaired = std::size_t(-1);
+
+bool is_opening(const parser::Token& token) {
+    return token.first == parser::TokenType::Bracket && eval::is_opening_bracket(std::get<std::string>(token.second));
+}
+
+/**
+ * Pairs the brackets on several threads: each chunk of tokens pairs its own brackets with a stack, leaving the closing
+ * brackets it cannot pair and the opening ones it leaves open, which are then paired across the chunks in order.
+ * Fills match with the index of the other bracket of each pair. Returns false if a bracket is unpaired.
+ */
+bool pair_brackets(const std::vector<parser::Token>& tokens, unsigned threads, std::vector<std::size_t>& match) {
+    match.assign(tokens.size(), kUnpaired);
+    auto is_pair = [&tokens](std::size_t opening, std::size_t closing) {
+        return eval::is_bracket_match(std::get<std::string>(tokens[opening].second), std::get<std::string>(tokens[closing].second));
+    };
+
+    struct Chunk {
+        std::vector<std::size_t> closing_; // Closing brackets paired in an earlier chunk, in order
+        std::vector<std::size_t> opening_; // Opening brackets paired in a later chunk, outermost first
+        bool mismatch_ = false;
+    };
+    const std::size_t chunk_count = std::clamp<std::size_t>(threads, 1, tokens.size());
+    std::vector<Chunk> chunks(chunk_count);
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t k = 0; k < chunk_count; ++k) {
+        tasks.emplace_back([&, k] {
+            Chunk& chunk = chunks[k];
+            for (std::size_t i = tokens.size() * k / chunk_count; i < tokens.size() * (k + 1) / chunk_count; ++i) {
+                if (tokens[i].first != parser::TokenType::Bracket) continue;
+                if (is_opening(tokens[i])) chunk.opening_.push_back(i);
+                else if (chunk.opening_.empty()) chunk.closing_.push_back(i);
+                else if (!is_pair(chunk.opening_.back(), i)) {
+                    chunk.mismatch_ = true;
+                    return;
+                }
+                else {
+                    match[chunk.opening_.back()] = i;
+                    match[i] = chunk.opening_.back();
+                    chunk.opening_.pop_back();
                 }
-                if (operators.empty()) throw std::runtime_error("Syntax error: Unpaired brackets");
-                operators.pop(); // Discard the opening parenthesis
             }
-            break;
+        });
+    }
+    run_tasks(tasks, threads);
+
+    std::vector<std::size_t> open;
+    for (const Chunk& chunk : chunks) {
+        if (chunk.mismatch_) return false;
+        for (std::size_t closing : chunk.closing_) {
+            if (open.empty() || !is_pair(open.back(), closing)) return false;
+            match[open.back()] = closing;
+            match[closing] = open.back();
+            open.pop_back();
+        }
+        open.insert(open.end(), chunk.opening_.begin(), chunk.opening_.end());
+    }
+    return open.empty();
+}
+
+// The tokens of an expression with their positions and paired brackets
+struct ParseContext {
+    const std::vector<parser::Token>& tokens_;
+    const std::size_t* positions_;
+    const std::vector<std::size_t>& match_;
+    const functions::FunctionRegistry* functions_;
+    const std::string* source_;
+};
+
+typedef std::pair<std::size_t, std::size_t> TokenRange; // Indices of the first token and past the last one
+
+std::unique_ptr<expr::ExprNode> build_range(const ParseContext& context, TokenRange range, unsigned threads);
+
+/**
+ * Builds the trees of consecutive ranges on several threads: a range with at least two threads' share of the tokens
+ * gets that many threads, the others are built one after another in runs of about one share.
+ * Returns an empty vector if one of them has an error.
+ */
+std::vector<std::unique_ptr<expr::ExprNode>> build_ranges(const ParseContext& context, const std::vector<TokenRange>& ranges,
+    unsigned threads) {
+
+    std::size_t total = 0;
+    for (const auto& [begin, end] : ranges) total += end - begin;
+    const std::size_t share = std::max<std::size_t>(total / threads, 1);
+
+    std::vector<std::unique_ptr<expr::ExprNode>> trees(ranges.size());
+    std::atomic<bool> failed{false};
+    std::vector<std::function<void()>> tasks;
+    for (std::size_t first = 0; first < ranges.size(); ) {
+        std::size_t length = ranges[first].second - ranges[first].first;
+        if (length >= 2 * share) {
+            unsigned range_threads = static_cast<unsigned>(std::min<std::size_t>(length / share, threads));
+            tasks.emplace_back([&, first, range_threads] {
+                trees[first] = build_range(context, ranges[first], range_threads);
+                if (!trees[first]) failed = true;
+            });
+            ++first;
+            continue;
         }
-        case parser::TokenType::Separator: { // Comma separator
-            while (!operators.empty()) {
-                std::string op_str = std::get<std::string>(operators.top().second);
-                if (op_str == "(" || op_str == "[" || op_str == "{") break;
+        std::size_t last = first + 1;
+        for (; last < ranges.size() && length < share; ++last) {
+            std::size_t next = ranges[last].second - ranges[last].first;
+            if (next >= 2 * share) break;
+            length += next;
+        }
+        tasks.emplace_back([&, first, last] {
+            for (std::size_t k = first; k < last && !failed; ++k) {
+                trees[k] = build_range(context, ranges[k], 1);
+                if (!trees[k]) failed = true;
+            }
+        });
+        first = last;
+    }
+    run_tasks(tasks, threads);
+    if (failed) trees.clear();
+    return trees;
+}
 
-                reverse_polish.push(std::move(operators.top())); // Push the top of the operators stack into RPN queue
-                operators.pop(); // Pop the operator stack
+/**
+ * Builds the tree of a range of tokens, or returns nullptr if it has an error.
+ * A long range is split where the sequential builder would join independent subexpressions:
+ * - a range in brackets is the range inside them;
+ * - a call of a function or prefix operator, op(a, b, ...), has the arguments as children, the last one first;
+ * - otherwise, if the binary operators outside brackets with the lowest precedence share their associativity, and
+ *   every other operator outside brackets binds tighter, the operands between them are joined from the left, or from
+ *   the right for right-associative ones.
+ * Each part is a range the sequential builder starts as it would at the beginning of an expression: after an opening
+ * bracket, a comma or a binary operator that is not a function, a + or - is a sign and a bracket is not a call.
+ * What has no such split, such as a range with a comma outside brackets, is built sequentially.
+ */
+std::unique_ptr<expr::ExprNode> build_range(const ParseContext& context, TokenRange range, unsigned threads) {
+    const auto& [begin, end] = range;
+    const auto& tokens = context.tokens_;
+    auto sequential = [&]() -> std::unique_ptr<expr::ExprNode> {
+        auto tree = build_tree(tokens.begin() + static_cast<std::ptrdiff_t>(begin), tokens.begin() + static_cast<std::ptrdiff_t>(end),
+            context.positions_ + begin, context.functions_, context.source_);
+        return tree ? std::move(tree).value() : nullptr;
+    };
+    if (threads <= 1 || end - begin < kParallelTokens) return sequential();
+
+    // A range in brackets
+    if (is_opening(tokens[begin]) && context.match_[begin] == end - 1) return build_range(context, {begin + 1, end - 1}, threads);
+
+    // A call
+    if (tokens[begin].first == parser::TokenType::Operator && is_opening(tokens[begin + 1]) && context.match_[begin + 1] == end - 1) {
+        const std::string& name = std::get<std::string>(tokens[begin].second);
+        const auto& info = operator_info(name, context.functions_);
+        if (!(info.function_ || info.arity_ > 2 || (info.arity_ == 1 && !info.postfix_))) return sequential();
+        std::vector<TokenRange> arguments;
+        std::size_t first = begin + 2;
+        for (std::size_t i = first; i < end - 1; ++i) {
+            if (is_opening(tokens[i])) i = context.match_[i];
+            else if (tokens[i].first == parser::TokenType::Separator) {
+                arguments.emplace_back(first, i);
+                first = i + 1;
             }
-            if (operators.empty()) throw std::runtime_error("Syntax error: Misplaced comma or unpaired brackets");
-            break;
         }
-        } // switch (it->first)
+        arguments.emplace_back(first, end - 1);
+        if (arguments.size() != static_cast<std::size_t>(info.arity_)) return sequential();
+        for (const auto& [argument_begin, argument_end] : arguments) {
+            if (argument_begin == argument_end) return sequential();
+        }
+        auto children = build_ranges(context, arguments, threads);
+        if (children.empty()) return nullptr;
+        std::reverse(children.begin(), children.end());
+        auto node = info.node_func_(std::move(children));
+        node->setPosition(context.positions_[begin]);
+        return node;
+    }
+
+    // Operators outside brackets
+    std::vector<std::pair<std::size_t, const expr::OperatorInfo*>> binary; // Binary operators and their info
+    int lowest = INT_MAX; // Lowest precedence of the binary operators
+    int other = INT_MAX;  // Lowest precedence of the other operators
+    for (std::size_t i = begin; i < end; ++i) {
+        if (is_opening(tokens[i])) {
+            i = context.match_[i];
+            continue;
+        }
+        if (tokens[i].first == parser::TokenType::Separator) return sequential();
+        if (tokens[i].first != parser::TokenType::Operator) continue;
+
+        std::string name = std::get<std::string>(tokens[i].second);
+        if ((name == "+" || name == "-") && i != begin) { // As in build_tree
+            const parser::Token& previous = tokens[i - 1];
+            bool prefix = is_opening(previous) || previous.first == parser::TokenType::Separator;
+            if (previous.first == parser::TokenType::Operator) {
+                const auto& previous_info = operator_info(std::get<std::string>(previous.second), context.functions_);
+                prefix = previous_info.arity_ != 0 && !previous_info.postfix_;
+            }
+            if (prefix) name += name;
+        }
+        else if (name == "+" || name == "-") name += name;
+
+        const auto& info = operator_info(name, context.functions_);
+        if (info.arity_ == 0) continue;
+        if (info.arity_ == 2 && !info.function_ && !info.postfix_) {
+            binary.emplace_back(i, &info);
+            lowest = std::min(lowest, info.precedence_);
+        }
+        else other = std::min(other, info.precedence_);
+    }
+    if (binary.empty() || other <= lowest) return sequential();
+
+    std::vector<std::pair<std::size_t, const expr::OperatorInfo*>> splits;
+    for (const auto& split : binary) {
+        if (split.second->precedence_ == lowest) splits.push_back(split);
+    }
+    const bool right_assoc = splits.front().second->right_assoc_;
+    std::vector<TokenRange> operands;
+    std::size_t first = begin;
+    for (const auto& [index, info] : splits) {
+        if (info->right_assoc_ != right_assoc) return sequential();
+        operands.emplace_back(first, index);
+        first = index + 1;
+    }
+    operands.emplace_back(first, end);
+    for (const auto& [operand_begin, operand_end] : operands) {
+        if (operand_begin == operand_end) return sequential();
+    }
+
+    auto trees = build_ranges(context, operands, threads);
+    if (trees.empty()) return nullptr;
+    auto join = [&](std::size_t k, std::unique_ptr<expr::ExprNode>&& left, std::unique_ptr<expr::ExprNode>&& right) {
+        std::vector<std::unique_ptr<expr::ExprNode>> children;
+        children.push_back(std::move(right)); // The builder pops the right operand first
+        children.push_back(std::move(left));
+        auto node = splits[k].second->node_func_(std::move(children));
+        node->setPosition(context.positions_[splits[k].first]);
+        return node;
+    };
+    if (right_assoc) {
+        auto tree = std::move(trees.back());
+        for (std::size_t k = splits.size(); k-- > 0; ) tree = join(k, std::move(trees[k]), std::move(tree));
+        return tree;
+    }
+    auto tree = std::move(trees.front());
+    for (std::size_t k = 0; k < splits.size(); ++k) tree = join(k, std::move(tree), std::move(trees[k + 1]));
+    return tree;
+}
+
+} // namespace
+
+types::Expected<std::unique_ptr<expr::ExprNode>> eval::try_parse_parallel(const std::string& expression, unsigned threads,
+    const functions::FunctionRegistry* functions) {
+
+    if (threads <= 1 || expression.size() < kParallelParseLength) return try_parse(expression, functions);
+    std::vector<std::size_t> positions;
+    auto tokens = parser::try_tokenize_parallel(expression, threads, &positions);
+    if (!tokens) return tokens.error();
+    if (functions) functions->recognize(tokens.value());
+
+    // Errors are left to the sequential builder, which reports them the same way
+    const auto& all = tokens.value();
+    std::vector<std::size_t> match;
+    std::unique_ptr<expr::ExprNode> root;
+    if (pair_brackets(all, threads, match)) root = build_range({all, positions.data(), match, functions, &expression}, {0, all.size()}, threads);
+    if (!root) return try_build_expr_tree(all.begin(), all.end(), positions.data(), functions, &expression);
+    if (functions) functions::inline_calls(root);
+    return root;
+}
+
+namespace {
+
+// Operand of the streamed evaluation: the value of a subexpression, or the error evaluating it raised
+struct StreamValue {
+    types::Numeral value_ = 0;
+    std::size_t position_ = 0;  // Of the token that produced it
+    bool cheap_ = true;         // Whether the subexpression is cheap (see ExprNode::isCheap)
+    types::ErrorCode code_ = types::ErrorCode::None;
+    std::size_t error_position_ = 0;
+    types::Symbol symbol_;      // The symbol or function the error names, if any
+};
+
+// Leaf standing for an operand of a streamed operator; its copies read the same operand
+class OperandNode : public expr::ExprNode {
+private:
+    const StreamValue* const* operand_;
+
+    types::Numeral value() const {
+        const StreamValue& operand = **operand_;
+        if (operand.code_ != types::ErrorCode::None) {
+            throw std::runtime_error(types::error_message(types::Error{operand.code_, operand.error_position_, operand.symbol_}));
+        }
+        return operand.value_;
+    }
+
+public:
+    explicit OperandNode(const StreamValue* const* operand) : ExprNode(), operand_(operand) {}
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final { return value(); }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return value();
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final {
+        const StreamValue& operand = **operand_;
+        if (operand.code_ == types::ErrorCode::None) return operand.value_;
+        if (status.ok() && !operand.symbol_.empty()) status.symbol_ = &operand.symbol_;
+        status.fail(operand.code_, operand.error_position_);
+        return std::numeric_limits<types::Numeral>::quiet_NaN();
+    }
+
+    virtual bool isCheap() const noexcept override final { return (*operand_)->cheap_; }
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final {
+        return expr::Dual{value(), 0};
+    }
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final {
+        return tape.constant(value());
+    }
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final {
+        return positioned(std::make_unique<OperandNode>(operand_));
+    }
+};
+
+// Shunting-yard over the tokens as they come, applying each operator that leaves the operator stack to the value stack
+class StreamEvaluator {
+private:
+    // An operator or an opening bracket on the operator stack
+    struct Pending {
+        parser::TokenType type_;
+        std::string name_;
+        std::size_t position_;
+    };
+
+    // The node of an operator over leaves standing for its operands, in source order
+    struct Applier {
+        std::unique_ptr<expr::ExprNode> node_;
+        std::unique_ptr<const StreamValue*[]> operands_;
+        bool user_ = false; // Calls of user-defined functions are built at each call, as inlining depends on the operands
+    };
+
+    const SymbolTable& symbols_;
+    const functions::FunctionRegistry* functions_;
+    expr::NumericMode mode_;
+    std::vector<StreamValue> values_;
+    std::vector<Pending> operators_;
+    std::vector<std::pair<int, bool>> brackets_; // For each open bracket, commas seen so far and whether it holds call arguments
+    std::unordered_map<std::string, Applier> appliers_;
+    parser::TokenType previous_type_ = parser::TokenType::Symbol;
+    std::string previous_name_; // Of the previous token, if an operator or a bracket
+    bool expecting_ = true;     // Whether the next token stands where an operand is expected
+    bool called_ = false;       // Whether the previous token is an operator taking the bracket after it as its arguments
+    std::optional<std::size_t> empty_call_; // Position of an opening bracket after a constant, which must close at once
+    eval::StreamStats stats_;
+
+    // Whether an operator after an operand is binary or postfix
+    bool isInfix(const std::string& name) const {
+        const auto& info = operator_info(name, functions_);
+        return info.postfix_ || (info.arity_ == 2 && !info.function_);
+    }
+
+    std::optional<types::Error> apply(const std::string& name, std::size_t position) {
+        const auto& info = operator_info(name, functions_);
+        const auto arity = static_cast<std::size_t>(info.arity_);
+        if (values_.size() < arity) {
+            return types::Error{types::ErrorCode::ArgumentCount, position, name, info.arity_, static_cast<int>(values_.size())};
+        }
+        Applier& applier = appliers_[name];
+        if (!applier.operands_) {
+            applier.operands_ = std::make_unique<const StreamValue*[]>(arity);
+            applier.user_ = expr::get_node_factory_map().count(name) == 0;
+        }
+        const StreamValue* operands = values_.data() + values_.size() - arity;
+        for (std::size_t i = 0; i < arity; ++i) applier.operands_[i] = operands + i;
+        if (!applier.node_ || applier.user_) {
+            std::vector<std::unique_ptr<expr::ExprNode>> children; // The builder pops the last operand first
+            for (std::size_t i = arity; i-- > 0; ) children.push_back(std::make_unique<OperandNode>(&applier.operands_[i]));
+            applier.node_ = info.node_func_(std::move(children));
+            applier.node_->setPosition(position);
+            if (applier.user_) functions::inline_calls(applier.node_);
+        }
+        applier.node_->setPosition(position);
+
+        expr::EvalStatus status;
+        status.mode_ = mode_;
+        StreamValue result;
+        result.value_ = applier.node_->evaluateChecked(symbols_, status);
+        result.position_ = position;
+        result.cheap_ = applier.node_->isCheap();
+        if (!status.ok()) {
+            result.code_ = status.code_;
+            result.error_position_ = status.position_;
+            if (status.symbol_) result.symbol_ = *status.symbol_;
+        }
+        values_.resize(values_.size() - arity);
+        values_.push_back(std::move(result));
+        return std::nullopt;
+    }
+
+    // Applies the operators on top of the operator stack down to a bracket, or while stop is false
+    template <typename Stop>
+    std::optional<types::Error> unwind(Stop stop) {
+        while (!operators_.empty() && operators_.back().type_ != parser::TokenType::Bracket && !stop(operators_.back())) {
+            Pending top = std::move(operators_.back());
+            operators_.pop_back();
+            if (auto error = apply(top.name_, top.position_)) return error;
+        }
+        return std::nullopt;
     }
-    while (!operators.empty()) { // Push the remaining operators into the expression
-        reverse_polish.push(std::move(operators.top())); // Push the top of the operators stack into RPN queue
-        operators.pop(); // Pop the operator stack
+
+    std::optional<types::Error> feedOperator(std::string name, std::size_t position) {
+        // Disambiguitate between infix +- and prefix +-
+        if (expecting_ && (name == "+" || name == "-")) name += name;
+
+        const auto& info = operator_info(name, functions_);
+        if (info.arity_ == 0) { // A constant
+            expecting_ = false;
+            return apply(name, position);
+        }
+        if (info.function_ || info.arity_ > 2 || (info.arity_ == 1 && !info.postfix_) || (expecting_ && !info.postfix_)) {
+            operators_.push_back({parser::TokenType::Operator, std::move(name), position}); // Arguments in the following brackets
+            called_ = expecting_ = true;
+            return std::nullopt;
+        }
+        expecting_ = !info.postfix_;
+        if (info.arity_ == 1) { // Postfix operator
+            auto error = unwind([&](const Pending& top) { return operator_info(top.name_, functions_).precedence_ <= info.precedence_; });
+            if (error) return error;
+            return apply(name, position);
+        }
+        auto error = unwind([&](const Pending& top) { // Binary operator
+            const auto& top_info = operator_info(top.name_, functions_);
+            return !(top_info.precedence_ > info.precedence_ || (top_info.precedence_ == info.precedence_ && !top_info.right_assoc_));
+        });
+        if (error) return error;
+        operators_.push_back({parser::TokenType::Operator, std::move(name), position});
+        return std::nullopt;
     }
 
-    // Build expression tree from Reverse Polish Notation
-    std::stack<std::unique_ptr<expr::ExprNode>> node_stack; // Stack for the node
-    std::vector<std::unique_ptr<expr::ExprNode>> children_nodes; // Temporary vector for storing children nodes
+    std::optional<types::Error> feedBracket(const std::string& bracket, std::size_t position, bool after_call) {
+        if (eval::is_opening_bracket(bracket)) {
+            brackets_.emplace_back(0, after_call);
+            operators_.push_back({parser::TokenType::Bracket, bracket, position});
+            return std::nullopt;
+        }
+        if (auto error = unwind([](const Pending&) { return false; })) return error;
+        if (operators_.empty() || !eval::is_bracket_match(operators_.back().name_, bracket)) {
+            return types::Error{types::ErrorCode::UnpairedBrackets, position};
+        }
+        operators_.pop_back();
 
-    // for (int i = 0; i < reverse_polish.size(); ++i) {
-    //     auto element = reverse_polish.front();
-    //     reverse_polish.pop();
-    //     if (element.first == parser::TokenType::Numeral) std::cout << std::get<types::Numeral>(element.second) << " ";
-    //     else std::cout << std::get<std::string>(element.second) << " ";
-    //     reverse_polish.push(element);
-    // }
-    // std::cout << std::endl;
+        // Check the argument count of a function call
+        auto [commas, call] = brackets_.back();
+        brackets_.pop_back();
+        if (call) {
+            bool empty = previous_type_ == parser::TokenType::Bracket && eval::is_opening_bracket(previous_name_);
+            int arguments = empty ? 0 : commas + 1;
+            const Pending& function = operators_.back();
+            int arity = operator_info(function.name_, functions_).arity_;
+            if (arguments != arity) return types::Error{types::ErrorCode::ArgumentCount, function.position_, function.name_, arity, arguments};
+            if (arity != 1) { // Applied at once, as the tree takes the call as an operand; a prefix operator still binds
+                Pending top = std::move(operators_.back());
+                operators_.pop_back();
+                return apply(top.name_, top.position_);
+            }
+        }
+        return std::nullopt;
+    }
+
+    // The error of a function or of a prefix binary operator not followed by its bracket, if the previous token is one
+    std::optional<types::Error> uncalled() const {
+        if (!called_) return std::nullopt;
+        const Pending& function = operators_.back();
+        int arity = operator_info(function.name_, functions_).arity_;
+        if (arity == 1) return std::nullopt;
+        return types::Error{types::ErrorCode::ArgumentCount, function.position_, function.name_, arity, 0};
+    }
 
-    while (!reverse_polish.empty()) {
-        auto token = reverse_polish.front(); // Take out the frontmost token
-        reverse_polish.pop();
+public:
+    StreamEvaluator(const SymbolTable& symbols, const functions::FunctionRegistry* functions, expr::NumericMode mode)
+        : symbols_(symbols), functions_(functions), mode_(mode) {}
 
-        switch (token.first) { // Should be either numeral, symbol, or operator
+    // Takes the next token, returning the syntax error it makes if any
+    std::optional<types::Error> feed(const parser::Token& token, std::size_t position) {
+        ++stats_.tokens_;
+        const bool opening = token.first == parser::TokenType::Bracket && eval::is_opening_bracket(std::get<std::string>(token.second));
+        const bool call = called_;
+        if (!opening) {
+            if (auto error = uncalled()) return error;
+        }
+        if (empty_call_) {
+            if (token.first != parser::TokenType::Bracket || opening) return types::Error{types::ErrorCode::MissingArguments, *empty_call_};
+            empty_call_.reset();
+        }
+        else if (!expecting_ && (token.first == parser::TokenType::Numeral || token.first == parser::TokenType::Symbol || opening
+            || (token.first == parser::TokenType::Operator && !isInfix(std::get<std::string>(token.second))))) {
+            // An operand right after another, as in the tree, bar the empty brackets of a constant
+            const bool constant = previous_type_ == parser::TokenType::Operator && operator_info(previous_name_, functions_).arity_ == 0;
+            if (!opening || !constant) return types::Error{types::ErrorCode::MissingArguments, position};
+            empty_call_ = position;
+        }
+        called_ = false;
+        std::optional<types::Error> error;
+        switch (token.first) {
         case parser::TokenType::Numeral:
-            node_stack.push(std::make_unique<expr::NumeralNode>(std::get<types::Numeral>(token.second)));
+            values_.push_back({std::get<types::Numeral>(token.second), position});
+            expecting_ = false;
             break;
-        case parser::TokenType::Symbol:
-            node_stack.push(std::make_unique<expr::SymbolNode>(std::get<types::Symbol>(token.second)));
-            break;
-        case parser::TokenType::Operator: {
-            std::string op_name = std::get<std::string>(token.second);
-            auto op_info = expr::get_operator_info(op_name);
-            for (int i = 0; i < op_info.arity_; ++i) {
-                if (node_stack.empty()) { // If node stack is empty, then there are some errors
-                    throw std::runtime_error("Syntax error: Operator '" + op_name + "' expects " + std::to_string(op_info.arity_)
-                    + " arguments, received " + std::to_string(i));
-                }
-
-                children_nodes.push_back(std::move(node_stack.top()));
-                node_stack.pop();
+        case parser::TokenType::Symbol: {
+            expecting_ = false;
+            const auto& symbol = std::get<types::Symbol>(token.second);
+            if (const types::Numeral* value = symbols_.find(symbol)) values_.push_back({*value, position});
+            else {
+                values_.push_back({std::numeric_limits<types::Numeral>::quiet_NaN(), position, true,
+                    types::ErrorCode::UndefinedSymbol, position, symbol});
             }
-            node_stack.push(expr::create_node(op_name, std::move(children_nodes)));
-            children_nodes.clear(); // Reset
+            break;
         }
+        case parser::TokenType::Operator:
+            error = feedOperator(std::get<std::string>(token.second), position);
+            break;
+        case parser::TokenType::Bracket:
+            error = feedBracket(std::get<std::string>(token.second), position, call);
+            expecting_ = opening;
+            break;
+        case parser::TokenType::Separator:
+            expecting_ = true;
+            error = unwind([](const Pending&) { return false; });
+            if (!error && (brackets_.empty() || !brackets_.back().second)) error = types::Error{types::ErrorCode::MisplacedSeparator, position};
+            if (!error) ++brackets_.back().first;
+            break;
         } // switch (token.first)
+        previous_type_ = token.first;
+        if (token.first != parser::TokenType::Numeral) previous_name_ = std::get<std::string>(token.second);
+        stats_.depth_ = std::max(stats_.depth_, operators_.size() + values_.size());
+        return error;
     }
 
-    if (node_stack.size() != 1) throw std::runtime_error("Syntax error: Missing or redundant arguments");
-    return std::move(node_stack.top()); // The root node
+    // Applies the operators left, giving the value of the expression or its first error
+    types::Expected<types::Numeral> finish() {
+        if (stats_.tokens_ == 0) return types::Error{types::ErrorCode::EmptyExpression, 0};
+        for (auto it = operators_.rbegin(); it != operators_.rend(); ++it) { // The innermost bracket left open
+            if (it->type_ == parser::TokenType::Bracket) return types::Error{types::ErrorCode::UnpairedBrackets, it->position_};
+        }
+        if (auto error = uncalled()) return *error;
+        if (auto error = unwind([](const Pending&) { return false; })) return *error;
+        if (values_.size() != 1) return types::Error{types::ErrorCode::MissingArguments, values_.empty() ? 0 : values_.back().position_};
+        const StreamValue& result = values_.back();
+        if (result.code_ != types::ErrorCode::None) return types::Error{result.code_, result.error_position_, result.symbol_};
+        return result.value_;
+    }
+
+    const eval::StreamStats& stats() const noexcept { return stats_; }
+};
+
+// Whether a character is neither a space, a bracket, a comma nor part of a numeral or a symbol
+bool is_operator_character(char ch) {
+    return !std::isspace(static_cast<unsigned char>(ch)) && ch != ',' && !parser::is_bracket(std::string(1, ch))
+        && !parser::is_numeral(ch) && !parser::is_symbol_middle(ch);
 }
 
-bool eval::check_bracket_matching(std::vector<parser::Token>::const_iterator tokens_begin, std::vector<parser::Token>::const_iterator tokens_end) {
-    std::stack<std::string> brackets;
+// Whether a token ends between buffer[cut - 1] and buffer[cut]: after a space, bracket or comma, between a numeral or
+// symbol and an operator, or after an operator character unless = follows, which may make it <=, >=, == or !=
+bool is_stream_cut(const std::string& buffer, std::size_t cut) {
+    const char previous = buffer[cut - 1], next = buffer[cut];
+    if (std::isspace(static_cast<unsigned char>(previous)) || previous == ',' || parser::is_bracket(std::string(1, previous))) return true;
+    return is_operator_character(previous) ? next != '=' : is_operator_character(next);
+}
 
-    for (auto it = tokens_begin; it != tokens_end; ++it) {
-        if (it->first != parser::TokenType::Bracket) continue; // Not a bracket
-        
-        std::string bracket = std::get<std::string>(it->second);
-        if (bracket == "(" || bracket == "[" || bracket == "{") brackets.push(bracket); // An opening bracket
-        else { // A closing bracket
-            if (brackets.empty() || !is_bracket_match(brackets.top(), bracket)) return false; // Not paired
-            brackets.pop();
+} // namespace
+
+types::Expected<types::Numeral> eval::evaluate_stream(std::istream& in, const SymbolTable& symbols,
+    const functions::FunctionRegistry* functions, expr::NumericMode mode, StreamStats* stats) {
+
+    StreamEvaluator evaluator(symbols, functions, mode);
+    std::string buffer;     // The bytes carried over, then the bytes read
+    std::size_t offset = 0; // Position of buffer[0] in the stream
+    std::size_t largest = 0; // Most bytes tokenized at once
+    std::vector<std::size_t> positions;
+    auto done = [&](types::Expected<types::Numeral>&& result) {
+        if (stats) {
+            *stats = evaluator.stats();
+            stats->bytes_ = offset + buffer.size();
+            stats->buffer_ = largest;
+        }
+        return std::move(result);
+    };
+    for (bool end = false; !end; ) {
+        const std::size_t carried = buffer.size();
+        buffer.resize(carried + kStreamBuffer);
+        in.read(&buffer[carried], static_cast<std::streamsize>(kStreamBuffer));
+        buffer.resize(carried + static_cast<std::size_t>(in.gcount()));
+        end = !in;
+
+        // Tokens end at the last cut whatever follows; the carried bytes hold none, but for a cut after the last of them
+        std::size_t cut = buffer.size();
+        if (!end) {
+            const std::size_t first = std::max<std::size_t>(carried, 1);
+            for (cut = buffer.size() - 1; cut >= first && !is_stream_cut(buffer, cut); --cut) {}
+            if (cut < first) continue;
+        }
+        largest = std::max(largest, cut);
+        auto tokens = parser::try_tokenize(buffer.substr(0, cut), &positions);
+        if (!tokens && tokens.error().code_ != types::ErrorCode::EmptyExpression) {
+            types::Error error = tokens.error();
+            error.position_ += offset;
+            return done(std::move(error));
+        }
+        if (tokens) {
+            if (functions) functions->recognize(tokens.value());
+            for (std::size_t i = 0; i < tokens.value().size(); ++i) {
+                if (auto error = evaluator.feed(tokens.value()[i], offset + positions[i])) return done(std::move(*error));
+            }
         }
+        buffer.erase(0, cut);
+        offset += cut;
     }
-    return brackets.empty(); // Empty means all correctly paired, not empty means not correctly paired
+    return done(evaluator.finish());
 }
@@ -0,0 +1,489 @@
+#include "core/functions.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include "core/eval.h"
+
+namespace {
+
+thread_local const types::Numeral* current_arguments = nullptr; // Arguments of the innermost call
+thread_local unsigned call_depth = 0;                           // Calls in progress on this thread
+
+// Makes the arguments of a call visible to the parameters of the body, restoring the caller's on exit
+class CallFrame {
+private:
+    const types::Numeral* saved_;
+
+public:
+    explicit CallFrame(const types::Numeral* arguments) : saved_(current_arguments) {
+        current_arguments = arguments;
+        ++call_depth;
+    }
+    ~CallFrame() {
+        current_arguments = saved_;
+        --call_depth;
+    }
+};
+
+std::uint64_t to_bits(types::Numeral value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+types::Numeral from_bits(std::uint64_t bits) {
+    types::Numeral value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::size_t memo_index(const types::Numeral* arguments, std::size_t count) {
+    std::uint64_t hash = 0x9e3779b97f4a7c15ULL;
+    for (std::size_t i = 0; i < count; ++i) {
+        // Small integers differ only in the high bits, so every argument is fully mixed (MurmurHash3 finalizer)
+        hash ^= to_bits(arguments[i]);
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+    }
+    return static_cast<std::size_t>(hash) & (functions::kMemoEntries - 1);
+}
+
+void skip_spaces(const std::string& str, std::size_t& i) {
+    while (i < str.size() && std::isspace(static_cast<unsigned char>(str[i]))) ++i;
+}
+
+// Scans a symbol at i, empty if there is none
+std::string scan_symbol(const std::string& str, std::size_t& i) {
+    std::size_t begin = i;
+    if (i < str.size() && parser::is_symbol_start(str[i])) {
+        ++i;
+        while (i < str.size() && parser::is_symbol_middle(str[i])) ++i;
+    }
+    return str.substr(begin, i - begin);
+}
+
+// Whether the operand at index of a node is only evaluated under some condition
+bool is_lazy_operand(const expr::ExprNode& node, std::size_t index) {
+    if (dynamic_cast<const expr::ShortCircuitNode*>(&node)) return index == 1;
+    if (dynamic_cast<const expr::ConditionalNode*>(&node)) return index >= 1;
+    return false;
+}
+
+/**
+ * Replaces the parameters of an inlined body by the arguments of the call, moving an argument in at its last use.
+ * The nodes of the body take the position of the call, so that errors point into the caller's expression.
+ */
+void substitute(std::unique_ptr<expr::ExprNode>& node, std::vector<std::unique_ptr<expr::ExprNode>>& arguments,
+    std::vector<unsigned>& uses_left, std::size_t position) {
+
+    if (auto* parameter = dynamic_cast<const functions::ParameterNode*>(node.get())) {
+        std::size_t index = parameter->index();
+        node = --uses_left[index] == 0 ? std::move(arguments[index]) : arguments[index]->clone();
+        return;
+    }
+    node->setPosition(position);
+    for (std::size_t i = 0; i < node->childCount(); ++i) {
+        auto child = node->replaceChild(i, nullptr);
+        substitute(child, arguments, uses_left, position);
+        node->replaceChild(i, std::move(child));
+    }
+}
+
+/**
+ * Inlines the call at the root of a subtree whose arguments are already inlined, true if it did.
+ */
+bool inline_call(std::unique_ptr<expr::ExprNode>& tree) {
+    auto* call = dynamic_cast<functions::CallNode*>(tree.get());
+    if (!call || !call->function().inlinable()) return false;
+
+    // Calls evaluate every argument exactly once; inlining must not change what is evaluated
+    const functions::UserFunction& function = call->function();
+    for (std::size_t i = 0; i < function.arity(); ++i) {
+        if (!call->child(i)->isCheap() && (function.uses(i) != 1 || function.usedLazily(i))) return false;
+    }
+
+    std::size_t position = call->getPosition();
+    auto arguments = call->releaseArguments();
+    std::vector<unsigned> uses_left(function.arity());
+    for (std::size_t i = 0; i < function.arity(); ++i) uses_left[i] = function.uses(i);
+    auto body = function.body().clone();
+    substitute(body, arguments, uses_left, position);
+    tree = std::move(body);
+    return true;
+}
+
+} // namespace
+
+functions::UserFunction::UserFunction(std::string name, std::vector<std::string> parameters, std::string source) :
+    name_(std::move(name)), parameters_(std::move(parameters)), source_(std::move(source)), body_(nullptr),
+    info_{static_cast<int>(parameters_.size()), false, 90, false,
+        [this](std::vector<std::unique_ptr<expr::ExprNode>>&& children) -> std::unique_ptr<expr::ExprNode> {
+            if (children.size() != parameters_.size()) {
+                throw std::runtime_error("Syntax error: " + name_ + " expects " + std::to_string(parameters_.size()) + " arguments");
+            }
+            std::reverse(children.begin(), children.end()); // Source order
+            return std::make_unique<CallNode>(this, std::move(children));
+        }, true},
+    uses_(parameters_.size(), 0), lazy_uses_(parameters_.size(), false) {}
+
+bool functions::UserFunction::memoLookup(const types::Numeral* arguments, types::Numeral& value) const noexcept {
+    const MemoEntry& entry = memo_[memo_index(arguments, parameters_.size())];
+    std::uint64_t seq = entry.seq_.load(std::memory_order_acquire);
+    if (seq == 0 || (seq & 1)) return false; // Empty, or being written
+
+    for (std::size_t i = 0; i < parameters_.size(); ++i) {
+        if (entry.arguments_[i].load(std::memory_order_relaxed) != to_bits(arguments[i])) return false;
+    }
+    std::uint64_t bits = entry.value_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (entry.seq_.load(std::memory_order_relaxed) != seq) return false; // Overwritten meanwhile
+
+    value = from_bits(bits);
+    return true;
+}
+
+void functions::UserFunction::memoStore(const types::Numeral* arguments, types::Numeral value) const noexcept {
+    MemoEntry& entry = memo_[memo_index(arguments, parameters_.size())];
+    std::uint64_t seq = entry.seq_.load(std::memory_order_relaxed);
+    if ((seq & 1) || !entry.seq_.compare_exchange_strong(seq, seq + 1, std::memory_order_relaxed)) return; // Another writer
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (std::size_t i = 0; i < parameters_.size(); ++i) entry.arguments_[i].store(to_bits(arguments[i]), std::memory_order_relaxed);
+    entry.value_.store(to_bits(value), std::memory_order_relaxed);
+    entry.seq_.store(seq + 2, std::memory_order_release);
+}
+
+types::Numeral functions::UserFunction::call(const types::Numeral* arguments, const SymbolTable& symbols,
+    expr::EvalStatus& status, std::size_t position) const noexcept {
+
+    // Once an error is recorded the result is meaningless, and a recursion failing deep down would otherwise
+    // evaluate every remaining call of the recursion tree
+    if (!status.ok()) return std::numeric_limits<types::Numeral>::quiet_NaN();
+    if (call_depth >= kMaxCallDepth) {
+        if (status.ok()) {
+            status.fail(types::ErrorCode::CallDepth, position);
+            status.symbol_ = &name_;
+        }
+        return std::numeric_limits<types::Numeral>::quiet_NaN();
+    }
+
+    types::Numeral value;
+    if (memo_ && memoLookup(arguments, value)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return value;
+    }
+
+    bool was_ok = status.ok();
+    {
+        CallFrame frame(arguments);
+        value = body_->evaluateChecked(symbols, status);
+    }
+    if (was_ok && !status.ok()) status.position_ = position; // Positions in the body are meaningless to the caller
+
+    if (memo_) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        // Only plain values are kept, so that an IEEE-mode infinity never answers a strict-mode call
+        if (status.ok() && std::isfinite(value)) memoStore(arguments, value);
+    }
+    return value;
+}
+
+types::Numeral functions::UserFunction::callAt(const types::Numeral* arguments, const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+
+    if (call_depth >= kMaxCallDepth) {
+        throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::CallDepth, 0, name_}));
+    }
+    CallFrame frame(arguments);
+    return body_->evaluateAt(symbols, variables);
+}
+
+expr::Dual functions::UserFunction::callDual(const expr::Dual* arguments, const SymbolTable& symbols,
+    expr::ForwardContext& context) const {
+
+    if (context.depth_ >= kMaxCallDepth) {
+        throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::CallDepth, 0, name_}));
+    }
+    const expr::Dual* saved = context.arguments_;
+    context.arguments_ = arguments;
+    ++context.depth_;
+    expr::Dual result = body_->evaluateDual(symbols, context);
+    --context.depth_;
+    context.arguments_ = saved;
+    return result;
+}
+
+expr::TapeValue functions::UserFunction::record(const expr::TapeValue* arguments, const SymbolTable& symbols,
+    expr::Tape& tape) const {
+
+    if (tape.depth_ >= kMaxCallDepth) {
+        throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::CallDepth, 0, name_}));
+    }
+    const expr::TapeValue* saved = tape.arguments_;
+    tape.arguments_ = arguments;
+    ++tape.depth_;
+    expr::TapeValue result = body_->record(symbols, tape);
+    --tape.depth_;
+    tape.arguments_ = saved;
+    return result;
+}
+
+functions::MemoStats functions::UserFunction::memoStats() const noexcept {
+    return MemoStats{name_, hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed)};
+}
+
+functions::CallNode::CallNode(const UserFunction* function, std::vector<std::unique_ptr<expr::ExprNode>>&& arguments) :
+    MultinaryNode(std::move(arguments)), function_(function) {}
+
+types::Numeral functions::CallNode::evaluate(const SymbolTable& symbols) const {
+    expr::EvalStatus status;
+    types::Numeral value = evaluateChecked(symbols, status);
+    if (!status.ok()) {
+        throw std::runtime_error(types::error_message(
+            types::Error{status.code_, status.position_, status.symbol_ ? *status.symbol_ : std::string()}));
+    }
+    return value;
+}
+
+types::Numeral functions::CallNode::evaluateAt(const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+
+    std::array<types::Numeral, kMaxParameters> arguments;
+    for (std::size_t i = 0; i < children_.size(); ++i) arguments[i] = children_[i]->evaluateAt(symbols, variables);
+    return function_->callAt(arguments.data(), symbols, variables);
+}
+
+types::Numeral functions::CallNode::evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept {
+    std::array<types::Numeral, kMaxParameters> arguments;
+    for (std::size_t i = 0; i < children_.size(); ++i) arguments[i] = children_[i]->evaluateChecked(symbols, status);
+    return function_->call(arguments.data(), symbols, status, position_);
+}
+
+expr::Dual functions::CallNode::evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const {
+    std::array<expr::Dual, kMaxParameters> arguments;
+    for (std::size_t i = 0; i < children_.size(); ++i) arguments[i] = children_[i]->evaluateDual(symbols, context);
+    return function_->callDual(arguments.data(), symbols, context);
+}
+
+expr::TapeValue functions::CallNode::record(const SymbolTable& symbols, expr::Tape& tape) const {
+    std::array<expr::TapeValue, kMaxParameters> arguments;
+    for (std::size_t i = 0; i < children_.size(); ++i) arguments[i] = children_[i]->record(symbols, tape);
+    return function_->record(arguments.data(), symbols, tape);
+}
+
+std::unique_ptr<expr::ExprNode> functions::CallNode::clone() const {
+    return positioned(std::make_unique<CallNode>(function_, cloneChildren()));
+}
+
+types::Numeral functions::ParameterNode::evaluate(const SymbolTable& symbols) const {
+    if (!current_arguments) throw std::runtime_error("Internal error: Parameter evaluated outside of a call");
+    return current_arguments[index_];
+}
+
+types::Numeral functions::ParameterNode::evaluateAt(const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+    return evaluate(symbols);
+}
+
+types::Numeral functions::ParameterNode::evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept {
+    return current_arguments ? current_arguments[index_] : std::numeric_limits<types::Numeral>::quiet_NaN();
+}
+
+expr::Dual functions::ParameterNode::evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const {
+    if (!context.arguments_) throw std::runtime_error("Internal error: Parameter evaluated outside of a call");
+    return context.arguments_[index_];
+}
+
+expr::TapeValue functions::ParameterNode::record(const SymbolTable& symbols, expr::Tape& tape) const {
+    if (!tape.arguments_) throw std::runtime_error("Internal error: Parameter evaluated outside of a call");
+    return tape.arguments_[index_];
+}
+
+std::unique_ptr<expr::ExprNode> functions::ParameterNode::clone() const {
+    return positioned(std::make_unique<ParameterNode>(index_));
+}
+
+types::Expected<const functions::UserFunction*> functions::FunctionRegistry::define(const std::string& definition) {
+    // Parse the head, name(p1, p2, ...) =
+    std::size_t i = 0;
+    skip_spaces(definition, i);
+    std::size_t name_position = i;
+    std::string name = scan_symbol(definition, i);
+    if (name.empty()) return types::Error{types::ErrorCode::InvalidDefinition, name_position};
+    if (expr::contains(name)) return types::Error{types::ErrorCode::InvalidDefinition, name_position, name}; // A built-in
+
+    skip_spaces(definition, i);
+    if (i == definition.size() || definition[i] != '(') return types::Error{types::ErrorCode::InvalidDefinition, i};
+    ++i;
+    std::vector<std::string> parameters;
+    while (true) {
+        skip_spaces(definition, i);
+        std::size_t parameter_position = i;
+        std::string parameter = scan_symbol(definition, i);
+        if (parameter.empty()) return types::Error{types::ErrorCode::InvalidDefinition, parameter_position};
+        if (expr::contains(parameter) || std::find(parameters.begin(), parameters.end(), parameter) != parameters.end()
+            || parameters.size() == kMaxParameters) {
+            return types::Error{types::ErrorCode::InvalidDefinition, parameter_position, parameter};
+        }
+        parameters.push_back(std::move(parameter));
+
+        skip_spaces(definition, i);
+        if (i < definition.size() && definition[i] == ',') ++i;
+        else if (i < definition.size() && definition[i] == ')') break;
+        else return types::Error{types::ErrorCode::InvalidDefinition, i};
+    }
+    ++i;
+    skip_spaces(definition, i);
+    if (i == definition.size() || definition[i] != '=') return types::Error{types::ErrorCode::InvalidDefinition, i};
+    std::size_t body_begin = i + 1;
+
+    // Tokenize the body, positions relative to the definition
+    std::vector<std::size_t> positions;
+    auto tokens = parser::try_tokenize(definition.substr(body_begin), &positions);
+    if (!tokens) {
+        types::Error error = tokens.error();
+        error.position_ += body_begin;
+        return error;
+    }
+    for (auto& position : positions) position += body_begin;
+
+    // Register before parsing the body, so that the body may call the function itself
+    UserFunction& function = functions_.emplace_back(name, parameters, definition);
+    UserFunction*& registered = by_name_[name];
+    UserFunction* previous = registered;
+    registered = &function;
+
+    for (auto& [token_type, token_content] : tokens.value()) { // Parameters shadow functions
+        if (token_type != parser::TokenType::Symbol) continue;
+        const auto& symbol = std::get<std::string>(token_content);
+        if (find(symbol) && std::find(parameters.begin(), parameters.end(), symbol) == parameters.end()) {
+            token_type = parser::TokenType::Operator;
+        }
+    }
+    auto tree = eval::try_build_expr_tree(tokens.value().begin(), tokens.value().end(), positions.data(), this, &definition);
+    if (!tree) {
+        if (previous) by_name_[name] = previous;
+        else by_name_.erase(name);
+        functions_.pop_back();
+        return tree.error();
+    }
+
+    // Bind the parameters and classify the body
+    std::unique_ptr<expr::ExprNode> body = std::move(tree).value();
+    auto analyze = [&function](auto& self, std::unique_ptr<expr::ExprNode>& node, bool lazy) -> void {
+        ++function.body_nodes_;
+        if (auto* symbol = dynamic_cast<const expr::SymbolNode*>(node.get())) {
+            auto found = std::find(function.parameters_.begin(), function.parameters_.end(), symbol->getSymbolName());
+            if (found == function.parameters_.end()) function.pure_ = false; // A free symbol
+            else {
+                auto index = static_cast<std::size_t>(found - function.parameters_.begin());
+                std::size_t position = node->getPosition();
+                node = std::make_unique<ParameterNode>(index);
+                node->setPosition(position);
+                ++function.uses_[index];
+                if (lazy) function.lazy_uses_[index] = true;
+            }
+            return;
+        }
+        if (auto* call = dynamic_cast<const CallNode*>(node.get())) {
+            if (&call->function() == &function) function.recursive_ = true;
+            else if (!call->function().pure()) function.pure_ = false;
+        }
+        for (std::size_t i = 0; i < node->childCount(); ++i) {
+            auto child = node->replaceChild(i, nullptr);
+            self(self, child, lazy || is_lazy_operand(*node, i));
+            node->replaceChild(i, std::move(child));
+        }
+    };
+    analyze(analyze, body, false);
+    function.body_ = std::move(body);
+
+    // Memoize the calls worth more than a lookup
+    if (function.pure_ && function.arity() <= kMaxMemoParameters && (function.recursive_ || function.body_nodes_ > kInlineNodes)) {
+        function.memo_ = std::make_unique<UserFunction::MemoEntry[]>(kMemoEntries);
+    }
+    return static_cast<const UserFunction*>(&function);
+}
+
+const functions::UserFunction* functions::FunctionRegistry::find(const std::string& name) const noexcept {
+    auto it = by_name_.find(name);
+    return it == by_name_.end() ? nullptr : it->second;
+}
+
+const expr::OperatorInfo* functions::FunctionRegistry::find_operator(const std::string& name) const noexcept {
+    const UserFunction* function = find(name);
+    return function ? &function->info() : nullptr;
+}
+
+void functions::FunctionRegistry::recognize(std::vector<parser::Token>& tokens) const {
+    if (by_name_.empty()) return;
+    for (auto& [token_type, token_content] : tokens) {
+        if (token_type == parser::TokenType::Symbol && find(std::get<std::string>(token_content))) {
+            token_type = parser::TokenType::Operator;
+        }
+    }
+}
+
+std::vector<functions::MemoStats> functions::FunctionRegistry::memo_stats() const {
+    std::vector<MemoStats> stats;
+    for (const auto& function : functions_) {
+        if (function.memoized()) stats.push_back(function.memoStats());
+    }
+    return stats;
+}
+
+void functions::FunctionRegistry::write_memo_stats(std::ostream& out) const {
+    char buf[160];
+    for (const auto& stats : memo_stats()) {
+        std::snprintf(buf, sizeof(buf), "memo %-16s %12llu hits %12llu misses %7.2f%% hit rate\n", stats.name_.c_str(),
+            static_cast<unsigned long long>(stats.hits_), static_cast<unsigned long long>(stats.misses_), 100 * stats.hit_rate());
+        out << buf;
+    }
+    out << std::flush;
+}
+
+bool functions::is_definition(const std::string& line) {
+    std::size_t i = 0;
+    skip_spaces(line, i);
+    if (scan_symbol(line, i).empty()) return false;
+    skip_spaces(line, i);
+    if (i == line.size() || line[i] != '(') return false;
+
+    i = line.find(')', i);
+    if (i == std::string::npos) return false;
+    ++i;
+    skip_spaces(line, i);
+    return i < line.size() && line[i] == '=' && (i + 1 == line.size() || line[i + 1] != '='); // Not f(x) == y
+}
+
+std::size_t functions::inline_calls(std::unique_ptr<expr::ExprNode>& tree) {
+    // Arguments first, so that nested calls inline too, walked on a stack of their own so that long chains of
+    // operators take no call stack: each subtree is taken out of its parent while visited, and put back inlined
+    struct Frame {
+        std::unique_ptr<expr::ExprNode> node_;
+        std::size_t next_; // The next child to visit
+    };
+    std::vector<Frame> stack;
+    stack.push_back({std::move(tree), 0});
+    std::size_t inlined = 0;
+    while (true) {
+        Frame& top = stack.back();
+        if (top.next_ < top.node_->childCount()) {
+            auto child = top.node_->replaceChild(top.next_++, nullptr);
+            stack.push_back({std::move(child), 0});
+            continue;
+        }
+        auto node = std::move(top.node_);
+        stack.pop_back();
+        if (inline_call(node)) ++inlined;
+        if (stack.empty()) {
+            tree = std::move(node);
+            return inlined;
+        }
+        stack.back().node_->replaceChild(stack.back().next_ - 1, std::move(node));
+    }
+}
@@ -0,0 +1,209 @@
+#include "core/fusion_pass.h"
+#include <cmath>
+#include "functional/elementary.h"
+
+namespace {
+
+#if defined(__GNUC__) && defined(__x86_64__)
+// FmaNode with the instruction inlined, for CPUs with FMA (see elementary::has_avx2)
+class HardwareFmaNode final : public fusion::FmaNode {
+public:
+    using FmaNode::FmaNode;
+
+    __attribute__((target("fma"))) virtual types::Numeral evaluate(const SymbolTable& symbols) const override {
+        types::Numeral first = children_[0]->evaluate(symbols);
+        types::Numeral second = children_[1]->evaluate(symbols);
+        types::Numeral a, b, c;
+        arrange(first, second, children_[2]->evaluate(symbols), a, b, c);
+        return __builtin_fma(a, b, c);
+    }
+
+    __attribute__((target("fma"))) virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override {
+        types::Numeral first = children_[0]->evaluateAt(symbols, variables);
+        types::Numeral second = children_[1]->evaluateAt(symbols, variables);
+        types::Numeral a, b, c;
+        arrange(first, second, children_[2]->evaluateAt(symbols, variables), a, b, c);
+        return __builtin_fma(a, b, c);
+    }
+
+    __attribute__((target("fma"))) virtual types::Numeral evaluateChecked(const SymbolTable& symbols,
+        expr::EvalStatus& status) const noexcept override {
+        types::Numeral first = children_[0]->evaluateChecked(symbols, status);
+        types::Numeral second = children_[1]->evaluateChecked(symbols, status);
+        types::Numeral a, b, c;
+        arrange(first, second, children_[2]->evaluateChecked(symbols, status), a, b, c);
+        return __builtin_fma(a, b, c);
+    }
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override {
+        return positioned(std::make_unique<HardwareFmaNode>(cloneChildren(), addend_first_, product_sign_ < 0, addend_sign_ < 0));
+    }
+};
+#endif
+
+std::unique_ptr<expr::ExprNode> make_fma(std::vector<std::unique_ptr<expr::ExprNode>>&& children, bool addend_first,
+    bool negate_product, bool negate_addend) {
+#if defined(__GNUC__) && defined(__x86_64__)
+    if (elementary::has_avx2()) return std::make_unique<HardwareFmaNode>(std::move(children), addend_first, negate_product, negate_addend);
+#endif
+    return std::make_unique<fusion::FmaNode>(std::move(children), addend_first, negate_product, negate_addend);
+}
+
+// Whether 1/value is exact
+bool has_exact_reciprocal(types::Numeral value) {
+    if (value == 0 || !std::isfinite(value) || !std::isfinite(1 / value)) return false;
+    int exponent;
+    return std::fabs(std::frexp(value, &exponent)) == 0.5;
+}
+
+const expr::NumeralNode* as_numeral(const expr::ExprNode* node) { return dynamic_cast<const expr::NumeralNode*>(node); }
+
+const expr::SymbolNode* as_symbol(const expr::ExprNode* node) { return dynamic_cast<const expr::SymbolNode*>(node); }
+
+// The children of a binary node, taken out
+std::pair<std::unique_ptr<expr::ExprNode>, std::unique_ptr<expr::ExprNode>> release(expr::ExprNode& node) {
+    auto first = node.replaceChild(0, nullptr);
+    return {std::move(first), node.replaceChild(1, nullptr)};
+}
+
+// A symbol with a constant, in either order, into a leaf; returns false if the operands are not a symbol and a constant
+template <fusion::SymbolOperation Op>
+bool fuse_symbol(std::unique_ptr<expr::ExprNode>& node, bool negate_constant, bool commutative) {
+    const expr::SymbolNode* symbol = as_symbol(node->child(0));
+    const expr::NumeralNode* constant = as_numeral(node->child(1));
+    if (commutative && !symbol) {
+        symbol = as_symbol(node->child(1));
+        constant = as_numeral(node->child(0));
+    }
+    if (!symbol || !constant) return false;
+    types::Numeral value = constant->evaluate(SymbolTable());
+    auto leaf = std::make_unique<fusion::SymbolConstantNode<Op>>(symbol->getSymbolName(), negate_constant ? -value : value,
+        symbol->getPosition());
+    leaf->setPosition(node->getPosition());
+    node = std::move(leaf);
+    return true;
+}
+
+// Division by a constant, into multiplication by its reciprocal
+void fuse_reciprocal(std::unique_ptr<expr::ExprNode>& node, bool inexact_reciprocals, fusion::FusionCounts& counts) {
+    if (!dynamic_cast<const expr::DivisionNode*>(node.get())) return;
+    const expr::NumeralNode* divisor = as_numeral(node->child(1));
+    if (!divisor) return;
+    types::Numeral value = divisor->evaluate(SymbolTable());
+    if (!has_exact_reciprocal(value) && !(inexact_reciprocals && value != 0 && std::isfinite(value) && std::isfinite(1 / value))) return;
+    const std::size_t position = node->getPosition();
+    auto [dividend, constant] = release(*node);
+    auto reciprocal = std::make_unique<expr::NumeralNode>(1 / value);
+    reciprocal->setPosition(constant->getPosition());
+    node = std::make_unique<expr::MultiplicationNode>(std::move(reciprocal), std::move(dividend)); // Left is the second operand
+    node->setPosition(position);
+    ++counts.reciprocals_;
+}
+
+void fuse(std::unique_ptr<expr::ExprNode>& node, bool inexact_reciprocals, fusion::FusionCounts& counts) {
+    const std::size_t position = node->getPosition();
+    fuse_reciprocal(node, inexact_reciprocals, counts);
+
+    const bool addition = dynamic_cast<const expr::AdditionNode*>(node.get()) != nullptr;
+    const bool subtraction = dynamic_cast<const expr::SubtractionNode*>(node.get()) != nullptr;
+    if (addition || subtraction) { // A product plus or minus an addend, the first operand taken if both are products
+        for (std::size_t p = 0; p < 2; ++p) {
+            auto child = node->replaceChild(p, nullptr);
+            fuse_reciprocal(child, inexact_reciprocals, counts);
+            node->replaceChild(p, std::move(child));
+        }
+        for (std::size_t p = 0; p < 2; ++p) {
+            if (!dynamic_cast<const expr::MultiplicationNode*>(node->child(p))) continue;
+            auto [first, second] = release(*node);
+            auto& product = p == 0 ? first : second;
+            auto [a, b] = release(*product);
+            std::vector<std::unique_ptr<expr::ExprNode>> children;
+            if (p == 1) children.push_back(std::move(first));
+            children.push_back(std::move(a));
+            children.push_back(std::move(b));
+            if (p == 0) children.push_back(std::move(second));
+            node = make_fma(std::move(children), p == 1, subtraction && p == 1, subtraction && p == 0);
+            node->setPosition(position);
+            ++counts.fma_;
+            break;
+        }
+        // Otherwise x + k, k + x or x - k, but not k - x
+        if (!dynamic_cast<const fusion::FmaNode*>(node.get()) && fuse_symbol<fusion::SymbolOperation::Add>(node, subtraction, addition)) {
+            ++counts.shifted_;
+        }
+    }
+    else if (dynamic_cast<const expr::MultiplicationNode*>(node.get())) {
+        if (fuse_symbol<fusion::SymbolOperation::Multiply>(node, false, true)) ++counts.scaled_;
+    }
+
+    for (std::size_t i = 0; i < node->childCount(); ++i) {
+        auto child = node->replaceChild(i, nullptr);
+        fuse(child, inexact_reciprocals, counts);
+        node->replaceChild(i, std::move(child));
+    }
+}
+
+} // namespace
+
+fusion::FmaNode::FmaNode(std::vector<std::unique_ptr<expr::ExprNode>>&& children, bool addend_first, bool negate_product,
+    bool negate_addend) :
+    MultinaryNode(std::move(children)), addend_first_(addend_first), product_sign_(negate_product ? -1 : 1),
+    addend_sign_(negate_addend ? -1 : 1) {}
+
+types::Numeral fusion::FmaNode::evaluate(const SymbolTable& symbols) const {
+    types::Numeral first = children_[0]->evaluate(symbols);
+    types::Numeral second = children_[1]->evaluate(symbols);
+    types::Numeral a, b, c;
+    arrange(first, second, children_[2]->evaluate(symbols), a, b, c);
+    return std::fma(a, b, c);
+}
+
+types::Numeral fusion::FmaNode::evaluateAt(const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+    types::Numeral first = children_[0]->evaluateAt(symbols, variables);
+    types::Numeral second = children_[1]->evaluateAt(symbols, variables);
+    types::Numeral a, b, c;
+    arrange(first, second, children_[2]->evaluateAt(symbols, variables), a, b, c);
+    return std::fma(a, b, c);
+}
+
+types::Numeral fusion::FmaNode::evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept {
+    types::Numeral first = children_[0]->evaluateChecked(symbols, status);
+    types::Numeral second = children_[1]->evaluateChecked(symbols, status);
+    types::Numeral a, b, c;
+    arrange(first, second, children_[2]->evaluateChecked(symbols, status), a, b, c);
+    return std::fma(a, b, c);
+}
+
+expr::Dual fusion::FmaNode::evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const {
+    expr::Dual first = children_[0]->evaluateDual(symbols, context);
+    expr::Dual second = children_[1]->evaluateDual(symbols, context);
+    expr::Dual third = children_[2]->evaluateDual(symbols, context);
+    types::Numeral a, b, c, da, db, dc;
+    arrange(first.value_, second.value_, third.value_, a, b, c);
+    arrange(first.tangent_, second.tangent_, third.tangent_, da, db, dc);
+    return expr::Dual{std::fma(a, b, c), da * b + a * db + dc};
+}
+
+expr::TapeValue fusion::FmaNode::record(const SymbolTable& symbols, expr::Tape& tape) const {
+    expr::TapeValue recorded[3];
+    for (std::size_t i = 0; i < 3; ++i) recorded[i] = children_[i]->record(symbols, tape);
+    const expr::TapeValue& x = recorded[addend_first_ ? 1 : 0];
+    const expr::TapeValue& y = recorded[addend_first_ ? 2 : 1];
+    const expr::TapeValue& z = recorded[addend_first_ ? 0 : 2];
+    types::Numeral a, b, c;
+    arrange(recorded[0].value_, recorded[1].value_, recorded[2].value_, a, b, c);
+    expr::TapeValue product = tape.binary(x.value_ * y.value_, x, y.value_, y, x.value_);
+    return tape.binary(std::fma(a, b, c), product, product_sign_, z, addend_sign_);
+}
+
+std::unique_ptr<expr::ExprNode> fusion::FmaNode::clone() const {
+    return positioned(std::make_unique<FmaNode>(cloneChildren(), addend_first_, product_sign_ < 0, addend_sign_ < 0));
+}
+
+fusion::FusionCounts fusion::fuse_operations(std::unique_ptr<expr::ExprNode>& tree, FusionMode mode) {
+    FusionCounts counts;
+    if (mode != FusionMode::Off) fuse(tree, mode == FusionMode::Fast, counts);
+    return counts;
+}
@@ -0,0 +1,77 @@
+#include "core/grad.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include "core/parser.h"
+
+grad::Gradient grad::reverse(const expr::ExprNode& tree, const SymbolTable& symbols,
+    const std::vector<types::Symbol>& variables, expr::Tape* tape) {
+
+    expr::Tape local_tape;
+    if (!tape) tape = &local_tape;
+    tape->clear();
+
+    expr::TapeValue result = tree.record(symbols, *tape);
+    auto partials = tape->gradient(result);
+
+    Gradient gradient{result.value_, std::vector<types::Numeral>(variables.size(), 0)};
+    for (std::size_t i = 0; i < variables.size(); ++i) {
+        auto it = partials.find(variables[i]);
+        if (it != partials.end()) gradient.partials_[i] = it->second; // Otherwise the result does not depend on it
+    }
+    return gradient;
+}
+
+grad::Gradient grad::forward(const expr::ExprNode& tree, const SymbolTable& symbols, const std::vector<types::Symbol>& variables) {
+    Gradient gradient;
+    if (variables.empty()) {
+        gradient.value_ = tree.evaluate(symbols);
+        return gradient;
+    }
+    gradient.partials_.reserve(variables.size());
+    for (const auto& variable : variables) {
+        expr::ForwardContext context;
+        context.variable_ = variable;
+        expr::Dual result = tree.evaluateDual(symbols, context);
+        gradient.value_ = result.value_;
+        gradient.partials_.push_back(result.tangent_);
+    }
+    return gradient;
+}
+
+grad::Gradient grad::gradient(const expr::ExprNode& tree, const SymbolTable& symbols, const std::vector<types::Symbol>& variables) {
+    // A dual pass costs about one evaluation, a recorded one a few, so forward mode wins for few variables
+    if (variables.size() <= kForwardVariables) return forward(tree, symbols, variables);
+    return reverse(tree, symbols, variables);
+}
+
+std::vector<types::Symbol> grad::parse_point(const std::string& point, SymbolTable& symbols) {
+    std::vector<types::Symbol> variables;
+    std::size_t begin = 0;
+    while (begin <= point.size()) {
+        std::size_t end = point.find(',', begin);
+        if (end == std::string::npos) end = point.size();
+        std::string coordinate = point.substr(begin, end - begin);
+
+        std::size_t equals = coordinate.find('=');
+        std::string name = coordinate.substr(0, equals);
+        bool valid = equals != std::string::npos && !name.empty() && parser::is_symbol_start(name[0]);
+        for (char ch : name) valid = valid && parser::is_symbol_middle(ch);
+        types::Numeral value = 0;
+        if (valid) {
+            const char* first = coordinate.data() + equals + 1;
+            const char* last = coordinate.data() + coordinate.size();
+            auto [parsed_end, ec] = std::from_chars(first, last, value);
+            valid = ec == std::errc() && parsed_end == last;
+        }
+        if (!valid) throw std::invalid_argument("Invalid command line argument: '" + coordinate + "' is not of the form name=value");
+        if (std::find(variables.begin(), variables.end(), name) != variables.end()) {
+            throw std::invalid_argument("Invalid command line argument: Symbol '" + name + "' has two values");
+        }
+
+        symbols.insert_or_assign(name, value);
+        variables.push_back(std::move(name));
+        begin = end + 1;
+    }
+    return variables;
+}
@@ -0,0 +1,217 @@
+#include "core/incremental.h"
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include "core/functions.h"
+#include "core/grad.h"
+#include "core/parser.h"
+
+namespace {
+
+using Slot = incremental::Evaluator::Slot;
+
+// A subtree of the tree in the residual, evaluated once and then read from its slot
+class CachedNode : public expr::ExprNode {
+private:
+    const expr::ExprNode* subtree_;
+    Slot* slot_;
+
+public:
+    CachedNode(const expr::ExprNode* subtree, Slot* slot) : ExprNode(), subtree_(subtree), slot_(slot) {
+        position_ = subtree->getPosition();
+    }
+
+    virtual types::Numeral evaluate(const SymbolTable& symbols) const override final {
+        if (slot_->state_ == Slot::State::Strict) return slot_->value_;
+        types::Numeral value = subtree_->evaluate(symbols); // The throwing path fails on every numerical error
+        *slot_ = Slot{value, Slot::State::Strict};
+        return value;
+    }
+
+    virtual types::Numeral evaluateAt(const SymbolTable& symbols,
+        const std::unordered_map<types::Symbol, types::Numeral>& variables) const override final {
+        return subtree_->evaluateAt(symbols, variables); // The variables may differ from the cached values
+    }
+
+    virtual types::Numeral evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept override final {
+        const bool ieee = status.mode_ == expr::NumericMode::IEEE;
+        if (slot_->state_ == Slot::State::Strict || (ieee && slot_->state_ == Slot::State::IEEE)) return slot_->value_;
+        const bool ok = status.ok();
+        types::Numeral value = subtree_->evaluateChecked(symbols, status);
+        if (ok && status.ok()) *slot_ = Slot{value, ieee ? Slot::State::IEEE : Slot::State::Strict};
+        return value;
+    }
+
+    virtual bool isCheap() const noexcept override final { return subtree_->isCheap(); }
+
+    virtual expr::Dual evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const override final {
+        return subtree_->evaluateDual(symbols, context);
+    }
+
+    virtual expr::TapeValue record(const SymbolTable& symbols, expr::Tape& tape) const override final {
+        return subtree_->record(symbols, tape);
+    }
+
+    virtual std::unique_ptr<expr::ExprNode> clone() const override final { return subtree_->clone(); }
+};
+
+} // namespace
+
+incremental::Evaluator::Evaluator(const expr::ExprNode& tree, const SymbolTable& symbols) : symbols_(symbols) {
+    // Preorder, so the subtree of a node is the range up to its end
+    struct Pending {
+        const expr::ExprNode* node_;
+        std::size_t index_;       // In nodes_
+        std::size_t visited_ = 0; // Children visited
+    };
+    std::vector<Pending> pending{{&tree, 0}};
+    nodes_.push_back(&tree);
+    subtree_ends_.push_back(0);
+    while (!pending.empty()) {
+        Pending& top = pending.back();
+        if (top.visited_ == top.node_->childCount()) {
+            subtree_ends_[top.index_] = nodes_.size();
+            pending.pop_back();
+            continue;
+        }
+        const expr::ExprNode* child = top.node_->child(top.visited_++);
+        pending.push_back({child, nodes_.size()});
+        nodes_.push_back(child);
+        subtree_ends_.push_back(0);
+    }
+    for (const expr::ExprNode* node : nodes_) {
+        if (const auto* symbol = dynamic_cast<const expr::SymbolNode*>(node)) {
+            symbol_indices_.emplace(symbol->getSymbolName(), symbol_indices_.size());
+        }
+    }
+
+    // The symbol sets, children first
+    words_ = std::max<std::size_t>(1, (symbol_indices_.size() + 63) / 64);
+    dependencies_.assign(nodes_.size() * words_, 0);
+    impure_.assign(nodes_.size(), false);
+    for (std::size_t i = nodes_.size(); i-- > 0; ) {
+        std::uint64_t* set = &dependencies_[i * words_];
+        const auto* call = dynamic_cast<const functions::CallNode*>(nodes_[i]);
+        if (call && !call->function().pure()) impure_[i] = true;
+        if (const auto* symbol = dynamic_cast<const expr::SymbolNode*>(nodes_[i])) {
+            std::size_t bit = symbol_indices_.at(symbol->getSymbolName());
+            set[bit / 64] |= std::uint64_t(1) << (bit % 64);
+        }
+        for (std::size_t child = i + 1; child < subtree_ends_[i]; child = subtree_ends_[child]) {
+            for (std::size_t w = 0; w < words_; ++w) set[w] |= dependencies_[child * words_ + w];
+            if (impure_[child]) impure_[i] = true;
+        }
+    }
+    slots_ = std::make_unique<Slot[]>(nodes_.size());
+    changing_.assign(words_, 0);
+    changed_.assign(words_, 0);
+}
+
+bool incremental::Evaluator::meets(std::size_t node, const std::vector<std::uint64_t>& set) const noexcept {
+    if (impure_[node]) return true;
+    for (std::size_t w = 0; w < words_; ++w) {
+        if (dependencies_[node * words_ + w] & set[w]) return true;
+    }
+    return false;
+}
+
+void incremental::Evaluator::prune(expr::ExprNode& copy, std::size_t node) {
+    ++residual_nodes_;
+    std::size_t k = 0;
+    for (std::size_t child = node + 1; child < subtree_ends_[node]; child = subtree_ends_[child], ++k) {
+        if (!meets(child, changing_)) copy.replaceChild(k, std::make_unique<CachedNode>(nodes_[child], &slots_[child]));
+        else { // Taken out to be pruned in turn, so the tree is copied once
+            auto owned = copy.replaceChild(k, std::make_unique<expr::NumeralNode>());
+            prune(*owned, child);
+            copy.replaceChild(k, std::move(owned));
+        }
+    }
+}
+
+void incremental::Evaluator::prepare() {
+    bool within = residual_ != nullptr;
+    for (std::size_t w = 0; w < words_; ++w) within = within && (changed_[w] & ~changing_[w]) == 0;
+    if (!within) {
+        // The residual kept the values below its changing symbols stale, and the new symbols make more stale
+        for (std::size_t w = 0; w < words_; ++w) changing_[w] |= changed_[w];
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (meets(i, changing_)) slots_[i].state_ = Slot::State::Empty;
+        }
+        changing_ = changed_;
+        residual_nodes_ = 0;
+        if (meets(0, changing_)) {
+            residual_ = nodes_[0]->clone();
+            prune(*residual_, 0);
+        }
+        else residual_ = std::make_unique<CachedNode>(nodes_[0], &slots_[0]);
+    }
+    std::fill(changed_.begin(), changed_.end(), 0);
+}
+
+void incremental::Evaluator::set(const types::Symbol& symbol, types::Numeral value) {
+    symbols_.insert_or_assign(symbol, value);
+    auto it = symbol_indices_.find(symbol);
+    if (it != symbol_indices_.end()) changed_[it->second / 64] |= std::uint64_t(1) << (it->second % 64);
+}
+
+types::Numeral incremental::Evaluator::evaluate() {
+    prepare();
+    return residual_->evaluate(symbols_);
+}
+
+types::Expected<types::Numeral> incremental::Evaluator::try_evaluate(expr::NumericMode mode) {
+    prepare();
+    expr::EvalStatus status;
+    status.mode_ = mode;
+    types::Numeral value = residual_->evaluateChecked(symbols_, status);
+    if (status.ok()) return value;
+    return types::Error{status.code_, status.position_, status.symbol_ ? *status.symbol_ : std::string()};
+}
+
+std::vector<types::Expected<types::Numeral>> incremental::Evaluator::sweep(const types::Symbol& symbol, types::Numeral first,
+    types::Numeral last, std::size_t steps, expr::NumericMode mode) {
+
+    std::vector<types::Expected<types::Numeral>> results;
+    results.reserve(steps);
+    for (std::size_t i = 0; i < steps; ++i) {
+        set(symbol, sweep_point(first, last, steps, i));
+        results.push_back(try_evaluate(mode));
+    }
+    return results;
+}
+
+types::Numeral incremental::sweep_point(types::Numeral first, types::Numeral last, std::size_t steps, std::size_t i) noexcept {
+    if (i == 0) return first;
+    if (i + 1 == steps) return last;
+    return first + (last - first) * (static_cast<types::Numeral>(i) / static_cast<types::Numeral>(steps - 1));
+}
+
+incremental::Sweep incremental::parse_sweep(const std::string& text, SymbolTable& symbols) {
+    auto malformed = [&text]() {
+        return std::invalid_argument("Invalid command line argument: '" + text + "' is not of the form name=first:last:steps");
+    };
+    std::size_t comma = std::min(text.find(','), text.size());
+    std::string range = text.substr(0, comma);
+    std::size_t equals = range.find('=');
+    Sweep sweep;
+    sweep.symbol_ = range.substr(0, std::min(equals, range.size()));
+    bool valid = equals != std::string::npos && !sweep.symbol_.empty() && parser::is_symbol_start(sweep.symbol_[0]);
+    for (char ch : sweep.symbol_) valid = valid && parser::is_symbol_middle(ch);
+    if (!valid) throw malformed();
+
+    const char* p = range.data() + equals + 1;
+    const char* end = range.data() + range.size();
+    auto [first_end, first_ec] = std::from_chars(p, end, sweep.first_);
+    if (first_ec != std::errc() || first_end == end || *first_end != ':') throw malformed();
+    auto [last_end, last_ec] = std::from_chars(first_end + 1, end, sweep.last_);
+    if (last_ec != std::errc() || last_end == end || *last_end != ':') throw malformed();
+    auto [steps_end, steps_ec] = std::from_chars(last_end + 1, end, sweep.steps_);
+    if (steps_ec != std::errc() || steps_end != end || sweep.steps_ == 0) throw malformed();
+
+    if (comma < text.size()) {
+        for (const auto& symbol : grad::parse_point(text.substr(comma + 1), symbols)) {
+            if (symbol == sweep.symbol_) throw std::invalid_argument("Invalid command line argument: Symbol '" + symbol + "' has two values");
+        }
+    }
+    return sweep;
+}
@@ -0,0 +1,440 @@
+#include "core/matrix_eval.h"
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include "core/parser.h"
+#include "functional/elementary.h"
+#include "functional/linalg.h"
+
+namespace {
+
+using dispatcher::Result;
+
+// Rows and columns of a value; a scalar is 1 x 1 and a vector of n elements 1 x n
+struct Shape {
+    std::size_t kind_ = 0; // Index of the alternative in Result: scalar, vector or matrix
+    std::size_t rows_ = 1;
+    std::size_t columns_ = 1;
+
+    std::size_t size() const noexcept { return rows_ * columns_; }
+};
+
+Shape shape_of(const Result& value) noexcept {
+    if (const auto* vector = std::get_if<types::Vector>(&value)) return Shape{1, 1, vector->size()};
+    if (const auto* matrix = std::get_if<types::Matrix>(&value)) return Shape{2, matrix->rows(), matrix->columns()};
+    return Shape{};
+}
+
+const double* elements(const Result& value) noexcept {
+    if (const auto* vector = std::get_if<types::Vector>(&value)) return vector->data();
+    if (const auto* matrix = std::get_if<types::Matrix>(&value)) return matrix->data();
+    return &std::get<types::Numeral>(value);
+}
+
+double* elements(Result& value) noexcept { return const_cast<double*>(elements(static_cast<const Result&>(value))); }
+
+// A value of a shape, every element 0
+Result make(const Shape& shape) {
+    switch (shape.kind_) {
+    case 0: return types::Numeral(0);
+    case 1: return types::Vector(shape.columns_);
+    default: return types::Matrix(shape.rows_, shape.columns_);
+    } // switch (shape.kind_)
+}
+
+std::string describe(const Shape& shape) {
+    switch (shape.kind_) {
+    case 0: return "a scalar";
+    case 1: return "a vector of " + std::to_string(shape.columns_);
+    default: return "a " + std::to_string(shape.rows_) + "x" + std::to_string(shape.columns_) + " matrix";
+    } // switch (shape.kind_)
+}
+
+std::runtime_error mismatch(const std::string& name, const Shape& a) {
+    return std::runtime_error("Numerical error: Cannot apply '" + name + "' to " + describe(a));
+}
+
+std::runtime_error mismatch(const std::string& name, const Shape& a, const Shape& b) {
+    return std::runtime_error("Numerical error: Cannot apply '" + name + "' to " + describe(a) + " and " + describe(b));
+}
+
+// The shape of an element-wise operation on two shapes, which must be equal along each side or 1
+Shape broadcast(const std::string& name, const Shape& a, const Shape& b) {
+    if (a.kind_ == 0) return b;
+    if (b.kind_ == 0) return a;
+    auto fit = [](std::size_t x, std::size_t y) { return x == y || x == 1 || y == 1; };
+    if (!fit(a.rows_, b.rows_) || !fit(a.columns_, b.columns_)) throw mismatch(name, a, b);
+    return Shape{std::max(a.kind_, b.kind_), std::max(a.rows_, b.rows_), std::max(a.columns_, b.columns_)};
+}
+
+enum class Op { Leaf, Negate, Add, Subtract, Multiply, Divide, Power, Function };
+
+// A value, or an element-wise operation on terms, left to compute a block at a time
+struct Term {
+    Op op_ = Op::Leaf;
+    Shape shape_;
+    Result value_;                     // Of a leaf, unless borrowed_
+    const Result* borrowed_ = nullptr; // The bound value a leaf refers to
+    elementary::Function function_ = elementary::Function::Sqrt;
+    std::unique_ptr<Term> first_;      // Operands in source order, second_ of binary operations only
+    std::unique_ptr<Term> second_;
+    std::vector<double> block_;        // The current block, of an operand
+
+    const Result& value() const noexcept { return borrowed_ ? *borrowed_ : value_; }
+};
+
+std::unique_ptr<Term> leaf(Result&& value) {
+    auto term = std::make_unique<Term>();
+    term->shape_ = shape_of(value);
+    term->value_ = std::move(value);
+    return term;
+}
+
+std::unique_ptr<Term> leaf(const Result* bound) {
+    auto term = std::make_unique<Term>();
+    term->shape_ = shape_of(*bound);
+    term->borrowed_ = bound;
+    return term;
+}
+
+// Writes elements first.. of a term, broadcast to the shape of the whole expression, to destination, or returns where
+// they are already
+const double* fill(Term& term, const Shape& shape, std::size_t first, std::size_t count, double* destination) {
+    if (term.op_ == Op::Leaf) {
+        const Shape& own = term.shape_;
+        const double* data = elements(term.value());
+        if (own.rows_ == shape.rows_ && own.columns_ == shape.columns_) return data + first;
+        std::size_t row = first / shape.columns_, column = first % shape.columns_;
+        for (double* out = destination; count > 0; ++row, column = 0) {
+            const std::size_t run = std::min(count, shape.columns_ - column);
+            const double* source = data + (own.rows_ == 1 ? 0 : row * own.columns_);
+            if (own.columns_ == 1) std::fill(out, out + run, source[0]);
+            else std::copy(source + column, source + column + run, out);
+            out += run;
+            count -= run;
+        }
+        return destination;
+    }
+
+    const double* a = fill(*term.first_, shape, first, count, term.first_->block_.data());
+    const double* b = term.second_ ? fill(*term.second_, shape, first, count, term.second_->block_.data()) : nullptr;
+    switch (term.op_) {
+    case Op::Negate:
+        for (std::size_t i = 0; i < count; ++i) destination[i] = -a[i];
+        break;
+    case Op::Add:
+        for (std::size_t i = 0; i < count; ++i) destination[i] = a[i] + b[i];
+        break;
+    case Op::Subtract:
+        for (std::size_t i = 0; i < count; ++i) destination[i] = a[i] - b[i];
+        break;
+    case Op::Multiply:
+        for (std::size_t i = 0; i < count; ++i) destination[i] = a[i] * b[i];
+        break;
+    case Op::Divide:
+        if (std::find(b, b + count, 0.0) != b + count) throw std::runtime_error("Numerical error: Cannot divide by 0");
+        for (std::size_t i = 0; i < count; ++i) destination[i] = a[i] / b[i];
+        break;
+    case Op::Power:
+        for (std::size_t i = 0; i < count; ++i) {
+            if (a[i] == 0 && b[i] < 0) throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::DivisionByZero}));
+            if (!elementary::pow_in_domain(a[i], b[i])) {
+                throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::OutOfDomain, 0, expr::PowerNode::name()}));
+            }
+        }
+        elementary::pow(a, b, destination, count);
+        break;
+    case Op::Function:
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!elementary::in_domain(term.function_, a[i])) {
+                throw std::runtime_error(types::error_message(types::Error{types::ErrorCode::OutOfDomain, 0,
+                    elementary::function_name(term.function_)}));
+            }
+        }
+        elementary::evaluate(term.function_, a, destination, count);
+        break;
+    case Op::Leaf:
+        break;
+    } // switch (term.op_)
+    return destination;
+}
+
+// Computes an operation into a leaf, a block at a time
+const Result& materialize(Term& term) {
+    if (term.op_ == Op::Leaf) return term.value();
+    Result value = make(term.shape_);
+    double* out = elements(value);
+    const std::size_t size = term.shape_.size();
+    for (std::size_t first = 0; first < size; first += matrix_eval::kElementBlock) {
+        fill(term, term.shape_, first, std::min(matrix_eval::kElementBlock, size - first), out + first);
+    }
+    term.op_ = Op::Leaf;
+    term.value_ = std::move(value);
+    term.first_.reset();
+    term.second_.reset();
+    return term.value_;
+}
+
+// Factors a square matrix, false if it is singular
+bool factor(const Result& value, std::vector<double>& lu, std::vector<std::size_t>& pivots) {
+    const types::Matrix& matrix = std::get<types::Matrix>(value);
+    lu.assign(matrix.data(), matrix.data() + matrix.size());
+    pivots.resize(matrix.rows());
+    return linalg::lu_factor(lu.data(), matrix.rows(), pivots.data());
+}
+
+template <elementary::Function... Fs>
+bool is_elementary(const expr::ExprNode& node, elementary::Function& function) noexcept {
+    return ((dynamic_cast<const expr::ElementaryNode<Fs>*>(&node) && (function = Fs, true)) || ...);
+}
+
+class Evaluator {
+private:
+    SymbolTable scalars_;
+    const dispatcher::Bindings& values_;
+    unsigned threads_;
+
+    // Whether no symbol of a subtree is a vector or matrix
+    bool scalarOnly(const expr::ExprNode& node) const {
+        if (const auto* symbol = dynamic_cast<const expr::SymbolNode*>(&node)) {
+            auto it = values_.find(symbol->getSymbolName());
+            return it == values_.end() || std::holds_alternative<types::Numeral>(it->second);
+        }
+        for (std::size_t i = 0; i < node.childCount(); ++i) {
+            if (!scalarOnly(*node.child(i))) return false;
+        }
+        return true;
+    }
+
+    std::unique_ptr<Term> operation(Op op, const std::string& name, std::unique_ptr<Term> first, std::unique_ptr<Term> second) {
+        auto term = std::make_unique<Term>();
+        term->op_ = op;
+        term->shape_ = second ? broadcast(name, first->shape_, second->shape_) : first->shape_;
+        first->block_.resize(matrix_eval::kElementBlock);
+        if (second) second->block_.resize(matrix_eval::kElementBlock);
+        term->first_ = std::move(first);
+        term->second_ = std::move(second);
+        return term;
+    }
+
+    std::unique_ptr<Term> product(std::unique_ptr<Term> first, std::unique_ptr<Term> second) {
+        const Shape a = first->shape_, b = second->shape_;
+        if (a.kind_ == 0 || b.kind_ == 0 || (a.kind_ == 1 && b.kind_ == 1)) {
+            return operation(Op::Multiply, "*", std::move(first), std::move(second));
+        }
+        // A vector is a row on the left and a column on the right
+        const std::size_t m = a.kind_ == 1 ? 1 : a.rows_;
+        const std::size_t k = a.columns_;
+        const std::size_t n = b.kind_ == 1 ? 1 : b.columns_;
+        if ((b.kind_ == 1 ? b.columns_ : b.rows_) != k) throw mismatch("*", a, b);
+        Result result = a.kind_ == 1 || b.kind_ == 1 ? Result(types::Vector(m * n)) : Result(types::Matrix(m, n));
+        linalg::multiply(elements(materialize(*first)), elements(materialize(*second)), elements(result), m, k, n, threads_);
+        return leaf(std::move(result));
+    }
+
+    std::unique_ptr<Term> dot(std::unique_ptr<Term> first, std::unique_ptr<Term> second) {
+        const Shape a = first->shape_, b = second->shape_;
+        if (a.kind_ != b.kind_ || a.rows_ != b.rows_ || a.columns_ != b.columns_) throw mismatch("dot", a, b);
+        const double* x = elements(materialize(*first));
+        const double* y = elements(materialize(*second));
+        double sums[4] = {0, 0, 0, 0};
+        const std::size_t size = a.size();
+        std::size_t i = 0;
+        for (; i + 4 <= size; i += 4) {
+            for (std::size_t lane = 0; lane < 4; ++lane) sums[lane] += x[i + lane] * y[i + lane];
+        }
+        for (; i < size; ++i) sums[0] += x[i] * y[i];
+        return leaf((sums[0] + sums[1]) + (sums[2] + sums[3]));
+    }
+
+    std::unique_ptr<Term> solve(std::unique_ptr<Term> first, std::unique_ptr<Term> second) {
+        const Shape a = first->shape_, b = second->shape_;
+        if (a.kind_ == 0) return operation(Op::Divide, "solve", std::move(second), std::move(first));
+        if (a.kind_ != 2 || a.rows_ != a.columns_ || b.kind_ == 0 || (b.kind_ == 1 ? b.columns_ : b.rows_) != a.rows_) {
+            throw mismatch("solve", a, b);
+        }
+        std::vector<double> lu;
+        std::vector<std::size_t> pivots;
+        if (!factor(materialize(*first), lu, pivots)) throw std::runtime_error("Numerical error: Cannot solve, the matrix is singular");
+        Result x = materialize(*second);
+        linalg::lu_solve(lu.data(), pivots.data(), a.rows_, elements(x), b.kind_ == 1 ? 1 : b.columns_);
+        return leaf(std::move(x));
+    }
+
+    std::unique_ptr<Term> transpose(std::unique_ptr<Term> first) {
+        const Shape a = first->shape_;
+        if (a.kind_ != 2) return first; // A vector is a row or a column as it is used
+        types::Matrix t(a.columns_, a.rows_);
+        linalg::transpose(elements(materialize(*first)), t.data(), a.rows_, a.columns_);
+        return leaf(std::move(t));
+    }
+
+    std::unique_ptr<Term> determinant(std::unique_ptr<Term> first) {
+        const Shape a = first->shape_;
+        if (a.kind_ == 0) return first;
+        if (a.kind_ != 2 || a.rows_ != a.columns_) throw mismatch("det", a);
+        std::vector<double> lu;
+        std::vector<std::size_t> pivots;
+        if (!factor(materialize(*first), lu, pivots)) return leaf(types::Numeral(0));
+        return leaf(linalg::lu_determinant(lu.data(), pivots.data(), a.rows_));
+    }
+
+public:
+    Evaluator(const SymbolTable& symbols, const dispatcher::Bindings& values, unsigned threads)
+        : scalars_(symbols), values_(values), threads_(threads) {
+        for (const auto& [symbol, value] : values) {
+            if (const auto* scalar = std::get_if<types::Numeral>(&value)) scalars_.insert_or_assign(symbol, *scalar);
+        }
+    }
+
+    const SymbolTable& scalars() const noexcept { return scalars_; }
+
+    bool scalarTree(const expr::ExprNode& tree) const { return scalarOnly(tree); }
+
+    std::unique_ptr<Term> term(const expr::ExprNode& node) {
+        if (const auto* symbol = dynamic_cast<const expr::SymbolNode*>(&node)) {
+            auto it = values_.find(symbol->getSymbolName());
+            if (it != values_.end() && !std::holds_alternative<types::Numeral>(it->second)) return leaf(&it->second);
+            return leaf(node.evaluate(scalars_));
+        }
+        elementary::Function function;
+        if (is_elementary<elementary::Function::Sqrt, elementary::Function::Exp, elementary::Function::Log,
+            elementary::Function::Sin, elementary::Function::Cos, elementary::Function::Gamma,
+            elementary::Function::LogGamma, elementary::Function::Factorial>(node, function)) {
+            auto result = operation(Op::Function, elementary::function_name(function), term(*node.child(0)), nullptr);
+            result->function_ = function;
+            return result;
+        }
+        if (dynamic_cast<const expr::PositiveNode*>(&node)) return term(*node.child(0));
+        if (dynamic_cast<const expr::NegativeNode*>(&node)) return operation(Op::Negate, "-", term(*node.child(0)), nullptr);
+        if (dynamic_cast<const expr::TransposeNode*>(&node)) return transpose(term(*node.child(0)));
+        if (dynamic_cast<const expr::DeterminantNode*>(&node)) return determinant(term(*node.child(0)));
+
+        if (dynamic_cast<const expr::BinaryNode*>(&node)) {
+            Op op = Op::Leaf;
+            std::string name;
+            if (dynamic_cast<const expr::AdditionNode*>(&node)) {
+                op = Op::Add;
+                name = "+";
+            }
+            else if (dynamic_cast<const expr::SubtractionNode*>(&node)) {
+                op = Op::Subtract;
+                name = "-";
+            }
+            else if (dynamic_cast<const expr::DivisionNode*>(&node)) {
+                op = Op::Divide;
+                name = "/";
+            }
+            else if (dynamic_cast<const expr::PowerNode*>(&node)) {
+                op = Op::Power;
+                name = expr::PowerNode::name();
+            }
+            const bool matrix_op = dynamic_cast<const expr::MultiplicationNode*>(&node) || dynamic_cast<const expr::DotNode*>(&node)
+                || dynamic_cast<const expr::SolveNode*>(&node);
+            if (op != Op::Leaf || matrix_op) {
+                auto first = term(*node.child(0));
+                auto second = term(*node.child(1));
+                if (dynamic_cast<const expr::MultiplicationNode*>(&node)) return product(std::move(first), std::move(second));
+                if (dynamic_cast<const expr::DotNode*>(&node)) return dot(std::move(first), std::move(second));
+                if (dynamic_cast<const expr::SolveNode*>(&node)) return solve(std::move(first), std::move(second));
+                return operation(op, name, std::move(first), std::move(second));
+            }
+        }
+
+        // Comparisons, logic, conditionals and calls: scalars only, evaluated lazily as the tree does
+        if (!scalarOnly(node)) {
+            throw std::runtime_error("Numerical error: The operation at position " + std::to_string(node.getPosition())
+                + " takes scalars only");
+        }
+        return leaf(node.evaluate(scalars_));
+    }
+};
+
+// Parses the numbers of a line, false if it has none
+bool parse_row(const std::string& line, std::vector<double>& values, std::size_t& count) {
+    auto separator = [](char ch) { return ch == ' ' || ch == '\t' || ch == ',' || ch == ';' || ch == '\r'; };
+    count = 0;
+    const char* p = line.data();
+    const char* end = p + line.size();
+    while (p != end && separator(*p)) ++p;
+    if (p == end || *p == '#') return false;
+    while (p != end) {
+        double value = 0;
+        auto [next, ec] = std::from_chars(p, end, value);
+        if (ec != std::errc() || (next != end && !separator(*next))) throw std::invalid_argument("malformed number");
+        values.push_back(value);
+        ++count;
+        for (p = next; p != end && separator(*p); ++p) {}
+    }
+    return true;
+}
+
+} // namespace
+
+dispatcher::Result matrix_eval::evaluate(const expr::ExprNode& tree, const SymbolTable& symbols,
+    const dispatcher::Bindings& values, unsigned threads) {
+
+    Evaluator evaluator(symbols, values, threads);
+    if (evaluator.scalarTree(tree)) return tree.evaluate(evaluator.scalars());
+    auto root = evaluator.term(tree);
+    materialize(*root);
+    if (root->borrowed_) return *root->borrowed_;
+    return std::move(root->value_);
+}
+
+dispatcher::Result matrix_eval::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) throw std::invalid_argument("Invalid command line argument: Cannot open '" + path + "'");
+    std::vector<double> values;
+    std::size_t rows = 0, columns = 0;
+    std::string line;
+    for (std::size_t number = 1; std::getline(file, line); ++number) {
+        std::size_t count = 0;
+        try {
+            if (!parse_row(line, values, count)) continue;
+        }
+        catch (const std::invalid_argument&) {
+            throw std::invalid_argument("Invalid command line argument: '" + path + "' has a malformed number on line " + std::to_string(number));
+        }
+        if (rows > 0 && count != columns) {
+            throw std::invalid_argument("Invalid command line argument: '" + path + "' has " + std::to_string(count)
+                + " numbers on line " + std::to_string(number) + ", not " + std::to_string(columns));
+        }
+        columns = count;
+        ++rows;
+    }
+    if (rows == 0) throw std::invalid_argument("Invalid command line argument: '" + path + "' holds no numbers");
+    if (rows == 1 || columns == 1) return types::Vector(std::move(values));
+    return types::Matrix(rows, columns, std::move(values));
+}
+
+std::pair<types::Symbol, dispatcher::Result> matrix_eval::parse_binding(const std::string& text) {
+    std::size_t equals = text.find('=');
+    types::Symbol symbol = text.substr(0, std::min(equals, text.size()));
+    bool valid = equals != std::string::npos && equals + 1 < text.size() && !symbol.empty() && parser::is_symbol_start(symbol[0]);
+    for (char ch : symbol) valid = valid && parser::is_symbol_middle(ch);
+    if (!valid) throw std::invalid_argument("Invalid command line argument: '" + text + "' is not of the form name=file");
+    return {symbol, load(text.substr(equals + 1))};
+}
+
+std::string matrix_eval::to_string(const dispatcher::Result& value) {
+    std::ostringstream out;
+    auto row = [&out](const double* values, std::size_t count) {
+        out << "[";
+        for (std::size_t i = 0; i < count; ++i) out << (i > 0 ? ", " : "") << values[i];
+        out << "]";
+    };
+    if (const auto* vector = std::get_if<types::Vector>(&value)) row(vector->data(), vector->size());
+    else if (const auto* matrix = std::get_if<types::Matrix>(&value)) {
+        for (std::size_t i = 0; i < matrix->rows(); ++i) {
+            if (i > 0) out << "\n";
+            row(matrix->data() + i * matrix->columns(), matrix->columns());
+        }
+    }
+    else out << std::get<types::Numeral>(value);
+    return out.str();
+}
@@ -1,22 +1,122 @@
 #include "core/parser.h"
+#include <algorithm>
+#include <charconv>
+#include <thread>
 
 std::vector<parser::Token> parser::tokenize(std::string expression) {
-    std::vector<Token> tokens;
+    auto tokens = try_tokenize(expression);
+    if (!tokens) throw std::runtime_error(types::error_message(tokens.error()));
+    return std::move(tokens).value();
+}
+
+namespace {
+
+constexpr std::size_t kParallelTokenizeLength = std::size_t(1) << 16; // Shortest expression tokenized in chunks
+
+// Tokenizes expression[begin, end), which starts and ends between tokens, with the offsets in expression
+types::Expected<std::vector<parser::Token>> tokenize_range(const std::string& expression, std::size_t begin, std::size_t end,
+    std::vector<std::size_t>* positions) {
+
+    std::vector<parser::Token> tokens;
+    const auto range_end = expression.begin() + static_cast<std::ptrdiff_t>(end);
+
+    // Iterate through the expression, build the token array; spaces separate tokens
+    auto token_begin = expression.begin() + static_cast<std::ptrdiff_t>(begin);
+    while (true) {
+        while (token_begin != range_end && std::isspace(static_cast<unsigned char>(*token_begin))) ++token_begin;
+        if (token_begin == range_end) break;
+
+        auto [token_end, token_type] = parser::find_token_end(token_begin, range_end); // Find the token's end iterator
+        auto position = static_cast<std::size_t>(token_begin - expression.begin());
 
-    // Removes the spaces in the expression
-    remove_spaces(expression);
+        if (token_type == parser::TokenType::Numeral) { // Parse the number in place
+            const char* first = expression.data() + position;
+            const char* last = first + (token_end - token_begin);
+            types::Numeral value;
+            auto [parsed_end, ec] = std::from_chars(first, last, value);
+            if (ec != std::errc() || parsed_end != last) {
+                return types::Error{types::ErrorCode::InvalidNumber, position, std::string(first, last)};
+            }
+            tokens.emplace_back(parser::TokenType::Numeral, value);
+        }
+        else tokens.push_back(parser::string_to_token(token_begin, token_end, token_type)); // Parse this token and add to the tokens vector
+        if (positions) positions->push_back(position);
 
-    // Iterate through the expression, build the token array
-    auto token_begin = expression.begin();
-    do {
-        auto [token_end, token_type] = find_token_end(token_begin, expression.end()); // Find the token's end iterator
-        tokens.push_back(string_to_token(token_begin, token_end, token_type)); // Parse this token and add to the tokens vector
         token_begin = token_end; // Move to the next token
-    } while (token_begin != expression.end()); // Until reaches the end of the expressions
+    }
+    return tokens;
+}
+
+// Whether a token ends right before offset: the previous character is a space, a bracket or a comma, none of which
+// is part of a longer token
+bool is_token_boundary(const std::string& expression, std::size_t offset) {
+    char previous = expression[offset - 1];
+    return std::isspace(static_cast<unsigned char>(previous)) || previous == ',' || parser::is_bracket(std::string(1, previous));
+}
+
+} // namespace
+
+types::Expected<std::vector<parser::Token>> parser::try_tokenize(const std::string& expression, std::vector<std::size_t>* positions) {
+    if (positions) positions->clear();
+    auto tokens = tokenize_range(expression, 0, expression.size(), positions);
+    if (!tokens) return tokens;
+    if (tokens.value().empty()) return types::Error{types::ErrorCode::EmptyExpression, 0};
 
     // Recognize brackets and operators
-    recognize(tokens);
-    
+    recognize(tokens.value());
+
+    return tokens;
+}
+
+types::Expected<std::vector<parser::Token>> parser::try_tokenize_parallel(const std::string& expression, unsigned threads,
+    std::vector<std::size_t>* positions) {
+
+    if (threads <= 1 || expression.size() < kParallelTokenizeLength) return try_tokenize(expression, positions);
+
+    // Cut the expression into one chunk per thread, each moved forward to the next token boundary
+    std::vector<std::size_t> cuts = {0};
+    for (unsigned k = 1; k < threads; ++k) {
+        std::size_t cut = std::max(cuts.back() + 1, expression.size() / threads * k);
+        while (cut < expression.size() && !is_token_boundary(expression, cut)) ++cut;
+        if (cut >= expression.size()) break;
+        cuts.push_back(cut);
+    }
+    cuts.push_back(expression.size());
+    const std::size_t chunk_count = cuts.size() - 1;
+
+    std::vector<types::Expected<std::vector<Token>>> chunks(chunk_count, std::vector<Token>());
+    std::vector<std::vector<std::size_t>> chunk_positions(chunk_count);
+    auto tokenize_chunk = [&](std::size_t k) {
+        chunks[k] = tokenize_range(expression, cuts[k], cuts[k + 1], positions ? &chunk_positions[k] : nullptr);
+        if (chunks[k]) recognize(chunks[k].value());
+    };
+    std::vector<std::thread> workers;
+    for (std::size_t k = 1; k < chunk_count; ++k) workers.emplace_back(tokenize_chunk, k);
+    tokenize_chunk(0);
+    for (auto& worker : workers) worker.join();
+
+    // The first error is the one the sequential scan meets
+    std::size_t total = 0;
+    for (const auto& chunk : chunks) {
+        if (!chunk) return chunk.error();
+        total += chunk.value().size();
+    }
+    if (total == 0) return types::Error{types::ErrorCode::EmptyExpression, 0};
+
+    // Join the chunks at their offsets
+    std::vector<Token> tokens(total);
+    if (positions) positions->assign(total, 0);
+    std::vector<std::size_t> offsets(chunk_count, 0);
+    for (std::size_t k = 1; k < chunk_count; ++k) offsets[k] = offsets[k - 1] + chunks[k - 1].value().size();
+    auto join_chunk = [&](std::size_t k) {
+        std::move(chunks[k].value().begin(), chunks[k].value().end(), tokens.begin() + static_cast<std::ptrdiff_t>(offsets[k]));
+        if (positions) std::copy(chunk_positions[k].begin(), chunk_positions[k].end(), positions->begin() + static_cast<std::ptrdiff_t>(offsets[k]));
+        chunks[k].value() = std::vector<Token>();
+    };
+    workers.clear();
+    for (std::size_t k = 1; k < chunk_count; ++k) workers.emplace_back(join_chunk, k);
+    join_chunk(0);
+    for (auto& worker : workers) worker.join();
     return tokens;
 }
 
@@ -27,26 +127,29 @@ void parser::remove_spaces(std::string& expression) {
     }
 }
 
-std::pair<std::string::iterator, parser::TokenType> parser::find_token_end(std::string::iterator token_begin, std::string::iterator expr_end) {
+std::pair<std::string::const_iterator, parser::TokenType> parser::find_token_end(std::string::const_iterator token_begin, std::string::const_iterator expr_end) {
     // Check if the range is valid
     if (token_begin == expr_end) throw std::out_of_range("Internal error: Attempt to parse after end of expression");
     
     if (is_numeral(*token_begin)) { // Is a numeral
         auto end_it = token_begin + 1;
-        while (is_numeral(*end_it) && end_it != expr_end) ++end_it; // Go on until the position is no longer a numeral
-        return std::pair<std::string::iterator, TokenType>(end_it, TokenType::Numeral);
+        while (end_it != expr_end && is_numeral(*end_it)) ++end_it; // Go on until the position is no longer a numeral
+        return std::pair<std::string::const_iterator, TokenType>(end_it, TokenType::Numeral);
     }
     else if (is_symbol_start(*token_begin)) { // Is a symbol
         auto end_it = token_begin + 1;
-        while (is_symbol_middle(*end_it) && end_it != expr_end) ++end_it; // Go on until the position is no longer a symbol
-        return std::pair<std::string::iterator, TokenType>(end_it, TokenType::Symbol);
+        while (end_it != expr_end && is_symbol_middle(*end_it)) ++end_it; // Go on until the position is no longer a symbol
+        return std::pair<std::string::const_iterator, TokenType>(end_it, TokenType::Symbol);
     }
-    else { // Other tokens will have only 1 character
-        return std::pair<std::string::iterator, TokenType>(token_begin + 1, TokenType::Symbol);
+    else { // Other tokens have 1 character, or 2 if they form an operator (such as <=)
+        if (token_begin + 1 != expr_end && is_two_character_operator(*token_begin, *(token_begin + 1))) {
+            return std::pair<std::string::const_iterator, TokenType>(token_begin + 2, TokenType::Symbol);
+        }
+        return std::pair<std::string::const_iterator, TokenType>(token_begin + 1, TokenType::Symbol);
     }
 }
 
-parser::Token parser::string_to_token(std::string::iterator token_begin, std::string::iterator token_end, parser::TokenType token_type) {
+parser::Token parser::string_to_token(std::string::const_iterator token_begin, std::string::const_iterator token_end, parser::TokenType token_type) {
     std::string token_string(token_begin, token_end); // Acquire the token string
     TokenContent token_content;
 
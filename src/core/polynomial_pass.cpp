@@ -0,0 +1,176 @@
+#include "core/polynomial_pass.h"
+#include <cmath>
+#include <optional>
+#include <vector>
+#include "core/functions.h"
+
+namespace {
+
+// A subtree found to be a polynomial
+struct Analysis {
+    poly::Polynomial polynomial_;
+    const expr::ExprNode* variable_; // Leaf of the variable, nullptr if the subtree is constant
+    std::size_t nodes_;              // Nodes of the subtree
+};
+
+constexpr types::Numeral kMaxExpandedPower = 64; // Highest constant exponent of x^n expanded into a polynomial
+
+bool is_variable(const expr::ExprNode& node) {
+    return dynamic_cast<const expr::SymbolNode*>(&node) || dynamic_cast<const functions::ParameterNode*>(&node);
+}
+
+bool same_variable(const expr::ExprNode* a, const expr::ExprNode* b) {
+    if (!a || !b) return true; // A constant combines with anything
+    auto* symbol_a = dynamic_cast<const expr::SymbolNode*>(a);
+    auto* symbol_b = dynamic_cast<const expr::SymbolNode*>(b);
+    if (symbol_a && symbol_b) return symbol_a->getSymbolName() == symbol_b->getSymbolName();
+    auto* parameter_a = dynamic_cast<const functions::ParameterNode*>(a);
+    auto* parameter_b = dynamic_cast<const functions::ParameterNode*>(b);
+    return parameter_a && parameter_b && parameter_a->index() == parameter_b->index();
+}
+
+std::size_t terms(const poly::Polynomial& polynomial) {
+    std::size_t count = 0;
+    for (std::size_t k = 0; k <= polynomial.degree(); ++k) count += polynomial.coefficient(k) != 0;
+    return count;
+}
+
+// Whether 1/value is exact
+bool has_exact_reciprocal(types::Numeral value) {
+    if (value == 0 || !std::isfinite(value)) return false;
+    int exponent;
+    return std::fabs(std::frexp(value, &exponent)) == 0.5;
+}
+
+// Whether value is a natural number small enough to expand x^value into
+bool is_small_power(types::Numeral value) {
+    return value >= 0 && value <= kMaxExpandedPower && value == std::floor(value);
+}
+
+// Whether replacing the subtree by its polynomial saves operations
+bool worth_rewriting(const Analysis& analysis) {
+    return analysis.variable_ && analysis.nodes_ > 2 * analysis.polynomial_.degree() + 1;
+}
+
+void rewrite(std::unique_ptr<expr::ExprNode>& node, Analysis& analysis) {
+    std::size_t position = node->getPosition();
+    node = std::make_unique<poly::PolynomialNode>(analysis.variable_->clone(), std::move(analysis.polynomial_));
+    node->setPosition(position);
+}
+
+/**
+ * Analyzes a subtree, bottom-up. Returns its polynomial if it is one; otherwise rewrites its polynomial children.
+ */
+std::optional<Analysis> collect(std::unique_ptr<expr::ExprNode>& node, poly::PolynomialMode mode, std::size_t& rewritten) {
+    const expr::ExprNode& current = *node;
+    if (dynamic_cast<const expr::NumeralNode*>(&current) || dynamic_cast<const expr::PiNode*>(&current)
+        || dynamic_cast<const expr::ENode*>(&current)) {
+        return Analysis{poly::Polynomial::constant(current.evaluate(SymbolTable())), nullptr, 1};
+    }
+    if (is_variable(current)) return Analysis{poly::Polynomial::identity(), &current, 1};
+
+    std::vector<std::optional<Analysis>> children;
+    bool all_polynomial = true;
+    for (std::size_t i = 0; i < node->childCount(); ++i) {
+        auto child = node->replaceChild(i, nullptr);
+        children.push_back(collect(child, mode, rewritten));
+        node->replaceChild(i, std::move(child));
+        all_polynomial = all_polynomial && children.back().has_value();
+    }
+
+    // Combine the children, if the node is a polynomial operation on polynomials in the same variable
+    std::optional<Analysis> result;
+    if (all_polynomial && !children.empty()) {
+        const expr::ExprNode* variable = children[0]->variable_;
+        std::size_t nodes = 1;
+        bool compatible = true;
+        for (const auto& child : children) {
+            compatible = compatible && same_variable(variable, child->variable_);
+            if (!variable) variable = child->variable_;
+            nodes += child->nodes_;
+        }
+
+        std::optional<poly::Polynomial> polynomial;
+        if (compatible) {
+            const poly::Polynomial& first = children[0]->polynomial_;
+            if (dynamic_cast<const expr::PositiveNode*>(&current)) polynomial = first;
+            else if (dynamic_cast<const expr::NegativeNode*>(&current)) polynomial = -first;
+            else if (dynamic_cast<const expr::AdditionNode*>(&current)) polynomial = first + children[1]->polynomial_;
+            else if (dynamic_cast<const expr::SubtractionNode*>(&current)) polynomial = first - children[1]->polynomial_;
+            else if (dynamic_cast<const expr::MultiplicationNode*>(&current)) {
+                const poly::Polynomial& second = children[1]->polynomial_;
+                if (mode == poly::PolynomialMode::Expand || terms(first) <= 1 || terms(second) <= 1) polynomial = first * second;
+            }
+            else if (dynamic_cast<const expr::DivisionNode*>(&current)) {
+                const poly::Polynomial& divisor = children[1]->polynomial_;
+                if (divisor.isConstant() && has_exact_reciprocal(divisor.coefficient(0))) {
+                    polynomial = first * (1 / divisor.coefficient(0));
+                }
+            }
+            else if (dynamic_cast<const expr::PowerNode*>(&current)) {
+                const poly::Polynomial& exponent = children[1]->polynomial_;
+                if (exponent.isConstant() && is_small_power(exponent.coefficient(0))
+                    && (mode == poly::PolynomialMode::Expand || terms(first) <= 1)) {
+                    poly::Polynomial power = poly::Polynomial::constant(1);
+                    for (auto n = static_cast<int>(exponent.coefficient(0)); n > 0; --n) power = power * first;
+                    polynomial = std::move(power);
+                }
+            }
+        }
+        if (polynomial) result = Analysis{std::move(*polynomial), variable, nodes};
+    }
+    if (result) return result;
+
+    // Not a polynomial itself, so its polynomial children are maximal
+    for (std::size_t i = 0; i < children.size(); ++i) {
+        if (!children[i] || !worth_rewriting(*children[i])) continue;
+        auto child = node->replaceChild(i, nullptr);
+        rewrite(child, *children[i]);
+        node->replaceChild(i, std::move(child));
+        ++rewritten;
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+poly::PolynomialNode::PolynomialNode(std::unique_ptr<expr::ExprNode>&& variable, Polynomial polynomial) :
+    UnaryNode(std::move(variable)), polynomial_(std::move(polynomial)), derivative_(polynomial_.derivative()) {}
+
+types::Numeral poly::PolynomialNode::evaluate(const SymbolTable& symbols) const {
+    return polynomial_.evaluate(child_->evaluate(symbols));
+}
+
+types::Numeral poly::PolynomialNode::evaluateAt(const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+    return polynomial_.evaluate(child_->evaluateAt(symbols, variables));
+}
+
+types::Numeral poly::PolynomialNode::evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept {
+    return polynomial_.evaluate(child_->evaluateChecked(symbols, status));
+}
+
+expr::Dual poly::PolynomialNode::evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const {
+    expr::Dual x = child_->evaluateDual(symbols, context);
+    return expr::Dual{polynomial_.evaluate(x.value_), derivative_.evaluate(x.value_) * x.tangent_};
+}
+
+expr::TapeValue poly::PolynomialNode::record(const SymbolTable& symbols, expr::Tape& tape) const {
+    expr::TapeValue x = child_->record(symbols, tape);
+    return tape.unary(polynomial_.evaluate(x.value_), x, derivative_.evaluate(x.value_));
+}
+
+std::unique_ptr<expr::ExprNode> poly::PolynomialNode::clone() const {
+    return positioned(std::make_unique<PolynomialNode>(child_->clone(), polynomial_));
+}
+
+std::size_t poly::collect_polynomials(std::unique_ptr<expr::ExprNode>& tree, PolynomialMode mode) {
+    if (mode == PolynomialMode::Off) return 0;
+    std::size_t rewritten = 0;
+    auto analysis = collect(tree, mode, rewritten);
+    if (analysis && worth_rewriting(*analysis)) {
+        rewrite(tree, *analysis);
+        ++rewritten;
+    }
+    return rewritten;
+}
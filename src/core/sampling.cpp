@@ -0,0 +1,173 @@
+#include "core/sampling.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+#include "core/parser.h"
+#include "core/typed_program.h"
+#include "functional/random.h"
+
+namespace {
+
+std::string trim(const std::string& text) {
+    std::size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) return std::string();
+    return text.substr(begin, text.find_last_not_of(" \t") - begin + 1);
+}
+
+// How each symbol of the program gets its values
+struct Column {
+    const sampling::Distribution* distribution_ = nullptr; // nullptr for a fixed value
+    std::uint64_t stream_ = 0;
+    double value_ = 0;
+};
+
+// Draws the samples first.. of a column
+void draw(const Column& column, std::uint64_t seed, std::uint64_t first, std::size_t count, double* values) {
+    const sampling::Distribution& distribution = *column.distribution_;
+    const double a = distribution.a_, b = distribution.b_;
+    switch (distribution.family_) {
+    case sampling::Family::Normal:
+        prng::normal(seed, column.stream_, first, count, values);
+        for (std::size_t i = 0; i < count; ++i) values[i] = a + b * values[i];
+        break;
+    case sampling::Family::LogNormal:
+        prng::normal(seed, column.stream_, first, count, values);
+        for (std::size_t i = 0; i < count; ++i) values[i] = std::exp(a + b * values[i]);
+        break;
+    case sampling::Family::Uniform:
+        prng::uniform(seed, column.stream_, first, count, values);
+        for (std::size_t i = 0; i < count; ++i) values[i] = a + (b - a) * values[i];
+        break;
+    case sampling::Family::Exponential:
+        prng::uniform(seed, column.stream_, first, count, values);
+        for (std::size_t i = 0; i < count; ++i) values[i] = -std::log(values[i]) / a;
+        break;
+    } // switch (distribution.family_)
+}
+
+} // namespace
+
+std::pair<types::Symbol, sampling::Distribution> sampling::parse_distribution(const std::string& text) {
+    auto malformed = [&text](const std::string& why) {
+        return std::invalid_argument("Invalid command line argument: '" + text + "' " + why);
+    };
+    const std::string trimmed = trim(text);
+    std::size_t tilde = trimmed.find('~');
+    std::size_t open = trimmed.find('(', tilde == std::string::npos ? 0 : tilde);
+    if (tilde == std::string::npos || open == std::string::npos || trimmed.back() != ')') {
+        throw malformed("is not of the form name ~ family(parameters)");
+    }
+    std::string name = trim(trimmed.substr(0, tilde));
+    bool valid = !name.empty() && parser::is_symbol_start(name[0]);
+    for (char ch : name) valid = valid && parser::is_symbol_middle(ch);
+    if (!valid) throw malformed("does not start with a symbol name");
+
+    std::string family = trim(trimmed.substr(tilde + 1, open - tilde - 1));
+    std::vector<double> parameters;
+    const std::string list = trimmed.substr(0, trimmed.size() - 1); // Without the closing bracket
+    for (std::size_t begin = open + 1; ; ) {
+        std::size_t end = std::min(list.find(',', begin), list.size());
+        std::string parameter = trim(list.substr(begin, end - begin));
+        double value = 0;
+        auto [parsed_end, ec] = std::from_chars(parameter.data(), parameter.data() + parameter.size(), value);
+        if (parameter.empty() || ec != std::errc() || parsed_end != parameter.data() + parameter.size()) {
+            throw malformed("has a parameter that is not a number");
+        }
+        parameters.push_back(value);
+        if (end == list.size()) break;
+        begin = end + 1;
+    }
+
+    Distribution distribution;
+    std::size_t arity = 2;
+    if (family == "normal") distribution.family_ = Family::Normal;
+    else if (family == "uniform") distribution.family_ = Family::Uniform;
+    else if (family == "lognormal") distribution.family_ = Family::LogNormal;
+    else if (family == "exponential") {
+        distribution.family_ = Family::Exponential;
+        arity = 1;
+    }
+    else throw malformed("has no known family (normal, uniform, lognormal, exponential)");
+    if (parameters.size() != arity) throw malformed("expects " + std::to_string(arity) + " parameters for " + family);
+
+    distribution.a_ = parameters[0];
+    if (arity == 2) distribution.b_ = parameters[1];
+    bool in_range = std::isfinite(distribution.a_) && std::isfinite(distribution.b_);
+    if (distribution.family_ == Family::Uniform) in_range = in_range && distribution.a_ < distribution.b_;
+    else if (distribution.family_ == Family::Exponential) in_range = in_range && distribution.a_ > 0;
+    else in_range = in_range && distribution.b_ >= 0;
+    if (!in_range) throw malformed("has parameters out of range");
+    return {name, distribution};
+}
+
+sampling::SamplingSummary sampling::sample(const expr::ExprNode& tree,
+    const std::vector<std::pair<types::Symbol, Distribution>>& distributions, const SymbolTable& symbols,
+    const SamplingOptions& options) {
+
+    typed::Program<double> program(tree);
+    std::vector<Column> columns;
+    for (const auto& symbol : program.symbols()) {
+        Column column;
+        for (std::size_t k = 0; k < distributions.size(); ++k) {
+            if (distributions[k].first != symbol) continue;
+            if (column.distribution_) throw std::invalid_argument("Syntax error: Symbol '" + symbol + "' has two distributions");
+            column.distribution_ = &distributions[k].second;
+            column.stream_ = k;
+        }
+        if (!column.distribution_) {
+            const types::Numeral* value = symbols.find(symbol);
+            if (!value) throw std::invalid_argument("Syntax error: Symbol '" + symbol + "' undefined, it has no distribution or value");
+            column.value_ = *value;
+        }
+        columns.push_back(column);
+    }
+
+    const std::size_t block_count = static_cast<std::size_t>((options.samples_ + kSampleBlock - 1) / kSampleBlock);
+    const unsigned workers = static_cast<unsigned>(std::clamp<std::size_t>(options.threads_, 1, std::max<std::size_t>(block_count, 1)));
+    std::vector<stats::Moments> moments(workers);
+    std::vector<stats::QuantileSketch> sketches(workers, stats::QuantileSketch(options.accuracy_));
+    std::vector<std::uint64_t> non_finite(workers, 0);
+    std::atomic<std::size_t> next{0};
+
+    auto worker = [&](unsigned index) {
+        std::vector<std::vector<double>> values(columns.size(), std::vector<double>(kSampleBlock));
+        std::vector<const double*> pointers;
+        for (std::size_t s = 0; s < columns.size(); ++s) {
+            if (!columns[s].distribution_) std::fill(values[s].begin(), values[s].end(), columns[s].value_);
+            pointers.push_back(values[s].data());
+        }
+        std::vector<double> results(kSampleBlock), finite(kSampleBlock);
+        for (std::size_t block; (block = next.fetch_add(1, std::memory_order_relaxed)) < block_count; ) {
+            const std::uint64_t first = static_cast<std::uint64_t>(block) * kSampleBlock;
+            const std::size_t count = static_cast<std::size_t>(std::min<std::uint64_t>(kSampleBlock, options.samples_ - first));
+            for (std::size_t s = 0; s < columns.size(); ++s) {
+                if (columns[s].distribution_) draw(columns[s], options.seed_, first, count, values[s].data());
+            }
+            program.evaluateBulk(pointers.data(), count, results.data());
+
+            std::size_t finite_count = 0;
+            for (std::size_t i = 0; i < count; ++i) {
+                double result = results[i];
+                if (std::isfinite(result)) finite[finite_count++] = result;
+                else ++non_finite[index];
+                sketches[index].add(result);
+            }
+            moments[index].add(finite.data(), finite_count);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < workers; ++i) threads.emplace_back(worker, i);
+    worker(0);
+    for (auto& thread : threads) thread.join();
+
+    SamplingSummary summary{stats::Moments(), stats::QuantileSketch(options.accuracy_), 0};
+    for (unsigned i = 0; i < workers; ++i) {
+        summary.moments_.merge(moments[i]);
+        summary.quantiles_.merge(sketches[i]);
+        summary.non_finite_ += non_finite[i];
+    }
+    return summary;
+}
@@ -0,0 +1,502 @@
+#include "core/server.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "core/batch.h"
+#include "core/eval.h"
+#include "core/parser.h"
+#include "utils/operator_table.h"
+#include "utils/versioned_symbol_table.h"
+
+namespace {
+
+constexpr std::uint32_t kMaxFrameSize = 16u << 20; // Largest accepted length-prefixed request
+constexpr std::size_t kReadSize = 64 * 1024;        // Bytes read per read() call
+constexpr int kMaxEvents = 256;                      // Events handled per epoll_wait() call
+
+// Framing of a connection, chosen by the first byte the client sends
+enum class Framing { Unknown, Newline, LengthPrefixed };
+
+struct Job {
+    std::uint64_t connection_;
+    std::uint64_t sequence_;
+    std::string expression_;
+};
+
+struct Completion {
+    std::uint64_t connection_;
+    std::uint64_t sequence_;
+    std::string response_;
+};
+
+struct Connection {
+    int fd_;
+    Framing framing_ = Framing::Unknown;
+    std::string in_;                                // Received bytes not yet framed
+    std::string out_;                               // Framed responses not yet written
+    std::size_t out_offset_ = 0;                    // Bytes of out_ already written
+    std::uint64_t next_sequence_ = 0;               // Sequence number of the next request
+    std::uint64_t next_response_ = 0;               // Sequence number of the next response to write
+    std::map<std::uint64_t, std::string> pending_;  // Responses completed ahead of their turn
+    std::deque<std::string> waiting_;               // Framed requests not yet dispatched, held behind an assignment
+    bool read_closed_ = false;                      // Peer has shut down its writing side
+    std::uint32_t events_ = 0;                      // Events currently registered with epoll
+
+    std::size_t in_flight() const { return next_sequence_ - next_response_ + waiting_.size(); }
+    std::size_t evaluating() const { return next_sequence_ - next_response_ - pending_.size(); } // Jobs at the workers
+};
+
+// Runs the evaluation of one request, answering an exception with an error instead of ending the server
+template <typename F>
+std::string answer(F evaluate) {
+    try {
+        return evaluate();
+    }
+    catch (const std::exception& err) {
+        return std::string("error: ") + err.what();
+    }
+    catch (...) {
+        return "error: Internal error";
+    }
+}
+
+/**
+ * Pool of evaluation workers. Jobs go in through a single queue, completions come back through
+ * a second queue, and the event loop is woken through an eventfd. Each job reads one snapshot of the symbols.
+ */
+class WorkerPool {
+private:
+    const VersionedSymbolTable& symbols_;
+    const batch::BatchOptions& options_;
+    int wake_fd_;
+    std::mutex jobs_mutex_;
+    std::condition_variable jobs_cv_;
+    std::deque<Job> jobs_;
+    std::mutex done_mutex_;
+    std::vector<Completion> done_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+
+    void run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex_);
+                jobs_cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return; // Stopping
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            Completion completion{job.connection_, job.sequence_,
+                answer([&] { return server::evaluate_request(job.expression_, *symbols_.snapshot(), options_); })};
+            bool was_empty;
+            {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                was_empty = done_.empty();
+                done_.push_back(std::move(completion));
+            }
+            if (was_empty) { // The event loop has not been woken for this batch yet
+                std::uint64_t one = 1;
+                [[maybe_unused]] auto written = ::write(wake_fd_, &one, sizeof(one));
+            }
+        }
+    }
+
+public:
+    WorkerPool(unsigned workers, const VersionedSymbolTable& symbols, const batch::BatchOptions& options, int wake_fd) :
+        symbols_(symbols), options_(options), wake_fd_(wake_fd) {
+        for (unsigned i = 0; i < workers; ++i) threads_.emplace_back(&WorkerPool::run, this);
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            stopping_ = true;
+            jobs_.clear();
+        }
+        jobs_cv_.notify_all();
+        for (auto& thread : threads_) thread.join();
+    }
+
+    void submit(std::vector<Job>&& jobs) {
+        if (jobs.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex_);
+            for (auto& job : jobs) jobs_.push_back(std::move(job));
+        }
+        if (jobs.size() == 1) jobs_cv_.notify_one();
+        else jobs_cv_.notify_all();
+    }
+
+    std::vector<Completion> take_completions() {
+        std::vector<Completion> result;
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        result.swap(done_);
+        return result;
+    }
+};
+
+void append_frame(Connection& connection, const std::string& payload) {
+    if (connection.framing_ == Framing::LengthPrefixed) {
+        auto size = static_cast<std::uint32_t>(payload.size());
+        char header[4] = {static_cast<char>(size >> 24), static_cast<char>(size >> 16),
+            static_cast<char>(size >> 8), static_cast<char>(size)};
+        connection.out_.append(header, 4);
+        connection.out_ += payload;
+    }
+    else {
+        connection.out_ += payload;
+        connection.out_ += '\n';
+    }
+}
+
+// Frames the responses whose turn has come
+void deliver(Connection& connection) {
+    for (auto pending = connection.pending_.begin();
+         pending != connection.pending_.end() && pending->first == connection.next_response_;
+         pending = connection.pending_.erase(pending)) {
+        append_frame(connection, pending->second);
+        ++connection.next_response_;
+    }
+}
+
+// Finds the '=' of a request of the form "name = expression", npos for any other request
+std::size_t find_assignment(const std::string& request) {
+    std::size_t i = 0;
+    while (i < request.size() && std::isspace(static_cast<unsigned char>(request[i]))) ++i;
+    if (i == request.size() || !parser::is_symbol_start(request[i])) return std::string::npos;
+    while (i < request.size() && parser::is_symbol_middle(request[i])) ++i;
+    while (i < request.size() && std::isspace(static_cast<unsigned char>(request[i]))) ++i;
+    if (i == request.size() || request[i] != '=' || (i + 1 < request.size() && request[i + 1] == '=')) return std::string::npos;
+    return i;
+}
+
+// Applies an assignment whose '=' is at sign, publishing a version of the symbols with the new value
+std::string assign(const std::string& request, std::size_t sign, VersionedSymbolTable& symbols, const batch::BatchOptions& options) {
+    std::size_t name_position = 0;
+    while (std::isspace(static_cast<unsigned char>(request[name_position]))) ++name_position;
+    std::size_t name_end = name_position;
+    while (parser::is_symbol_middle(request[name_end])) ++name_end;
+    std::string name = request.substr(name_position, name_end - name_position);
+
+    // A built-in or function of that name would hide the symbol
+    if (expr::contains(name) || (options.functions_ && options.functions_->find(name))) {
+        return batch::format_error(types::Error{types::ErrorCode::InvalidDefinition, name_position, name});
+    }
+    auto fail = [sign](types::Error error) {
+        error.position_ += sign + 1; // Positions in the whole request
+        return batch::format_error(error);
+    };
+    auto tree = eval::try_parse(request.substr(sign + 1), options.functions_);
+    if (!tree) return fail(tree.error());
+    auto value = eval::try_evaluate(*tree.value(), *symbols.snapshot(), options.numeric_mode_);
+    if (!value) return fail(value.error());
+    symbols.insert_or_assign(name, value.value());
+    return batch::format_numeral(value.value());
+}
+
+/**
+ * Splits the complete frames off the connection's input buffer.
+ * Returns false if the stream is malformed and the connection must be dropped.
+ */
+bool extract_frames(Connection& connection, std::vector<std::string>& frames) {
+    std::string& in = connection.in_;
+    std::size_t begin = 0;
+
+    if (connection.framing_ == Framing::Unknown && !in.empty()) {
+        if (in[0] == '\0') {
+            connection.framing_ = Framing::LengthPrefixed;
+            begin = 1; // Consume the selector byte
+        }
+        else connection.framing_ = Framing::Newline;
+    }
+
+    if (connection.framing_ == Framing::Newline) {
+        while (true) {
+            auto newline = in.find('\n', begin);
+            if (newline == std::string::npos) break;
+            std::size_t end = newline;
+            if (end > begin && in[end - 1] == '\r') --end;
+            frames.emplace_back(in, begin, end - begin);
+            begin = newline + 1;
+        }
+        if (in.size() - begin > kMaxFrameSize) return false;
+    }
+    else if (connection.framing_ == Framing::LengthPrefixed) {
+        while (in.size() - begin >= 4) {
+            auto byte = [&in, begin](std::size_t i) { return static_cast<std::uint32_t>(static_cast<unsigned char>(in[begin + i])); };
+            std::uint32_t size = (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+            if (size > kMaxFrameSize) return false;
+            if (in.size() - begin - 4 < size) break;
+            frames.emplace_back(in, begin + 4, size);
+            begin += 4 + size;
+        }
+    }
+    in.erase(0, begin);
+    return true;
+}
+
+/**
+ * Runs the event loop until a signal arrives on signal_fd or, without a listening socket, until the last client is done.
+ * listen_fd, signal_fd and client_fd may be -1; all given descriptors are closed on return.
+ */
+void run_loop(const server::ServerOptions& options, const SymbolTable& initial, int listen_fd, int signal_fd, int client_fd) {
+    expr::get_node_factory_map(); // Warm up the operator table before accepting requests
+    VersionedSymbolTable symbols(initial);
+
+    int epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    int wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || wake_fd < 0) throw std::runtime_error("Server error: Cannot create event loop");
+
+    // Connection ids above these are clients; the low ids tag the internal descriptors
+    constexpr std::uint64_t kListenId = 0, kWakeId = 1, kSignalId = 2;
+    std::uint64_t next_id = 3;
+    auto add_fd = [epoll_fd](int fd, std::uint64_t id, std::uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.u64 = id;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    };
+    if (listen_fd >= 0) add_fd(listen_fd, kListenId, EPOLLIN);
+    add_fd(wake_fd, kWakeId, EPOLLIN);
+    if (signal_fd >= 0) add_fd(signal_fd, kSignalId, EPOLLIN);
+
+    std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> connections;
+    auto add_connection = [&](int fd) {
+        auto connection = std::make_unique<Connection>();
+        connection->fd_ = fd;
+        connection->events_ = EPOLLIN;
+        add_fd(fd, next_id, EPOLLIN);
+        connections.emplace(next_id++, std::move(connection));
+    };
+    if (client_fd >= 0) add_connection(client_fd);
+
+    auto pool = std::make_unique<WorkerPool>(std::max(1u, options.workers_), symbols, options.evaluation_, wake_fd);
+    std::vector<Job> jobs;
+    std::vector<std::string> frames;
+    std::string read_buffer(kReadSize, '\0');
+
+    // Dispatches the waiting requests in order. An assignment waits until the requests before it have been evaluated,
+    // as they read the symbols when a worker takes them; the requests after it are dispatched once it is applied.
+    auto dispatch = [&](std::uint64_t id, Connection& connection) {
+        for (; !connection.waiting_.empty(); connection.waiting_.pop_front()) {
+            std::string& frame = connection.waiting_.front();
+            std::size_t sign = find_assignment(frame);
+            if (sign == std::string::npos) {
+                jobs.push_back({id, connection.next_sequence_++, std::move(frame)});
+                continue;
+            }
+            if (connection.evaluating() > 0) break;
+            connection.pending_.emplace(connection.next_sequence_++,
+                answer([&] { return assign(frame, sign, symbols, options.evaluation_); }));
+        }
+        pool->submit(std::move(jobs));
+        jobs.clear();
+        deliver(connection);
+    };
+
+    auto close_connection = [&](std::uint64_t id) {
+        auto it = connections.find(id);
+        if (it == connections.end()) return;
+        ::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second->fd_, nullptr);
+        ::close(it->second->fd_);
+        connections.erase(it);
+    };
+
+    // Writes as much as possible, re-registers interest, and closes finished connections.
+    // Returns false if the connection has been closed.
+    auto flush = [&](std::uint64_t id, Connection& connection) {
+        while (connection.out_offset_ < connection.out_.size()) {
+            ssize_t written = ::send(connection.fd_, connection.out_.data() + connection.out_offset_,
+                connection.out_.size() - connection.out_offset_, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                if (errno == EINTR) continue;
+                close_connection(id);
+                return false;
+            }
+            connection.out_offset_ += static_cast<std::size_t>(written);
+        }
+        if (connection.out_offset_ == connection.out_.size()) {
+            connection.out_.clear();
+            connection.out_offset_ = 0;
+        }
+
+        if (connection.read_closed_ && connection.in_flight() == 0 && connection.out_.empty()) {
+            close_connection(id);
+            return false;
+        }
+
+        std::uint32_t events = 0;
+        if (!connection.read_closed_ && connection.in_flight() < options.max_in_flight_) events |= EPOLLIN; // Back-pressure
+        if (!connection.out_.empty()) events |= EPOLLOUT;
+        if (events != connection.events_) {
+            epoll_event event{};
+            event.events = events;
+            event.data.u64 = id;
+            ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, connection.fd_, &event);
+            connection.events_ = events;
+        }
+        return true;
+    };
+
+    bool running = true;
+    epoll_event events[kMaxEvents];
+    while (running && (listen_fd >= 0 || !connections.empty())) {
+        int count = ::epoll_wait(epoll_fd, events, kMaxEvents, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            std::uint64_t id = events[i].data.u64;
+
+            if (id == kSignalId) { // Shut down
+                running = false;
+            }
+            else if (id == kListenId) { // Accept all pending clients
+                while (true) {
+                    int accepted_fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                    if (accepted_fd < 0) break;
+                    add_connection(accepted_fd);
+                }
+            }
+            else if (id == kWakeId) { // Collect completed requests, write those whose turn has come
+                std::uint64_t value;
+                [[maybe_unused]] auto drained = ::read(wake_fd, &value, sizeof(value));
+
+                std::vector<std::uint64_t> touched;
+                for (auto& completion : pool->take_completions()) {
+                    auto it = connections.find(completion.connection_);
+                    if (it == connections.end()) continue; // Client went away
+                    it->second->pending_.emplace(completion.sequence_, std::move(completion.response_));
+                    touched.push_back(completion.connection_);
+                }
+                for (auto touched_id : touched) {
+                    auto it = connections.find(touched_id);
+                    if (it == connections.end()) continue;
+                    Connection& connection = *it->second;
+                    if (connection.pending_.empty() && connection.waiting_.empty()) continue; // Already flushed for an earlier completion
+                    dispatch(touched_id, connection);
+                    flush(touched_id, connection);
+                }
+            }
+            else { // Client connection
+                auto it = connections.find(id);
+                if (it == connections.end()) continue;
+                Connection& connection = *it->second;
+
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) { // Peer is gone, nobody will read the responses
+                    close_connection(id);
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    bool alive = true;
+                    while (!connection.read_closed_ && connection.in_flight() < options.max_in_flight_) {
+                        ssize_t received = ::read(connection.fd_, read_buffer.data(), read_buffer.size());
+                        if (received > 0) {
+                            connection.in_.append(read_buffer.data(), static_cast<std::size_t>(received));
+                            if (static_cast<std::size_t>(received) < read_buffer.size()) break;
+                        }
+                        else if (received == 0) connection.read_closed_ = true;
+                        else if (errno == EINTR) continue;
+                        else if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                        else {
+                            alive = false;
+                            break;
+                        }
+                    }
+
+                    frames.clear();
+                    if (!alive || !extract_frames(connection, frames)) {
+                        close_connection(id);
+                        continue;
+                    }
+                    for (auto& frame : frames) connection.waiting_.push_back(std::move(frame));
+                    dispatch(id, connection);
+                }
+                if (!flush(id, connection)) continue;
+            }
+        }
+    }
+
+    pool.reset(); // Join the workers before their wake-up descriptor goes away
+    for (auto& [id, connection] : connections) ::close(connection->fd_);
+    connections.clear();
+    if (signal_fd >= 0) ::close(signal_fd);
+    ::close(wake_fd);
+    ::close(epoll_fd);
+    if (listen_fd >= 0) ::close(listen_fd);
+}
+
+} // namespace
+
+std::string server::evaluate_request(const std::string& expression, const SymbolTable& symbols, const batch::BatchOptions& options) {
+    return batch::evaluate_line(expression, symbols, options).output_;
+}
+
+void server::serve(const ServerOptions& options, const SymbolTable& symbols) {
+    // Only a stale socket from a previous run may be replaced, never a file that happens to have the name
+    struct stat existing;
+    if (::lstat(options.socket_path_.c_str(), &existing) == 0 && !S_ISSOCK(existing.st_mode)) {
+        throw std::runtime_error("Server error: '" + options.socket_path_ + "' exists and is not a socket");
+    }
+
+    // Route SIGINT/SIGTERM to a signalfd; blocked before the workers start so that they inherit the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    // Listening socket
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (options.socket_path_.size() >= sizeof(address.sun_path)) throw std::runtime_error("Server error: Socket path too long");
+    std::strcpy(address.sun_path, options.socket_path_.c_str());
+
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) throw std::runtime_error(std::string("Server error: socket failed: ") + std::strerror(errno));
+    ::unlink(options.socket_path_.c_str()); // Remove a stale socket from a previous run, checked above
+    if (::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listen_fd, SOMAXCONN) < 0) {
+        std::string message = std::string("Server error: Cannot listen on '") + options.socket_path_ + "': " + std::strerror(errno);
+        ::close(listen_fd);
+        throw std::runtime_error(message);
+    }
+
+
+    int signal_fd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0) {
+        ::close(listen_fd);
+        throw std::runtime_error("Server error: Cannot create event loop");
+    }
+    run_loop(options, symbols, listen_fd, signal_fd, -1);
+    ::unlink(options.socket_path_.c_str());
+}
+
+void server::serve_connection(int fd, const ServerOptions& options, const SymbolTable& symbols) {
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    run_loop(options, symbols, -1, -1, fd);
+}
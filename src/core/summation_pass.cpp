@@ -0,0 +1,103 @@
+#include "core/summation_pass.h"
+#include "functional/stats.h"
+
+namespace {
+
+bool is_sum(const expr::ExprNode* node) {
+    return dynamic_cast<const expr::AdditionNode*>(node) || dynamic_cast<const expr::SubtractionNode*>(node);
+}
+
+// The terms of a chain of additions and subtractions, in source order, with their signs
+void gather(std::unique_ptr<expr::ExprNode>&& node, types::Numeral sign, std::vector<std::unique_ptr<expr::ExprNode>>& terms,
+    std::vector<types::Numeral>& signs) {
+
+    if (!is_sum(node.get())) {
+        terms.push_back(std::move(node));
+        signs.push_back(sign);
+        return;
+    }
+    const bool subtraction = dynamic_cast<const expr::SubtractionNode*>(node.get()) != nullptr;
+    auto first = node->replaceChild(0, nullptr);
+    auto second = node->replaceChild(1, nullptr);
+    gather(std::move(first), sign, terms, signs);
+    gather(std::move(second), subtraction ? -sign : sign, terms, signs);
+}
+
+// Terms of the chain below node, counting itself
+std::size_t term_count(const expr::ExprNode* node) {
+    return is_sum(node) ? term_count(node->child(0)) + term_count(node->child(1)) : 1;
+}
+
+void collect(std::unique_ptr<expr::ExprNode>& node, std::size_t& count) {
+    if (is_sum(node.get()) && term_count(node.get()) >= 3) {
+        const std::size_t position = node->getPosition();
+        std::vector<std::unique_ptr<expr::ExprNode>> terms;
+        std::vector<types::Numeral> signs;
+        gather(std::move(node), 1, terms, signs);
+        node = std::make_unique<summation::ExactSumNode>(std::move(terms), std::move(signs));
+        node->setPosition(position);
+        ++count;
+    }
+    for (std::size_t i = 0; i < node->childCount(); ++i) {
+        auto child = node->replaceChild(i, nullptr);
+        collect(child, count);
+        node->replaceChild(i, std::move(child));
+    }
+}
+
+} // namespace
+
+summation::ExactSumNode::ExactSumNode(std::vector<std::unique_ptr<expr::ExprNode>>&& children, std::vector<types::Numeral> signs) :
+    MultinaryNode(std::move(children)), signs_(std::move(signs)) {}
+
+types::Numeral summation::ExactSumNode::evaluate(const SymbolTable& symbols) const {
+    stats::ExactSum sum;
+    for (std::size_t i = 0; i < children_.size(); ++i) sum.add(signs_[i] * children_[i]->evaluate(symbols));
+    return sum.value();
+}
+
+types::Numeral summation::ExactSumNode::evaluateAt(const SymbolTable& symbols,
+    const std::unordered_map<types::Symbol, types::Numeral>& variables) const {
+    stats::ExactSum sum;
+    for (std::size_t i = 0; i < children_.size(); ++i) sum.add(signs_[i] * children_[i]->evaluateAt(symbols, variables));
+    return sum.value();
+}
+
+types::Numeral summation::ExactSumNode::evaluateChecked(const SymbolTable& symbols, expr::EvalStatus& status) const noexcept {
+    stats::ExactSum sum;
+    for (std::size_t i = 0; i < children_.size(); ++i) sum.add(signs_[i] * children_[i]->evaluateChecked(symbols, status));
+    return sum.value();
+}
+
+expr::Dual summation::ExactSumNode::evaluateDual(const SymbolTable& symbols, expr::ForwardContext& context) const {
+    stats::ExactSum sum, tangent;
+    for (std::size_t i = 0; i < children_.size(); ++i) {
+        expr::Dual term = children_[i]->evaluateDual(symbols, context);
+        sum.add(signs_[i] * term.value_);
+        tangent.add(signs_[i] * term.tangent_);
+    }
+    return expr::Dual{sum.value(), tangent.value()};
+}
+
+expr::TapeValue summation::ExactSumNode::record(const SymbolTable& symbols, expr::Tape& tape) const {
+    // A chain of binary entries, the partial sums rounded as they go but the last one the exact sum
+    stats::ExactSum sum;
+    expr::TapeValue total = tape.constant(0);
+    for (std::size_t i = 0; i < children_.size(); ++i) {
+        expr::TapeValue term = children_[i]->record(symbols, tape);
+        sum.add(signs_[i] * term.value_);
+        const types::Numeral value = i + 1 == children_.size() ? sum.value() : total.value_ + signs_[i] * term.value_;
+        total = tape.binary(value, total, 1, term, signs_[i]);
+    }
+    return total;
+}
+
+std::unique_ptr<expr::ExprNode> summation::ExactSumNode::clone() const {
+    return positioned(std::make_unique<ExactSumNode>(cloneChildren(), signs_));
+}
+
+std::size_t summation::collect_sums(std::unique_ptr<expr::ExprNode>& tree) {
+    std::size_t count = 0;
+    collect(tree, count);
+    return count;
+}
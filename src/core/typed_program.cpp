@@ -0,0 +1,786 @@
+#include "core/typed_program.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include "core/eval.h"
+#include "core/functions.h"
+#include "core/polynomial_pass.h"
+#include "functional/elementary.h"
+#include "functional/numbers.h"
+#ifdef CALC_HAS_FLOAT128
+extern "C" {
+#include <quadmath.h>
+}
+#endif
+
+namespace {
+
+constexpr double kMaxFallingProduct = 1100; // Longest falling product of binom(n, k); longer ones overflow or go through double
+
+// More digits than any of the types holds, rounded once by from_string
+constexpr const char* kPiDigits = "3.14159265358979323846264338327950288419716939937510582097494459";
+constexpr const char* kEDigits = "2.71828182845904523536028747135266249775724709369995957496696763";
+
+// Thrown by Program::compile for a node the type cannot evaluate, caught by the constructor
+struct Unsupported {
+    types::Error error_;
+};
+
+// Call frame of the scalar evaluation
+struct Frame {
+    std::size_t return_;   // Instruction to resume at
+    std::size_t base_;     // Stack index of the first argument
+    std::size_t position_; // Position of the call, reported for errors in the body
+};
+
+template <typename T>
+T horner(const std::vector<T>& coefficients, T x) noexcept {
+    T result = coefficients.back();
+    for (std::size_t k = coefficients.size() - 1; k-- > 0; ) result = result * x + coefficients[k];
+    return result;
+}
+
+// Identifies the function of an elementary node
+bool elementary_function(const expr::ExprNode& node, elementary::Function& function) noexcept {
+    if (dynamic_cast<const expr::SqrtNode*>(&node)) function = elementary::Function::Sqrt;
+    else if (dynamic_cast<const expr::ExpNode*>(&node)) function = elementary::Function::Exp;
+    else if (dynamic_cast<const expr::LogNode*>(&node)) function = elementary::Function::Log;
+    else if (dynamic_cast<const expr::SinNode*>(&node)) function = elementary::Function::Sin;
+    else if (dynamic_cast<const expr::CosNode*>(&node)) function = elementary::Function::Cos;
+    else if (dynamic_cast<const expr::GammaNode*>(&node)) function = elementary::Function::Gamma;
+    else if (dynamic_cast<const expr::LogGammaNode*>(&node)) function = elementary::Function::LogGamma;
+    else if (dynamic_cast<const expr::FactorialNode*>(&node)) function = elementary::Function::Factorial;
+    else return false;
+    return true;
+}
+
+template <typename T>
+T fused_multiply_add(T a, T b, T c) noexcept {
+#ifdef CALC_HAS_FLOAT128
+    if constexpr (std::is_same_v<T, __float128>) return fmaq(a, b, c);
+    else
+#endif
+    return std::fma(a, b, c);
+}
+
+// n! in T for every n whose factorial is finite, rounded once as numbers::factorial's table is for double: each
+// product is carried with its rounding error, which the fused multiply-add gives exactly, and only the entry rounds
+template <typename T>
+const std::vector<T>& factorial_table() {
+    static const std::vector<T> table = [] {
+        std::vector<T> values{T(1)};
+        T high = 1, low = 0;
+        for (T n = 1; ; n += 1) {
+            T product = high * n;
+            if (product - product != 0) return values; // Overflowed
+            T error = fused_multiply_add(high, n, -product) + low * n;
+            high = product + error;
+            low = error - (high - product);
+            values.push_back(high);
+        }
+    }();
+    return table;
+}
+
+// x! or gamma(x) of an integer the table holds; tgamma is off by an ulp or more there
+template <typename T>
+bool tabulated_factorial(elementary::Function function, T x, T& value) {
+    if (function != elementary::Function::Factorial && function != elementary::Function::Gamma) return false;
+    const auto& table = factorial_table<T>();
+    T n = function == elementary::Function::Gamma ? x - 1 : x;
+    if (!(n >= 0 && n < static_cast<T>(table.size()))) return false; // NaN too
+    auto index = static_cast<std::size_t>(n);
+    if (static_cast<T>(index) != n) return false;
+    value = table[index];
+    return true;
+}
+
+// Elementary functions in the inexact types; double goes through functional/elementary.h and --fast-math
+template <typename T>
+T evaluate_function(elementary::Function function, T x) noexcept {
+    if constexpr (std::is_same_v<T, double>) return elementary::evaluate(function, x);
+    else if (T value; tabulated_factorial(function, x, value)) return value;
+#ifdef CALC_HAS_FLOAT128
+    else if constexpr (std::is_same_v<T, __float128>) {
+        switch (function) {
+        case elementary::Function::Sqrt: return sqrtq(x);
+        case elementary::Function::Exp: return expq(x);
+        case elementary::Function::Log: return logq(x);
+        case elementary::Function::Sin: return sinq(x);
+        case elementary::Function::Cos: return cosq(x);
+        case elementary::Function::Gamma: return tgammaq(x);
+        case elementary::Function::LogGamma: return lgammaq(x);
+        case elementary::Function::Factorial: return tgammaq(x + 1);
+        } // switch (function)
+        return x;
+    }
+#endif
+    else {
+        switch (function) {
+        case elementary::Function::Sqrt: return std::sqrt(x);
+        case elementary::Function::Exp: return std::exp(x);
+        case elementary::Function::Log: return std::log(x);
+        case elementary::Function::Sin: return std::sin(x);
+        case elementary::Function::Cos: return std::cos(x);
+        case elementary::Function::Gamma: return std::tgamma(x);
+        case elementary::Function::LogGamma: return std::lgamma(x);
+        case elementary::Function::Factorial: return std::tgamma(x + 1);
+        } // switch (function)
+        return x;
+    }
+}
+
+// x^y in the inexact types
+template <typename T>
+T evaluate_power(T x, T y) noexcept {
+    if constexpr (std::is_same_v<T, double>) return elementary::pow(x, y);
+#ifdef CALC_HAS_FLOAT128
+    else if constexpr (std::is_same_v<T, __float128>) return powq(x, y);
+#endif
+    else return std::pow(x, y);
+}
+
+// binom(n, k) in the inexact types: a falling product in T for an integer k, else through double
+template <typename T>
+T evaluate_binomial(T n, T k) noexcept {
+    if constexpr (std::is_same_v<T, double>) return numbers::binomial(n, k);
+    else {
+        auto integer = [](T x) { return static_cast<double>(x) == std::trunc(static_cast<double>(x)) && static_cast<T>(static_cast<double>(x)) == x; };
+        if (!integer(k) || (integer(n) && n < 0) || k > kMaxFallingProduct) return static_cast<T>(numbers::binomial(static_cast<double>(n), static_cast<double>(k)));
+        if (k < 0 || (integer(n) && k > n)) return 0;
+        if (integer(n) && n - k < k) k = n - k;
+        T value = 1;
+        for (T j = 0; j < k; j += 1) value = value * (n - j) / (j + 1);
+        return value;
+    }
+}
+
+// x! or gamma(x) of an integer exactly; code receives the reason if there is none
+types::Rational exact_factorial(elementary::Function function, const types::Rational& x, types::ErrorCode& code) {
+    types::Rational n = function == elementary::Function::Gamma ? x - 1 : x;
+    if (!x.isInteger()) code = types::ErrorCode::Inexact;
+    else if (n < 0) code = types::ErrorCode::OutOfDomain;
+    else if (n > types::Rational(static_cast<std::int64_t>(numbers::kMaxExactFactorial))) code = types::ErrorCode::TooLarge;
+    else return types::Rational(numbers::factorial_exact(static_cast<std::uint64_t>(n.toDouble())));
+    return types::Rational();
+}
+
+// binom(n, k) of integers exactly, with the conventions of numbers::binomial; code receives the reason if there is none
+types::Rational exact_binomial(types::Rational n, types::Rational k, types::ErrorCode& code) {
+    if (!n.isInteger() || !k.isInteger()) {
+        code = types::ErrorCode::Inexact;
+        return types::Rational();
+    }
+    if (k < 0) return 0;
+    bool negate = false;
+    if (n < 0) { // binom(n, k) = (-1)^k binom(k - n - 1, k)
+        negate = std::fmod(k.toDouble(), 2) != 0;
+        n = k - n - 1;
+    }
+    if (k > n) return 0;
+    if (n > types::Rational(static_cast<std::int64_t>(numbers::kMaxExactFactorial))) {
+        code = types::ErrorCode::TooLarge;
+        return types::Rational();
+    }
+    types::Rational value(numbers::binomial_exact(static_cast<std::uint64_t>(n.toDouble()), static_cast<std::uint64_t>(k.toDouble())));
+    return negate ? -value : value;
+}
+
+// x^y for an integer y, by repeated squaring; x must not be 0 if y is negative
+types::Rational integer_power(types::Rational x, const types::Rational& y) {
+    auto exponent = static_cast<std::int64_t>(y.toDouble());
+    types::Rational result(1);
+    for (std::uint64_t n = exponent < 0 ? 0 - static_cast<std::uint64_t>(exponent) : exponent; n != 0; n >>= 1) {
+        if (n & 1) result *= x;
+        if (n > 1) x *= x;
+    }
+    return exponent < 0 ? types::Rational(1) / result : result;
+}
+
+// Applies an elementwise operation to the two topmost lanes, leaving the result in the lower one
+template <typename T, typename F>
+void apply(T* a, const T* b, std::size_t count, F f) noexcept {
+    for (std::size_t i = 0; i < count; ++i) a[i] = f(a[i], b[i]);
+}
+
+} // namespace
+
+typed::NumericType typed::parse_numeric_type(const std::string& name) {
+    if (name == "float") return NumericType::Float;
+    if (name == "double") return NumericType::Double;
+    if (name == "long-double") return NumericType::LongDouble;
+    if (name == "rational") return NumericType::Rational;
+    if (name == "float128") {
+#ifdef CALC_HAS_FLOAT128
+        return NumericType::Float128;
+#else
+        throw std::invalid_argument("Invalid command line argument: float128 is not available in this build");
+#endif
+    }
+    throw std::invalid_argument("Invalid command line argument: --type expects float, double, long-double, float128 or rational");
+}
+
+const char* typed::numeric_type_name(NumericType type) noexcept {
+    switch (type) {
+    case NumericType::Float: return "float";
+    case NumericType::Double: return "double";
+    case NumericType::LongDouble: return "long-double";
+    case NumericType::Float128: return "float128";
+    case NumericType::Rational: return "rational";
+    default: return "unknown";
+    } // switch (type)
+}
+
+template <typename T>
+T typed::from_string(const std::string& str) {
+    if constexpr (std::is_same_v<T, types::Rational>) return types::Rational::fromString(str);
+    else {
+        const char* begin = str.c_str();
+        char* end = nullptr;
+        T value;
+        if constexpr (std::is_same_v<T, float>) value = std::strtof(begin, &end);
+        else if constexpr (std::is_same_v<T, double>) value = std::strtod(begin, &end);
+        else if constexpr (std::is_same_v<T, long double>) value = std::strtold(begin, &end);
+#ifdef CALC_HAS_FLOAT128
+        else value = strtoflt128(begin, &end);
+#endif
+        if (end == begin || *end != '\0') throw std::invalid_argument("Numerical error: '" + str + "' is not a valid number");
+        return value;
+    }
+}
+
+template <typename T>
+std::string typed::to_string(T value) {
+    char buf[128];
+    if constexpr (std::is_same_v<T, types::Rational>) return value.toString();
+#ifdef CALC_HAS_FLOAT128
+    else if constexpr (std::is_same_v<T, __float128>) {
+        int length = quadmath_snprintf(buf, sizeof(buf), "%.33Qg", value);
+        return std::string(buf, std::min<std::size_t>(static_cast<std::size_t>(std::max(length, 0)), sizeof(buf) - 1));
+    }
+#endif
+    else {
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value); // Shortest round trip
+        return std::string(buf, end);
+    }
+}
+
+template <typename T>
+T typed::from_numeral(types::Numeral value) {
+    if constexpr (std::is_same_v<T, double>) return value;
+    else {
+        if (!std::isfinite(value)) {
+            if constexpr (std::is_same_v<T, types::Rational>) throw std::invalid_argument("Numerical error: Infinity has no exact value");
+            else return static_cast<T>(value);
+        }
+        char buf[64];
+        auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+        return from_string<T>(std::string(buf, end));
+    }
+}
+
+template <typename T>
+std::uint32_t typed::Program<T>::constant(T value) {
+    constants_.push_back(value);
+    return static_cast<std::uint32_t>(constants_.size() - 1);
+}
+
+template <typename T>
+std::uint32_t typed::Program<T>::symbol(const types::Symbol& name, std::size_t position) {
+    auto it = std::find(symbols_.begin(), symbols_.end(), name);
+    if (it != symbols_.end()) return static_cast<std::uint32_t>(it - symbols_.begin());
+    symbols_.push_back(name);
+    symbol_positions_.push_back(position);
+    return static_cast<std::uint32_t>(symbols_.size() - 1);
+}
+
+template <typename T>
+void typed::Program<T>::compile(const expr::ExprNode& node, bool lazy, std::size_t depth, std::vector<Instruction>& code,
+    std::vector<const expr::ExprNode*>& bodies) {
+
+    stack_size_ = std::max(stack_size_, depth + 1);
+    const std::size_t position = node.getPosition();
+    auto emit = [&code, position](Op op, std::uint32_t operand = 0) {
+        code.push_back(Instruction{op, operand, position});
+        return code.size() - 1;
+    };
+    auto operands = [&](Op op) {
+        for (std::size_t i = 0; i < node.childCount(); ++i) compile(*node.child(i), lazy, depth + i, code, bodies);
+        emit(op);
+    };
+
+    if (auto* numeral = dynamic_cast<const expr::NumeralNode*>(&node)) { // Rounded once from the literal, not through its double
+        const bool written = !std::is_same_v<T, double> && !numeral->text().empty();
+        types::Numeral value = node.evaluate(SymbolTable());
+        if (std::is_same_v<T, types::Rational> && !written && !std::isfinite(value)) {
+            throw Unsupported{types::Error{types::ErrorCode::NoExactValue, position, "Infinity"}};
+        }
+        emit(Op::Constant, constant(written ? from_string<T>(numeral->text()) : from_numeral<T>(value)));
+    }
+    else if (dynamic_cast<const expr::PiNode*>(&node) || dynamic_cast<const expr::ENode*>(&node)) {
+        bool pi = dynamic_cast<const expr::PiNode*>(&node) != nullptr;
+        if constexpr (std::is_same_v<T, types::Rational>) {
+            throw Unsupported{types::Error{types::ErrorCode::NoExactValue, position, pi ? "pi" : "e"}};
+        }
+        else emit(Op::Constant, constant(from_string<T>(pi ? kPiDigits : kEDigits)));
+    }
+    else if (auto* symbol_node = dynamic_cast<const expr::SymbolNode*>(&node)) emit(Op::Load, symbol(symbol_node->getSymbolName(), position));
+    else if (auto* parameter = dynamic_cast<const functions::ParameterNode*>(&node)) {
+        emit(Op::Parameter, static_cast<std::uint32_t>(parameter->index()));
+    }
+    else if (auto* polynomial = dynamic_cast<const poly::PolynomialNode*>(&node)) {
+        compile(*node.child(0), lazy, depth, code, bodies);
+        std::vector<T> coefficients;
+        for (auto coefficient : polynomial->polynomial().coefficients()) {
+            if (std::is_same_v<T, types::Rational> && !std::isfinite(coefficient)) {
+                throw Unsupported{types::Error{types::ErrorCode::NoExactValue, position, "Infinity"}};
+            }
+            coefficients.push_back(from_numeral<T>(coefficient));
+        }
+        polynomials_.push_back(std::move(coefficients));
+        emit(Op::Polynomial, static_cast<std::uint32_t>(polynomials_.size() - 1));
+    }
+    else if (elementary::Function function; elementary_function(node, function)) {
+        if constexpr (std::is_same_v<T, types::Rational>) { // Only factorials of integers have exact values
+            if (function != elementary::Function::Factorial && function != elementary::Function::Gamma) {
+                throw Unsupported{types::Error{types::ErrorCode::NoExactValue, position, elementary::function_name(function)}};
+            }
+        }
+        compile(*node.child(0), lazy, depth, code, bodies);
+        emit(Op::Elementary, static_cast<std::uint32_t>(function));
+    }
+    else if (dynamic_cast<const expr::PowerNode*>(&node)) operands(Op::Power);
+    else if (dynamic_cast<const expr::BinomialNode*>(&node)) operands(Op::Binomial);
+    else if (dynamic_cast<const expr::PositiveNode*>(&node)) compile(*node.child(0), lazy, depth, code, bodies);
+    else if (dynamic_cast<const expr::NegativeNode*>(&node)) operands(Op::Negate);
+    else if (dynamic_cast<const expr::AdditionNode*>(&node)) operands(Op::Add);
+    else if (dynamic_cast<const expr::SubtractionNode*>(&node)) operands(Op::Subtract);
+    else if (dynamic_cast<const expr::MultiplicationNode*>(&node)) operands(Op::Multiply);
+    else if (dynamic_cast<const expr::DivisionNode*>(&node)) { // The divisor first, as DivisionNode evaluates it, then b / a
+        compile(*node.child(1), lazy, depth, code, bodies);
+        compile(*node.child(0), lazy, depth + 1, code, bodies);
+        emit(Op::DivideReversed);
+    }
+    else if (dynamic_cast<const expr::DotNode*>(&node)) operands(Op::Multiply); // The meanings of scalars
+    else if (dynamic_cast<const expr::SolveNode*>(&node)) operands(Op::DivideReversed); // a first, then b / a
+    else if (dynamic_cast<const expr::TransposeNode*>(&node) || dynamic_cast<const expr::DeterminantNode*>(&node)) {
+        compile(*node.child(0), lazy, depth, code, bodies);
+    }
+    else if (dynamic_cast<const expr::LessNode*>(&node)) operands(Op::Less);
+    else if (dynamic_cast<const expr::LessEqualNode*>(&node)) operands(Op::LessEqual);
+    else if (dynamic_cast<const expr::GreaterNode*>(&node)) operands(Op::Greater);
+    else if (dynamic_cast<const expr::GreaterEqualNode*>(&node)) operands(Op::GreaterEqual);
+    else if (dynamic_cast<const expr::EqualNode*>(&node)) operands(Op::Equal);
+    else if (dynamic_cast<const expr::NotEqualNode*>(&node)) operands(Op::NotEqual);
+    else if (dynamic_cast<const expr::NotNode*>(&node)) operands(Op::Not);
+    else if (dynamic_cast<const expr::AndNode*>(&node) || dynamic_cast<const expr::OrNode*>(&node)) {
+        bool is_and = dynamic_cast<const expr::AndNode*>(&node) != nullptr;
+        if (!lazy) return operands(is_and ? Op::And : Op::Or);
+
+        // first; jump to the decided result; second; truth; jump to the end; decided: constant
+        compile(*node.child(0), lazy, depth, code, bodies);
+        std::size_t decided = emit(is_and ? Op::JumpIfZero : Op::JumpIfNonZero);
+        compile(*node.child(1), lazy, depth, code, bodies);
+        emit(Op::Truth);
+        std::size_t done = emit(Op::Jump);
+        code[decided].operand_ = static_cast<std::uint32_t>(code.size());
+        emit(Op::Constant, constant(is_and ? 0 : 1));
+        code[done].operand_ = static_cast<std::uint32_t>(code.size());
+    }
+    else if (dynamic_cast<const expr::ConditionalNode*>(&node)) {
+        if (!lazy) return operands(Op::Select);
+
+        // condition; jump to else if 0; then; jump to the end; else
+        compile(*node.child(0), lazy, depth, code, bodies);
+        std::size_t otherwise = emit(Op::JumpIfZero);
+        compile(*node.child(1), lazy, depth, code, bodies);
+        std::size_t done = emit(Op::Jump);
+        code[otherwise].operand_ = static_cast<std::uint32_t>(code.size());
+        compile(*node.child(2), lazy, depth, code, bodies);
+        code[done].operand_ = static_cast<std::uint32_t>(code.size());
+    }
+    else if (auto* call = dynamic_cast<const functions::CallNode*>(&node)) {
+        if (!lazy) throw std::logic_error("call"); // Caught by the constructor, which drops the bulk code
+        for (std::size_t i = 0; i < node.childCount(); ++i) compile(*node.child(i), lazy, depth + i, code, bodies);
+
+        // Each function is compiled once, after the expression
+        const expr::ExprNode* body = &call->function().body();
+        std::size_t index = std::find(bodies.begin(), bodies.end(), body) - bodies.begin();
+        if (index == bodies.size()) {
+            bodies.push_back(body);
+            functions_.push_back(Function{call->function().name(), call->function().arity(), 0});
+        }
+        emit(Op::Call, static_cast<std::uint32_t>(index));
+    }
+    else throw std::invalid_argument("Internal error: Node cannot be evaluated in another numeric type");
+}
+
+template <typename T>
+typed::Program<T>::Program(const expr::ExprNode& tree) {
+    if (const auto* node = eval::find_too_deep(tree)) { // The compiler recurses into the tree
+        error_ = types::Error{types::ErrorCode::TooDeep, node->getPosition()};
+        return;
+    }
+    std::vector<const expr::ExprNode*> bodies;
+    try {
+        compile(tree, true, 0, code_, bodies);
+        code_.push_back(Instruction{Op::Halt});
+        std::size_t stack_size = stack_size_; // Bodies run on frames above the expression's stack
+        for (std::size_t i = 0; i < bodies.size(); ++i) { // Bodies may call further functions
+            functions_[i].entry_ = code_.size();
+            compile(*bodies[i], true, 0, code_, bodies);
+            code_.push_back(Instruction{Op::Return});
+        }
+        stack_size_ = stack_size;
+    }
+    catch (const Unsupported& unsupported) { // Reported by every evaluation instead
+        error_ = unsupported.error_;
+        code_.clear();
+        return;
+    }
+
+    if (!bodies.empty()) return;
+    try {
+        compile(tree, false, 0, bulk_code_, bodies);
+    }
+    catch (const std::logic_error&) {
+        bulk_code_.clear();
+    }
+}
+
+template <typename T>
+T typed::Program<T>::evaluate(const T* values, expr::EvalStatus& status) const noexcept {
+    const T kNaN = std::numeric_limits<T>::quiet_NaN(); // 0 for types::Rational
+    std::vector<T> stack;
+    std::vector<Frame> frames;
+    stack.reserve(stack_size_);
+    auto fail = [&](types::ErrorCode code, std::size_t position) {
+        status.fail(code, frames.empty() ? position : frames.front().position_); // Positions in bodies are meaningless
+        return kNaN;
+    };
+    if (!compiled()) {
+        if (status.ok()) status.symbol_ = &error_.detail_;
+        return fail(error_.code_, error_.position_);
+    }
+
+    for (std::size_t pc = 0; ; ) {
+        const Instruction& instruction = code_[pc++];
+        switch (instruction.op_) {
+        case Op::Constant: stack.push_back(constants_[instruction.operand_]); break;
+        case Op::Load: stack.push_back(values[instruction.operand_]); break;
+        case Op::Parameter: stack.push_back(stack[frames.back().base_ + instruction.operand_]); break;
+        case Op::Negate: stack.back() = -stack.back(); break;
+        case Op::Not: stack.back() = stack.back() == 0 ? 1 : 0; break;
+        case Op::Truth: stack.back() = stack.back() != 0 ? 1 : 0; break;
+        case Op::Polynomial: stack.back() = horner(polynomials_[instruction.operand_], stack.back()); break;
+        case Op::Elementary: {
+            auto function = static_cast<elementary::Function>(instruction.operand_);
+            if constexpr (std::is_same_v<T, types::Rational>) { // Compiled for factorials only
+                types::ErrorCode code = types::ErrorCode::None;
+                stack.back() = exact_factorial(function, stack.back(), code);
+                if (code != types::ErrorCode::None) {
+                    if (status.ok()) status.symbol_ = &elementary::function_name(function);
+                    return fail(code, instruction.position_);
+                }
+            }
+            else {
+                if (status.mode_ == expr::NumericMode::Strict && !elementary::in_domain(function, static_cast<double>(stack.back()))) {
+                    if (status.ok()) status.symbol_ = &elementary::function_name(function);
+                    return fail(types::ErrorCode::OutOfDomain, instruction.position_);
+                }
+                stack.back() = evaluate_function(function, stack.back());
+            }
+            break;
+        }
+        case Op::Jump: pc = instruction.operand_; break;
+        case Op::JumpIfZero: case Op::JumpIfNonZero: {
+            bool zero = stack.back() == 0;
+            stack.pop_back();
+            if (zero == (instruction.op_ == Op::JumpIfZero)) pc = instruction.operand_;
+            break;
+        }
+        case Op::Call: {
+            const Function& function = functions_[instruction.operand_];
+            if (frames.size() >= functions::kMaxCallDepth) {
+                if (status.ok()) status.symbol_ = &function.name_;
+                return fail(types::ErrorCode::CallDepth, instruction.position_);
+            }
+            frames.push_back(Frame{pc, stack.size() - function.arity_, instruction.position_});
+            pc = function.entry_;
+            break;
+        }
+        case Op::Return: {
+            T result = stack.back();
+            stack.resize(frames.back().base_);
+            stack.push_back(result);
+            pc = frames.back().return_;
+            frames.pop_back();
+            break;
+        }
+        case Op::Halt: return stack.back();
+        default: { // Binary operations
+            T b = stack.back();
+            stack.pop_back();
+            T& a = stack.back();
+            switch (instruction.op_) {
+            case Op::Add: a += b; break;
+            case Op::Subtract: a -= b; break;
+            case Op::Multiply: a *= b; break;
+            case Op::DivideReversed:
+                if (a == 0 && (status.mode_ == expr::NumericMode::Strict || !std::numeric_limits<T>::has_infinity)) return fail(types::ErrorCode::DivisionByZero, instruction.position_);
+                a = b / a;
+                break;
+            case Op::Power:
+                if (a == 0 && b < 0 && (status.mode_ == expr::NumericMode::Strict || !std::numeric_limits<T>::has_infinity)) return fail(types::ErrorCode::DivisionByZero, instruction.position_);
+                if constexpr (std::is_same_v<T, types::Rational>) {
+                    if (!b.isInteger()) {
+                        if (status.ok()) status.symbol_ = &expr::PowerNode::name();
+                        return fail(types::ErrorCode::OutOfDomain, instruction.position_);
+                    }
+                    a = integer_power(a, b);
+                }
+                else {
+                    if (status.mode_ == expr::NumericMode::Strict && !elementary::pow_in_domain(static_cast<double>(a), static_cast<double>(b))) {
+                        if (status.ok()) status.symbol_ = &expr::PowerNode::name();
+                        return fail(types::ErrorCode::OutOfDomain, instruction.position_);
+                    }
+                    a = evaluate_power(a, b);
+                }
+                break;
+            case Op::Binomial:
+                if constexpr (std::is_same_v<T, types::Rational>) {
+                    types::ErrorCode code = types::ErrorCode::None;
+                    a = exact_binomial(a, b, code);
+                    if (code != types::ErrorCode::None) {
+                        if (status.ok()) status.symbol_ = &expr::BinomialNode::name();
+                        return fail(code, instruction.position_);
+                    }
+                }
+                else {
+                    if (status.mode_ == expr::NumericMode::Strict && !numbers::binomial_in_domain(static_cast<double>(a), static_cast<double>(b))) {
+                        if (status.ok()) status.symbol_ = &expr::BinomialNode::name();
+                        return fail(types::ErrorCode::OutOfDomain, instruction.position_);
+                    }
+                    a = evaluate_binomial(a, b);
+                }
+                break;
+            case Op::Less: a = a < b ? 1 : 0; break;
+            case Op::LessEqual: a = a <= b ? 1 : 0; break;
+            case Op::Greater: a = a > b ? 1 : 0; break;
+            case Op::GreaterEqual: a = a >= b ? 1 : 0; break;
+            case Op::Equal: a = a == b ? 1 : 0; break;
+            case Op::NotEqual: a = a != b ? 1 : 0; break;
+            default: return fail(types::ErrorCode::None, instruction.position_); // Eager operations are not in code_
+            } // switch (instruction.op_)
+        }
+        } // switch (instruction.op_)
+    }
+}
+
+template <typename T>
+types::Expected<T> typed::Program<T>::evaluate(const SymbolTable& symbols, expr::NumericMode mode) const {
+    if (!compiled()) return error_;
+    std::vector<T> values(symbols_.size());
+    for (std::size_t i = 0; i < symbols_.size(); ++i) {
+        const types::Numeral* value = symbols.find(symbols_[i]);
+        if (!value) return types::Error{types::ErrorCode::UndefinedSymbol, symbol_positions_[i], symbols_[i]};
+        if (std::is_same_v<T, types::Rational> && !std::isfinite(*value)) {
+            return types::Error{types::ErrorCode::NoExactValue, symbol_positions_[i], "Infinity"};
+        }
+        values[i] = from_numeral<T>(*value);
+    }
+    expr::EvalStatus status;
+    status.mode_ = mode;
+    T result = evaluate(values.data(), status);
+    if (!status.ok()) return types::Error{status.code_, status.position_, status.symbol_ ? *status.symbol_ : std::string()};
+    return result;
+}
+
+template <typename T>
+void typed::Program<T>::evaluateBulk(const T* const* columns, std::size_t count, T* results, types::Error* errors) const {
+    if (!compiled()) throw std::domain_error(types::error_message(error_));
+    std::vector<T> values(symbols_.size());
+    auto evaluate_point = [&](std::size_t i) { // Through the lazy code
+        for (std::size_t s = 0; s < symbols_.size(); ++s) values[s] = columns[s][i];
+        expr::EvalStatus status;
+        status.mode_ = errors ? expr::NumericMode::Strict : expr::NumericMode::IEEE;
+        results[i] = evaluate(values.data(), status);
+        if (errors) errors[i] = types::Error{status.code_, status.position_, status.symbol_ ? *status.symbol_ : std::string()};
+    };
+    if (bulk_code_.empty() || (errors && !std::numeric_limits<T>::has_infinity)) { // Point by point
+        for (std::size_t i = 0; i < count; ++i) evaluate_point(i);
+        return;
+    }
+
+    std::vector<T> lanes(stack_size_ * kLanes);
+    std::vector<unsigned char> invalid(errors ? kLanes : 0); // Points where an instruction gave an infinity or NaN
+    for (std::size_t begin = 0; begin < count; begin += kLanes) {
+        const std::size_t n = std::min(kLanes, count - begin);
+        std::size_t top = 0; // Number of lanes in use
+        auto lane = [&lanes](std::size_t index) { return lanes.data() + index * kLanes; };
+
+        for (const Instruction& instruction : bulk_code_) {
+            switch (instruction.op_) {
+            case Op::Constant: std::fill_n(lane(top++), n, constants_[instruction.operand_]); break;
+            case Op::Load: std::copy_n(columns[instruction.operand_] + begin, n, lane(top++)); break;
+            case Op::Negate: {
+                T* a = lane(top - 1);
+                for (std::size_t i = 0; i < n; ++i) a[i] = -a[i];
+                break;
+            }
+            case Op::Not: {
+                T* a = lane(top - 1);
+                for (std::size_t i = 0; i < n; ++i) a[i] = a[i] == 0 ? 1 : 0;
+                break;
+            }
+            case Op::Polynomial: {
+                T* a = lane(top - 1);
+                const std::vector<T>& coefficients = polynomials_[instruction.operand_];
+                for (std::size_t i = 0; i < n; ++i) a[i] = horner(coefficients, a[i]);
+                break;
+            }
+            case Op::Elementary:
+                if constexpr (std::is_same_v<T, double>) { // The array kernels of functional/elementary.h
+                    elementary::evaluate(static_cast<elementary::Function>(instruction.operand_), lane(top - 1), lane(top - 1), n);
+                }
+                else if constexpr (std::is_same_v<T, types::Rational>) {
+                    T* a = lane(top - 1);
+                    auto function = static_cast<elementary::Function>(instruction.operand_);
+                    for (std::size_t i = 0; i < n; ++i) {
+                        types::ErrorCode code = types::ErrorCode::None;
+                        a[i] = exact_factorial(function, a[i], code);
+                        if (code != types::ErrorCode::None) {
+                            throw std::domain_error(types::error_message(types::Error{code, 0, elementary::function_name(function)}));
+                        }
+                    }
+                }
+                else {
+                    T* a = lane(top - 1);
+                    auto function = static_cast<elementary::Function>(instruction.operand_);
+                    for (std::size_t i = 0; i < n; ++i) a[i] = evaluate_function(function, a[i]);
+                }
+                break;
+            case Op::Select: {
+                T* c = lane(top - 3);
+                const T* a = lane(top - 2);
+                const T* b = lane(top - 1);
+                for (std::size_t i = 0; i < n; ++i) c[i] = c[i] != 0 ? a[i] : b[i];
+                top -= 2;
+                break;
+            }
+            default: { // Binary operations
+                T* a = lane(top - 2);
+                const T* b = lane(top - 1);
+                switch (instruction.op_) {
+                case Op::Add: apply(a, b, n, [](T x, T y) { return x + y; }); break;
+                case Op::Subtract: apply(a, b, n, [](T x, T y) { return x - y; }); break;
+                case Op::Multiply: apply(a, b, n, [](T x, T y) { return x * y; }); break;
+                case Op::DivideReversed: apply(a, b, n, [](T x, T y) { return y / x; }); break;
+                case Op::Power:
+                    if constexpr (std::is_same_v<T, double>) elementary::pow(a, b, a, n);
+                    else if constexpr (std::is_same_v<T, types::Rational>) {
+                        apply(a, b, n, [](T x, T y) {
+                            if (y.isInteger() && !(x == 0 && y < 0)) return integer_power(x, y);
+                            auto code = y.isInteger() ? types::ErrorCode::DivisionByZero : types::ErrorCode::OutOfDomain;
+                            throw std::domain_error(types::error_message(types::Error{code, 0, expr::PowerNode::name()}));
+                        });
+                    }
+                    else apply(a, b, n, [](T x, T y) { return evaluate_power(x, y); });
+                    break;
+                case Op::Binomial:
+                    if constexpr (std::is_same_v<T, types::Rational>) {
+                        apply(a, b, n, [](T x, T y) {
+                            types::ErrorCode code = types::ErrorCode::None;
+                            T value = exact_binomial(x, y, code);
+                            if (code != types::ErrorCode::None) {
+                                throw std::domain_error(types::error_message(types::Error{code, 0, expr::BinomialNode::name()}));
+                            }
+                            return value;
+                        });
+                    }
+                    else apply(a, b, n, [](T x, T y) { return evaluate_binomial(x, y); });
+                    break;
+                case Op::Less: apply(a, b, n, [](T x, T y) { return x < y ? T(1) : T(0); }); break;
+                case Op::LessEqual: apply(a, b, n, [](T x, T y) { return x <= y ? T(1) : T(0); }); break;
+                case Op::Greater: apply(a, b, n, [](T x, T y) { return x > y ? T(1) : T(0); }); break;
+                case Op::GreaterEqual: apply(a, b, n, [](T x, T y) { return x >= y ? T(1) : T(0); }); break;
+                case Op::Equal: apply(a, b, n, [](T x, T y) { return x == y ? T(1) : T(0); }); break;
+                case Op::NotEqual: apply(a, b, n, [](T x, T y) { return x != y ? T(1) : T(0); }); break;
+                case Op::And: apply(a, b, n, [](T x, T y) { return x != 0 && y != 0 ? T(1) : T(0); }); break;
+                case Op::Or: apply(a, b, n, [](T x, T y) { return x != 0 || y != 0 ? T(1) : T(0); }); break;
+                default: break; // Lazy operations are not in bulk_code_
+                } // switch (instruction.op_)
+                --top;
+            }
+            } // switch (instruction.op_)
+            if (errors) {
+                const T* a = lane(top - 1);
+                for (std::size_t i = 0; i < n; ++i) invalid[i] |= a[i] - a[i] != 0;
+            }
+        }
+        std::copy_n(lane(0), n, results + begin);
+        if (!errors) continue;
+        for (std::size_t i = 0; i < n; ++i) { // Every error gives an infinity or NaN in the eager code, not conversely
+            if (invalid[i]) evaluate_point(begin + i);
+            else errors[begin + i] = types::Error{};
+            invalid[i] = 0;
+        }
+    }
+}
+
+namespace {
+
+template <typename T>
+types::Expected<std::string> evaluate_in(const expr::ExprNode& tree, const SymbolTable& symbols, expr::NumericMode mode) {
+    auto value = typed::Program<T>(tree).evaluate(symbols, mode);
+    if (!value) return value.error();
+    return typed::to_string(value.value());
+}
+
+} // namespace
+
+types::Expected<std::string> typed::evaluate_as(NumericType type, const expr::ExprNode& tree, const SymbolTable& symbols,
+    expr::NumericMode mode) {
+
+    switch (type) {
+    case NumericType::Float: return evaluate_in<float>(tree, symbols, mode);
+    case NumericType::Double: return evaluate_in<double>(tree, symbols, mode);
+    case NumericType::LongDouble: return evaluate_in<long double>(tree, symbols, mode);
+    case NumericType::Rational: return evaluate_in<types::Rational>(tree, symbols, mode);
+#ifdef CALC_HAS_FLOAT128
+    case NumericType::Float128: return evaluate_in<__float128>(tree, symbols, mode);
+#endif
+    default: throw std::invalid_argument("Invalid command line argument: float128 is not available in this build");
+    } // switch (type)
+}
+
+namespace typed {
+
+template class Program<float>;
+template class Program<double>;
+template class Program<long double>;
+template float from_string<float>(const std::string&);
+template double from_string<double>(const std::string&);
+template long double from_string<long double>(const std::string&);
+template std::string to_string<float>(float);
+template std::string to_string<double>(double);
+template std::string to_string<long double>(long double);
+template float from_numeral<float>(types::Numeral);
+template double from_numeral<double>(types::Numeral);
+template long double from_numeral<long double>(types::Numeral);
+template class Program<types::Rational>;
+template types::Rational from_string<types::Rational>(const std::string&);
+template std::string to_string<types::Rational>(types::Rational);
+template types::Rational from_numeral<types::Rational>(types::Numeral);
+#ifdef CALC_HAS_FLOAT128
+template class Program<__float128>;
+template __float128 from_string<__float128>(const std::string&);
+template std::string to_string<__float128>(__float128);
+template __float128 from_numeral<__float128>(types::Numeral);
+#endif
+
+} // namespace typed
@@ -0,0 +1,325 @@
+#include "core/workers.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "globals.h"
+
+namespace {
+
+constexpr std::uint64_t kShutdown = ~std::uint64_t(0); // Index of the record that stops a worker
+constexpr std::uint32_t kParsed = 1, kFailed = 2;      // Flags of a result
+constexpr unsigned kSpinRounds = 64;                   // Idle rounds that yield before sleeping
+constexpr auto kIdleSleep = std::chrono::microseconds(50);
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "The rings need atomics that work across processes");
+
+// Header of a record in a ring, followed by its text padded to 8 bytes
+struct RecordHeader {
+    std::uint64_t index_ = 0;       // Line of the expression
+    std::uint32_t length_ = 0;      // Bytes of the text
+    std::uint32_t flags_ = 0;       // Attempt of a request, kParsed and kFailed of a result
+    std::uint64_t parse_ns_ = 0;    // Latencies of a result
+    std::uint64_t evaluate_ns_ = 0;
+};
+
+std::size_t record_size(std::size_t length) { return sizeof(RecordHeader) + ((length + 7) & ~std::size_t(7)); }
+
+// A single-producer single-consumer ring of records in shared memory; only the producer writes head_, and only the
+// consumer writes tail_, both counting bytes from the start
+class Ring {
+private:
+    struct Control {
+        alignas(64) std::atomic<std::uint64_t> head_{0};
+        alignas(64) std::atomic<std::uint64_t> tail_{0};
+    };
+    Control* control_ = nullptr;
+    char* data_ = nullptr;
+    std::size_t capacity_ = 0; // A power of 2
+
+    void copy_in(std::uint64_t at, const void* source, std::size_t size) {
+        std::size_t offset = static_cast<std::size_t>(at) & (capacity_ - 1);
+        std::size_t first = std::min(size, capacity_ - offset);
+        std::memcpy(data_ + offset, source, first);
+        std::memcpy(data_, static_cast<const char*>(source) + first, size - first);
+    }
+
+    void copy_out(std::uint64_t at, void* target, std::size_t size) const {
+        std::size_t offset = static_cast<std::size_t>(at) & (capacity_ - 1);
+        std::size_t first = std::min(size, capacity_ - offset);
+        std::memcpy(target, data_ + offset, first);
+        std::memcpy(static_cast<char*>(target) + first, data_, size - first);
+    }
+
+public:
+    Ring() = default;
+    Ring(char* memory, std::size_t capacity) : control_(new (memory) Control()), data_(memory + sizeof(Control)), capacity_(capacity) {}
+
+    static std::size_t footprint(std::size_t capacity) { return sizeof(Control) + capacity; }
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    // Empties the ring, while neither side uses it
+    void reset() {
+        control_->head_.store(0, std::memory_order_relaxed);
+        control_->tail_.store(0, std::memory_order_relaxed);
+    }
+
+    // Appends a record, or returns false if it does not fit yet
+    bool push(const RecordHeader& header, const char* text) {
+        const std::uint64_t head = control_->head_.load(std::memory_order_relaxed);
+        const std::size_t size = record_size(header.length_);
+        if (head + size - control_->tail_.load(std::memory_order_acquire) > capacity_) return false;
+        copy_in(head, &header, sizeof(header));
+        copy_in(head + sizeof(header), text, header.length_);
+        control_->head_.store(head + size, std::memory_order_release);
+        return true;
+    }
+
+    // Takes the next record, or returns false if there is none
+    bool pop(RecordHeader& header, std::string& text) {
+        const std::uint64_t tail = control_->tail_.load(std::memory_order_relaxed);
+        if (control_->head_.load(std::memory_order_acquire) == tail) return false;
+        copy_out(tail, &header, sizeof(header));
+        text.resize(header.length_);
+        copy_out(tail + sizeof(header), text.data(), header.length_);
+        control_->tail_.store(tail + record_size(header.length_), std::memory_order_release);
+        return true;
+    }
+};
+
+// Anonymous POSIX shared memory, unlinked at once and kept by its mapping, which forked workers inherit
+class SharedMemory {
+private:
+    char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    explicit SharedMemory(std::size_t size) : size_(size) {
+        static std::atomic<unsigned> counter{0};
+        const std::string name = "/cli-calc-" + std::to_string(::getpid()) + "-" + std::to_string(counter++);
+        int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) throw std::runtime_error("Cannot create shared memory: " + std::string(std::strerror(errno)));
+        ::shm_unlink(name.c_str());
+        if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Cannot size shared memory: " + std::string(std::strerror(errno)));
+        }
+        void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) throw std::runtime_error("Cannot map shared memory: " + std::string(std::strerror(errno)));
+        data_ = static_cast<char*>(mapped);
+    }
+
+    ~SharedMemory() { ::munmap(data_, size_); }
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    char* data() const noexcept { return data_; }
+};
+
+// Yields, then sleeps, while there is nothing to do
+class Backoff {
+private:
+    unsigned rounds_ = 0;
+
+public:
+    void wait() {
+        if (++rounds_ < kSpinRounds) std::this_thread::yield();
+        else std::this_thread::sleep_for(kIdleSleep);
+    }
+    void reset() noexcept { rounds_ = 0; }
+};
+
+struct Worker {
+    pid_t pid_ = -1;
+    Ring requests_;                    // Expressions, written by the coordinator
+    Ring results_;                     // Outputs, written by the worker
+    std::deque<std::size_t> in_flight_; // Records sent and not answered, in order
+};
+
+// The loop of a worker process, which answers the records in order until told to stop or orphaned
+[[noreturn]] void work(Worker& worker, const SymbolTable& symbols, const batch::BatchOptions& options,
+    const workers::WorkerOptions& worker_options) {
+
+    const pid_t parent = ::getppid();
+    Backoff backoff;
+    RecordHeader header;
+    std::string text;
+    try {
+        while (true) {
+            if (!worker.requests_.pop(header, text)) {
+                if (::getppid() != parent) ::_exit(1);
+                backoff.wait();
+                continue;
+            }
+            backoff.reset();
+            if (header.index_ == kShutdown) ::_exit(0);
+            if (worker_options.fault_hook_) worker_options.fault_hook_(static_cast<std::size_t>(header.index_), header.flags_);
+
+            batch::LineResult line = batch::evaluate_line(text, symbols, options);
+            RecordHeader reply;
+            reply.index_ = header.index_;
+            reply.length_ = static_cast<std::uint32_t>(line.output_.size());
+            reply.flags_ = (line.parsed_ ? kParsed : 0) | (line.failed_ ? kFailed : 0);
+            reply.parse_ns_ = line.parse_ns_;
+            reply.evaluate_ns_ = line.evaluate_ns_;
+            while (!worker.results_.push(reply, line.output_.data())) {
+                if (::getppid() != parent) ::_exit(1);
+                backoff.wait();
+            }
+            backoff.reset();
+        }
+    }
+    catch (...) {
+        ::_exit(2); // Never unwind into the coordinator's code
+    }
+}
+
+void start(Worker& worker, const SymbolTable& symbols, const batch::BatchOptions& options, const workers::WorkerOptions& worker_options) {
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t pid = ::fork();
+    if (pid < 0) throw std::runtime_error("Cannot fork a worker process: " + std::string(std::strerror(errno)));
+    if (pid == 0) work(worker, symbols, options, worker_options);
+    worker.pid_ = pid;
+}
+
+std::string describe_exit(int status) {
+    if (WIFSIGNALED(status)) return "killed by signal " + std::to_string(WTERMSIG(status));
+    return "exited with status " + std::to_string(WEXITSTATUS(status));
+}
+
+} // namespace
+
+batch::BatchReport workers::run(const std::vector<std::string>& expressions, const SymbolTable& symbols,
+    const batch::BatchOptions& options, const WorkerOptions& worker_options, std::vector<std::string>& outputs) {
+
+    outputs.assign(expressions.size(), std::string());
+    batch::BatchReport report;
+    report.slowest_ = utils::SlowestList(options.slowest_);
+    auto record = [&](std::size_t index, std::string&& output, std::uint64_t parse_ns, std::uint64_t evaluate_ns, std::uint32_t flags) {
+        outputs[index] = std::move(output);
+        report.parse_.record(parse_ns);
+        if (flags & kParsed) report.evaluate_.record(evaluate_ns);
+        if (flags & kFailed) ++report.errors_;
+        report.total_.record(parse_ns + evaluate_ns);
+        report.slowest_.offer(parse_ns + evaluate_ns, index + 1, expressions[index]);
+    };
+
+    // Two rings per worker in one shared mapping
+    std::size_t capacity = 64;
+    while (capacity < worker_options.ring_bytes_) capacity *= 2;
+    const unsigned worker_count = std::clamp(worker_options.workers_, 1u, static_cast<unsigned>(kMaxWorkers));
+    SharedMemory memory(2 * worker_count * Ring::footprint(capacity));
+    std::vector<Worker> workers(worker_count);
+    for (unsigned k = 0; k < worker_count; ++k) {
+        workers[k].requests_ = Ring(memory.data() + 2 * k * Ring::footprint(capacity), capacity);
+        workers[k].results_ = Ring(memory.data() + (2 * k + 1) * Ring::footprint(capacity), capacity);
+    }
+    for (Worker& worker : workers) start(worker, symbols, options, worker_options);
+
+    std::size_t pending = 0;
+    for (const auto& expression : expressions) {
+        if (expression.find_first_not_of(" \t\r") != std::string::npos) ++pending; // Blank lines get blank outputs
+    }
+    std::deque<std::size_t> retry;          // Records to send again, taken before the next ones
+    std::vector<unsigned> attempts(expressions.size(), 0); // Workers each record crashed
+    std::size_t next = 0;
+    RecordHeader header;
+    std::string text;
+
+    auto collect = [&](Worker& worker) {
+        bool any = false;
+        while (worker.results_.pop(header, text)) {
+            worker.in_flight_.pop_front(); // Answers come in the order of the records
+            record(static_cast<std::size_t>(header.index_), std::move(text), header.parse_ns_, header.evaluate_ns_, header.flags_);
+            --pending;
+            any = true;
+        }
+        return any;
+    };
+    // Index of the next record to send, or expressions.size() if there is none
+    auto peek = [&]() -> std::size_t {
+        if (!retry.empty()) return retry.front();
+        for (; next < expressions.size(); ++next) {
+            const std::string& expression = expressions[next];
+            if (expression.find_first_not_of(" \t\r") == std::string::npos) continue;
+            if (record_size(expression.size()) <= capacity / 4) return next;
+            batch::LineResult line = batch::evaluate_line(expression, symbols, options); // Too long for the ring
+            record(next, std::move(line.output_), line.parse_ns_, line.evaluate_ns_,
+                (line.parsed_ ? kParsed : 0) | (line.failed_ ? kFailed : 0));
+            --pending;
+        }
+        return expressions.size();
+    };
+
+    Backoff backoff;
+    while (pending > 0) {
+        bool progress = false;
+        for (Worker& worker : workers) {
+            progress |= collect(worker);
+            while (worker.in_flight_.size() < kMaxInFlight) {
+                std::size_t index = peek();
+                if (index == expressions.size()) break;
+                RecordHeader request;
+                request.index_ = index;
+                request.length_ = static_cast<std::uint32_t>(expressions[index].size());
+                request.flags_ = attempts[index];
+                if (!worker.requests_.push(request, expressions[index].data())) break;
+                if (!retry.empty()) retry.pop_front();
+                else ++next;
+                worker.in_flight_.push_back(index);
+                progress = true;
+            }
+        }
+        if (progress) {
+            backoff.reset();
+            continue;
+        }
+
+        // Nothing moved: restart the workers that died, sending their records again
+        for (Worker& worker : workers) {
+            int status = 0;
+            if (::waitpid(worker.pid_, &status, WNOHANG) != worker.pid_) continue;
+            collect(worker);
+            ++report.restarts_;
+            if (!worker.in_flight_.empty()) {
+                // The worker answers in order, so the first record unanswered is the one it died on
+                std::size_t culprit = worker.in_flight_.front();
+                if (++attempts[culprit] >= worker_options.max_attempts_) {
+                    worker.in_flight_.pop_front();
+                    record(culprit, "error: Worker process " + describe_exit(status) + " evaluating this expression", 0, 0, kFailed);
+                    --pending;
+                }
+            }
+            retry.insert(retry.begin(), worker.in_flight_.begin(), worker.in_flight_.end());
+            worker.in_flight_.clear();
+            worker.requests_.reset();
+            worker.results_.reset();
+            start(worker, symbols, options, worker_options);
+            progress = true;
+        }
+        if (!progress) backoff.wait();
+    }
+
+    // Stop the workers
+    RecordHeader shutdown;
+    shutdown.index_ = kShutdown;
+    for (Worker& worker : workers) {
+        while (!worker.requests_.push(shutdown, "")) backoff.wait();
+    }
+    for (Worker& worker : workers) ::waitpid(worker.pid_, nullptr, 0);
+    return report;
+}
@@ -0,0 +1,631 @@
+#include "data/big_integer.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::uint64_t kBase = std::uint64_t(1) << 32;
+constexpr std::uint32_t kDecimalChunk = 1000000000; // 10^9, the largest power of 10 in a limb
+
+// Sizes in limbs from which the subquadratic algorithms take over
+constexpr std::size_t kKaratsubaThreshold = 32;    // Shorter operand of a multiplication
+constexpr std::size_t kNttThreshold = 1536;        // Shorter operand of a multiplication
+constexpr std::size_t kNttMaxLength = 1 << 24;     // Longest product the three primes below transform
+constexpr std::size_t kNewtonThreshold = 96;       // Divisor and quotient of a division
+constexpr std::size_t kConversionThreshold = 128;  // Decimal conversion
+
+// out[0, na + nb) = a[0, na) * b[0, nb)
+void multiply_schoolbook(const std::uint32_t* a, std::size_t na, const std::uint32_t* b, std::size_t nb, std::uint32_t* out) noexcept {
+    std::fill(out, out + na + nb, 0);
+    for (std::size_t i = 0; i < na; ++i) {
+        std::uint64_t carry = 0;
+        for (std::size_t j = 0; j < nb; ++j) {
+            std::uint64_t current = static_cast<std::uint64_t>(a[i]) * b[j] + out[i + j] + carry;
+            out[i + j] = static_cast<std::uint32_t>(current);
+            carry = current >> 32;
+        }
+        out[i + nb] = static_cast<std::uint32_t>(carry);
+    }
+}
+
+// a[0, n) += b[0, nb), nb <= n, returning the carry out of a
+std::uint32_t add_into(std::uint32_t* a, std::size_t n, const std::uint32_t* b, std::size_t nb) noexcept {
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < n && (i < nb || carry); ++i) {
+        std::uint64_t sum = static_cast<std::uint64_t>(a[i]) + (i < nb ? b[i] : 0) + carry;
+        a[i] = static_cast<std::uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    return static_cast<std::uint32_t>(carry);
+}
+
+// a[0, n) -= b[0, nb), nb <= n, where a >= b
+void subtract_into(std::uint32_t* a, std::size_t n, const std::uint32_t* b, std::size_t nb) noexcept {
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < n && (i < nb || borrow); ++i) {
+        std::int64_t difference = static_cast<std::int64_t>(a[i]) - (i < nb ? b[i] : 0) - borrow;
+        borrow = difference < 0;
+        a[i] = static_cast<std::uint32_t>(difference + (borrow ? static_cast<std::int64_t>(kBase) : 0));
+    }
+}
+
+// out[0, 2n) = a[0, n) * b[0, n): a0 b0 + ((a0 + a1)(b0 + b1) - a0 b0 - a1 b1) B^h + a1 b1 B^2h
+void multiply_karatsuba(const std::uint32_t* a, const std::uint32_t* b, std::size_t n, std::uint32_t* out) {
+    if (n < kKaratsubaThreshold) return multiply_schoolbook(a, n, b, n, out);
+    const std::size_t h = n / 2, high = n - h;
+    multiply_karatsuba(a, b, h, out);
+    multiply_karatsuba(a + h, b + h, high, out + 2 * h);
+
+    std::vector<std::uint32_t> sum_a(a + h, a + n), sum_b(b + h, b + n), middle(2 * high + 2);
+    sum_a.push_back(add_into(sum_a.data(), high, a, h));
+    sum_b.push_back(add_into(sum_b.data(), high, b, h));
+    multiply_karatsuba(sum_a.data(), sum_b.data(), high + 1, middle.data());
+    subtract_into(middle.data(), middle.size(), out, 2 * h);
+    subtract_into(middle.data(), middle.size(), out + 2 * h, 2 * high);
+    std::size_t length = middle.size();
+    while (length > 0 && middle[length - 1] == 0) --length;
+    add_into(out + h, 2 * n - h, middle.data(), length);
+}
+
+// Number-theoretic transforms modulo a prime P = c 2^k + 1 below 2^31 with primitive root G. Products are reduced
+// with Montgomery's method (R = 2^32) rather than a division; the roots are kept in Montgomery form, so that
+// multiplying by one leaves a value in the ordinary form. Sums are reduced as min(s, s - P), where s - P wraps around
+// if s < P, which keeps the butterflies free of branches and lets them vectorize.
+template <std::uint32_t P, std::uint32_t G>
+struct Ntt {
+    static constexpr std::uint32_t inverse_p() noexcept { // P^-1 mod 2^32 by Newton's iteration
+        std::uint32_t inverse = P;
+        for (int i = 0; i < 4; ++i) inverse *= 2 - P * inverse;
+        return inverse;
+    }
+    static constexpr std::uint32_t kNegativeInverse = 0 - inverse_p();
+    static constexpr std::uint32_t kR2 = static_cast<std::uint32_t>((static_cast<unsigned __int128>(1) << 64) % P); // R^2 mod P
+
+    // a b / R mod P
+    static std::uint32_t multiply(std::uint32_t a, std::uint32_t b) noexcept {
+        std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+        std::uint32_t m = static_cast<std::uint32_t>(product) * kNegativeInverse;
+        auto reduced = static_cast<std::uint32_t>((product + static_cast<std::uint64_t>(m) * P) >> 32);
+        return std::min(reduced, reduced - P); // reduced - P wraps around if reduced < P
+    }
+
+    static std::uint32_t power(std::uint64_t base, std::uint64_t exponent) noexcept {
+        std::uint64_t result = 1;
+        for (base %= P; exponent; exponent >>= 1, base = base * base % P) {
+            if (exponent & 1) result = result * base % P;
+        }
+        return static_cast<std::uint32_t>(result);
+    }
+
+    // roots[h + j] = w^j in Montgomery form for a primitive 2h-th root w, for each power of two h < n
+    static std::vector<std::uint32_t> roots(std::size_t n, bool inverse) {
+        std::vector<std::uint32_t> result(std::max<std::size_t>(n, 2));
+        for (std::size_t half = 1; half < n; half <<= 1) {
+            std::uint32_t root = power(G, (P - 1) / (2 * half));
+            if (inverse) root = power(root, P - 2);
+            std::uint32_t montgomery_root = multiply(root, kR2), current = multiply(1, kR2);
+            for (std::size_t j = 0; j < half; ++j, current = multiply(current, montgomery_root)) result[half + j] = current;
+        }
+        return result;
+    }
+
+    // Decimation in frequency: natural order in, bit-reversed order out
+    static void forward(std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& roots) noexcept {
+        for (std::size_t half = a.size() / 2; half >= 1; half >>= 1) {
+            for (std::size_t begin = 0; begin < a.size(); begin += 2 * half) {
+                std::uint32_t* x = a.data() + begin;
+                for (std::size_t j = 0; j < half; ++j) {
+                    std::uint32_t u = x[j], v = x[j + half];
+                    x[j] = std::min(u + v, u + v - P);
+                    x[j + half] = multiply(std::min(u - v, u - v + P), roots[half + j]);
+                }
+            }
+        }
+    }
+
+    // Decimation in time: bit-reversed order in, natural order out, scaled by n
+    static void inverse(std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& roots) noexcept {
+        for (std::size_t half = 1; half < a.size(); half <<= 1) {
+            for (std::size_t begin = 0; begin < a.size(); begin += 2 * half) {
+                std::uint32_t* x = a.data() + begin;
+                for (std::size_t j = 0; j < half; ++j) {
+                    std::uint32_t u = x[j], v = multiply(x[j + half], roots[half + j]);
+                    x[j] = std::min(u + v, u + v - P);
+                    x[j + half] = std::min(u - v, u - v + P);
+                }
+            }
+        }
+    }
+
+    // The cyclic convolution of length n of a and b, modulo P; a squaring if a and b are the same vector
+    static std::vector<std::uint32_t> convolve(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b, std::size_t n) {
+        const auto forward_roots = roots(n, false);
+        std::vector<std::uint32_t> fa(n), fb;
+        for (std::size_t i = 0; i < a.size(); ++i) fa[i] = a[i] % P;
+        forward(fa, forward_roots);
+        if (&a != &b) {
+            fb.resize(n);
+            for (std::size_t i = 0; i < b.size(); ++i) fb[i] = b[i] % P;
+            forward(fb, forward_roots);
+        }
+        const std::vector<std::uint32_t>& other = &a != &b ? fb : fa;
+        for (std::size_t i = 0; i < n; ++i) fa[i] = multiply(fa[i], other[i]); // Now divided by R
+        inverse(fa, roots(n, true));
+
+        // Times R^2 / n in Montgomery form: R / n, undoing the scaling and the division by R
+        std::uint32_t scale = multiply(multiply(power(n, P - 2), kR2), kR2);
+        for (auto& x : fa) x = multiply(x, scale);
+        return fa;
+    }
+};
+
+using Ntt1 = Ntt<2013265921, 31>; // 15 2^27 + 1
+using Ntt2 = Ntt<754974721, 11>;  // 45 2^24 + 1
+using Ntt3 = Ntt<469762049, 3>;   // 7 2^26 + 1
+
+// The product by convolving the limbs modulo three primes, whose product (about 2^89) exceeds every coefficient
+// (below n 2^64), then recovering each coefficient by the Chinese remainder theorem (Garner's algorithm)
+std::vector<std::uint32_t> multiply_ntt(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) {
+    constexpr std::uint64_t m1 = 2013265921, m2 = 754974721, m3 = 469762049;
+    const std::uint64_t m1_inverse_m2 = Ntt2::power(m1, m2 - 2);
+    const std::uint64_t m1_inverse_m3 = Ntt3::power(m1, m3 - 2);
+    const std::uint64_t m2_inverse_m3 = Ntt3::power(m2, m3 - 2);
+
+    std::size_t n = 1;
+    while (n < a.size() + b.size()) n <<= 1;
+    auto r1 = Ntt1::convolve(a, b, n);
+    auto r2 = Ntt2::convolve(a, b, n);
+    auto r3 = Ntt3::convolve(a, b, n);
+
+    std::vector<std::uint32_t> result(a.size() + b.size());
+    unsigned __int128 carry = 0;
+    for (std::size_t i = 0; i < result.size(); ++i) {
+        std::uint64_t x1 = r1[i];
+        std::uint64_t x2 = (r2[i] + m2 - x1 % m2) % m2 * m1_inverse_m2 % m2;
+        std::uint64_t x3 = ((r3[i] + m3 - x1 % m3) % m3 * m1_inverse_m3 % m3 + m3 - x2 % m3) % m3 * m2_inverse_m3 % m3;
+        carry += x1 + static_cast<unsigned __int128>(x2) * m1 + static_cast<unsigned __int128>(x3) * (m1 * m2);
+        result[i] = static_cast<std::uint32_t>(carry);
+        carry >>= 32;
+    }
+    return result;
+}
+
+// Divides a magnitude in place by a single limb, returning the remainder
+std::uint32_t divide_small(std::vector<std::uint32_t>& limbs, std::uint32_t divisor) noexcept {
+    std::uint64_t remainder = 0;
+    for (std::size_t i = limbs.size(); i-- > 0; ) {
+        std::uint64_t current = (remainder << 32) | limbs[i];
+        limbs[i] = static_cast<std::uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    return static_cast<std::uint32_t>(remainder);
+}
+
+// Multiplies a magnitude in place by a single limb and adds another
+void multiply_add_small(std::vector<std::uint32_t>& limbs, std::uint32_t factor, std::uint32_t addend) {
+    std::uint64_t carry = addend;
+    for (auto& limb : limbs) {
+        std::uint64_t current = static_cast<std::uint64_t>(limb) * factor + carry;
+        limb = static_cast<std::uint32_t>(current);
+        carry = current >> 32;
+    }
+    if (carry) limbs.push_back(static_cast<std::uint32_t>(carry));
+}
+
+// Knuth's algorithm D (as in Hacker's Delight, divmnu): u / v with v having at least 2 limbs and u >= v
+void divide_long(const std::vector<std::uint32_t>& u, const std::vector<std::uint32_t>& v,
+    std::vector<std::uint32_t>& quotient, std::vector<std::uint32_t>& remainder) {
+
+    const std::size_t m = u.size(), n = v.size();
+    const int shift = __builtin_clz(v[n - 1]); // Normalize so that the top limb of v has its high bit set
+    std::vector<std::uint32_t> vn(n), un(m + 1);
+    for (std::size_t i = n - 1; i > 0; --i) {
+        vn[i] = (v[i] << shift) | (shift ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(v[i - 1]) >> (32 - shift)) : 0);
+    }
+    vn[0] = v[0] << shift;
+    un[m] = shift ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(u[m - 1]) >> (32 - shift)) : 0;
+    for (std::size_t i = m - 1; i > 0; --i) {
+        un[i] = (u[i] << shift) | (shift ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(u[i - 1]) >> (32 - shift)) : 0);
+    }
+    un[0] = u[0] << shift;
+
+    quotient.assign(m - n + 1, 0);
+    for (std::size_t j = m - n + 1; j-- > 0; ) {
+        // Estimate the quotient limb from the top two limbs, then correct it at most twice
+        std::uint64_t numerator = (static_cast<std::uint64_t>(un[j + n]) << 32) | un[j + n - 1];
+        std::uint64_t qhat = numerator / vn[n - 1];
+        std::uint64_t rhat = numerator % vn[n - 1];
+        while (qhat >= kBase || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+            --qhat;
+            rhat += vn[n - 1];
+            if (rhat >= kBase) break;
+        }
+
+        // Multiply and subtract
+        std::int64_t borrow = 0, t;
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint64_t product = qhat * vn[i];
+            t = static_cast<std::int64_t>(un[i + j]) - borrow - static_cast<std::int64_t>(product & 0xFFFFFFFF);
+            un[i + j] = static_cast<std::uint32_t>(t);
+            borrow = static_cast<std::int64_t>(product >> 32) - (t >> 32);
+        }
+        t = static_cast<std::int64_t>(un[j + n]) - borrow;
+        un[j + n] = static_cast<std::uint32_t>(t);
+
+        quotient[j] = static_cast<std::uint32_t>(qhat);
+        if (t < 0) { // Subtracted too much, add back
+            --quotient[j];
+            std::uint64_t carry = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                std::uint64_t sum = static_cast<std::uint64_t>(un[i + j]) + vn[i] + carry;
+                un[i + j] = static_cast<std::uint32_t>(sum);
+                carry = sum >> 32;
+            }
+            un[j + n] = static_cast<std::uint32_t>(un[j + n] + carry);
+        }
+    }
+
+    remainder.assign(n, 0);
+    for (std::size_t i = 0; i < n; ++i) {
+        remainder[i] = (un[i] >> shift) | (shift ? static_cast<std::uint32_t>(static_cast<std::uint64_t>(un[i + 1]) << (32 - shift)) : 0);
+    }
+}
+
+} // namespace
+
+types::BigInteger::BigInteger(std::int64_t value) : negative_(value < 0) {
+    // The magnitude of INT64_MIN does not fit in int64_t, so it is taken in unsigned arithmetic
+    std::uint64_t magnitude = negative_ ? ~static_cast<std::uint64_t>(value) + 1 : static_cast<std::uint64_t>(value);
+    while (magnitude) {
+        limbs_.push_back(static_cast<std::uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+void types::BigInteger::trim() noexcept {
+    while (!limbs_.empty() && limbs_.back() == 0) limbs_.pop_back();
+    if (limbs_.empty()) negative_ = false;
+}
+
+types::BigInteger types::BigInteger::fromString(const std::string& str) {
+    std::size_t i = 0;
+    bool negative = false;
+    if (i < str.size() && (str[i] == '-' || str[i] == '+')) negative = str[i++] == '-';
+    if (i == str.size()) throw std::invalid_argument("Numerical error: '" + str + "' is not a valid integer");
+
+    BigInteger result;
+    for (; i < str.size(); ++i) {
+        if (str[i] < '0' || str[i] > '9') throw std::invalid_argument("Numerical error: '" + str + "' is not a valid integer");
+        multiply_add_small(result.limbs_, 10, static_cast<std::uint32_t>(str[i] - '0'));
+    }
+    result.negative_ = negative;
+    result.trim();
+    return result;
+}
+
+bool types::BigInteger::fitsInt64() const noexcept {
+    if (limbs_.size() > 2) return false;
+    std::uint64_t magnitude = limbs_.empty() ? 0 : limbs_[0];
+    if (limbs_.size() == 2) magnitude |= static_cast<std::uint64_t>(limbs_[1]) << 32;
+    return negative_ ? magnitude <= (std::uint64_t(1) << 63) : magnitude < (std::uint64_t(1) << 63);
+}
+
+std::int64_t types::BigInteger::toInt64() const noexcept {
+    std::uint64_t magnitude = limbs_.empty() ? 0 : limbs_[0];
+    if (limbs_.size() >= 2) magnitude |= static_cast<std::uint64_t>(limbs_[1]) << 32;
+    return static_cast<std::int64_t>(negative_ ? ~magnitude + 1 : magnitude);
+}
+
+double types::BigInteger::toDouble() const noexcept {
+    double result = 0;
+    for (std::size_t i = limbs_.size(); i-- > 0; ) result = result * static_cast<double>(kBase) + limbs_[i];
+    return negative_ ? -result : result;
+}
+
+void types::BigInteger::appendDecimal(const BigInteger& value, const std::vector<BigInteger>& powers,
+    std::vector<BigInteger>& inverses, std::size_t digits, std::string& out) {
+
+    if (value.limbs_.size() < kConversionThreshold) { // Chunks of 9 digits by repeated division
+        std::vector<std::uint32_t> magnitude = value.limbs_;
+        std::vector<std::uint32_t> chunks; // Base 10^9 digits, least significant first
+        while (!magnitude.empty()) chunks.push_back(divide_small(magnitude, kDecimalChunk));
+        std::string head = chunks.empty() ? "" : std::to_string(chunks.back());
+        std::size_t length = head.size() + 9 * (chunks.empty() ? 0 : chunks.size() - 1);
+        if (digits > length) out.append(digits - length, '0');
+        else if (chunks.empty()) out += '0';
+        out += head;
+        for (std::size_t i = chunks.size() - 1; chunks.size() > 1 && i-- > 0; ) {
+            std::string chunk = std::to_string(chunks[i]);
+            out.append(9 - chunk.size(), '0');
+            out += chunk;
+        }
+        return;
+    }
+
+    // Split by the largest 10^(9 2^k) with fewer limbs, which the value exceeds. Values at a level share the divisor,
+    // so its reciprocal is computed once, for dividends of up to twice its length.
+    std::size_t k = 0;
+    while (k + 1 < powers.size() && powers[k + 1].limbs_.size() < value.limbs_.size()) ++k;
+    const BigInteger& divisor = powers[k];
+    const std::size_t precision = 2 * divisor.limbs_.size();
+    BigInteger low, high;
+    bool newton = divisor.limbs_.size() >= kNewtonThreshold && value.limbs_.size() - divisor.limbs_.size() >= kNewtonThreshold &&
+        (value * BigInteger(std::int64_t(1) << __builtin_clz(divisor.limbs_.back()))).limbs_.size() <= precision;
+    if (newton) {
+        if (inverses[k].isZero()) inverses[k] = normalizedInverse(divisor, precision);
+        high = value.divideNewton(divisor, inverses[k], precision, low);
+    }
+    else high = value.divide(divisor, &low);
+    const std::size_t low_digits = std::size_t(9) << k;
+    appendDecimal(high, powers, inverses, digits > low_digits ? digits - low_digits : 0, out);
+    appendDecimal(low, powers, inverses, low_digits, out);
+}
+
+std::string types::BigInteger::toString() const {
+    if (limbs_.empty()) return "0";
+    BigInteger magnitude = *this;
+    magnitude.negative_ = false;
+    std::vector<BigInteger> powers = {BigInteger(kDecimalChunk)}; // 10^(9 2^k), up to about half the limbs
+    while (powers.back().limbs_.size() * 2 <= limbs_.size() && limbs_.size() >= kConversionThreshold) {
+        powers.push_back(powers.back() * powers.back());
+    }
+    std::vector<BigInteger> inverses(powers.size());
+    std::string result = negative_ ? "-" : "";
+    appendDecimal(magnitude, powers, inverses, 0, result);
+    return result;
+}
+
+int types::BigInteger::compareMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) noexcept {
+    if (a.size() != b.size()) return a.size() < b.size() ? -1 : 1;
+    for (std::size_t i = a.size(); i-- > 0; ) {
+        if (a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+std::vector<std::uint32_t> types::BigInteger::addMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) {
+    const auto& longer = a.size() >= b.size() ? a : b;
+    const auto& shorter = a.size() >= b.size() ? b : a;
+    std::vector<std::uint32_t> result(longer.size() + 1);
+    std::uint64_t carry = 0;
+    for (std::size_t i = 0; i < longer.size(); ++i) {
+        std::uint64_t sum = static_cast<std::uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+        result[i] = static_cast<std::uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    result[longer.size()] = static_cast<std::uint32_t>(carry);
+    return result;
+}
+
+std::vector<std::uint32_t> types::BigInteger::subtractMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) {
+    std::vector<std::uint32_t> result(a.size()); // Requires |a| >= |b|
+    std::int64_t borrow = 0;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        std::int64_t difference = static_cast<std::int64_t>(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = difference < 0;
+        result[i] = static_cast<std::uint32_t>(difference + (borrow ? static_cast<std::int64_t>(kBase) : 0));
+    }
+    return result;
+}
+
+types::BigInteger types::BigInteger::operator-() const {
+    BigInteger result = *this;
+    if (!result.limbs_.empty()) result.negative_ = !negative_;
+    return result;
+}
+
+types::BigInteger types::BigInteger::operator+(const BigInteger& other) const {
+    BigInteger result;
+    if (negative_ == other.negative_) {
+        result.limbs_ = addMagnitudes(limbs_, other.limbs_);
+        result.negative_ = negative_;
+    }
+    else if (compareMagnitudes(limbs_, other.limbs_) >= 0) {
+        result.limbs_ = subtractMagnitudes(limbs_, other.limbs_);
+        result.negative_ = negative_;
+    }
+    else {
+        result.limbs_ = subtractMagnitudes(other.limbs_, limbs_);
+        result.negative_ = other.negative_;
+    }
+    result.trim();
+    return result;
+}
+
+types::BigInteger types::BigInteger::operator-(const BigInteger& other) const {
+    return *this + (-other);
+}
+
+std::vector<std::uint32_t> types::BigInteger::multiplyMagnitudes(const std::vector<std::uint32_t>& a, const std::vector<std::uint32_t>& b) {
+    const auto& longer = a.size() >= b.size() ? a : b;
+    const auto& shorter = a.size() >= b.size() ? b : a;
+    std::vector<std::uint32_t> result(a.size() + b.size());
+    if (shorter.size() < kKaratsubaThreshold) {
+        multiply_schoolbook(longer.data(), longer.size(), shorter.data(), shorter.size(), result.data());
+    }
+    else if (shorter.size() >= kNttThreshold && result.size() <= kNttMaxLength) result = multiply_ntt(a, b);
+    else { // Karatsuba on slices of the longer operand as long as the shorter
+        const std::size_t n = shorter.size();
+        std::vector<std::uint32_t> slice(n), product(2 * n);
+        for (std::size_t begin = 0; begin < longer.size(); begin += n) {
+            std::size_t length = std::min(n, longer.size() - begin);
+            std::copy_n(longer.data() + begin, length, slice.data());
+            std::fill(slice.begin() + length, slice.end(), 0);
+            multiply_karatsuba(slice.data(), shorter.data(), n, product.data());
+            add_into(result.data() + begin, result.size() - begin, product.data(), std::min(2 * n, result.size() - begin));
+        }
+    }
+    return result;
+}
+
+types::BigInteger types::BigInteger::operator*(const BigInteger& other) const {
+    BigInteger result;
+    if (limbs_.empty() || other.limbs_.empty()) return result;
+    result.limbs_ = multiplyMagnitudes(limbs_, other.limbs_);
+    result.negative_ = negative_ != other.negative_;
+    result.trim();
+    return result;
+}
+
+types::BigInteger types::BigInteger::shiftLimbs(std::ptrdiff_t count) const {
+    BigInteger result;
+    if (count >= 0) {
+        if (limbs_.empty()) return result;
+        result.limbs_.assign(static_cast<std::size_t>(count), 0);
+        result.limbs_.insert(result.limbs_.end(), limbs_.begin(), limbs_.end());
+    }
+    else if (static_cast<std::size_t>(-count) < limbs_.size()) result.limbs_.assign(limbs_.begin() - count, limbs_.end());
+    result.negative_ = negative_;
+    result.trim();
+    return result;
+}
+
+types::BigInteger types::BigInteger::reciprocal(const BigInteger& divisor) {
+    const std::size_t n = divisor.limbs_.size();
+    BigInteger power = BigInteger(1).shiftLimbs(static_cast<std::ptrdiff_t>(2 * n));
+    if (n < kNewtonThreshold) {
+        BigInteger result, rest;
+        if (n == 1) {
+            result.limbs_ = power.limbs_;
+            divide_small(result.limbs_, divisor.limbs_[0]);
+        }
+        else divide_long(power.limbs_, divisor.limbs_, result.limbs_, rest.limbs_);
+        result.trim();
+        return result;
+    }
+
+    // B^2h / (the top h limbs) shifted, with relative error about B^-h, then a Newton step x + x (B^2n - d x) / B^2n
+    const std::size_t h = (n + 1) / 2, l = n - h;
+    BigInteger x = reciprocal(divisor.shiftLimbs(-static_cast<std::ptrdiff_t>(l))).shiftLimbs(static_cast<std::ptrdiff_t>(l));
+    x = x + (x * (power - divisor * x)).shiftLimbs(-static_cast<std::ptrdiff_t>(2 * n));
+
+    // Off by a few units: correct to the floor
+    BigInteger rest = power - divisor * x;
+    while (rest.isNegative()) {
+        x = x - BigInteger(1);
+        rest = rest + divisor;
+    }
+    while (rest.compare(divisor) >= 0) {
+        x = x + BigInteger(1);
+        rest = rest - divisor;
+    }
+    return x;
+}
+
+types::BigInteger types::BigInteger::normalizedInverse(const BigInteger& divisor, std::size_t precision) {
+    // Shifted so that the top limb has its high bit set, which bounds the error of the reciprocal
+    const BigInteger normalized = divisor * BigInteger(std::int64_t(1) << __builtin_clz(divisor.limbs_.back()));
+    const std::size_t n = normalized.limbs_.size();
+    return reciprocal(normalized.shiftLimbs(static_cast<std::ptrdiff_t>(precision - 2 * n))); // floor(B^precision / normalized)
+}
+
+types::BigInteger types::BigInteger::divideNewton(const BigInteger& divisor, const BigInteger& inverse, std::size_t precision,
+    BigInteger& remainder) const {
+
+    // The estimate is at most 2 below the quotient, as the normalized dividend is below B^precision, and at most 1
+    // more for dropping its low n - 1 limbs, which weigh less than 1 in the product
+    const auto dropped = static_cast<std::ptrdiff_t>(divisor.limbs_.size() - 1);
+    BigInteger scale(std::int64_t(1) << __builtin_clz(divisor.limbs_.back()));
+    BigInteger quotient = ((*this * scale).shiftLimbs(-dropped) * inverse).shiftLimbs(dropped - static_cast<std::ptrdiff_t>(precision));
+    remainder = *this - quotient * divisor;
+    while (remainder.isNegative()) {
+        quotient = quotient - BigInteger(1);
+        remainder = remainder + divisor;
+    }
+    while (remainder.compare(divisor) >= 0) {
+        quotient = quotient + BigInteger(1);
+        remainder = remainder - divisor;
+    }
+    return quotient;
+}
+
+types::BigInteger types::BigInteger::divide(const BigInteger& divisor, BigInteger* remainder) const {
+    if (divisor.limbs_.empty()) throw std::domain_error("Numerical error: Cannot divide by 0");
+    BigInteger quotient, rest;
+    if (compareMagnitudes(limbs_, divisor.limbs_) < 0) rest = *this;
+    else if (divisor.limbs_.size() == 1) {
+        quotient.limbs_ = limbs_;
+        std::uint32_t small = divide_small(quotient.limbs_, divisor.limbs_[0]);
+        rest = BigInteger(static_cast<std::int64_t>(small));
+        rest.negative_ = negative_ && small != 0;
+    }
+    else if (divisor.limbs_.size() >= kNewtonThreshold && limbs_.size() - divisor.limbs_.size() >= kNewtonThreshold) {
+        BigInteger u = *this, v = divisor;
+        u.negative_ = v.negative_ = false;
+
+        // A quotient much shorter than the divisor depends only on the top limbs: dropping the low ones of both
+        // operands, keeping two more divisor limbs than the quotient has, leaves it off by at most one
+        const std::size_t length = limbs_.size() - divisor.limbs_.size() + 1;
+        const auto dropped = static_cast<std::ptrdiff_t>(v.limbs_.size() - std::min(v.limbs_.size(), length + 2));
+        BigInteger top_u = u.shiftLimbs(-dropped), top_v = v.shiftLimbs(-dropped);
+        std::size_t precision = std::max(2 * top_v.limbs_.size(),
+            (top_u * BigInteger(std::int64_t(1) << __builtin_clz(top_v.limbs_.back()))).limbs_.size());
+        quotient = top_u.divideNewton(top_v, normalizedInverse(top_v, precision), precision, rest);
+        if (dropped > 0) {
+            rest = u - quotient * v;
+            while (rest.isNegative()) {
+                quotient = quotient - BigInteger(1);
+                rest = rest + v;
+            }
+            while (rest.compare(v) >= 0) {
+                quotient = quotient + BigInteger(1);
+                rest = rest - v;
+            }
+        }
+        rest.negative_ = negative_ && !rest.limbs_.empty();
+    }
+    else {
+        divide_long(limbs_, divisor.limbs_, quotient.limbs_, rest.limbs_);
+        rest.negative_ = negative_;
+    }
+    quotient.negative_ = negative_ != divisor.negative_;
+    quotient.trim();
+    rest.trim();
+    if (remainder) *remainder = std::move(rest);
+    return quotient;
+}
+
+int types::BigInteger::compare(const BigInteger& other) const noexcept {
+    if (negative_ != other.negative_) return negative_ ? -1 : 1;
+    int magnitude = compareMagnitudes(limbs_, other.limbs_);
+    return negative_ ? -magnitude : magnitude;
+}
+
+types::BigInteger types::isqrt(const BigInteger& value) {
+    if (value.negative_) throw std::domain_error("Numerical error: Argument outside the domain of 'sqrt'");
+    const std::size_t n = value.limbs_.size();
+    if (n <= 2) { // Below 2^64: the long double root is off by at most one
+        std::uint64_t v = value.limbs_.empty() ? 0 : value.limbs_[0];
+        if (n == 2) v |= static_cast<std::uint64_t>(value.limbs_[1]) << 32;
+        auto root = static_cast<std::uint64_t>(std::sqrt(static_cast<long double>(v)));
+        while (static_cast<unsigned __int128>(root) * root > v) --root;
+        while (static_cast<unsigned __int128>(root + 1) * (root + 1) <= v) ++root;
+        return BigInteger(static_cast<std::int64_t>(root));
+    }
+
+    // (isqrt(value / B^2k) + 1) B^k is above the root with relative error about B^(k - n/2). Newton steps
+    // (x + value / x) / 2 from above stay at or above the root and square the relative error, so one step
+    // usually leaves it within a unit
+    const std::size_t k = std::max<std::size_t>(1, n / 4);
+    BigInteger root = (isqrt(value.shiftLimbs(-static_cast<std::ptrdiff_t>(2 * k))) + BigInteger(1)).shiftLimbs(static_cast<std::ptrdiff_t>(k));
+    while (true) {
+        root = (root + value.divide(root)).divide(BigInteger(2));
+        if (!(value < root * root)) return root;
+        BigInteger below = root - BigInteger(1); // Cheaper to try than another step
+        if (!(value < below * below)) return below;
+    }
+}
+
+types::BigInteger types::gcd(BigInteger a, BigInteger b) {
+    if (a.isNegative()) a = -a;
+    if (b.isNegative()) b = -b;
+    while (!b.isZero()) {
+        BigInteger remainder;
+        a.divide(b, &remainder);
+        a = std::move(b);
+        b = std::move(remainder);
+    }
+    return a;
+}
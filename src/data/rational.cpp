@@ -0,0 +1,201 @@
+#include "data/rational.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+std::uint64_t magnitude(std::int64_t value) noexcept {
+    return value < 0 ? ~static_cast<std::uint64_t>(value) + 1 : static_cast<std::uint64_t>(value);
+}
+
+// gcd(0, b) = b. One remainder brings the operands to the same size (running sums have large numerators over small
+// denominators), then a branchless binary gcd finishes.
+std::uint64_t gcd64(std::uint64_t a, std::uint64_t b) noexcept {
+    if (a == 1 || b == 1) return 1; // Integers have denominator 1
+    if (a == 0 || b == 0) return a | b;
+    if ((a >> 12) > b) a %= b;      // Only worth a division when the sizes differ much
+    else if ((b >> 12) > a) b %= a;
+    if (a == 0 || b == 0) return a | b;
+    int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    b >>= __builtin_ctzll(b);
+    while (a != b) {
+        std::uint64_t smaller = std::min(a, b);
+        std::uint64_t difference = std::max(a, b) - smaller; // Even, as both are odd
+        a = smaller;
+        b = difference >> __builtin_ctzll(difference);
+    }
+    return a << shift;
+}
+
+// Exact division by a common factor, skipping the slow 64-bit division in the common case of no common factor
+inline std::int64_t reduce(std::int64_t value, std::int64_t factor) noexcept {
+    return factor == 1 ? value : value / factor;
+}
+
+} // namespace
+
+types::Rational::Rational(std::int64_t numerator, std::int64_t denominator) {
+    if (denominator == 0) throw std::domain_error("Numerical error: Cannot divide by 0");
+    if (numerator == 0) return;
+    std::int64_t g = static_cast<std::int64_t>(gcd64(magnitude(numerator), magnitude(denominator)));
+    if (g == std::numeric_limits<std::int64_t>::min()) { // Both are INT64_MIN
+        numerator_ = 1;
+        return;
+    }
+    numerator /= g;
+    denominator /= g;
+    if (denominator < 0) {
+        if (__builtin_sub_overflow(0, numerator, &numerator) || __builtin_sub_overflow(0, denominator, &denominator)) {
+            *this = fromBig(-BigInteger(numerator), -BigInteger(denominator));
+            return;
+        }
+    }
+    numerator_ = numerator;
+    denominator_ = denominator;
+}
+
+types::Rational types::Rational::fromBig(BigInteger numerator, BigInteger denominator) {
+    if (denominator.isZero()) throw std::domain_error("Numerical error: Cannot divide by 0");
+    if (denominator.isNegative()) {
+        numerator = -numerator;
+        denominator = -denominator;
+    }
+    BigInteger g = gcd(numerator, denominator);
+    if (g != BigInteger(1)) {
+        numerator = numerator.divide(g);
+        denominator = denominator.divide(g);
+    }
+    if (numerator.fitsInt64() && denominator.fitsInt64()) return Rational(numerator.toInt64(), denominator.toInt64(), Raw());
+    Rational result;
+    result.big_ = std::make_shared<const Big>(Big{std::move(numerator), std::move(denominator)});
+    return result;
+}
+
+types::Rational types::Rational::fromString(const std::string& str) {
+    auto slash = str.find('/');
+    if (slash != std::string::npos) return fromString(str.substr(0, slash)) / fromString(str.substr(slash + 1));
+
+    // sign, digits, optional fraction digits, optional exponent
+    std::size_t i = 0;
+    std::string digits;
+    bool negative = false;
+    if (i < str.size() && (str[i] == '-' || str[i] == '+')) negative = str[i++] == '-';
+    long exponent = 0;
+    bool has_digits = false, has_point = false;
+    for (; i < str.size(); ++i) {
+        char ch = str[i];
+        if (ch >= '0' && ch <= '9') {
+            digits += ch;
+            has_digits = true;
+            if (has_point) --exponent;
+        }
+        else if (ch == '.' && !has_point) has_point = true;
+        else break;
+    }
+    if (has_digits && i < str.size() && (str[i] == 'e' || str[i] == 'E')) {
+        std::size_t used = 0;
+        try {
+            exponent += std::stol(str.substr(i + 1), &used);
+        }
+        catch (const std::exception&) {
+            used = 0;
+        }
+        i = used ? i + 1 + used : str.size() + 1;
+    }
+    if (!has_digits || i != str.size()) throw std::invalid_argument("Numerical error: '" + str + "' is not a valid number");
+
+    BigInteger numerator = BigInteger::fromString(digits);
+    BigInteger power(1);
+    for (long k = 0; k < (exponent < 0 ? -exponent : exponent); ++k) power = power * BigInteger(10);
+    if (negative) numerator = -numerator;
+    return exponent < 0 ? fromBig(std::move(numerator), std::move(power)) : fromBig(numerator * power, BigInteger(1));
+}
+
+std::string types::Rational::toString() const {
+    if (big_) {
+        std::string result = big_->numerator_.toString();
+        if (big_->denominator_ != BigInteger(1)) result += "/" + big_->denominator_.toString();
+        return result;
+    }
+    std::string result = std::to_string(numerator_);
+    if (denominator_ != 1) result += "/" + std::to_string(denominator_);
+    return result;
+}
+
+double types::Rational::toDouble() const noexcept {
+    if (big_) return big_->numerator_.toDouble() / big_->denominator_.toDouble();
+    return static_cast<double>(numerator_) / static_cast<double>(denominator_);
+}
+
+types::Rational types::Rational::operator-() const {
+    std::int64_t negated;
+    if (!big_ && !__builtin_sub_overflow(0, numerator_, &negated)) return Rational(negated, denominator_, Raw());
+    return fromBig(-bigNumerator(), bigDenominator());
+}
+
+types::Rational types::Rational::operator+(const Rational& other) const {
+    if (!big_ && !other.big_) {
+        std::int64_t numerator, denominator, a, b;
+        if (denominator_ == other.denominator_) {
+            if (!__builtin_add_overflow(numerator_, other.numerator_, &numerator)) {
+                auto g = static_cast<std::int64_t>(gcd64(magnitude(numerator), static_cast<std::uint64_t>(denominator_)));
+                return Rational(reduce(numerator, g), reduce(denominator_, g), Raw());
+            }
+        }
+        else {
+            // Knuth's method: with g = gcd(d1, d2), the sum's common factors all divide g
+            auto g = static_cast<std::int64_t>(gcd64(static_cast<std::uint64_t>(denominator_), static_cast<std::uint64_t>(other.denominator_)));
+            if (!__builtin_mul_overflow(numerator_, reduce(other.denominator_, g), &a)
+                && !__builtin_mul_overflow(other.numerator_, reduce(denominator_, g), &b) && !__builtin_add_overflow(a, b, &numerator)) {
+                if (numerator == 0) return Rational();
+                auto g2 = g == 1 ? 1 : static_cast<std::int64_t>(gcd64(magnitude(numerator), static_cast<std::uint64_t>(g)));
+                if (!__builtin_mul_overflow(reduce(denominator_, g), reduce(other.denominator_, g2), &denominator)) {
+                    return Rational(reduce(numerator, g2), denominator, Raw());
+                }
+            }
+        }
+    }
+    return fromBig(bigNumerator() * other.bigDenominator() + other.bigNumerator() * bigDenominator(),
+        bigDenominator() * other.bigDenominator());
+}
+
+types::Rational types::Rational::operator-(const Rational& other) const {
+    return *this + (-other);
+}
+
+types::Rational types::Rational::operator*(const Rational& other) const {
+    if (!big_ && !other.big_) {
+        // Cross-cancelling first keeps the product in lowest terms
+        auto g1 = static_cast<std::int64_t>(gcd64(magnitude(numerator_), static_cast<std::uint64_t>(other.denominator_)));
+        auto g2 = static_cast<std::int64_t>(gcd64(magnitude(other.numerator_), static_cast<std::uint64_t>(denominator_)));
+        std::int64_t numerator, denominator;
+        if (numerator_ == 0 || other.numerator_ == 0) return Rational();
+        if (!__builtin_mul_overflow(reduce(numerator_, g1), reduce(other.numerator_, g2), &numerator)
+            && !__builtin_mul_overflow(reduce(denominator_, g2), reduce(other.denominator_, g1), &denominator)) {
+            return Rational(numerator, denominator, Raw());
+        }
+    }
+    return fromBig(bigNumerator() * other.bigNumerator(), bigDenominator() * other.bigDenominator());
+}
+
+types::Rational types::Rational::operator/(const Rational& other) const {
+    if (other.sign() == 0) throw std::domain_error("Numerical error: Cannot divide by 0");
+    if (!other.big_) {
+        // The reciprocal, with the sign moved to the numerator
+        std::int64_t numerator = other.denominator_, denominator = other.numerator_;
+        if (denominator > 0 || (!__builtin_sub_overflow(0, numerator, &numerator) && !__builtin_sub_overflow(0, denominator, &denominator))) {
+            return *this * Rational(numerator, denominator, Raw());
+        }
+    }
+    return fromBig(bigNumerator() * other.bigDenominator(), bigDenominator() * other.bigNumerator());
+}
+
+int types::Rational::compare(const Rational& other) const {
+    if (!big_ && !other.big_) {
+        __int128 a = static_cast<__int128>(numerator_) * other.denominator_;
+        __int128 b = static_cast<__int128>(other.numerator_) * denominator_;
+        return (a > b) - (a < b);
+    }
+    return (bigNumerator() * other.bigDenominator()).compare(other.bigNumerator() * bigDenominator());
+}
@@ -0,0 +1,148 @@
+#include "functional/constants.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "functional/numbers.h"
+#include "functional/parallel.h"
+
+namespace {
+
+using parallel::run_tasks;
+using types::BigInteger;
+
+constexpr double kDigitsPerTerm = 14.181647462725477; // log10(640320^3 / 1728) digits per Chudnovsky term
+constexpr std::int64_t kChudnovskyFactor = 10939058860032000; // 640320^3 / 24
+constexpr std::size_t kParallelTerms = 4096; // Shortest range of terms split on separate threads
+constexpr std::size_t kGuardDigits = 10;
+
+BigInteger power_of_ten(std::size_t exponent) {
+    BigInteger result(1), base(10);
+    for (; exponent > 0; exponent >>= 1) {
+        if (exponent & 1) result = result * base;
+        if (exponent > 1) base = base * base;
+    }
+    return result;
+}
+
+// Sums of the Chudnovsky terms a..b-1: T / Q = sum of P(a..k) (13591409 + 545140134 k) (-1)^k / Q(a..k)
+struct Chudnovsky {
+    BigInteger p_, q_, t_;
+};
+
+Chudnovsky chudnovsky(std::int64_t a, std::int64_t b, unsigned threads, bool need_p) {
+    if (b - a == 1) {
+        if (a == 0) return {BigInteger(1), BigInteger(1), BigInteger(13591409)};
+        BigInteger p = BigInteger((6 * a - 5) * (2 * a - 1)) * BigInteger(6 * a - 1);
+        BigInteger q = BigInteger(a) * BigInteger(a * a) * BigInteger(kChudnovskyFactor);
+        BigInteger t = p * BigInteger(13591409 + 545140134 * a);
+        return {std::move(p), std::move(q), a % 2 == 0 ? std::move(t) : -t};
+    }
+    const std::int64_t middle = a + (b - a) / 2;
+    Chudnovsky left, right;
+    if (threads > 1 && static_cast<std::size_t>(b - a) >= kParallelTerms) {
+        run_tasks({[&] { left = chudnovsky(a, middle, threads / 2, true); },
+            [&] { right = chudnovsky(middle, b, threads - threads / 2, need_p); }}, 2);
+    }
+    else {
+        left = chudnovsky(a, middle, 1, true);
+        right = chudnovsky(middle, b, 1, need_p);
+    }
+
+    Chudnovsky result;
+    BigInteger first, second;
+    std::vector<std::function<void()>> products = {
+        [&] { result.q_ = left.q_ * right.q_; },
+        [&] { first = left.t_ * right.q_; },
+        [&] { second = left.p_ * right.t_; }};
+    if (need_p) products.emplace_back([&] { result.p_ = left.p_ * right.p_; });
+    run_tasks(products, threads);
+    result.t_ = first + second;
+    return result;
+}
+
+// Sums of the factorial series a+1..b: P / Q = sum of 1 / ((a + 1) (a + 2) ... k)
+struct Factorial {
+    BigInteger p_, q_;
+};
+
+Factorial factorial_series(std::int64_t a, std::int64_t b, unsigned threads) {
+    if (b - a == 1) return {BigInteger(1), BigInteger(b)};
+    const std::int64_t middle = a + (b - a) / 2;
+    Factorial left, right;
+    if (threads > 1 && static_cast<std::size_t>(b - a) >= kParallelTerms) {
+        run_tasks({[&] { left = factorial_series(a, middle, threads / 2); },
+            [&] { right = factorial_series(middle, b, threads - threads / 2); }}, 2);
+    }
+    else {
+        left = factorial_series(a, middle, 1);
+        right = factorial_series(middle, b, 1);
+    }
+
+    Factorial result;
+    BigInteger product;
+    run_tasks({[&] { result.q_ = left.q_ * right.q_; }, [&] { product = left.p_ * right.q_; }}, threads);
+    result.p_ = product + right.p_;
+    return result;
+}
+
+struct Cache {
+    std::mutex mutex_;
+    std::string digits_; // floor(c 10^n) for the largest n computed so far, empty before
+};
+
+Cache& cache(constants::Constant constant) {
+    static Cache caches[2];
+    return caches[static_cast<std::size_t>(constant)];
+}
+
+} // namespace
+
+const std::string& constants::constant_name(Constant constant) noexcept {
+    static const std::string names[] = {"pi", "e"};
+    return names[static_cast<std::size_t>(constant)];
+}
+
+types::BigInteger constants::scaled(Constant constant, std::size_t digits, unsigned threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+    if (constant == Constant::Pi) {
+        // Each term adds about 14.18 digits
+        const auto terms = static_cast<std::int64_t>(static_cast<double>(digits) / kDigitsPerTerm) + 2;
+        Chudnovsky sums;
+        BigInteger root;
+        run_tasks({[&] { sums = chudnovsky(0, terms, std::max(1u, threads - 1), false); },
+            [&] { root = types::isqrt(BigInteger(10005) * power_of_ten(2 * digits)); }}, 2);
+        return (BigInteger(426880) * root * sums.q_).divide(sums.t_);
+    }
+
+    // Enough terms that the tail, below 1 / terms!, is below 10^-(digits + 1)
+    const double target = static_cast<double>(digits + 1) * std::log(10.0);
+    std::int64_t terms = 2;
+    while (numbers::lgamma(static_cast<double>(terms) + 1) < target) terms *= 2;
+    for (std::int64_t step = terms / 4; step > 0; step /= 2) {
+        if (numbers::lgamma(static_cast<double>(terms - step) + 1) >= target) terms -= step;
+    }
+    Factorial sums = factorial_series(0, terms, threads);
+    return (power_of_ten(digits) * (sums.q_ + sums.p_)).divide(sums.q_);
+}
+
+std::string constants::digits(Constant constant, std::size_t digits, unsigned threads) {
+    Cache& cached = cache(constant);
+    std::lock_guard<std::mutex> lock(cached.mutex_);
+    if (cached.digits_.size() < digits + 1) {
+        for (std::size_t guard = kGuardDigits; ; guard *= 2) {
+            // The scaled value is off by a few units, which changes the truncated digits only next to a carry
+            std::string text = scaled(constant, digits + guard, threads).toString();
+            std::string tail = text.substr(text.size() - guard);
+            if (tail.find_first_not_of('0') < guard - 2 && tail.find_first_not_of('9') < guard - 2) {
+                cached.digits_ = text.substr(0, text.size() - guard);
+                break;
+            }
+        }
+    }
+    std::string result = cached.digits_.substr(0, 1);
+    if (digits > 0) result += "." + cached.digits_.substr(1, digits);
+    return result;
+}
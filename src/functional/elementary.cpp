@@ -0,0 +1,174 @@
+#include "functional/elementary.h"
+#include <atomic>
+#include <cmath>
+#include "functional/elementary_kernels.h"
+#include "functional/numbers.h"
+
+namespace elementary {
+
+#ifdef CALC_HAS_AVX2
+// Defined in elementary_avx2.cpp, built with -mavx2 -mfma
+namespace avx2 {
+double exp(double x) noexcept;
+double log(double x) noexcept;
+double sin(double x) noexcept;
+double cos(double x) noexcept;
+double pow(double x, double y) noexcept;
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept;
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept;
+} // namespace avx2
+#endif
+
+namespace {
+
+std::atomic<Accuracy> selected_accuracy{Accuracy::Precise};
+
+double precise(Function function, double x) noexcept {
+    switch (function) {
+        case Function::Sqrt: return std::sqrt(x);
+        case Function::Exp: return std::exp(x);
+        case Function::Log: return std::log(x);
+        case Function::Sin: return std::sin(x);
+        case Function::Cos: return std::cos(x);
+        case Function::Gamma: return numbers::gamma(x);
+        case Function::LogGamma: return numbers::lgamma(x);
+        case Function::Factorial: return numbers::factorial(x);
+    } // switch (function)
+    return x;
+}
+
+} // namespace
+
+void set_accuracy(Accuracy accuracy) noexcept { selected_accuracy.store(accuracy, std::memory_order_relaxed); }
+
+Accuracy accuracy() noexcept { return selected_accuracy.load(std::memory_order_relaxed); }
+
+bool has_avx2() noexcept {
+#ifdef CALC_HAS_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+const std::string& function_name(Function function) noexcept {
+    static const std::string names[] = {"sqrt", "exp", "log", "sin", "cos", "gamma", "lgamma", "!"};
+    return names[static_cast<std::size_t>(function)];
+}
+
+bool in_domain(Function function, double x) noexcept {
+    switch (function) {
+        case Function::Sqrt: return !(x < 0);
+        case Function::Log: return !(x <= 0);
+        case Function::Sin:
+        case Function::Cos: return !std::isinf(x);
+        case Function::Gamma:
+        case Function::LogGamma: return !(x <= 0 && x == std::trunc(x)); // Poles at 0, -1, -2, ...
+        case Function::Factorial: return !(x < 0 && x == std::trunc(x));
+        case Function::Exp: return true;
+    } // switch (function)
+    return true;
+}
+
+bool pow_in_domain(double x, double y) noexcept {
+    if (x < 0 && std::isfinite(y)) return y == std::trunc(y);
+    return !(x == 0 && y < 0);
+}
+
+double evaluate(Function function, double x) noexcept {
+    if (accuracy() == Accuracy::Precise) return precise(function, x);
+    switch (function) {
+        case Function::Sqrt: return std::sqrt(x);
+        case Function::Exp: return fast::exp(x);
+        case Function::Log: return fast::log(x);
+        case Function::Sin: return fast::sin(x);
+        case Function::Cos: return fast::cos(x);
+        default: return precise(function, x);
+    } // switch (function)
+}
+
+double pow(double x, double y) noexcept { return accuracy() == Accuracy::Precise ? std::pow(x, y) : fast::pow(x, y); }
+
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept {
+    if (accuracy() == Accuracy::Fast) return fast::evaluate(function, x, result, count);
+    for (std::size_t i = 0; i < count; ++i) result[i] = precise(function, x[i]);
+}
+
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept {
+    if (accuracy() == Accuracy::Fast) return fast::pow(x, y, result, count);
+    for (std::size_t i = 0; i < count; ++i) result[i] = std::pow(x[i], y[i]);
+}
+
+namespace fast {
+
+double exp(double x) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::exp(x); // Fused multiply-adds
+#endif
+    return exp_in_range(x) ? exp_kernel(x) : std::exp(x);
+}
+
+double log(double x) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::log(x); // Fused multiply-adds
+#endif
+    return log_in_range(x) ? log_kernel(x) : std::log(x);
+}
+
+double sin(double x) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::sin(x); // Fused multiply-adds
+#endif
+    return trig_in_range(x) ? sin_kernel(x, 0) : std::sin(x);
+}
+
+double cos(double x) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::cos(x); // Fused multiply-adds
+#endif
+    return trig_in_range(x) ? sin_kernel(x, 1) : std::cos(x);
+}
+
+double pow(double x, double y) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::pow(x, y); // Fused multiply-adds
+#endif
+    if (pow_in_range(x, y)) {
+        double product;
+        double power = pow_kernel(x, y, product);
+        if (exp_in_range(product)) return power;
+    }
+    return std::pow(x, y);
+}
+
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::evaluate(function, x, result, count); // Four arguments at once
+#endif
+    double (*scalar)(double) noexcept = nullptr;
+    switch (function) {
+        case Function::Sqrt:
+            for (std::size_t i = 0; i < count; ++i) result[i] = std::sqrt(x[i]);
+            return;
+        case Function::Exp: scalar = fast::exp; break;
+        case Function::Log: scalar = fast::log; break;
+        case Function::Sin: scalar = fast::sin; break;
+        case Function::Cos: scalar = fast::cos; break;
+        default:
+            for (std::size_t i = 0; i < count; ++i) result[i] = precise(function, x[i]);
+            return;
+    } // switch (function)
+    for (std::size_t i = 0; i < count; ++i) result[i] = scalar(x[i]);
+}
+
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (has_avx2()) return avx2::pow(x, y, result, count); // Four arguments at once
+#endif
+    for (std::size_t i = 0; i < count; ++i) result[i] = fast::pow(x[i], y[i]);
+}
+
+} // namespace fast
+
+} // namespace elementary
@@ -0,0 +1,108 @@
+#include "functional/elementary.h"
+#include <cmath>
+#include <cstring>
+#include "functional/elementary_kernels.h"
+
+// The kernels of elementary::fast built with -mavx2 -mfma, called only if has_avx2(). The scalar ones differ from the
+// portable build only by fusing multiply-adds; the array ones pass four arguments through a kernel at once, then
+// recompute the lanes outside its reduced range with libm.
+
+namespace elementary {
+namespace avx2 {
+
+namespace {
+
+constexpr std::size_t kWidth = 4;
+
+inline Double4 load(const double* source) noexcept {
+    Double4 v;
+    std::memcpy(&v, source, sizeof(v));
+    return v;
+}
+
+inline void store(double* destination, Double4 v) noexcept { std::memcpy(destination, &v, sizeof(v)); }
+
+// Applies kernel where in_range holds and libm elsewhere; result may alias x
+template <typename Kernel, typename InRange, typename Libm>
+void apply(const double* x, double* result, std::size_t count, Kernel kernel, InRange in_range, Libm libm) noexcept {
+    std::size_t i = 0;
+    for (; i + kWidth <= count; i += kWidth) {
+        Double4 v = load(x + i);
+        Int4 ok = in_range(v);
+        store(result + i, kernel(v));
+        if (any(ok == 0)) {
+            for (std::size_t lane = 0; lane < kWidth; ++lane) {
+                if (!ok[lane]) result[i + lane] = libm(v[lane]);
+            }
+        }
+    }
+    for (; i < count; ++i) result[i] = in_range(x[i]) ? kernel(x[i]) : libm(x[i]);
+}
+
+} // namespace
+
+double exp(double x) noexcept { return exp_in_range(x) ? exp_kernel(x) : std::exp(x); }
+
+double log(double x) noexcept { return log_in_range(x) ? log_kernel(x) : std::log(x); }
+
+double sin(double x) noexcept { return trig_in_range(x) ? sin_kernel(x, 0) : std::sin(x); }
+
+double cos(double x) noexcept { return trig_in_range(x) ? sin_kernel(x, 1) : std::cos(x); }
+
+double pow(double x, double y) noexcept {
+    if (pow_in_range(x, y)) {
+        double product;
+        double power = pow_kernel(x, y, product);
+        if (exp_in_range(product)) return power;
+    }
+    return std::pow(x, y);
+}
+
+void evaluate(Function function, const double* x, double* result, std::size_t count) noexcept {
+    switch (function) {
+        case Function::Sqrt: {
+            std::size_t i = 0;
+            for (; i + kWidth <= count; i += kWidth) {
+                store(result + i, reinterpret_cast<Double4>(_mm256_sqrt_pd(reinterpret_cast<__m256d>(load(x + i)))));
+            }
+            for (; i < count; ++i) result[i] = std::sqrt(x[i]);
+            return;
+        }
+        case Function::Exp:
+            return apply(x, result, count, [](auto v) { return exp_kernel(v); },
+                [](auto v) { return exp_in_range(v); }, [](double v) { return std::exp(v); });
+        case Function::Log:
+            return apply(x, result, count, [](auto v) { return log_kernel(v); },
+                [](auto v) { return log_in_range(v); }, [](double v) { return std::log(v); });
+        case Function::Sin:
+            return apply(x, result, count, [](auto v) { return sin_kernel(v, 0); },
+                [](auto v) { return trig_in_range(v); }, [](double v) { return std::sin(v); });
+        case Function::Cos:
+            return apply(x, result, count, [](auto v) { return sin_kernel(v, 1); },
+                [](auto v) { return trig_in_range(v); }, [](double v) { return std::cos(v); });
+        default:
+            for (std::size_t i = 0; i < count; ++i) result[i] = elementary::evaluate(function, x[i]);
+            return;
+    } // switch (function)
+}
+
+void pow(const double* x, const double* y, double* result, std::size_t count) noexcept {
+    std::size_t i = 0;
+    for (; i + kWidth <= count; i += kWidth) {
+        Double4 base = load(x + i);
+        Double4 exponent = load(y + i);
+        Double4 product;
+        Double4 power = pow_kernel(base, exponent, product);
+        Int4 ok = pow_in_range(base, exponent) & exp_in_range(product);
+        store(result + i, power);
+        if (any(ok == 0)) {
+            for (std::size_t lane = 0; lane < kWidth; ++lane) {
+                if (!ok[lane]) result[i + lane] = std::pow(base[lane], exponent[lane]);
+            }
+        }
+    }
+    for (; i < count; ++i) result[i] = avx2::pow(x[i], y[i]);
+}
+
+} // namespace avx2
+} // namespace elementary
@@ -0,0 +1,138 @@
+#include "functional/linalg.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "functional/elementary.h"
+#include "functional/linalg_kernels.h"
+
+namespace linalg {
+
+#ifdef CALC_HAS_AVX2
+// Defined in linalg_avx2.cpp, built with -mavx2 -mfma
+namespace avx2 {
+
+void multiply_add(std::size_t m, std::size_t n, std::size_t k, double alpha, const double* a, std::size_t lda,
+    const double* b, std::size_t ldb, double* c, std::size_t ldc);
+
+} // namespace avx2
+#endif
+
+} // namespace linalg
+
+namespace {
+
+constexpr std::size_t kTransposeTile = 32; // Side of the tiles of transpose, 32 rows of 32 numerals fitting L1
+
+} // namespace
+
+void linalg::multiply_add(std::size_t m, std::size_t n, std::size_t k, double alpha, const double* a, std::size_t lda,
+    const double* b, std::size_t ldb, double* c, std::size_t ldc) {
+
+#ifdef CALC_HAS_AVX2
+    if (elementary::has_avx2()) return avx2::multiply_add(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+#endif
+    Gemm<Double2, 4, 2>::run(m, n, k, alpha, a, lda, b, ldb, c, ldc); // Eight accumulators of the sixteen xmm registers
+}
+
+void linalg::multiply(const double* a, const double* b, double* c, std::size_t m, std::size_t k, std::size_t n, unsigned threads) {
+    std::fill(c, c + m * n, 0.0);
+    const std::size_t bands = m * k * n < kParallelWork ? 1 : std::min<std::size_t>(threads, (m + kRowBlock - 1) / kRowBlock);
+    if (bands <= 1) return multiply_add(m, n, k, 1, a, k, b, n, c, n);
+
+    // Bands of whole row blocks, so no thread packs a block of A another one packs too
+    const std::size_t band = ((m + bands - 1) / bands + kRowBlock - 1) / kRowBlock * kRowBlock;
+    std::vector<std::thread> workers;
+    for (std::size_t first = band; first < m; first += band) {
+        const std::size_t rows = std::min(band, m - first);
+        workers.emplace_back([=]() { multiply_add(rows, n, k, 1, a + first * k, k, b, n, c + first * n, n); });
+    }
+    multiply_add(std::min(band, m), n, k, 1, a, k, b, n, c, n);
+    for (auto& worker : workers) worker.join();
+}
+
+void linalg::transpose(const double* a, double* t, std::size_t rows, std::size_t columns) noexcept {
+    for (std::size_t i0 = 0; i0 < rows; i0 += kTransposeTile) {
+        const std::size_t i1 = std::min(rows, i0 + kTransposeTile);
+        for (std::size_t j0 = 0; j0 < columns; j0 += kTransposeTile) {
+            const std::size_t j1 = std::min(columns, j0 + kTransposeTile);
+            for (std::size_t i = i0; i < i1; ++i) {
+                for (std::size_t j = j0; j < j1; ++j) t[j * rows + i] = a[i * columns + j];
+            }
+        }
+    }
+}
+
+bool linalg::lu_factor(double* a, std::size_t n, std::size_t* pivots) {
+    for (std::size_t j0 = 0; j0 < n; j0 += kPanelWidth) {
+        const std::size_t j1 = std::min(n, j0 + kPanelWidth);
+
+        // The panel of columns j0..j1, column by column, swapping whole rows
+        for (std::size_t j = j0; j < j1; ++j) {
+            std::size_t pivot = j;
+            for (std::size_t i = j + 1; i < n; ++i) {
+                if (std::fabs(a[i * n + j]) > std::fabs(a[pivot * n + j])) pivot = i;
+            }
+            pivots[j] = pivot;
+            if (a[pivot * n + j] == 0) return false;
+            if (pivot != j) std::swap_ranges(a + j * n, a + (j + 1) * n, a + pivot * n);
+
+            const double* row = a + j * n;
+            for (std::size_t i = j + 1; i < n; ++i) {
+                double* target = a + i * n;
+                const double factor = target[j] /= row[j];
+                for (std::size_t c = j + 1; c < j1; ++c) target[c] -= factor * row[c];
+            }
+        }
+        if (j1 == n) break;
+
+        // The rows of U right of the panel, by the unit lower triangle of the panel
+        for (std::size_t i = j0 + 1; i < j1; ++i) {
+            double* target = a + i * n;
+            for (std::size_t r = j0; r < i; ++r) {
+                const double factor = target[r];
+                const double* row = a + r * n;
+                for (std::size_t c = j1; c < n; ++c) target[c] -= factor * row[c];
+            }
+        }
+
+        // The rest of the matrix, less L (below the panel) times U (right of it)
+        const std::size_t rest = n - j1;
+        multiply_add(rest, rest, j1 - j0, -1, a + j1 * n + j0, n, a + j0 * n + j1, n, a + j1 * n + j1, n);
+    }
+    return true;
+}
+
+void linalg::lu_solve(const double* lu, const std::size_t* pivots, std::size_t n, double* b, std::size_t columns) noexcept {
+    for (std::size_t i = 0; i < n; ++i) {
+        if (pivots[i] != i) std::swap_ranges(b + i * columns, b + (i + 1) * columns, b + pivots[i] * columns);
+    }
+    for (std::size_t i = 1; i < n; ++i) {
+        double* target = b + i * columns;
+        for (std::size_t r = 0; r < i; ++r) {
+            const double factor = lu[i * n + r];
+            const double* row = b + r * columns;
+            for (std::size_t c = 0; c < columns; ++c) target[c] -= factor * row[c];
+        }
+    }
+    for (std::size_t i = n; i-- > 0; ) {
+        double* target = b + i * columns;
+        for (std::size_t r = i + 1; r < n; ++r) {
+            const double factor = lu[i * n + r];
+            const double* row = b + r * columns;
+            for (std::size_t c = 0; c < columns; ++c) target[c] -= factor * row[c];
+        }
+        const double diagonal = lu[i * n + i];
+        for (std::size_t c = 0; c < columns; ++c) target[c] /= diagonal;
+    }
+}
+
+double linalg::lu_determinant(const double* lu, const std::size_t* pivots, std::size_t n) noexcept {
+    double determinant = 1;
+    for (std::size_t i = 0; i < n; ++i) {
+        determinant *= lu[i * n + i];
+        if (pivots[i] != i) determinant = -determinant;
+    }
+    return determinant;
+}
@@ -0,0 +1,16 @@
+#include "functional/linalg.h"
+#include "functional/linalg_kernels.h"
+
+// The matrix product built with -mavx2 -mfma, called only if elementary::has_avx2(). Tiles of 6 x 8 keep twelve
+// accumulators of four doubles in the sixteen ymm registers, and the multiply-adds are fused.
+
+namespace linalg {
+namespace avx2 {
+
+void multiply_add(std::size_t m, std::size_t n, std::size_t k, double alpha, const double* a, std::size_t lda,
+    const double* b, std::size_t ldb, double* c, std::size_t ldc) {
+    Gemm<Double4, 6, 2>::run(m, n, k, alpha, a, lda, b, ldb, c, ldc);
+}
+
+} // namespace avx2
+} // namespace linalg
@@ -1,3 +1,259 @@
 #include "functional/numbers.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
 
+namespace {
 
+constexpr long double kPi = 3.141592653589793238462643383279502884L;
+constexpr long double kHalfLogTwoPi = 0.918938533204672741780329736405617640L; // log(2 pi) / 2
+constexpr double kStirlingMinimum = 10;      // Stirling's series below is within 2^-64 from here
+constexpr std::uint64_t kMaxFallingSteps = 256; // Longest falling product for a real upper argument
+constexpr std::uint64_t kLeafLimit = std::uint64_t(1) << 62; // Leaves of the product trees are packed below this
+
+// B_2k / (2k (2k - 1)) for k = 1..8
+constexpr std::array<long double, 8> kStirlingCoefficients = {
+    1.0L / 12, -1.0L / 360, 1.0L / 1260, -1.0L / 1680, 1.0L / 1188, -691.0L / 360360, 1.0L / 156, -3617.0L / 122400};
+
+// B_2k / 2k for k = 1..7
+constexpr std::array<long double, 7> kDigammaCoefficients = {1.0L / 12, -1.0L / 120, 1.0L / 252, -1.0L / 240, 1.0L / 132,
+    -691.0L / 32760, 1.0L / 12};
+
+const std::array<std::uint64_t, numbers::kMaxFactorial64 + 1>& factorials64() noexcept {
+    static const auto table = [] {
+        std::array<std::uint64_t, numbers::kMaxFactorial64 + 1> result{1};
+        for (std::size_t n = 1; n < result.size(); ++n) result[n] = result[n - 1] * n;
+        return result;
+    }();
+    return table;
+}
+
+// n! rounded once from a long double product, whose 64-bit significand absorbs the rounding of 170 steps
+const std::array<double, numbers::kMaxFactorialDouble + 1>& factorials_double() noexcept {
+    static const auto table = [] {
+        std::array<double, numbers::kMaxFactorialDouble + 1> result{};
+        long double product = 1;
+        for (std::size_t n = 0; n < result.size(); ++n) {
+            if (n > 0) product *= n;
+            result[n] = n <= numbers::kMaxFactorial64 ? static_cast<double>(factorials64()[n]) : static_cast<double>(product);
+        }
+        return result;
+    }();
+    return table;
+}
+
+bool is_integer(double x) noexcept { return x == std::trunc(x); }
+
+// sin(pi x), accurate near the integers where sin(pi x) is small
+long double sin_pi(double x) noexcept {
+    double n = std::nearbyint(x);
+    long double value = std::sin(kPi * (x - n)); // x - n is exact
+    return std::fmod(n, 2) == 0 ? value : -value;
+}
+
+// log gamma(x) for x >= kStirlingMinimum
+long double stirling(long double x) noexcept {
+    long double inverse = 1 / x, square = inverse * inverse, series = 0;
+    for (std::size_t k = kStirlingCoefficients.size(); k-- > 0; ) series = series * square + kStirlingCoefficients[k];
+    return (x - 0.5L) * std::log(x) - x + kHalfLogTwoPi + series * inverse;
+}
+
+// gamma(x) for positive x, shifted up to Stirling's series by gamma(x) = gamma(x + m) / (x (x + 1) ... (x + m - 1))
+long double gamma_positive(long double x) noexcept {
+    long double product = 1;
+    for (; x < kStirlingMinimum; x += 1) product *= x;
+    return std::exp(stirling(x)) / product;
+}
+
+// log|gamma(x)| for x not a pole
+long double log_gamma(double x) noexcept {
+    if (x >= kStirlingMinimum) return stirling(x);
+    if (x > 0) return std::log(gamma_positive(x));
+    return std::log(kPi / std::fabs(sin_pi(x))) - log_gamma(1 - x); // gamma(x) gamma(1 - x) = pi / sin(pi x)
+}
+
+// The sign of gamma(x), alternating between the poles at the non-positive integers
+int gamma_sign(double x) noexcept { return x > 0 || std::fmod(std::floor(x), 2) == 0 ? 1 : -1; }
+
+// binom(n, k) for an integer k >= 0, which is at most n / 2 if n is an integer: exactly while the value fits in
+// 64 bits, then as a falling product until it overflows
+double falling_binomial(double n, double k) noexcept {
+    long double value = 1;
+    double j = 0;
+    if (is_integer(n) && n < 0x1p64) {
+        auto top = static_cast<std::uint64_t>(n);
+        unsigned __int128 exact = 1;
+        for (; j < k && exact <= std::numeric_limits<std::uint64_t>::max(); ++j) { // exact * (top - j) fits
+            auto step = static_cast<std::uint64_t>(j);
+            exact = exact * (top - step) / (step + 1);
+        }
+        if (j == k) return static_cast<double>(exact);
+        value = static_cast<long double>(exact);
+    }
+    for (; j < k && std::fabs(value) <= std::numeric_limits<double>::max() && value != 0; ++j) value *= (n - j) / (j + 1);
+    return static_cast<double>(value);
+}
+
+// Pushes p^exponent onto the leaves, packing the factors of a leaf below kLeafLimit
+void push_power(std::vector<std::uint64_t>& leaves, std::uint64_t p, std::uint64_t exponent) {
+    for (; exponent > 0; --exponent) {
+        if (leaves.empty() || leaves.back() >= kLeafLimit / p) leaves.push_back(p);
+        else leaves.back() *= p;
+    }
+}
+
+// The product of leaves[begin, end) as a balanced tree, so that the factors of each product have similar sizes
+types::BigInteger product_tree(const std::vector<std::uint64_t>& leaves, std::size_t begin, std::size_t end) {
+    if (end - begin == 0) return types::BigInteger(1);
+    if (end - begin == 1) return types::BigInteger(static_cast<std::int64_t>(leaves[begin]));
+    std::size_t middle = begin + (end - begin) / 2;
+    return product_tree(leaves, begin, middle) * product_tree(leaves, middle, end);
+}
+
+// Primes up to n
+std::vector<std::uint64_t> primes_to(std::uint64_t n) {
+    std::vector<bool> composite(n + 1);
+    std::vector<std::uint64_t> primes;
+    for (std::uint64_t p = 2; p <= n; ++p) {
+        if (composite[p]) continue;
+        primes.push_back(p);
+        for (std::uint64_t multiple = p * p; multiple <= n; multiple += p) composite[multiple] = true;
+    }
+    return primes;
+}
+
+// n! / (n/2)!^2, the product of p^e over the primes p <= n, with e the number of odd floor(n / p^i)
+types::BigInteger swing(std::uint64_t n, const std::vector<std::uint64_t>& primes) {
+    std::vector<std::uint64_t> leaves;
+    for (std::uint64_t p : primes) {
+        if (p > n) break;
+        std::uint64_t exponent = 0;
+        for (std::uint64_t q = n / p; q > 0; q /= p) exponent += q & 1;
+        push_power(leaves, p, exponent);
+    }
+    return product_tree(leaves, 0, leaves.size());
+}
+
+types::BigInteger factorial_recursive(std::uint64_t n, const std::vector<std::uint64_t>& primes) {
+    if (n <= numbers::kMaxFactorial64) return types::BigInteger(static_cast<std::int64_t>(numbers::factorial64(n)));
+    types::BigInteger half = factorial_recursive(n / 2, primes);
+    return half * half * swing(n, primes);
+}
+
+} // namespace
+
+std::uint64_t numbers::factorial64(std::uint64_t n) noexcept { return factorials64()[n]; }
+
+double numbers::factorial(double x) noexcept {
+    if (is_integer(x) && x >= 0) return x <= kMaxFactorialDouble ? factorials_double()[static_cast<std::size_t>(x)] : HUGE_VAL;
+    return gamma(x + 1);
+}
+
+double numbers::gamma(double x) noexcept {
+    if (std::isnan(x) || x == -HUGE_VAL) return std::numeric_limits<double>::quiet_NaN();
+    if (is_integer(x)) return x > 0 ? factorial(x - 1) : std::numeric_limits<double>::quiet_NaN();
+    if (x > 171.7) return HUGE_VAL;
+    if (x >= 0.5) return static_cast<double>(gamma_positive(x));
+    if (x < -185) return 0.0 * gamma_sign(x); // 1 / gamma(1 - x) underflows
+    return static_cast<double>(kPi / (sin_pi(x) * gamma_positive(1.0L - x)));
+}
+
+double numbers::lgamma(double x) noexcept {
+    if (std::isnan(x)) return x;
+    if (std::isinf(x)) return HUGE_VAL;
+    if (is_integer(x)) {
+        if (x <= 0) return HUGE_VAL;
+        if (x <= kMaxFactorialDouble + 1) return std::log(static_cast<long double>(factorials_double()[static_cast<std::size_t>(x) - 1]));
+    }
+    return static_cast<double>(log_gamma(x));
+}
+
+double numbers::digamma(double x) noexcept {
+    if (std::isnan(x) || x == HUGE_VAL) return x;
+    if (is_integer(x) && x <= 0) return std::numeric_limits<double>::quiet_NaN();
+    if (x < 0) { // psi(1 - x) - psi(x) = pi cot(pi x), which has period 1
+        long double reduced = kPi * (x - std::nearbyint(x));
+        return digamma(1 - x) - static_cast<double>(kPi * std::cos(reduced) / std::sin(reduced));
+    }
+    long double result = 0, shifted = x;
+    for (; shifted < 10; shifted += 1) result -= 1 / shifted; // psi(x) = psi(x + 1) - 1 / x
+    long double square = 1 / (shifted * shifted), series = 0;
+    for (std::size_t k = kDigammaCoefficients.size(); k-- > 0; ) series = series * square + kDigammaCoefficients[k];
+    return static_cast<double>(result + std::log(shifted) - 0.5L / shifted - series * square);
+}
+
+bool numbers::binomial_in_domain(double n, double k) noexcept { return !(n < 0 && is_integer(n) && !is_integer(k)); }
+
+double numbers::binomial(double n, double k) noexcept {
+    if (!std::isfinite(n) || !std::isfinite(k) || !binomial_in_domain(n, k)) return std::numeric_limits<double>::quiet_NaN();
+    if (is_integer(k)) {
+        if (k < 0) return 0;
+        if (is_integer(n)) {
+            if (n < 0) { // binom(n, k) = (-1)^k binom(k - n - 1, k)
+                double value = binomial(k - n - 1, k);
+                return std::fmod(k, 2) == 0 ? value : -value;
+            }
+            return k > n ? 0 : falling_binomial(n, std::min(k, n - k));
+        }
+        if (k <= kMaxFallingSteps) return falling_binomial(n, k);
+    }
+    if (is_integer(n - k) && n - k < 0) return 0; // gamma(n - k + 1) has a pole
+
+    // gamma(n + 1) / (gamma(k + 1) gamma(n - k + 1)) through logarithms and signs, which never overflow in between
+    long double log_value = log_gamma(n + 1) - log_gamma(k + 1) - log_gamma(n - k + 1);
+    int sign = gamma_sign(n + 1) * gamma_sign(k + 1) * gamma_sign(n - k + 1);
+    return static_cast<double>(sign * std::exp(log_value));
+}
+
+types::BigInteger numbers::factorial_exact(std::uint64_t n) {
+    if (n <= kMaxFactorial64) return factorial_recursive(n, {});
+    return factorial_recursive(n, primes_to(n));
+}
+
+types::BigInteger numbers::binomial_exact(std::uint64_t n, std::uint64_t k) {
+    if (k > n) return types::BigInteger();
+    std::vector<std::uint64_t> leaves;
+    for (std::uint64_t p : primes_to(n)) { // The exponent of p is the number of carries adding k and n - k in base p
+        std::uint64_t exponent = 0;
+        for (std::uint64_t power = p; power <= n; ) {
+            exponent += n / power - k / power - (n - k) / power;
+            if (power > n / p) break;
+            power *= p;
+        }
+        push_power(leaves, p, exponent);
+    }
+    return product_tree(leaves, 0, leaves.size());
+}
+
+numbers::BinomialTable::BinomialTable(std::uint64_t max_n) : log_factorials_(max_n + 1) {
+    long double sum = 0, compensation = 0; // Kahan summation of log i
+    for (std::uint64_t i = 2; i <= max_n; ++i) {
+        long double term = std::log(static_cast<long double>(i)) - compensation;
+        long double next = sum + term;
+        compensation = (next - sum) - term;
+        sum = next;
+        log_factorials_[i] = sum;
+    }
+}
+
+long double numbers::BinomialTable::logBinomial(std::uint64_t n, std::uint64_t k) const noexcept {
+    if (k > n) return -HUGE_VALL;
+    return log_factorials_[n] - log_factorials_[k] - log_factorials_[n - k];
+}
+
+double numbers::BinomialTable::operator()(std::uint64_t n, std::uint64_t k) const noexcept {
+    if (k > n) return 0;
+    long double log_value = logBinomial(n, k);
+    if (log_value < 43) { // Below 2^62, then exact in at most about 35 steps
+        std::uint64_t steps = std::min(k, n - k);
+        unsigned __int128 exact = 1;
+        for (std::uint64_t j = 0; j < steps; ++j) exact = exact * (n - j) / (j + 1);
+        return static_cast<double>(exact);
+    }
+    return static_cast<double>(std::exp(log_value));
+}
+
+void numbers::BinomialTable::evaluate(const std::uint64_t* n, const std::uint64_t* k, double* result, std::size_t count) const noexcept {
+    for (std::size_t i = 0; i < count; ++i) result[i] = (*this)(n[i], k[i]);
+}
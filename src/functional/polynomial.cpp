@@ -0,0 +1,193 @@
+#include "functional/polynomial.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <complex>
+
+namespace {
+
+// Shortest representation that round-trips
+std::string format(types::Numeral value) {
+    char buf[64];
+    auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), value);
+    return std::string(buf, end);
+}
+
+// In-place iterative radix-2 FFT; roots[j] = exp(2*pi*i*j/n)
+void fft(std::vector<std::complex<double>>& a, const std::vector<std::complex<double>>& roots, bool inverse) {
+    const std::size_t n = a.size();
+    for (std::size_t i = 1, j = 0; i < n; ++i) { // Bit-reversal permutation
+        std::size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(a[i], a[j]);
+    }
+    for (std::size_t length = 2; length <= n; length <<= 1) {
+        std::size_t step = n / length;
+        for (std::size_t begin = 0; begin < n; begin += length) {
+            for (std::size_t j = 0; j < length / 2; ++j) {
+                std::complex<double> root = inverse ? std::conj(roots[j * step]) : roots[j * step];
+                std::complex<double> u = a[begin + j];
+                std::complex<double> v = a[begin + j + length / 2] * root;
+                a[begin + j] = u + v;
+                a[begin + j + length / 2] = u - v;
+            }
+        }
+    }
+}
+
+} // namespace
+
+poly::Polynomial::Polynomial() : coefficients_{0}, degree_(0) {}
+
+poly::Polynomial::Polynomial(std::vector<types::Numeral> coefficients) : coefficients_(std::move(coefficients)), degree_(0) {
+    normalize();
+}
+
+void poly::Polynomial::normalize() {
+    std::size_t size = coefficients_.size();
+    while (size > 1 && coefficients_[size - 1] == 0) --size;
+    if (size == 0) size = 1;
+    degree_ = size - 1;
+
+    std::size_t padded = size;
+    if (degree_ >= kEstrinDegree) padded = (size + kEstrinBlock - 1) / kEstrinBlock * kEstrinBlock;
+    coefficients_.resize(padded, 0);
+}
+
+std::vector<types::Numeral> poly::Polynomial::coefficients() const {
+    return std::vector<types::Numeral>(coefficients_.begin(), coefficients_.begin() + degree_ + 1);
+}
+
+types::Numeral poly::Polynomial::evaluate(types::Numeral x) const noexcept {
+    const types::Numeral* c = coefficients_.data();
+    auto horner = [c, x](std::size_t degree) {
+        types::Numeral result = c[degree];
+        for (std::size_t k = degree; k-- > 0; ) result = result * x + c[k];
+        return result;
+    };
+    if (degree_ < kEstrinDegree) return horner(degree_);
+
+    // Estrin within each block, Horner across the blocks from the top one
+    types::Numeral x2 = x * x;
+    types::Numeral x4 = x2 * x2;
+    types::Numeral x8 = x4 * x4;
+    types::Numeral x16 = x8 * x8;
+    auto estrin = [&](std::size_t block) {
+        const types::Numeral* b = c + block * kEstrinBlock;
+        types::Numeral pairs[8];
+        for (int i = 0; i < 8; ++i) pairs[i] = b[2 * i] + b[2 * i + 1] * x;
+        types::Numeral quads[4];
+        for (int i = 0; i < 4; ++i) quads[i] = pairs[2 * i] + pairs[2 * i + 1] * x2;
+        types::Numeral low = quads[0] + quads[1] * x4;
+        types::Numeral high = quads[2] + quads[3] * x4;
+        return low + high * x8;
+    };
+    std::size_t block = coefficients_.size() / kEstrinBlock - 1;
+    types::Numeral result = estrin(block);
+    while (block-- > 0) result = result * x16 + estrin(block);
+
+    // The zeros padding the top block, times a power of x that overflows, give NaN where Horner gives the infinity or
+    // the finite value of the powers it does form
+    if (std::isnan(result) && !std::isnan(x)) return horner(degree_);
+    return result;
+}
+
+poly::Polynomial poly::Polynomial::derivative() const {
+    if (degree_ == 0) return Polynomial();
+    std::vector<types::Numeral> result(degree_);
+    for (std::size_t k = 1; k <= degree_; ++k) result[k - 1] = coefficients_[k] * static_cast<types::Numeral>(k);
+    return Polynomial(std::move(result));
+}
+
+poly::Polynomial poly::Polynomial::operator+(const Polynomial& other) const {
+    std::vector<types::Numeral> result(std::max(degree_, other.degree_) + 1, 0);
+    for (std::size_t k = 0; k < result.size(); ++k) result[k] = coefficient(k) + other.coefficient(k);
+    return Polynomial(std::move(result));
+}
+
+poly::Polynomial poly::Polynomial::operator-(const Polynomial& other) const {
+    std::vector<types::Numeral> result(std::max(degree_, other.degree_) + 1, 0);
+    for (std::size_t k = 0; k < result.size(); ++k) result[k] = coefficient(k) - other.coefficient(k);
+    return Polynomial(std::move(result));
+}
+
+poly::Polynomial poly::Polynomial::operator-() const {
+    std::vector<types::Numeral> result = coefficients();
+    for (auto& coefficient : result) coefficient = -coefficient;
+    return Polynomial(std::move(result));
+}
+
+poly::Polynomial poly::Polynomial::operator*(types::Numeral factor) const {
+    std::vector<types::Numeral> result = coefficients();
+    for (auto& coefficient : result) coefficient *= factor;
+    return Polynomial(std::move(result));
+}
+
+poly::Polynomial poly::Polynomial::operator*(const Polynomial& other) const {
+    return multiply(*this, other);
+}
+
+std::string poly::Polynomial::toString(const std::string& variable) const {
+    std::string result;
+    for (std::size_t k = degree_ + 1; k-- > 0; ) {
+        types::Numeral coefficient = coefficients_[k];
+        if (coefficient == 0 && !(k == 0 && result.empty())) continue;
+
+        if (result.empty()) result += coefficient < 0 ? "-" : "";
+        else result += coefficient < 0 ? " - " : " + ";
+        types::Numeral magnitude = std::fabs(coefficient);
+        if (k == 0) result += format(magnitude);
+        else {
+            if (magnitude != 1) result += format(magnitude) + "*";
+            result += variable;
+            if (k > 1) result += "^" + std::to_string(k);
+        }
+    }
+    return result;
+}
+
+poly::Polynomial poly::multiply(const Polynomial& a, const Polynomial& b) {
+    if (std::min(a.degree(), b.degree()) >= kFftDegree) return Polynomial(multiply_fft(a.coefficients(), b.coefficients()));
+    return Polynomial(multiply_schoolbook(a.coefficients(), b.coefficients()));
+}
+
+std::vector<types::Numeral> poly::multiply_schoolbook(const std::vector<types::Numeral>& a, const std::vector<types::Numeral>& b) {
+    if (a.empty() || b.empty()) return {};
+    std::vector<types::Numeral> result(a.size() + b.size() - 1, 0);
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (a[i] == 0) continue;
+        for (std::size_t j = 0; j < b.size(); ++j) result[i + j] += a[i] * b[j];
+    }
+    return result;
+}
+
+std::vector<types::Numeral> poly::multiply_fft(const std::vector<types::Numeral>& a, const std::vector<types::Numeral>& b) {
+    if (a.empty() || b.empty()) return {};
+    std::size_t result_size = a.size() + b.size() - 1;
+    std::size_t n = 1;
+    while (n < result_size) n <<= 1;
+
+    // Roots of unity computed directly rather than by repeated multiplication, for accuracy
+    std::vector<std::complex<double>> roots(n / 2);
+    for (std::size_t j = 0; j < n / 2; ++j) roots[j] = std::polar(1.0, 2 * M_PI * static_cast<double>(j) / static_cast<double>(n));
+
+    // One transform for both factors: a in the real parts, b in the imaginary parts
+    std::vector<std::complex<double>> packed(n);
+    for (std::size_t i = 0; i < a.size(); ++i) packed[i].real(a[i]);
+    for (std::size_t i = 0; i < b.size(); ++i) packed[i].imag(b[i]);
+    fft(packed, roots, false);
+
+    // A_k * B_k = (P_k^2 - conj(P_{n-k})^2) / 4i
+    std::vector<std::complex<double>> product(n);
+    for (std::size_t k = 0; k < n; ++k) {
+        std::complex<double> p = packed[k];
+        std::complex<double> q = std::conj(packed[(n - k) & (n - 1)]);
+        product[k] = (p * p - q * q) * std::complex<double>(0, -0.25);
+    }
+    fft(product, roots, true);
+
+    std::vector<types::Numeral> result(result_size);
+    for (std::size_t i = 0; i < result_size; ++i) result[i] = product[i].real() / static_cast<double>(n);
+    return result;
+}
@@ -0,0 +1,90 @@
+#include "functional/random.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr std::uint32_t kMultiplier0 = 0xD2511F53, kMultiplier1 = 0xCD9E8D57; // Philox round multipliers
+constexpr std::uint32_t kWeyl0 = 0x9E3779B9, kWeyl1 = 0xBB67AE85;             // Key increments, golden ratio and sqrt(3) - 1
+constexpr int kRounds = 10;
+constexpr std::size_t kLanes = 16; // Blocks computed together, two samples each
+constexpr double kUnit = 1.0 / 9007199254740992.0; // 2^-53
+constexpr double kTwoPi = 6.283185307179586;
+
+// The samples of the blocks at counters pair, pair + 1, ... pair + kLanes - 1 of a stream
+void uniform_lanes(std::uint64_t seed, std::uint64_t stream, std::uint64_t pair, double* values) noexcept {
+    std::uint32_t c0[kLanes], c1[kLanes], c2[kLanes], c3[kLanes];
+    for (std::size_t i = 0; i < kLanes; ++i) {
+        c0[i] = static_cast<std::uint32_t>(pair + i);
+        c1[i] = static_cast<std::uint32_t>((pair + i) >> 32);
+        c2[i] = static_cast<std::uint32_t>(stream);
+        c3[i] = static_cast<std::uint32_t>(stream >> 32);
+    }
+    std::uint32_t k0 = static_cast<std::uint32_t>(seed), k1 = static_cast<std::uint32_t>(seed >> 32);
+    for (int round = 0; round < kRounds; ++round) {
+        for (std::size_t i = 0; i < kLanes; ++i) {
+            std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * c0[i];
+            std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * c2[i];
+            std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1[i] ^ k0;
+            std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3[i] ^ k1;
+            c1[i] = static_cast<std::uint32_t>(p1);
+            c3[i] = static_cast<std::uint32_t>(p0);
+            c0[i] = n0;
+            c2[i] = n2;
+        }
+        k0 += kWeyl0;
+        k1 += kWeyl1;
+    }
+    for (std::size_t i = 0; i < kLanes; ++i) {
+        std::uint64_t high = (static_cast<std::uint64_t>(c0[i]) << 32 | c1[i]) >> 11;
+        std::uint64_t low = (static_cast<std::uint64_t>(c2[i]) << 32 | c3[i]) >> 11;
+        values[2 * i] = (static_cast<double>(high) + 0.5) * kUnit;
+        values[2 * i + 1] = (static_cast<double>(low) + 0.5) * kUnit;
+    }
+}
+
+// Fills values with the samples first.. of a stream, transform turning the 2 kLanes uniforms of a group of blocks into
+// as many samples of the distribution
+template <typename Transform>
+void draw(std::uint64_t seed, std::uint64_t stream, std::uint64_t first, std::size_t count, double* values, Transform transform) noexcept {
+    double buffer[2 * kLanes];
+    while (count > 0) {
+        const std::size_t skip = static_cast<std::size_t>(first % 2);
+        const std::size_t take = std::min(count, 2 * kLanes - skip);
+        uniform_lanes(seed, stream, first / 2, buffer);
+        transform(buffer);
+        std::copy(buffer + skip, buffer + skip + take, values);
+        values += take;
+        first += take;
+        count -= take;
+    }
+}
+
+} // namespace
+
+std::array<std::uint32_t, 4> prng::philox4x32(std::array<std::uint32_t, 4> counter, std::array<std::uint32_t, 2> key) noexcept {
+    for (int round = 0; round < kRounds; ++round) {
+        std::uint64_t p0 = static_cast<std::uint64_t>(kMultiplier0) * counter[0];
+        std::uint64_t p1 = static_cast<std::uint64_t>(kMultiplier1) * counter[2];
+        counter = {static_cast<std::uint32_t>(p1 >> 32) ^ counter[1] ^ key[0], static_cast<std::uint32_t>(p1),
+            static_cast<std::uint32_t>(p0 >> 32) ^ counter[3] ^ key[1], static_cast<std::uint32_t>(p0)};
+        key[0] += kWeyl0;
+        key[1] += kWeyl1;
+    }
+    return counter;
+}
+
+void prng::uniform(std::uint64_t seed, std::uint64_t stream, std::uint64_t first, std::size_t count, double* values) noexcept {
+    draw(seed, stream, first, count, values, [](double*) {});
+}
+
+void prng::normal(std::uint64_t seed, std::uint64_t stream, std::uint64_t first, std::size_t count, double* values) noexcept {
+    draw(seed, stream, first, count, values, [](double* buffer) {
+        for (std::size_t i = 0; i < 2 * kLanes; i += 2) {
+            double radius = std::sqrt(-2 * std::log(buffer[i]));
+            double angle = kTwoPi * buffer[i + 1];
+            buffer[i] = radius * std::cos(angle);
+            buffer[i + 1] = radius * std::sin(angle);
+        }
+    });
+}
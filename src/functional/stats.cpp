@@ -1,3 +1,524 @@
 #include "functional/stats.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include "functional/elementary.h"
+#include "functional/error_free.h"
+#include "functional/stats_kernels.h"
 
+namespace stats {
 
+#ifdef CALC_HAS_AVX2
+// Defined in stats_avx2.cpp, built with -mavx2 -mfma
+namespace avx2 {
+
+double largest_magnitude(const double* values, std::size_t count) noexcept;
+double extract(const double* values, double* remainders, std::size_t count, double sigma, double& largest) noexcept;
+double extract3(const double* values, double* remainders, std::size_t count, double sigma, double sums[3]) noexcept;
+void extremes(const double* values, std::size_t count, double& min, double& max) noexcept;
+
+} // namespace avx2
+#endif
+
+} // namespace stats
+
+namespace {
+
+constexpr double kMinMagnitude = 1e-300; // Smaller magnitudes are counted as zeros
+
+// Adds a count to bucket index of counts starting at offset, growing it as needed
+void increment(std::vector<std::uint64_t>& counts, int& offset, int index, std::uint64_t count) {
+    if (counts.empty()) offset = index;
+    if (index < offset) {
+        counts.insert(counts.begin(), static_cast<std::size_t>(offset - index), 0);
+        offset = index;
+    }
+    if (static_cast<std::size_t>(index - offset) >= counts.size()) counts.resize(static_cast<std::size_t>(index - offset) + 1, 0);
+    counts[static_cast<std::size_t>(index - offset)] += count;
+}
+
+constexpr int kBlockBits = 10;                // log2 of kSumBlock
+constexpr int kExtractionLevels = 6;          // Levels of ExactSum::addBlock before the remainders go one by one
+constexpr int kMinExtractionExponent = -1032; // Below, the multiples of 2^(e - 42) would be finer than 2^-1074
+constexpr int kMinFusedExponent = -950;       // Below, those of the third level of extract3 would
+constexpr int kMaxExtractionExponent = 1012;  // Above, sigma + x would overflow
+constexpr double kSquareLimit = 0x1p511;      // Magnitude below which squares and their splits do not overflow
+static_assert(stats::kSumBlock == std::size_t(1) << kBlockBits, "Blocks of 2^kBlockBits values");
+
+double largest_magnitude(const double* values, std::size_t count) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (elementary::has_avx2()) return stats::avx2::largest_magnitude(values, count);
+#endif
+    return stats::Extraction<stats::Double2>::largest(values, count);
+}
+
+double extract(const double* values, double* remainders, std::size_t count, double sigma, double& largest) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (elementary::has_avx2()) return stats::avx2::extract(values, remainders, count, sigma, largest);
+#endif
+    return stats::Extraction<stats::Double2>::extract(values, remainders, count, sigma, largest);
+}
+
+// Remainders may be null, to skip storing them
+double extract3(const double* values, double* remainders, std::size_t count, double sigma, double sums[3]) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (elementary::has_avx2()) return stats::avx2::extract3(values, remainders, count, sigma, sums);
+#endif
+    return remainders ? stats::Extraction<stats::Double2>::extract3<true>(values, remainders, count, sigma, sums)
+                      : stats::Extraction<stats::Double2>::extract3<false>(values, nullptr, count, sigma, sums);
+}
+
+void extremes(const double* values, std::size_t count, double& min, double& max) noexcept {
+#ifdef CALC_HAS_AVX2
+    if (elementary::has_avx2()) return stats::avx2::extremes(values, count, min, max);
+#endif
+    stats::Extraction<stats::Double2>::extremes(values, count, min, max);
+}
+
+using error_free::dekker_product;
+using error_free::two_product;
+
+// x^2 as high + low, low 0 once the square overflows
+void square(double x, double& high, double& low) noexcept {
+    two_product(x, x, high, low);
+    low = std::fabs(high) <= std::numeric_limits<double>::max() ? low : 0;
+}
+
+// Adds the square of value to squares
+void add_square(stats::ExactSum& squares, double value) noexcept {
+    double high, low;
+    square(value, high, low);
+    squares.add(high);
+    squares.add(low);
+}
+
+// The mean of count values of an exact sum, in double-double before the last rounding
+double mean_of(const stats::ExactSum& sum, double count) noexcept {
+    double high, low;
+    sum.value(high, low);
+    const double mean = high / count;
+    if (!std::isfinite(mean)) return mean;
+    double product, error;
+    two_product(mean, count, product, error);
+    return mean + (((high - product) - error) + low) / count;
+}
+
+// The sample variance from the exact sums of count values and of their squares, S2 - S1^2 / n over n - 1 in
+// double-double; infinite once a square overflows
+double variance_of(const stats::ExactSum& sum, const stats::ExactSum& squares, double count) noexcept {
+    double sum_high, sum_low, squares_high, squares_low;
+    sum.value(sum_high, sum_low);
+    squares.value(squares_high, squares_low);
+    if (!std::isfinite(sum_high)) return std::numeric_limits<double>::quiet_NaN();
+    if (!std::isfinite(squares_high)) return squares_high;
+
+    double product, error;
+    const double mean_high = sum_high / count;
+    two_product(mean_high, count, product, error);
+    const double mean_low = (((sum_high - product) - error) + sum_low) / count;
+    double correction_high, correction_low; // S1^2 / n, as S1 times the mean
+    two_product(sum_high, mean_high, correction_high, correction_low);
+    correction_low += sum_high * mean_low + sum_low * mean_high;
+    const double difference = squares_high - correction_high;
+    const double virtual_term = difference - squares_high;
+    const double difference_error = (squares_high - (difference - virtual_term)) + (-correction_high - virtual_term);
+    const double m2 = difference + ((difference_error + squares_low) - correction_low);
+    return std::max(0.0, m2 / (count - 1));
+}
+
+// Whether a goes before b as a minimum, so of equal zeros the negative one is the minimum whatever the order
+bool below(double a, double b) noexcept { return a < b || (a == b && std::signbit(a)); }
+
+void check_window(std::size_t window) {
+    if (window == 0) throw std::invalid_argument("Numerical error: Window must be positive");
+}
+
+} // namespace
+
+void stats::ExactSum::addFinite(double value) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const int exponent = static_cast<int>((bits >> 52) & 0x7ff);
+    std::uint64_t mantissa = bits & ((std::uint64_t(1) << 52) - 1);
+    if (exponent > 0) mantissa |= std::uint64_t(1) << 52;
+    if (mantissa == 0) return;
+
+    // The mantissa over the three digits it spans, its lowest bit at position, in units of 2^-1074
+    const int position = std::max(exponent, 1) - 1;
+    const int shift = position % 32;
+    const std::uint64_t shifted = mantissa << shift;
+    const std::int64_t low = static_cast<std::int64_t>(shifted & 0xffffffff);
+    const std::int64_t middle = static_cast<std::int64_t>(shifted >> 32);
+    const std::int64_t high = shift == 0 ? 0 : static_cast<std::int64_t>(mantissa >> (64 - shift));
+    std::int64_t* digit = digits_.data() + position / 32;
+    if (bits >> 63) {
+        digit[0] -= low;
+        digit[1] -= middle;
+        digit[2] -= high;
+    }
+    else {
+        digit[0] += low;
+        digit[1] += middle;
+        digit[2] += high;
+    }
+    if (++pending_ == kCarryInterval) normalize();
+}
+
+void stats::ExactSum::addBlock(const double* values, std::size_t count) noexcept {
+    double largest = largest_magnitude(values, count);
+    if (std::isnan(largest)) {
+        for (std::size_t i = 0; i < count; ++i) add(values[i]);
+        return;
+    }
+    double remainders[kSumBlock];
+    const double* source = values;
+    int exponent;
+    std::frexp(largest, &exponent); // largest < 2^exponent
+    if (largest > 0 && exponent >= kMinFusedExponent && exponent <= kMaxExtractionExponent) {
+        // Three levels in one pass, usually all of the bits; the remainders are computed again if any are left
+        const double sigma = std::ldexp(1.0, exponent + kBlockBits + 1);
+        double sums[3];
+        largest = extract3(values, nullptr, count, sigma, sums);
+        for (double sum : sums) addFinite(sum);
+        if (largest == 0) return;
+        extract3(values, remainders, count, sigma, sums);
+        source = remainders;
+    }
+    for (int level = 0; level < kExtractionLevels && largest > 0; ++level) {
+        std::frexp(largest, &exponent); // largest < 2^exponent
+        if (exponent < kMinExtractionExponent || exponent > kMaxExtractionExponent) break;
+        addFinite(extract(source, remainders, count, std::ldexp(1.0, exponent + kBlockBits + 1), largest));
+        source = remainders;
+    }
+    if (largest == 0) return;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (source[i] != 0) addFinite(source[i]);
+    }
+}
+
+void stats::ExactSum::normalize() noexcept {
+    for (std::size_t i = 0; i + 1 < kSumDigits; ++i) {
+        const std::int64_t carry = digits_[i] >> 32; // Rounded down, leaving the digit in [0, 2^32)
+        digits_[i] &= 0xffffffff;
+        digits_[i + 1] += carry;
+    }
+    pending_ = 0;
+}
+
+void stats::ExactSum::add(double value) noexcept {
+    if (std::isfinite(value)) addFinite(value);
+    else if (std::isnan(value)) nan_ = true;
+    else (value > 0 ? positive_infinity_ : negative_infinity_) = true;
+}
+
+void stats::ExactSum::add(const double* values, std::size_t count) noexcept {
+    for (std::size_t first = 0; first < count; first += kSumBlock) addBlock(values + first, std::min(kSumBlock, count - first));
+}
+
+void stats::ExactSum::merge(const ExactSum& other) noexcept {
+    for (std::size_t i = 0; i < kSumDigits; ++i) digits_[i] += other.digits_[i];
+    nan_ = nan_ || other.nan_;
+    positive_infinity_ = positive_infinity_ || other.positive_infinity_;
+    negative_infinity_ = negative_infinity_ || other.negative_infinity_;
+    pending_ += other.pending_ + 1; // The digits are as far from normalized as after that many additions
+    if (pending_ >= kCarryInterval) normalize();
+}
+
+double stats::ExactSum::value() const noexcept {
+    if (nan_ || (positive_infinity_ && negative_infinity_)) return std::numeric_limits<double>::quiet_NaN();
+    if (positive_infinity_) return std::numeric_limits<double>::infinity();
+    if (negative_infinity_) return -std::numeric_limits<double>::infinity();
+
+    ExactSum sum = *this;
+    sum.normalize();
+    const bool negative = sum.digits_.back() < 0;
+    if (negative) {
+        for (auto& digit : sum.digits_) digit = -digit;
+        sum.normalize();
+    }
+    std::ptrdiff_t top = static_cast<std::ptrdiff_t>(kSumDigits) - 1;
+    while (top >= 0 && sum.digits_[static_cast<std::size_t>(top)] == 0) --top;
+    if (top < 0) return 0;
+    auto digit = [&](std::ptrdiff_t i) { return i < 0 ? std::uint64_t(0) : static_cast<std::uint64_t>(sum.digits_[static_cast<std::size_t>(i)]); };
+
+    double magnitude;
+    if (top >= static_cast<std::ptrdiff_t>(kSumDigits) - 2) magnitude = std::numeric_limits<double>::infinity(); // Past 2^1038
+    else if (top < 2 && (digit(1) << 32 | digit(0)) < std::uint64_t(1) << 53) {
+        magnitude = std::ldexp(static_cast<double>(digit(1) << 32 | digit(0)), -1074); // Exact, maybe subnormal
+    }
+    else {
+        // The 64 bits from the leading one, rounded to 53 to nearest even, the bits below them making ties inexact
+        const int length = 64 - __builtin_clzll(digit(top));
+        const std::uint64_t window = digit(top) << (64 - length) | digit(top - 1) << (32 - length) | digit(top - 2) >> length;
+        bool sticky = (digit(top - 2) & ((std::uint64_t(1) << length) - 1)) != 0;
+        for (std::ptrdiff_t i = top - 3; i >= 0 && !sticky; --i) sticky = digit(i) != 0;
+        std::uint64_t mantissa = window >> 11;
+        const std::uint64_t rest = window & 0x7ff;
+        if (rest > 0x400 || (rest == 0x400 && (sticky || (mantissa & 1)))) ++mantissa;
+        magnitude = std::ldexp(static_cast<double>(mantissa), static_cast<int>(32 * top) + length - 1 - 52 - 1074);
+    }
+    return negative ? -magnitude : magnitude;
+}
+
+void stats::ExactSum::value(double& high, double& low) const noexcept {
+    high = value();
+    low = 0;
+    if (!std::isfinite(high)) return;
+    ExactSum rest = *this;
+    rest.add(-high);
+    low = rest.value();
+}
+
+void stats::Moments::extend(double min, double max) noexcept {
+    if (count_ == 0) {
+        min_ = min;
+        max_ = max;
+        return;
+    }
+    if (below(min, min_)) min_ = min;
+    if (below(max_, max)) max_ = max;
+}
+
+void stats::Moments::add(double value) noexcept {
+    extend(value, value);
+    ++count_;
+    sum_.add(value);
+    add_square(squares_, value);
+}
+
+void stats::Moments::add(const double* values, std::size_t count) noexcept {
+    double highs[kSumBlock], lows[kSumBlock];
+    for (std::size_t first = 0; first < count; first += kSumBlock) {
+        const std::size_t size = std::min(kSumBlock, count - first);
+        const double* block = values + first;
+        double min, max;
+        extremes(block, size, min, max);
+        for (std::size_t i = 0; i < size && (min == 0 || max == 0); ++i) { // Zeros of either sign ordered as by below
+            if (block[i] == 0 && below(block[i], min)) min = block[i];
+            if (block[i] == 0 && below(max, block[i])) max = block[i];
+        }
+        if (min > -kSquareLimit && max < kSquareLimit) { // No square overflows, nor needs the check that keeps the loop scalar
+            for (std::size_t i = 0; i < size; ++i) dekker_product(block[i], block[i], highs[i], lows[i]);
+        }
+        else {
+            for (std::size_t i = 0; i < size; ++i) square(block[i], highs[i], lows[i]);
+        }
+        extend(min, max);
+        count_ += size;
+        sum_.add(block, size);
+        squares_.add(highs, size);
+        squares_.add(lows, size);
+    }
+}
+
+void stats::Moments::merge(const Moments& other) noexcept {
+    if (other.count_ == 0) return;
+    extend(other.min_, other.max_);
+    count_ += other.count_;
+    sum_.merge(other.sum_);
+    squares_.merge(other.squares_);
+}
+
+double stats::Moments::mean() const noexcept { return count_ == 0 ? 0 : mean_of(sum_, static_cast<double>(count_)); }
+
+double stats::Moments::variance() const noexcept {
+    return count_ < 2 ? 0 : variance_of(sum_, squares_, static_cast<double>(count_));
+}
+
+double stats::Moments::stddev() const noexcept { return std::sqrt(variance()); }
+
+stats::QuantileSketch::QuantileSketch(double accuracy) :
+    accuracy_(accuracy), gamma_((1 + accuracy) / (1 - accuracy)), log_gamma_(std::log(gamma_)) {
+    if (!(accuracy > 0 && accuracy < 1)) throw std::invalid_argument("Numerical error: Sketch accuracy must be between 0 and 1");
+}
+
+int stats::QuantileSketch::bucket(double magnitude) const noexcept {
+    return static_cast<int>(std::ceil(std::log(magnitude) / log_gamma_));
+}
+
+double stats::QuantileSketch::estimate(int bucket) const noexcept {
+    return 2 * std::exp(bucket * log_gamma_) / (gamma_ + 1);
+}
+
+void stats::QuantileSketch::add(double value) {
+    if (std::isnan(value)) return;
+    ++count_;
+    if (std::fabs(value) < kMinMagnitude) ++zeros_;
+    else if (std::isinf(value)) ++(value > 0 ? positive_infinities_ : negative_infinities_);
+    else if (value > 0) increment(positive_, positive_offset_, bucket(value), 1);
+    else increment(negative_, negative_offset_, bucket(-value), 1);
+}
+
+void stats::QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.accuracy_ != accuracy_) throw std::invalid_argument("Numerical error: Cannot merge sketches of different accuracies");
+    for (std::size_t i = 0; i < other.positive_.size(); ++i) {
+        if (other.positive_[i]) increment(positive_, positive_offset_, other.positive_offset_ + static_cast<int>(i), other.positive_[i]);
+    }
+    for (std::size_t i = 0; i < other.negative_.size(); ++i) {
+        if (other.negative_[i]) increment(negative_, negative_offset_, other.negative_offset_ + static_cast<int>(i), other.negative_[i]);
+    }
+    zeros_ += other.zeros_;
+    positive_infinities_ += other.positive_infinities_;
+    negative_infinities_ += other.negative_infinities_;
+    count_ += other.count_;
+}
+
+double stats::QuantileSketch::quantile(double q) const noexcept {
+    if (count_ == 0) return std::numeric_limits<double>::quiet_NaN();
+    auto rank = static_cast<std::uint64_t>(std::clamp(q, 0.0, 1.0) * static_cast<double>(count_ - 1));
+
+    // Negative values first, from the largest magnitude down, then zeros, then positive values up
+    std::uint64_t seen = negative_infinities_;
+    if (seen > rank) return -std::numeric_limits<double>::infinity();
+    for (std::size_t i = negative_.size(); i-- > 0; ) {
+        seen += negative_[i];
+        if (seen > rank) return -estimate(negative_offset_ + static_cast<int>(i));
+    }
+    seen += zeros_;
+    if (seen > rank) return 0;
+    for (std::size_t i = 0; i < positive_.size(); ++i) {
+        seen += positive_[i];
+        if (seen > rank) return estimate(positive_offset_ + static_cast<int>(i));
+    }
+    return std::numeric_limits<double>::infinity();
+}
+
+stats::RollingMoments::RollingMoments(std::size_t window) {
+    check_window(window);
+    values_.resize(window);
+}
+
+void stats::RollingMoments::accumulate(double value, double sign) noexcept {
+    sum_.add(sign * value);
+    double high, low;
+    square(value, high, low);
+    if (std::isinf(high)) { // Counted apart, as an infinity in the sum could not be taken out again
+        if (sign > 0) ++overflows_;
+        else --overflows_;
+        return;
+    }
+    squares_.add(sign * high);
+    squares_.add(sign * low);
+}
+
+void stats::RollingMoments::add(double value) noexcept {
+    const std::size_t slot = static_cast<std::size_t>(index_ % values_.size());
+    if (index_ >= values_.size() && std::isfinite(values_[slot])) {
+        accumulate(values_[slot], -1);
+        --finite_;
+    }
+    values_[slot] = value;
+    ++index_;
+    if (std::isnan(value)) last_nan_ = index_;
+    else if (std::isinf(value)) (value > 0 ? last_positive_infinity_ : last_negative_infinity_) = index_;
+    else {
+        accumulate(value, 1);
+        ++finite_;
+    }
+}
+
+double stats::RollingMoments::mean() const noexcept {
+    const bool positive = in_window(last_positive_infinity_), negative = in_window(last_negative_infinity_);
+    if (in_window(last_nan_) || (positive && negative) || index_ == 0) return std::numeric_limits<double>::quiet_NaN();
+    if (positive) return std::numeric_limits<double>::infinity();
+    if (negative) return -std::numeric_limits<double>::infinity();
+    return mean_of(sum_, static_cast<double>(finite_));
+}
+
+double stats::RollingMoments::variance() const noexcept {
+    if (in_window(last_nan_) || in_window(last_positive_infinity_) || in_window(last_negative_infinity_)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (finite_ < 2) return 0;
+    return overflows_ > 0 ? std::numeric_limits<double>::infinity() : variance_of(sum_, squares_, static_cast<double>(finite_));
+}
+
+double stats::RollingMoments::stddev() const noexcept { return std::sqrt(variance()); }
+
+stats::RollingExtremes::RollingExtremes(std::size_t window) : window_(window) { check_window(window); }
+
+void stats::RollingExtremes::add(double value) {
+    const std::uint64_t index = index_++;
+    if (std::isnan(value)) last_nan_ = index_;
+    else {
+        while (!minima_.empty() && minima_.back().second >= value) minima_.pop_back();
+        minima_.emplace_back(index, value);
+        while (!maxima_.empty() && maxima_.back().second <= value) maxima_.pop_back();
+        maxima_.emplace_back(index, value);
+    }
+    while (!minima_.empty() && minima_.front().first + window_ <= index) minima_.pop_front();
+    while (!maxima_.empty() && maxima_.front().first + window_ <= index) maxima_.pop_front();
+}
+
+double stats::RollingExtremes::min() const noexcept {
+    if (minima_.empty() || (last_nan_ > 0 && last_nan_ + window_ > index_)) return std::numeric_limits<double>::quiet_NaN();
+    return minima_.front().second;
+}
+
+double stats::RollingExtremes::max() const noexcept {
+    if (maxima_.empty() || (last_nan_ > 0 && last_nan_ + window_ > index_)) return std::numeric_limits<double>::quiet_NaN();
+    return maxima_.front().second;
+}
+
+stats::RollingMedian::RollingMedian(std::size_t window) {
+    check_window(window);
+    values_.resize(window);
+}
+
+void stats::RollingMedian::balance() {
+    if (lower_.size() > upper_.size() + 1) {
+        auto largest = std::prev(lower_.end());
+        upper_.insert(*largest);
+        lower_.erase(largest);
+    }
+    else if (upper_.size() > lower_.size()) {
+        lower_.insert(*upper_.begin());
+        upper_.erase(upper_.begin());
+    }
+}
+
+void stats::RollingMedian::add(double value) {
+    const std::size_t slot = static_cast<std::size_t>(index_ % values_.size());
+    if (index_ >= values_.size() && !std::isnan(values_[slot])) {
+        // Every value of the lower half is at most every value of the upper half
+        const double leaving = values_[slot];
+        if (!lower_.empty() && leaving <= *lower_.rbegin()) lower_.erase(lower_.find(leaving));
+        else upper_.erase(upper_.find(leaving));
+    }
+    values_[slot] = value;
+    ++index_;
+    if (std::isnan(value)) last_nan_ = index_;
+    else if (!upper_.empty() && value >= *upper_.begin()) upper_.insert(value);
+    else lower_.insert(value);
+    balance();
+}
+
+double stats::RollingMedian::median() const noexcept {
+    if (lower_.empty() || (last_nan_ > 0 && last_nan_ + values_.size() > index_)) return std::numeric_limits<double>::quiet_NaN();
+    const double low = *lower_.rbegin();
+    if (lower_.size() > upper_.size()) return low;
+    const double high = *upper_.begin();
+    return low == high ? low : low / 2 + high / 2; // Halves first, as low + high may overflow
+}
+
+stats::Ewma::Ewma(double alpha) : alpha_(alpha) {
+    if (!(alpha > 0 && alpha <= 1)) throw std::invalid_argument("Numerical error: EWMA weight must be in (0, 1]");
+}
+
+void stats::Ewma::add(double value) noexcept {
+    if (!std::isfinite(value)) return;
+    if (count_++ == 0) {
+        mean_ = value;
+        return;
+    }
+    const double delta = value - mean_;
+    mean_ += alpha_ * delta;
+    variance_ = (1 - alpha_) * (variance_ + alpha_ * delta * delta);
+}
+
+double stats::Ewma::mean() const noexcept { return count_ == 0 ? std::numeric_limits<double>::quiet_NaN() : mean_; }
+
+double stats::Ewma::variance() const noexcept { return count_ == 0 ? std::numeric_limits<double>::quiet_NaN() : variance_; }
@@ -0,0 +1,25 @@
+#include "functional/stats_kernels.h"
+
+// The array loops of the exact sums built with -mavx2 -mfma, called only if elementary::has_avx2(): vectors of four
+// doubles, the same bits as the two of stats.cpp.
+
+namespace stats {
+namespace avx2 {
+
+double largest_magnitude(const double* values, std::size_t count) noexcept { return Extraction<Double4>::largest(values, count); }
+
+double extract(const double* values, double* remainders, std::size_t count, double sigma, double& largest) noexcept {
+    return Extraction<Double4>::extract(values, remainders, count, sigma, largest);
+}
+
+double extract3(const double* values, double* remainders, std::size_t count, double sigma, double sums[3]) noexcept {
+    return remainders ? Extraction<Double4>::extract3<true>(values, remainders, count, sigma, sums)
+                      : Extraction<Double4>::extract3<false>(values, nullptr, count, sigma, sums);
+}
+
+void extremes(const double* values, std::size_t count, double& min, double& max) noexcept {
+    Extraction<Double4>::extremes(values, count, min, max);
+}
+
+} // namespace avx2
+} // namespace stats
@@ -1,17 +1,254 @@
 #include <iostream>
+#include <fstream>
 #include "globals.h"
+#include "core/adaptive.h"
+#include "core/batch.h"
+#include "core/csv_input.h"
 #include "core/dispatcher.h"
+#include "core/functions.h"
+#include "core/fusion_pass.h"
+#include "core/summation_pass.h"
+#include "core/grad.h"
+#include "core/incremental.h"
+#include "core/matrix_eval.h"
+#include "core/polynomial_pass.h"
+#include "core/sampling.h"
+#include "core/server.h"
+#include "core/typed_program.h"
 #include "core/parser.h"
+#include "functional/constants.h"
+#include "functional/elementary.h"
 
 int main(int argc, char* argv[]) {
     if (argc > 1) { // There are some command-line options
         try {
             CliArgs args = get_cli_args(argc, argv);
+            poly::PolynomialMode polynomials = poly::PolynomialMode::Off;
+            if (args.poly_ == "collect") polynomials = poly::PolynomialMode::Collect;
+            else if (args.poly_ == "expand") polynomials = poly::PolynomialMode::Expand;
+            if (args.fast_math_) elementary::set_accuracy(elementary::Accuracy::Fast);
+            typed::NumericType type = args.type_.empty() ? typed::NumericType::Double : typed::parse_numeric_type(args.type_);
+            functions::FunctionRegistry functions;
+            for (const auto& definition : args.definitions_) {
+                auto function = functions.define(definition);
+                if (!function) throw std::runtime_error(batch::format_error(function.error()) + " in '" + definition + "'");
+            }
+            // How each expression of batch and server mode is evaluated
+            batch::BatchOptions evaluation;
+            if (args.ieee_) evaluation.numeric_mode_ = expr::NumericMode::IEEE;
+            evaluation.polynomials_ = polynomials;
+            evaluation.numeric_type_ = type;
+            if (args.fuse_) evaluation.fusion_ = args.fast_math_ ? fusion::FusionMode::Fast : fusion::FusionMode::Exact;
+            evaluation.exact_sums_ = args.exact_sum_;
+            evaluation.functions_ = &functions;
+            // Ends the server and -e paths, reporting the memo caches of the functions they called
+            auto finish = [&args, &functions]() {
+                if (args.memo_stats_) functions.write_memo_stats(std::cerr);
+                return 0;
+            };
+            if (args.mode_ == Mode::Batch) { // One expression per line, results in the same order
+                batch::BatchOptions options = evaluation;
+                options.threads_ = args.threads_;
+                options.slowest_ = args.slowest_;
+                options.memo_stats_ = args.memo_stats_;
+                options.workers_ = args.workers_;
+                if (args.latency_ == "text") options.report_ = batch::ReportFormat::Text;
+                else if (args.latency_ == "json") options.report_ = batch::ReportFormat::Json;
+
+                if (args.str_ == "-") batch::run_stream(std::cin, std::cout, std::cerr, options, &functions);
+                else {
+                    std::ifstream input(args.str_);
+                    if (!input) throw std::invalid_argument("Cannot open input file '" + args.str_ + "'");
+                    batch::run_stream(input, std::cout, std::cerr, options, &functions);
+                }
+                return 0;
+            }
+            if (args.mode_ == Mode::Binomials) { // One coefficient per query line
+                if (args.str_ == "-") batch::run_binomials(std::cin, std::cout);
+                else {
+                    std::ifstream input(args.str_);
+                    if (!input) throw std::invalid_argument("Cannot open input file '" + args.str_ + "'");
+                    batch::run_binomials(input, std::cout);
+                }
+                return 0;
+            }
+            if (args.mode_ == Mode::Statistics) { // One line of rolling statistics per sample
+                batch::RollingOptions options;
+                options.window_ = args.window_;
+                options.alpha_ = args.alpha_;
+                if (args.str_ == "-") batch::run_rolling(std::cin, std::cout, options);
+                else {
+                    std::ifstream input(args.str_);
+                    if (!input) throw std::invalid_argument("Cannot open input file '" + args.str_ + "'");
+                    batch::run_rolling(input, std::cout, options);
+                }
+                return 0;
+            }
+            if (args.mode_ == Mode::Serve) { // Runs until SIGINT or SIGTERM
+                server::ServerOptions options;
+                options.socket_path_ = args.str_;
+                options.workers_ = args.threads_;
+                options.evaluation_ = evaluation;
+                SymbolTable symbols;
+                if (!args.symbols_.empty()) grad::parse_point(args.symbols_, symbols);
+                server::serve(options, symbols);
+                return finish();
+            }
+            if (args.stream_) { // One expression read in buffers, evaluated as it is read
+                auto mode = args.ieee_ ? expr::NumericMode::IEEE : expr::NumericMode::Strict;
+                types::Expected<types::Numeral> value = types::Error{};
+                if (args.str_ == "-") value = eval::evaluate_stream(std::cin, {}, &functions, mode);
+                else {
+                    std::ifstream input(args.str_);
+                    if (!input) throw std::invalid_argument("Cannot open input file '" + args.str_ + "'");
+                    value = eval::evaluate_stream(input, {}, &functions, mode);
+                }
+                if (!value) throw std::runtime_error(types::error_message(value.error()));
+                std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << value.value() << RESET << "\n" << std::endl;
+                return finish();
+            }
             auto tokens = parser::tokenize(args.str_);
-            dispatcher::Result result = dispatcher::get_result(args.mode_, {}, tokens.begin(), tokens.end());
+            functions.recognize(tokens);
+            if (args.digits_ > 0) { // A constant to any number of digits
+                auto tree = eval::build_expr_tree(tokens.begin(), tokens.end(), &functions);
+                constants::Constant constant = constants::Constant::Pi;
+                if (dynamic_cast<const expr::ENode*>(tree.get())) constant = constants::Constant::E;
+                else if (!dynamic_cast<const expr::PiNode*>(tree.get())) {
+                    throw std::invalid_argument("Invalid command line argument: --digits expects the expression pi or e");
+                }
+                std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << constants::digits(constant, args.digits_) << RESET << "\n" << std::endl;
+                return finish();
+            }
+            if (!args.input_.empty()) { // One result per row of a CSV file
+                if (type != typed::NumericType::Double) throw std::invalid_argument("Invalid command line argument: --input evaluates in double");
+                auto parsed = eval::try_parse(args.str_, &functions); // Positions of row errors are offsets in the expression
+                if (!parsed) throw std::runtime_error(types::error_message(parsed.error()));
+                auto tree = std::move(parsed).value();
+                poly::collect_polynomials(tree, polynomials);
+                csv::CsvOptions options;
+                options.threads_ = args.threads_;
+                if (args.format_ == "binary") options.format_ = csv::OutputFormat::Binary;
+                options.numeric_mode_ = evaluation.numeric_mode_;
+                csv::CsvReport report = csv::evaluate_file(args.input_, *tree, std::cout, options);
+                if (report.malformed_ > 0) {
+                    std::cerr << "warning: " << report.malformed_ << " of " << report.rows_ << " rows have missing or malformed fields, "
+                        << "taken as nan" << std::endl;
+                }
+                if (report.failed_ > 0) {
+                    std::cerr << "warning: " << report.failed_ << " of " << report.rows_ << " rows failed to evaluate, "
+                        << (options.format_ == csv::OutputFormat::Binary ? "written as nan" : "answered with their errors") << std::endl;
+                }
+                return finish();
+            }
+            if (args.samples_ > 0) { // Summaries over samples of the symbols
+                if (type != typed::NumericType::Double) throw std::invalid_argument("Invalid command line argument: --sample evaluates in double");
+                std::vector<std::pair<types::Symbol, sampling::Distribution>> distributions;
+                for (const auto& text : args.distributions_) distributions.push_back(sampling::parse_distribution(text));
+                auto tree = eval::build_expr_tree(tokens.begin(), tokens.end(), &functions);
+                poly::collect_polynomials(tree, polynomials);
+                sampling::SamplingOptions options;
+                options.samples_ = args.samples_;
+                options.seed_ = args.seed_;
+                options.threads_ = args.threads_;
+                sampling::SamplingSummary summary = sampling::sample(*tree, distributions, {}, options);
+                const stats::Moments& moments = summary.moments_;
+                std::cout << "\nmean = " << RGB_TEXT(70, 130, 180) << moments.mean() << RESET << " +/- "
+                    << moments.stddev() / std::sqrt(static_cast<double>(std::max<std::uint64_t>(moments.count(), 1))) << "\n";
+                std::cout << "sd = " << RGB_TEXT(70, 130, 180) << moments.stddev() << RESET << "\n";
+                std::cout << "min = " << moments.min() << ", max = " << moments.max() << "\n";
+                for (double q : {0.01, 0.05, 0.25, 0.5, 0.75, 0.95, 0.99}) {
+                    std::cout << "p" << q * 100 << " = " << summary.quantiles_.quantile(q) << "\n";
+                }
+                if (summary.non_finite_ > 0) std::cout << "non-finite = " << summary.non_finite_ << " of " << args.samples_ << "\n";
+                std::cout << std::endl;
+                return finish();
+            }
+            if (!args.grad_.empty()) { // Value and partial derivatives at a point
+                if (type != typed::NumericType::Double) throw std::invalid_argument("Invalid command line argument: --grad evaluates in double");
+                SymbolTable symbols;
+                auto variables = grad::parse_point(args.grad_, symbols);
+                auto tree = eval::build_expr_tree(tokens.begin(), tokens.end(), &functions);
+                poly::collect_polynomials(tree, polynomials);
+                grad::Gradient gradient = grad::gradient(*tree, symbols, variables);
+                std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << gradient.value_ << RESET << "\n";
+                for (std::size_t i = 0; i < variables.size(); ++i) {
+                    std::cout << "d/d" << variables[i] << " = " << RGB_TEXT(70, 130, 180) << gradient.partials_[i] << RESET << "\n";
+                }
+                std::cout << std::endl;
+                return finish();
+            }
+            if (!args.sweep_.empty()) { // Values along a range of one symbol
+                if (type != typed::NumericType::Double) throw std::invalid_argument("Invalid command line argument: --sweep evaluates in double");
+                SymbolTable symbols;
+                incremental::Sweep sweep = incremental::parse_sweep(args.sweep_, symbols);
+                auto tree = eval::build_expr_tree(tokens.begin(), tokens.end(), &functions);
+                poly::collect_polynomials(tree, polynomials);
+                incremental::Evaluator evaluator(*tree, symbols);
+                auto mode = args.ieee_ ? expr::NumericMode::IEEE : expr::NumericMode::Strict;
+                auto values = evaluator.sweep(sweep.symbol_, sweep.first_, sweep.last_, sweep.steps_, mode);
+                std::cout << "\n";
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    std::cout << sweep.symbol_ << " = " << incremental::sweep_point(sweep.first_, sweep.last_, sweep.steps_, i) << ", ans = ";
+                    if (values[i]) std::cout << RGB_TEXT(70, 130, 180) << values[i].value() << RESET << "\n";
+                    else std::cout << RGB_TEXT(255, 40, 40) << types::error_message(values[i].error()) << RESET << "\n";
+                }
+                std::cout << std::endl;
+                return finish();
+            }
+            if (args.tolerance_ > 0) { // Value with a guaranteed error bound
+                if (type != typed::NumericType::Double) throw std::invalid_argument("Invalid command line argument: --adaptive evaluates in double");
+                auto tree = eval::build_expr_tree(tokens.begin(), tokens.end(), &functions);
+                poly::collect_polynomials(tree, polynomials);
+                adaptive::Result result = adaptive::evaluate(*tree, {}, args.tolerance_);
+                std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << result.value_ << RESET << " +/- " << result.error_;
+                if (result.refined_ > 0) std::cout << " (" << result.refined_ << " subtrees in double-double)";
+                std::cout << "\n" << std::endl;
+                return finish();
+            }
+            if (polynomials != poly::PolynomialMode::Off || type != typed::NumericType::Double || args.fuse_ || args.exact_sum_) {
+                auto parsed = eval::try_parse(args.str_, &functions); // With the text of long literals, for the wider types
+                if (!parsed) throw std::runtime_error(types::error_message(parsed.error()));
+                auto tree = std::move(parsed).value();
+                if (const auto* node = eval::find_too_deep(*tree)) { // The passes recurse into the tree
+                    throw std::runtime_error(types::error_message({types::ErrorCode::TooDeep, node->getPosition()}));
+                }
+                poly::collect_polynomials(tree, polynomials);
+                if (args.exact_sum_ && type == typed::NumericType::Double) summation::collect_sums(tree);
+                if (args.fuse_ && type == typed::NumericType::Double) {
+                    auto counts = fusion::fuse_operations(tree, args.fast_math_ ? fusion::FusionMode::Fast : fusion::FusionMode::Exact);
+                    std::cerr << "fused " << counts.total() << ": " << counts.fma_ << " fma, " << counts.scaled_ << " scaled, "
+                        << counts.shifted_ << " shifted, " << counts.reciprocals_ << " reciprocals" << std::endl;
+                }
+                auto* polynomial = dynamic_cast<const poly::PolynomialNode*>(tree.get());
+                auto* variable = polynomial ? dynamic_cast<const expr::SymbolNode*>(polynomial->child(0)) : nullptr;
+                if (variable) { // Shows the polynomial, as there is nothing to evaluate
+                    std::cout << "\npoly = " << RGB_TEXT(70, 130, 180) << polynomial->polynomial().toString(variable->getSymbolName())
+                        << RESET << "\n" << std::endl;
+                }
+                else if (type != typed::NumericType::Double) {
+                    auto value = typed::evaluate_as(type, *tree, {});
+                    if (!value) throw std::runtime_error(types::error_message(value.error()));
+                    std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << value.value() << RESET << "\n" << std::endl;
+                }
+                else {
+                    types::Numeral value = tree->evaluate({});
+                    std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << value << RESET << "\n" << std::endl;
+                }
+                return finish();
+            }
+            dispatcher::Bindings values;
+            for (const auto& binding : args.matrices_) {
+                auto [symbol, value] = matrix_eval::parse_binding(binding);
+                if (!values.emplace(symbol, std::move(value)).second) {
+                    throw std::invalid_argument("Invalid command line argument: Symbol '" + symbol + "' has two values");
+                }
+            }
+            dispatcher::Result result = dispatcher::get_result(args.mode_, {}, tokens.begin(), tokens.end(), &functions, &values, args.threads_);
             if (std::holds_alternative<types::Numeral>(result)) {
                 std::cout << "\nans = " << RGB_TEXT(70, 130, 180) << std::get<types::Numeral>(result) << RESET << "\n" << std::endl;
             }
+            else std::cout << "\nans =\n" << RGB_TEXT(70, 130, 180) << matrix_eval::to_string(result) << RESET << "\n" << std::endl;
+            return finish();
         }
         catch (const CliHelp&) {
             show_help();
@@ -0,0 +1,103 @@
+#include "utils/latency_histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Comparator putting the fastest sample on top of a std heap
+bool slower_than(const utils::SlowSample& lhs, const utils::SlowSample& rhs) {
+    return lhs.latency_ns_ > rhs.latency_ns_;
+}
+
+} // namespace
+
+utils::LatencyHistogram::LatencyHistogram() : counts_(), total_count_(0), min_(UINT64_MAX), max_(0), sum_(0) {}
+
+std::size_t utils::LatencyHistogram::bucket_index(std::uint64_t value_ns) noexcept {
+    if (value_ns < 2 * kSubBucketCount) return static_cast<std::size_t>(value_ns); // Linear region, exact
+    if (value_ns >> kMaxValueBits) return kBucketCount - 1;                          // Beyond the trackable range
+
+    int msb = 63 - __builtin_clzll(value_ns);    // Position of the leading bit, at least kSubBucketBits + 1
+    int shift = msb - kSubBucketBits;              // Keep the leading bit and kSubBucketBits bits below it
+    std::uint64_t sub = (value_ns >> shift) - kSubBucketCount;
+    return static_cast<std::size_t>(2 * kSubBucketCount + (shift - 1) * kSubBucketCount + sub);
+}
+
+std::uint64_t utils::LatencyHistogram::bucket_lowest(std::size_t index) noexcept {
+    if (index < 2 * kSubBucketCount) return index;
+    std::size_t offset = index - 2 * kSubBucketCount;
+    int shift = static_cast<int>(offset / kSubBucketCount) + 1;
+    std::uint64_t sub = offset % kSubBucketCount;
+    return (sub + kSubBucketCount) << shift;
+}
+
+std::uint64_t utils::LatencyHistogram::bucket_highest(std::size_t index) noexcept {
+    if (index < 2 * kSubBucketCount) return index;
+    std::size_t offset = index - 2 * kSubBucketCount;
+    int shift = static_cast<int>(offset / kSubBucketCount) + 1;
+    std::uint64_t sub = offset % kSubBucketCount;
+    return ((sub + kSubBucketCount + 1) << shift) - 1;
+}
+
+void utils::LatencyHistogram::record(std::uint64_t value_ns) noexcept {
+    ++counts_[bucket_index(value_ns)];
+    ++total_count_;
+    min_ = std::min(min_, value_ns);
+    max_ = std::max(max_, value_ns);
+    sum_ += value_ns;
+}
+
+utils::LatencyHistogram& utils::LatencyHistogram::merge(const LatencyHistogram& other) noexcept {
+    for (std::size_t i = 0; i < kBucketCount; ++i) counts_[i] += other.counts_[i];
+    total_count_ += other.total_count_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+    return *this;
+}
+
+std::uint64_t utils::LatencyHistogram::value_at_percentile(double percentile) const noexcept {
+    if (total_count_ == 0) return 0;
+    percentile = std::clamp(percentile, 0.0, 100.0);
+
+    // Rank of the requested value, at least the first one
+    auto rank = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(total_count_)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < kBucketCount; ++i) {
+        cumulative += counts_[i];
+        if (cumulative >= rank) return std::min(bucket_highest(i), max_); // Never report beyond the exact maximum
+    }
+    return max_;
+}
+
+utils::SlowestList::SlowestList(std::size_t capacity) : capacity_(capacity), heap_() {
+    heap_.reserve(capacity);
+}
+
+void utils::SlowestList::offer(std::uint64_t latency_ns, std::size_t line, const std::string& expression) {
+    if (capacity_ == 0) return;
+    if (heap_.size() < capacity_) {
+        heap_.push_back({latency_ns, line, expression});
+        std::push_heap(heap_.begin(), heap_.end(), slower_than);
+    }
+    else if (latency_ns > heap_.front().latency_ns_) { // Slower than the fastest kept sample, replace it
+        std::pop_heap(heap_.begin(), heap_.end(), slower_than);
+        heap_.back() = {latency_ns, line, expression};
+        std::push_heap(heap_.begin(), heap_.end(), slower_than);
+    }
+}
+
+utils::SlowestList& utils::SlowestList::merge(const SlowestList& other) {
+    for (const auto& sample : other.heap_) offer(sample.latency_ns_, sample.line_, sample.expression_);
+    return *this;
+}
+
+std::vector<utils::SlowSample> utils::SlowestList::sorted() const {
+    std::vector<SlowSample> result(heap_);
+    std::sort(result.begin(), result.end(), [](const SlowSample& lhs, const SlowSample& rhs) {
+        return lhs.latency_ns_ > rhs.latency_ns_ || (lhs.latency_ns_ == rhs.latency_ns_ && lhs.line_ < rhs.line_);
+    });
+    return result;
+}
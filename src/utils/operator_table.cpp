@@ -11,38 +11,130 @@ const std::unordered_map<std::string, expr::OperatorInfo>& expr::get_node_factor
             if (children.size() != 0) throw std::runtime_error("Syntax error: e cannot take an argument");
             return std::make_unique<expr::ENode>();
         }}},
-        {"++", {1, false, 3, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"++", {1, false, 70, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 1) throw std::runtime_error("Syntax error: + expects 1 argument");
             return std::make_unique<expr::PositiveNode>(std::move(children[0]));
         }}},
-        {"--", {1, false, 3, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"--", {1, false, 70, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 1) throw std::runtime_error("Syntax error: - expects 1 argument");
             return std::make_unique<expr::NegativeNode>(std::move(children[0]));
         }}},
-        {"+", {2, false, 1, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"+", {2, false, 50, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 2) throw std::runtime_error("Syntax error: + expects 2 arguments");
             return std::make_unique<expr::AdditionNode>(std::move(children[0]), std::move(children[1]));
         }}},
-        {"-", {2, false, 1, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"-", {2, false, 50, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 2) throw std::runtime_error("Syntax error: - expects 2 arguments");
             return std::make_unique<expr::SubtractionNode>(std::move(children[0]), std::move(children[1]));
         }}},
-        {"*", {2, false, 2, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"*", {2, false, 60, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 2) throw std::runtime_error("Syntax error: * expects 2 arguments");
             return std::make_unique<expr::MultiplicationNode>(std::move(children[0]), std::move(children[1]));
         }}},
-        {"/", {2, false, 2, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"/", {2, false, 60, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 2) throw std::runtime_error("Syntax error: / expects 2 arguments");
             return std::make_unique<expr::DivisionNode>(std::move(children[0]), std::move(children[1]));
         }}},
-        {"sqrt", {1, false, 4, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"^", {2, false, 75, true, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: ^ expects 2 arguments");
+            return std::make_unique<expr::PowerNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {"pow", {2, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: pow expects 2 arguments");
+            return std::make_unique<expr::PowerNode>(std::move(children[0]), std::move(children[1]));
+        }, true}},
+        {"sqrt", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 1) throw std::runtime_error("Syntax error: sqrt expects 1 argument");
-            return std::make_unique<expr::PositiveNode>(std::move(children[0]));
+            return std::make_unique<expr::SqrtNode>(std::move(children[0]));
+        }}},
+        {"exp", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: exp expects 1 argument");
+            return std::make_unique<expr::ExpNode>(std::move(children[0]));
+        }}},
+        {"log", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: log expects 1 argument");
+            return std::make_unique<expr::LogNode>(std::move(children[0]));
+        }}},
+        {"sin", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: sin expects 1 argument");
+            return std::make_unique<expr::SinNode>(std::move(children[0]));
+        }}},
+        {"cos", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: cos expects 1 argument");
+            return std::make_unique<expr::CosNode>(std::move(children[0]));
+        }}},
+        {"gamma", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: gamma expects 1 argument");
+            return std::make_unique<expr::GammaNode>(std::move(children[0]));
+        }}},
+        {"lgamma", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: lgamma expects 1 argument");
+            return std::make_unique<expr::LogGammaNode>(std::move(children[0]));
+        }}},
+        {"binom", {2, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: binom expects 2 arguments");
+            return std::make_unique<expr::BinomialNode>(std::move(children[0]), std::move(children[1]));
+        }, true}},
+        {"dot", {2, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: dot expects 2 arguments");
+            return std::make_unique<expr::DotNode>(std::move(children[0]), std::move(children[1]));
+        }, true}},
+        {"solve", {2, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: solve expects 2 arguments");
+            return std::make_unique<expr::SolveNode>(std::move(children[0]), std::move(children[1]));
+        }, true}},
+        {"transpose", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: transpose expects 1 argument");
+            return std::make_unique<expr::TransposeNode>(std::move(children[0]));
+        }}},
+        {"det", {1, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: det expects 1 argument");
+            return std::make_unique<expr::DeterminantNode>(std::move(children[0]));
         }}},
-        {"!", {1, true, 3, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+        {"!", {1, true, 80, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
             if (children.size() != 1) throw std::runtime_error("Syntax error: ! expects 1 argument");
-            return std::make_unique<expr::PositiveNode>(std::move(children[0]));
+            return std::make_unique<expr::FactorialNode>(std::move(children[0]));
+        }}},
+        {"<", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: < expects 2 arguments");
+            return std::make_unique<expr::LessNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {"<=", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: <= expects 2 arguments");
+            return std::make_unique<expr::LessEqualNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {">", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: > expects 2 arguments");
+            return std::make_unique<expr::GreaterNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {">=", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: >= expects 2 arguments");
+            return std::make_unique<expr::GreaterEqualNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {"==", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: == expects 2 arguments");
+            return std::make_unique<expr::EqualNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {"!=", {2, false, 40, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: != expects 2 arguments");
+            return std::make_unique<expr::NotEqualNode>(std::move(children[0]), std::move(children[1]));
+        }}},
+        {"not", {1, false, 30, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 1) throw std::runtime_error("Syntax error: not expects 1 argument");
+            return std::make_unique<expr::NotNode>(std::move(children[0]));
+        }}},
+        {"and", {2, false, 20, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: and expects 2 arguments");
+            return std::make_unique<expr::AndNode>(std::move(children[1]), std::move(children[0])); // Source order
+        }}},
+        {"or", {2, false, 10, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 2) throw std::runtime_error("Syntax error: or expects 2 arguments");
+            return std::make_unique<expr::OrNode>(std::move(children[1]), std::move(children[0])); // Source order
         }}},
+        {"if", {3, false, 90, false, [](std::vector<std::unique_ptr<expr::ExprNode>>&& children) {
+            if (children.size() != 3) throw std::runtime_error("Syntax error: if expects 3 arguments");
+            return std::make_unique<expr::ConditionalNode>(std::move(children[2]), std::move(children[1]), std::move(children[0]));
+        }, true}},
     };
 
     return node_factory_map;
@@ -21,6 +21,11 @@ const types::Numeral& SymbolTable::at(const types::Symbol& symbol_name) const {
     return it->second;
 }
 
+const types::Numeral* SymbolTable::find(const types::Symbol& symbol_name) const noexcept {
+    auto it = symbols_.find(symbol_name);
+    return it == symbols_.end() ? nullptr : &it->second;
+}
+
 types::Numeral& SymbolTable::operator[](const types::Symbol& symbol_name) {
     return symbols_[symbol_name];
 }
@@ -0,0 +1,96 @@
+#include "utils/versioned_symbol_table.h"
+#include <limits>
+#include <thread>
+
+namespace {
+
+// Preferred reader slot of the calling thread, so that threads rarely contend for the same slot
+std::size_t home_slot() {
+    static std::atomic<std::size_t> next_thread{0};
+    thread_local std::size_t slot = next_thread.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // namespace
+
+VersionedSymbolTable::VersionedSymbolTable() : VersionedSymbolTable(SymbolTable()) {}
+
+VersionedSymbolTable::VersionedSymbolTable(const SymbolTable& initial) :
+    current_(new Version{initial, 0}), epoch_(1), readers_(), writer_mutex_(), retired_() {}
+
+VersionedSymbolTable::~VersionedSymbolTable() {
+    for (auto& [version, epoch] : retired_) delete version;
+    delete current_.load();
+}
+
+VersionedSymbolTable::Snapshot VersionedSymbolTable::snapshot() const {
+    // Announce the epoch in a free slot, probing from this thread's home slot
+    std::size_t index = home_slot();
+    while (true) {
+        std::uint64_t epoch = epoch_.load();
+        std::uint64_t expected = 0;
+        for (std::size_t probe = 0; probe < kReaderSlots; ++probe) {
+            auto& slot = readers_[(index + probe) % kReaderSlots].epoch_;
+            if (slot.load(std::memory_order_relaxed) == 0 && slot.compare_exchange_strong(expected, epoch)) {
+                // The announcement is ordered before the load, so a writer retiring this version will see it
+                return Snapshot(current_.load(), &slot);
+            }
+            expected = 0;
+        }
+        std::this_thread::yield(); // Every slot is held, wait for a reader to finish
+    }
+}
+
+std::uint64_t VersionedSymbolTable::update(const std::function<void(SymbolTable&)>& mutator) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+
+    Version* old_version = current_.load();
+    auto* new_version = new Version{old_version->table_, old_version->number_ + 1};
+    try {
+        mutator(new_version->table_);
+    }
+    catch (...) {
+        delete new_version;
+        throw;
+    }
+
+    current_.exchange(new_version);
+    // Readers announcing this epoch or later loaded the pointer after the exchange
+    std::uint64_t retire_epoch = epoch_.fetch_add(1) + 1;
+    retired_.emplace_back(old_version, retire_epoch);
+    reclaim_locked();
+    return new_version->number_;
+}
+
+std::uint64_t VersionedSymbolTable::insert_or_assign(const types::Symbol& symbol_name, const types::Numeral& value) {
+    return update([&](SymbolTable& table) { table.insert_or_assign(symbol_name, value); });
+}
+
+std::uint64_t VersionedSymbolTable::version() const noexcept {
+    return current_.load(std::memory_order_acquire)->number_;
+}
+
+std::size_t VersionedSymbolTable::reclaim() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return reclaim_locked();
+}
+
+std::size_t VersionedSymbolTable::reclaim_locked() {
+    if (retired_.empty()) return 0;
+
+    // Oldest epoch still announced by a reader
+    std::uint64_t oldest = std::numeric_limits<std::uint64_t>::max();
+    for (const auto& slot : readers_) {
+        std::uint64_t epoch = slot.epoch_.load();
+        if (epoch != 0 && epoch < oldest) oldest = epoch;
+    }
+
+    // A version retired at epoch R is unreachable once every active reader announced R or later
+    std::size_t kept = 0;
+    for (auto& entry : retired_) {
+        if (entry.second <= oldest) delete entry.first;
+        else retired_[kept++] = entry;
+    }
+    retired_.resize(kept);
+    return kept;
+}
@@ -0,0 +1,1184 @@
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "core/adaptive.h"
+#include "core/batch.h"
+#include "core/csv_input.h"
+#include "core/eval.h"
+#include "core/functions.h"
+#include "core/fusion_pass.h"
+#include "core/grad.h"
+#include "core/incremental.h"
+#include "core/matrix_eval.h"
+#include "core/parser.h"
+#include "core/polynomial_pass.h"
+#include "core/sampling.h"
+#include "core/server.h"
+#include "core/summation_pass.h"
+#include "core/typed_program.h"
+#include "core/workers.h"
+#include "functional/constants.h"
+#include "functional/elementary.h"
+#include "functional/error_free.h"
+#include "functional/linalg.h"
+#include "functional/numbers.h"
+#include "functional/polynomial.h"
+#include "functional/random.h"
+#include "functional/stats.h"
+#include "globals.h"
+
+int main(int argc, char* argv[]) {
+    std::cout << "from test_core: Hello, world!\n";
+
+    int failures = 0;
+    auto check = [&failures](bool condition, const std::string& what) {
+        if (!condition) {
+            std::cout << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+    SymbolTable symbols = {{"x", 2.0}};
+
+    // Evaluates through the non-throwing path, NaN on error
+    auto value_of = [&symbols](const std::string& expression, expr::NumericMode mode = expr::NumericMode::Strict) {
+        auto tree = eval::try_parse(expression);
+        if (!tree) return std::nan("");
+        auto value = eval::try_evaluate(*tree.value(), symbols, mode);
+        return value ? value.value() : std::nan("");
+    };
+    // Error code and position of an expression expected to fail
+    auto error_of = [&symbols](const std::string& expression) {
+        auto tree = eval::try_parse(expression);
+        if (!tree) return tree.error();
+        auto value = eval::try_evaluate(*tree.value(), symbols);
+        return value ? types::Error{} : value.error();
+    };
+
+    // Non-throwing parse and evaluate
+    check(value_of("1+2*3") == 7, "1+2*3");
+    check(value_of("x*(x+1)") == 6, "x*(x+1)");
+    check(value_of("-x") == -2, "-x");
+
+    auto error = error_of("1 + 4/0");
+    check(error.code_ == types::ErrorCode::DivisionByZero && error.position_ == 5, "division by zero with position");
+    error = error_of("2*y");
+    check(error.code_ == types::ErrorCode::UndefinedSymbol && error.position_ == 2 && error.detail_ == "y", "undefined symbol");
+    error = error_of("1+2.3.4");
+    check(error.code_ == types::ErrorCode::InvalidNumber && error.position_ == 2, "invalid number");
+    check(error_of("(1+2").code_ == types::ErrorCode::UnpairedBrackets, "unpaired brackets");
+    check(error_of("1+").code_ == types::ErrorCode::ArgumentCount, "argument count");
+    check(error_of("  ").code_ == types::ErrorCode::EmptyExpression, "empty expression");
+
+    // IEEE mode propagates infinities and NaNs
+    check(std::isinf(value_of("1/0", expr::NumericMode::IEEE)), "1/0 is inf in IEEE mode");
+    check(std::isnan(value_of("0/0", expr::NumericMode::IEEE)), "0/0 is nan in IEEE mode");
+
+    // Comparisons, logical operators and conditionals
+    check(value_of("1 < 2") == 1 && value_of("2 <= 1") == 0 && value_of("x == 2") == 1 && value_of("x != 2") == 0, "comparisons");
+    check(value_of("1 < 2 and 2 < 3") == 1 && value_of("1 > 2 or not 1") == 0, "logical operators");
+    check(value_of("(x)-1") == 1 && value_of("3 - -1") == 4, "prefix and infix minus");
+    check(value_of("--3") == 3 && value_of("2--3") == 5 && value_of("2++3") == 5 && value_of("x<=2") == 1, "signs are not munched");
+    check(value_of(std::string(50000, '(') + "1" + std::string(50000, ')')) == 1
+        && value_of(std::string(30000, '(') + "(1)+x" + std::string(30000, ')') + "*3") == 9, "deep brackets take no stack");
+    {
+        std::string negations;
+        for (int i = 0; i < 20000; ++i) negations += "-(";
+        check(error_of(negations + "1" + std::string(20000, ')')).code_ == types::ErrorCode::TooDeep
+            && error_of(std::string(20000, '-') + "1").code_ == types::ErrorCode::TooDeep
+            && value_of(std::string(5000, '-') + "x") == 2, "deep operators are a syntax error, not a stack overflow");
+        std::string sum = "1";
+        for (int i = 1; i < 100000; ++i) sum += "+1";
+        batch::BatchOptions exact_sums;
+        exact_sums.exact_sums_ = true;
+        check(value_of(sum) == 100000 && batch::evaluate_line(sum, symbols, batch::BatchOptions{}, 4).output_ == batch::format_numeral(100000)
+            && typed::evaluate_as(typed::NumericType::Rational, *eval::try_parse(sum).value(), symbols).error().code_ == types::ErrorCode::TooDeep
+            && batch::evaluate_line(sum, symbols, exact_sums).output_.rfind("error: Syntax error: Expression nests too deep", 0) == 0,
+            "long flat sums are freed without recursing, and too deep for the passes");
+    }
+    check(value_of("if(x > 1, 10, 20) + 1") == 11, "if takes the then branch");
+    check(error_of("if(1, 2)").code_ == types::ErrorCode::ArgumentCount, "if argument count");
+
+    // Precedence climbing binds as shunting-yard did, and calls prefix binary operators whatever their precedence
+    check(value_of("-x^2") == -4 && value_of("-(x)^2") == -4 && value_of("2^3^2") == 512 && value_of("-3!") == -6, "prefix binding");
+    check(value_of("sin(0)^2 + 1") == 1 && value_of("pow(x, 3)^2") == 64 && value_of("not 1 < 2") == 0, "calls as operands");
+    check(value_of("2 * or(0, 1) + 1") == 3 && value_of("*(x, 3) - pi()") == 6 - M_PI, "prefix binary calls");
+    error = error_of("sin(1, 2)");
+    check(error.code_ == types::ErrorCode::ArgumentCount && error.detail_ == "sin" && error.received_args_ == 2, "sin argument count");
+    error = error_of("pow(1, )");
+    check(error.code_ == types::ErrorCode::ArgumentCount && error.position_ == 0 && error.received_args_ == 1, "empty argument");
+    check(error_of("(1, 2)").code_ == types::ErrorCode::MisplacedSeparator && error_of("(1, 2)").position_ == 2, "comma in a group");
+    check(error_of("1 2 + 3").code_ == types::ErrorCode::MissingArguments && error_of("1 2 + 3").position_ == 2, "adjacent operands");
+    check(error_of("1 2 (").code_ == types::ErrorCode::UnpairedBrackets, "unpaired brackets reported first");
+
+    // Untaken branches are never evaluated, not even on the branchless path
+    check(value_of("if(x > 1, x, 1/0)") == 2, "lazy else branch");
+    check(value_of("if(x < 1, y, 3)") == 3, "cheap branches with an undefined symbol");
+    check(value_of("0 and 1/0") == 0 && value_of("1 or y") == 1, "short circuit");
+    try {
+        auto tokens = parser::tokenize("if(x > 1, x, 1/0) + (0 and 1/0) + (x or y)");
+        check(eval::build_expr_tree(tokens.begin(), tokens.end())->evaluate(symbols) == 3, "lazy throwing path");
+    }
+    catch (const std::runtime_error& err) {
+        check(false, std::string("lazy throwing path: ") + err.what());
+    }
+
+    // User-defined functions
+    functions::FunctionRegistry registry;
+    check(registry.define("fib(n) = if(n < 2, n, fib(n-1) + fib(n-2))").has_value(), "define fib");
+    check(registry.define("sq(x) = x*x").has_value() && registry.define("hyp(a, b) = sq(a) + sq(b)").has_value(), "define sq, hyp");
+    check(registry.define("scale(t) = t*x").has_value(), "define with a free symbol");
+    check(registry.define("sq(y) = 1").has_value() && registry.find("sq")->parameters()[0] == "y", "redefinition");
+    check(registry.define("pi(x) = 1").error().code_ == types::ErrorCode::InvalidDefinition, "built-in names are reserved");
+    check(registry.define("g(a, a) = a").error().position_ == 5, "duplicate parameter");
+    check(functions::is_definition("f(x, y) = x") && !functions::is_definition("f(x) == 1"), "definition lines");
+
+    auto call = [&symbols, &registry](const std::string& expression) {
+        auto tree = eval::try_parse(expression, &registry);
+        if (!tree) return std::nan("");
+        auto value = eval::try_evaluate(*tree.value(), symbols);
+        return value ? value.value() : std::nan("");
+    };
+    check(call("fib(60)") == 1548008755920, "memoized recursion");
+    auto stats = registry.find("fib")->memoStats();
+    check(stats.misses_ == 61 && stats.hits_ == 58, "fib(60) evaluates each argument once");
+    check(call("fib(60) + fib(59)") == 2504730781961 && registry.find("fib")->memoStats().hits_ == 60, "memo hits across expressions");
+    check(call("hyp(3, 4)") == 25 && call("scale(5)") == 10, "calls");
+    check(!registry.find("scale")->pure() && !registry.find("scale")->memoized(), "free symbols are impure");
+
+    // Parameters used twice take cheap arguments only
+    auto is_call = [&registry](const std::string& expression) {
+        auto tree = eval::try_parse(expression, &registry);
+        return tree && dynamic_cast<functions::CallNode*>(tree.value().get()) != nullptr;
+    };
+    check(!is_call("hyp(x, 2)") && call("hyp(x, 2)") == 8, "inlined call");
+    check(is_call("hyp(x + 1, 2)") && call("hyp(x + 1, 2)") == 13, "call kept for a costly argument");
+    auto tokens = parser::tokenize("fib(x + 1)");
+    registry.recognize(tokens);
+    check(eval::build_expr_tree(tokens.begin(), tokens.end(), &registry)->evaluate(symbols) == 2, "throwing path call");
+    check(registry.define("inv(t) = 1/t").has_value(), "define inv");
+    check(error_of("2 + inv(x - 2)").code_ == types::ErrorCode::MissingArguments, "functions need a registry");
+    auto inlined = eval::try_evaluate(*eval::try_parse("2 + inv(x - 2)", &registry).value(), symbols);
+    check(!inlined && inlined.error().code_ == types::ErrorCode::DivisionByZero && inlined.error().position_ == 4, "errors in inlined bodies");
+    check(registry.define("deep(n) = if(n < 1, 0, deep(n-1) + 1)").has_value(), "define deep");
+    auto deep = eval::try_evaluate(*eval::try_parse("1 + deep(100000)", &registry).value(), symbols);
+    check(!deep && deep.error().code_ == types::ErrorCode::CallDepth && deep.error().position_ == 4, "call depth");
+
+    // Automatic differentiation agrees in both modes, through every node type
+    SymbolTable point = {{"x", 3.0}, {"y", 2.0}, {"z", -1.0}};
+    check(registry.define("mix(a, b) = if(a > b, a*b, a/b) + fib(3)").has_value(), "define mix");
+    auto gradient_of = [&point, &registry](const std::string& expression, bool reverse) {
+        auto tree = eval::try_parse(expression, &registry);
+        std::vector<types::Symbol> variables = {"x", "y", "z"};
+        return reverse ? grad::reverse(*tree.value(), point, variables) : grad::forward(*tree.value(), point, variables);
+    };
+    for (bool reverse : {false, true}) {
+        const std::string mode = reverse ? " (reverse)" : " (forward)";
+        auto g = gradient_of("x*y + x/y - -z + +(pi*e) - (x < y) + (not z) + (x and y) + (x or z)", reverse);
+        check(g.value_ == 6 + 1.5 + -1 + M_PI * M_E + 0 + 0 + 1 + 1, "value" + mode);
+        check(g.partials_[0] == 2.5 && g.partials_[1] == 3 - 0.75 && g.partials_[2] == 1, "arithmetic partials" + mode);
+        g = gradient_of("if(x > y, x*x*z, y) + mix(x, y) + mix(z, y)", reverse);
+        check(g.value_ == -9 + 6 + 2 + -0.5 + 2, "calls" + mode);
+        check(g.partials_[0] == 2 * 3 * -1 + 2 && g.partials_[1] == 3 + 0.25 && g.partials_[2] == 9 + 0.5, "call partials" + mode);
+        check(gradient_of("5 + 0*x", reverse).partials_ == std::vector<types::Numeral>({0, 0, 0}), "constant" + mode);
+    }
+    try {
+        gradient_of("x/(y-2)", true);
+        check(false, "differentiation throws");
+    }
+    catch (const std::runtime_error& err) {
+        check(std::string(err.what()) == "Numerical error: Cannot divide by 0", "differentiation error message");
+    }
+
+    // Polynomial subtrees collapse into one node and keep their values and derivatives
+    auto collected = [&registry](const std::string& expression, poly::PolynomialMode mode) {
+        auto tree = eval::try_parse(expression, &registry).value();
+        poly::collect_polynomials(tree, mode);
+        return tree;
+    };
+    auto cubic = collected("3*x*x*x + 2*x*x - x + 7", poly::PolynomialMode::Collect);
+    auto* cubic_node = dynamic_cast<poly::PolynomialNode*>(cubic.get());
+    check(cubic_node && cubic_node->polynomial().toString("x") == "3*x^3 + 2*x^2 - x + 7", "collected polynomial");
+    check(cubic->evaluate(symbols) == 37 && grad::reverse(*cubic, symbols, {"x"}).partials_[0] == 43, "polynomial value and derivative");
+    auto product = eval::try_parse("(x+1)*(x-1)").value();
+    check(poly::collect_polynomials(product, poly::PolynomialMode::Off) == 0
+        && poly::collect_polynomials(product, poly::PolynomialMode::Collect) == 0, "products of sums are kept");
+    check(poly::collect_polynomials(product, poly::PolynomialMode::Expand) == 1 && product->evaluate(symbols) == 3, "expanded product");
+    auto nested = collected("if(x > 1, x*x*x/4 - 3*x + 1, 0) + hyp(x, 1)", poly::PolynomialMode::Collect);
+    check(nested->evaluate(symbols) == -3 + 5 && grad::forward(*nested, symbols, {"x"}).partials_[0] == 0 + 4, "nested polynomials");
+    std::vector<types::Numeral> coefficients(200), others(100);
+    for (std::size_t k = 0; k < coefficients.size(); ++k) coefficients[k] = std::sin(static_cast<double>(k));
+    for (std::size_t k = 0; k < others.size(); ++k) others[k] = std::cos(static_cast<double>(k));
+    poly::Polynomial big(coefficients);
+    types::Numeral horner = 0;
+    for (std::size_t k = coefficients.size(); k-- > 0; ) horner = horner * 0.99 + coefficients[k];
+    check(std::fabs(big.evaluate(0.99) - horner) < 1e-12 * std::fabs(horner) + 1e-12, "Estrin agrees with Horner");
+    poly::Polynomial ninths(std::vector<types::Numeral>(9, 1.0)), tenths(std::vector<types::Numeral>(10, 1.0));
+    auto near = [](types::Numeral value, types::Numeral expected) { return std::fabs(value - expected) <= 1e-14 * std::fabs(expected); };
+    check(near(ninths.evaluate(1e20), 1e160) && near(ninths.evaluate(-1e20), 1e160) && tenths.evaluate(1e80) == HUGE_VAL
+        && tenths.evaluate(-1e80) == -HUGE_VAL, "Estrin at large x");
+    auto large = collected("x*x*x*x*x*x*x*x + x*x*x*x*x*x*x + x*x*x*x*x*x + x*x*x*x*x + x*x*x*x + x*x*x + x*x + x + 1", poly::PolynomialMode::Collect);
+    check(near(large->evaluateAt(symbols, {{"x", 1e20}}), 1e160), "collected polynomial at large x");
+    auto fft = poly::multiply_fft(coefficients, others);
+    auto schoolbook = poly::multiply_schoolbook(coefficients, others);
+    double worst = 0;
+    for (std::size_t k = 0; k < fft.size(); ++k) worst = std::max(worst, std::fabs(fft[k] - schoolbook[k]));
+    check(fft.size() == schoolbook.size() && worst < 1e-10, "FFT product agrees with the schoolbook product");
+
+    // Fused nodes keep the values, errors and derivatives of the patterns they replace
+    {
+        SymbolTable point{{"x", 1.5}, {"y", -2.0}, {"z", 3.0}};
+        auto fused = [&registry](const std::string& expression, fusion::FusionMode mode, fusion::FusionCounts* counts = nullptr) {
+            auto tree = eval::try_parse(expression, &registry).value();
+            auto made = fusion::fuse_operations(tree, mode);
+            if (counts) *counts = made;
+            return tree;
+        };
+        fusion::FusionCounts counts;
+        const std::string expression = "x*3 + 2*y - z/4 + 1/x + (y - 1) * hyp(x, 2)";
+        auto tree = fused(expression, fusion::FusionMode::Exact, &counts);
+        auto plain = eval::try_parse(expression, &registry).value();
+        check(counts.fma_ == 4 && counts.scaled_ == 1 && counts.shifted_ == 1 && counts.reciprocals_ == 1 && counts.total() == 7,
+            "fusion counts");
+        check(std::fabs(tree->evaluate(point) - plain->evaluate(point)) < 1e-14 && tree->clone()->evaluate(point) == tree->evaluate(point),
+            "fused value");
+        auto fused_gradient = grad::reverse(*tree, point, {"x", "y", "z"});
+        auto plain_gradient = grad::forward(*plain, point, {"x", "y", "z"});
+        bool same = true;
+        for (std::size_t i = 0; i < 3; ++i) same = same && std::fabs(fused_gradient.partials_[i] - plain_gradient.partials_[i]) < 1e-14;
+        check(same && grad::forward(*tree, point, {"x", "y", "z"}).partials_ == fused_gradient.partials_, "fused derivatives");
+        check(fused("0.1 * 10 - 1", fusion::FusionMode::Exact)->evaluate(point) == std::fma(0.1, 10, -1), "fma rounds once");
+        check(fused("1 - 0.1 * 10", fusion::FusionMode::Exact)->evaluate(point) == std::fma(-0.1, 10, 1), "product subtracted");
+
+        fused("x / 3 + (2 - x)", fusion::FusionMode::Exact, &counts);
+        check(counts.total() == 0, "no exact reciprocal, constant minus symbol");
+        fused("x / 3", fusion::FusionMode::Fast, &counts);
+        check(counts.reciprocals_ == 1 && counts.scaled_ == 1, "fast reciprocal");
+        fused("x * 2", fusion::FusionMode::Off, &counts);
+        check(counts.total() == 0, "fusion off");
+        for (const char* failing : {"w * 2 + 1", "x - w", "3 / 0 + x", "2 * x + w * 2", "y * 2 + 1 / (x - x)"}) {
+            auto error = eval::try_evaluate(*fused(failing, fusion::FusionMode::Exact), point);
+            auto expected = eval::try_evaluate(*eval::try_parse(failing, &registry).value(), point);
+            check(!error && error.error().code_ == expected.error().code_ && error.error().position_ == expected.error().position_
+                && error.error().detail_ == expected.error().detail_, std::string("fused error ") + failing);
+        }
+    }
+
+    // Chains of + and - summed exactly keep their errors and derivatives, and lose their dependence on the order
+    {
+        SymbolTable point{{"x", 1e100}, {"y", 1.0}, {"z", 3.0}};
+        auto summed = [&registry](const std::string& expression, std::size_t* count = nullptr) {
+            auto tree = eval::try_parse(expression, &registry).value();
+            std::size_t made = summation::collect_sums(tree);
+            if (count) *count = made;
+            return tree;
+        };
+        std::size_t count = 0;
+        auto tree = summed("x + y - x", &count);
+        check(count == 1 && tree->evaluate(point) == 1 && eval::try_parse("x + y - x", &registry).value()->evaluate(point) == 0,
+            "exact sum of a chain");
+        check(summed("y - x + x")->evaluate(point) == summed("x - (x - y)")->evaluate(point) && tree->clone()->evaluate(point) == 1,
+            "exact sum in any order and grouping");
+        summed("x + y", &count);
+        check(count == 0, "two terms left alone");
+        summed("(x + y + z) * (x - y - z + 1)", &count);
+        check(count == 2, "exact sums counted");
+        auto derivative = summed("x*y - z*z + y - 2*y");
+        auto gradient = grad::reverse(*derivative, point, {"y", "z"});
+        check(gradient.partials_ == grad::forward(*derivative, point, {"y", "z"}).partials_ && gradient.partials_[0] == 1e100 - 1
+            && gradient.partials_[1] == -6, "exact sum derivatives");
+        for (const char* failing : {"x + w - y", "x - 1/0 + y", "y + sqrt(-z) - w"}) {
+            auto error = eval::try_evaluate(*summed(failing), point);
+            auto expected = eval::try_evaluate(*eval::try_parse(failing, &registry).value(), point);
+            check(!error && error.error().code_ == expected.error().code_ && error.error().position_ == expected.error().position_,
+                std::string("exact sum error ") + failing);
+        }
+    }
+
+    // Typed evaluation agrees with the tree, and keeps the precision of the wider types
+    auto typed_value = [&symbols, &registry](const std::string& expression, typed::NumericType type) {
+        auto value = typed::evaluate_as(type, *eval::try_parse(expression, &registry).value(), symbols);
+        return value ? value.value() : types::error_message(value.error());
+    };
+    for (const std::string expression : {"if(x > 1, -x*3, 1/0) + (x < 3 or 1/0) - (0 and 1/0)", "fib(x + 10) / mix(x, 4)", "pi - e",
+        "dot(x, 3) - solve(4, x) + det(transpose(x))"}) {
+        std::string expected = batch::format_numeral(eval::try_evaluate(*eval::try_parse(expression, &registry).value(), symbols).value());
+        check(typed_value(expression, typed::NumericType::Double) == expected, "typed double " + expression);
+    }
+    check(typed_value("0.1 + 0.2", typed::NumericType::Float) == "0.3", "float sum");
+    check(typed_value("0.1 + 0.2", typed::NumericType::Double) == "0.30000000000000004", "double sum");
+    check(typed_value("1/3", typed::NumericType::LongDouble) == "0.33333333333333333334", "long double quotient");
+    check(typed::from_numeral<long double>(0.1) == 0.1L, "literals round once");
+    check(typed_value("0.1234567890123456789", typed::NumericType::LongDouble) == "0.1234567890123456789"
+        && typed_value("9007199254740993 - 9007199254740992", typed::NumericType::LongDouble) == "1", "long literals round once");
+    check(typed_value("1 + 1/(x-2)", typed::NumericType::Float) == "Numerical error: Cannot divide by 0", "typed errors");
+    for (typed::NumericType type : {typed::NumericType::Float, typed::NumericType::LongDouble}) { // The divisor fails first, as in the tree
+        auto value = typed::evaluate_as(type, *eval::try_parse("sqrt(-1)/(-1)^0.5").value(), symbols);
+        check(!value && batch::format_error(value.error()) == "error: Numerical error: Argument outside the domain of '^' at position 13",
+            "typed quotients evaluate the divisor first");
+    }
+    check(typed_value("1 + deep(100000)", typed::NumericType::LongDouble) == "Numerical error: Calls of 'deep' nest too deep", "typed call depth");
+    check(typed_value("1/3 + 1/6 + 0.1*x", typed::NumericType::Rational) == "7/10", "exact sum");
+    check(typed_value("if(1/3 + 1/3 + 1/3 == 1, 2/4, 0)", typed::NumericType::Rational) == "1/2", "exact comparison");
+    check(typed_value("(x + 9223372036854775808) * (x + 9223372036854775808) / 3", typed::NumericType::Rational) == "85070591730234615902737140005361156100/3", "exact big results");
+    check(typed_value("9223372036854775807+1", typed::NumericType::Rational) == "9223372036854775808"
+        && typed_value("9007199254740993", typed::NumericType::Rational) == "9007199254740993"
+        && typed_value("12345678901234567891", typed::NumericType::Rational) == "12345678901234567891"
+        && typed_value("0.12345678901234567890123", typed::NumericType::Rational) == "12345678901234567890123/100000000000000000000000",
+        "exact literals as written");
+    check(registry.define("big(t) = t + 9007199254740993").has_value() && typed_value("big(0) - 1", typed::NumericType::Rational) == "9007199254740992",
+        "exact literals of inlined bodies");
+    check(typed_value("1 + pi", typed::NumericType::Rational) == "Numerical error: pi has no exact value", "irrational constants");
+    check(typed_value("dot(x, 1/3) + solve(3, x) + transpose(1/6) * det(x)", typed::NumericType::Rational) == "5/3"
+        && typed_value("solve(x - 2, 1)", typed::NumericType::LongDouble) == "Numerical error: Cannot divide by 0", "typed scalar linear algebra");
+    check(batch::format_error(typed::evaluate_as(typed::NumericType::Rational, *eval::try_parse("2 * sqrt(x)").value(), symbols).error())
+        == "error: Numerical error: sqrt has no exact value at position 4", "irrational functions");
+    check(batch::format_error(typed::evaluate_as(typed::NumericType::Rational, *eval::try_parse("1 + y").value(), {{"y", HUGE_VAL}}).error())
+        == "error: Numerical error: Infinity has no exact value at position 4", "infinite symbols");
+    {
+        batch::BatchOptions exact;
+        exact.numeric_type_ = typed::NumericType::Rational;
+        exact.threads_ = 4;
+        std::vector<std::string> lines(64, "1/3"), outputs;
+        lines[17] = "pi";
+        batch::BatchReport report = batch::run(lines, symbols, exact, outputs);
+        check(report.errors_ == 1 && outputs[17] == "error: Numerical error: pi has no exact value at position 0" && outputs[63] == "1/3",
+            "one inexact line of an exact batch");
+    }
+#ifdef CALC_HAS_FLOAT128
+    check(typed_value("1/3", typed::NumericType::Float128) == "0.333333333333333333333333333333333", "float128 quotient");
+    check(typed_value("0.1234567890123456789012345678901", typed::NumericType::Float128) == "0.1234567890123456789012345678901", "float128 literals");
+#endif
+    typed::Program<float> program(*eval::try_parse("if(x > y, x*x - y, y/x) + (x == 0 or y == 0)").value());
+    std::vector<float> xs(1000), ys(1000), bulk(1000);
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        xs[i] = static_cast<float>(i % 7);
+        ys[i] = static_cast<float>(i % 5);
+    }
+    const float* columns[] = {xs.data(), ys.data()};
+    program.evaluateBulk(columns, xs.size(), bulk.data());
+    bool agrees = program.symbols() == std::vector<types::Symbol>({"x", "y"});
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        float values[] = {xs[i], ys[i]};
+        expr::EvalStatus status;
+        status.mode_ = expr::NumericMode::IEEE;
+        float scalar = program.evaluate(values, status);
+        agrees = agrees && (scalar == bulk[i] || (std::isnan(scalar) && std::isnan(bulk[i])));
+    }
+    check(agrees, "bulk evaluation agrees with scalar evaluation");
+    std::vector<types::Error> bulk_errors(xs.size());
+    typed::Program<float> failing(*eval::try_parse("x/y + log(x)").value());
+    std::vector<const float*> failing_columns;
+    for (const auto& name : failing.symbols()) failing_columns.push_back(name == "x" ? xs.data() : ys.data());
+    failing.evaluateBulk(failing_columns.data(), xs.size(), bulk.data(), bulk_errors.data());
+    check(bulk_errors[0].code_ == types::ErrorCode::DivisionByZero && bulk_errors[0].position_ == 1 && bulk_errors[1].code_ == types::ErrorCode::None
+        && bulk_errors[7].code_ == types::ErrorCode::OutOfDomain && bulk_errors[7].position_ == 6 && bulk[8] == 1.0f / 3.0f,
+        "bulk evaluation reports the first error of each point");
+
+    // Adaptive evaluation re-evaluates cancelling sums only, and its bound holds
+    auto adaptive_result = [&](const std::string& expression) {
+        return adaptive::evaluate(*eval::try_parse(expression).value(), symbols);
+    };
+    auto exact = adaptive_result("(10000000000000000 + 1) - 10000000000000000");
+    check(exact.value_ == 1 && exact.error_ == 0 && exact.refined_ == 1, "cancelling sum is re-evaluated exactly");
+    auto plain = adaptive_result("0.1 + 0.2 * x");
+    check(plain.value_ == 0.1 + 0.2 * 2.0 && plain.refined_ == 0 && plain.error_ > 0 && plain.error_ <= 1e-15, "stable sums stay in double");
+    check(adaptive_result("3*4 - 12").error_ == 0, "exact arithmetic has no error");
+    auto pi = adaptive_result("pi - 3.141592653589793");
+    check(std::fabs(pi.value_ - 1.2246467991473532e-16) <= pi.error_ && pi.error_ < 1e-30, "pi is exact to double-double");
+    symbols["a"] = 100000001;
+    symbols["b"] = 100000000;
+    auto quotient = adaptive_result("(a*a - b*b) / (a - b) + 1/3");
+    types::Rational truth = types::Rational::fromString("200000001") + types::Rational(1, 3);
+    check(std::fabs(quotient.value_ - truth.toDouble()) <= quotient.error_ && quotient.error_ < 1e-7, "bound holds after refinement");
+    check(adaptive_result("x*x - 3*x").refined_ == 0, "no cancellation, no refinement");
+    try {
+        adaptive_result("1 < 2");
+        check(false, "nodes without error bounds throw");
+    }
+    catch (const std::invalid_argument&) {
+    }
+
+    // Elementary functions and powers, with errors outside their domains
+    check(std::fabs(value_of("sqrt(x) * sqrt(x)") - 2) < 1e-15 && std::fabs(value_of("exp(log(x))") - 2) < 1e-15, "sqrt, exp, log");
+    check(std::fabs(value_of("sin(pi/6)") - 0.5) < 1e-15 && std::fabs(value_of("cos(x)^2 + sin(x)^2") - 1) < 1e-15, "sin, cos");
+    check(value_of("-2^2") == -4 && value_of("2^3^2") == 512 && value_of("2^-1") == 0.5 && value_of("3*x^2") == 12, "^ precedence and associativity");
+    check(value_of("pow(x, 10)") == 1024 && value_of("(-2)^3") == -8 && value_of("0^0") == 1, "integer powers");
+    check(error_of("sqrt(x - 3)").code_ == types::ErrorCode::OutOfDomain && error_of("sqrt(x - 3)").detail_ == "sqrt"
+        && error_of("1 + log(0)").position_ == 4, "domain errors");
+    check(error_of("0^-1").code_ == types::ErrorCode::DivisionByZero && error_of("(-8)^(1/3)").detail_ == "^", "power errors");
+    check(std::isnan(value_of("log(-1)", expr::NumericMode::IEEE)) && std::isinf(value_of("0^-1", expr::NumericMode::IEEE)), "IEEE domain errors");
+    for (bool reverse : {false, true}) {
+        const std::string mode = reverse ? " (reverse)" : " (forward)";
+        auto g = gradient_of("sqrt(x) + exp(y) + log(x) + sin(y) + cos(x)", reverse);
+        check(std::fabs(g.partials_[0] - (0.5 / std::sqrt(3.0) + 1 / 3.0 - std::sin(3.0))) < 1e-15
+            && std::fabs(g.partials_[1] - (std::exp(2.0) + std::cos(2.0))) < 1e-14, "elementary partials" + mode);
+        g = gradient_of("x^y + z^2", reverse);
+        check(g.value_ == 10 && g.partials_[0] == 6 && std::fabs(g.partials_[1] - 9 * std::log(3.0)) < 1e-14 && g.partials_[2] == -2, "power partials" + mode);
+    }
+    check(typed_value("2^(1/2) - sqrt(2)", typed::NumericType::LongDouble) == "0" && typed_value("(2/3)^-3", typed::NumericType::Rational) == "27/8",
+        "typed powers");
+    check(typed_value("2^(1/2)", typed::NumericType::Rational) == "Numerical error: Argument outside the domain of '^'", "exact powers are integer");
+    auto cube = collected("x^3 - 2*x^2", poly::PolynomialMode::Collect);
+    check(dynamic_cast<poly::PolynomialNode*>(cube.get()) && cube->evaluate(symbols) == 0, "integer powers are polynomials");
+
+    // The fast kernels stay within a few ulp of long double, with and without AVX2
+    auto ulps = [](double value, long double reference) {
+        double rounded = static_cast<double>(reference);
+        if (value == rounded) return 0.0L;
+        return std::fabs(value - reference) / (std::nextafter(std::fabs(rounded), INFINITY) - std::fabs(rounded));
+    };
+    struct Kernel { elementary::Function function_; double (*fast_)(double) noexcept; long double (*reference_)(long double); double from_, to_; };
+    const Kernel kernels[] = {
+        {elementary::Function::Exp, elementary::fast::exp, expl, -700, 700},
+        {elementary::Function::Log, elementary::fast::log, logl, 1e-300, 1e300},
+        {elementary::Function::Log, elementary::fast::log, logl, 0.5, 2},
+        {elementary::Function::Sin, elementary::fast::sin, sinl, -1000, 1000},
+        {elementary::Function::Cos, elementary::fast::cos, cosl, -1000, 1000},
+    };
+    for (const Kernel& kernel : kernels) {
+        const std::string name = elementary::function_name(kernel.function_);
+        std::vector<double> args(1001), values(args.size());
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            double t = static_cast<double>(i) / static_cast<double>(args.size() - 1);
+            args[i] = kernel.from_ + t * (kernel.to_ - kernel.from_);
+        }
+        if (kernel.function_ == elementary::Function::Log) { // Spread geometrically
+            for (double& arg : args) arg = std::exp(std::log(kernel.from_) + (arg - kernel.from_) / (kernel.to_ - kernel.from_) * std::log(kernel.to_ / kernel.from_));
+        }
+        elementary::fast::evaluate(kernel.function_, args.data(), values.data(), args.size());
+        long double worst_scalar = 0, worst_array = 0;
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            worst_scalar = std::max(worst_scalar, ulps(kernel.fast_(args[i]), kernel.reference_(args[i])));
+            worst_array = std::max(worst_array, ulps(values[i], kernel.reference_(args[i])));
+        }
+        check(worst_scalar <= 4 && worst_array <= 4, "fast " + name + " within 4 ulp");
+    }
+    std::vector<double> bases(1001), exponents(bases.size()), powers(bases.size());
+    for (std::size_t i = 0; i < bases.size(); ++i) {
+        bases[i] = 0.01 + 0.1 * static_cast<double>(i);
+        exponents[i] = -50 + 0.1 * static_cast<double>(i);
+    }
+    elementary::fast::pow(bases.data(), exponents.data(), powers.data(), bases.size());
+    long double worst_power = 0;
+    for (std::size_t i = 0; i < bases.size(); ++i) {
+        long double reference = powl(bases[i], exponents[i]);
+        worst_power = std::max({worst_power, ulps(powers[i], reference), ulps(elementary::fast::pow(bases[i], exponents[i]), reference)});
+    }
+    check(worst_power <= 4, "fast pow within 4 ulp");
+    check(elementary::fast::exp(1000) == INFINITY && elementary::fast::log(0) == -INFINITY && std::isnan(elementary::fast::sin(INFINITY))
+        && elementary::fast::pow(-2, 3) == -8 && std::fabs(elementary::fast::sin(1e22) - std::sin(1e22)) == 0, "fast kernels defer to libm");
+    elementary::set_accuracy(elementary::Accuracy::Fast);
+    check(std::fabs(value_of("exp(1) - e") ) < 1e-15 && value_of("2^10") == 1024, "fast accuracy evaluates expressions");
+    elementary::set_accuracy(elementary::Accuracy::Precise);
+
+    // Factorials, gamma and binomial coefficients
+    check(value_of("5!") == 120 && value_of("3!!") == 720 && value_of("2^3!") == 64 && value_of("-3!") == -6 && value_of("x!") == 2, "postfix !");
+    check(value_of("170!") == 7.257415615307998967e306 && std::isinf(value_of("171!")) && value_of("20!") == 2432902008176640000.0, "factorial table");
+    check(value_of("gamma(x + 1)") == 2 && std::fabs(value_of("gamma(0.5)^2") - M_PI) < 1e-15 && std::fabs(value_of("lgamma(101) - log(100!)")) < 1e-13,
+        "gamma and lgamma");
+    check(value_of("binom(10, 3)") == 120 && value_of("binom(-3, 2)") == 6 && value_of("binom(5, 7)") == 0 && value_of("binom(0.5, 2)") == -0.125
+        && value_of("binom(67, 33)") == 14226520737620288370.0, "binomials");
+    check(error_of("(-1)!").code_ == types::ErrorCode::OutOfDomain && error_of("gamma(0)").detail_ == "gamma"
+        && error_of("binom(-1, 0.5)").detail_ == "binom", "special domain errors");
+    long double worst_gamma = 0;
+    for (double x = -170.75; x < 171.5; x += 0.5) worst_gamma = std::max(worst_gamma, ulps(numbers::gamma(x), tgammal(x)));
+    check(worst_gamma <= 3, "gamma within 3 ulp");
+    for (bool reverse : {false, true}) {
+        const std::string mode = reverse ? " (reverse)" : " (forward)";
+        auto g = gradient_of("gamma(x) + lgamma(y) + (z + 2)!", reverse);
+        double digamma_3 = 1.5 - 0.57721566490153286;
+        check(std::fabs(g.partials_[0] - 2 * digamma_3) < 1e-14 && std::fabs(g.partials_[1] - (1 - 0.57721566490153286)) < 1e-14
+            && std::fabs(g.partials_[2] - (1 - 0.57721566490153286)) < 1e-14, "gamma partials" + mode);
+        g = gradient_of("binom(x, y)", reverse);
+        check(std::fabs(g.partials_[0] - 3 * (digamma_3 + 1.0 / 3 - (1 - 0.57721566490153286))) < 1e-14, "binomial partials" + mode);
+    }
+    check(typed_value("25!", typed::NumericType::Rational) == "15511210043330985984000000" && typed_value("gamma(4)", typed::NumericType::Rational) == "6"
+        && typed_value("binom(100, 50)", typed::NumericType::Rational) == "100891344545564193334812497256"
+        && typed_value("binom(-3, 3)", typed::NumericType::Rational) == "-10", "exact factorials and binomials");
+    check(typed_value("0.5!", typed::NumericType::Rational) == "Numerical error: '!' has no exact value at this argument", "no exact gamma of fractions");
+    check(typed_value("lgamma(2)", typed::NumericType::Rational) == "Numerical error: lgamma has no exact value", "log gamma is not exact");
+    check(typed_value("binom(50, 25) + 30!", typed::NumericType::LongDouble) == "2.6525285981219105875e+32", "typed binomials");
+    check(typed_value("5!", typed::NumericType::Float) == "120" && typed_value("gamma(3)", typed::NumericType::Float) == "2"
+        && typed_value("20!", typed::NumericType::LongDouble) == "2432902008176640000" && typed_value("gamma(8) - 7!", typed::NumericType::LongDouble) == "0"
+        && typed_value("34! / 33!", typed::NumericType::Float) == "34", "typed factorials of integers come from a table");
+    auto digit_sum = [](const std::string& digits) {
+        int sum = 0;
+        for (char digit : digits) sum += digit - '0';
+        return sum;
+    };
+    std::string thousand = numbers::factorial_exact(1000).toString();
+    check(thousand.size() == 2568 && digit_sum(thousand) == 10539 && digit_sum(numbers::factorial_exact(100).toString()) == 648, "prime-swing factorial");
+    check(numbers::binomial_exact(20000, 7000) * numbers::factorial_exact(7000) * numbers::factorial_exact(13000) == numbers::factorial_exact(20000),
+        "exact binomial");
+    numbers::BinomialTable table(100000);
+    check(table(100000, 2) == 4999950000.0 && table(67, 33) == 14226520737620288370.0 && table(5, 9) == 0, "binomial table");
+    check(std::fabs(table(3000, 100) / numbers::binomial(3000, 100) - 1) < 1e-13, "binomial table from log-factorials");
+    std::istringstream queries("10 3\n4 x\n1000 2\n");
+    std::ostringstream answers;
+    check(batch::run_binomials(queries, answers) == 1 && answers.str().rfind("120\nerror: ", 0) == 0 && answers.str().find("\n499500\n") != std::string::npos,
+        "batch binomials");
+
+    // Constants to any number of digits
+    std::string pi_digits = constants::digits(constants::Constant::Pi, 10000);
+    check(pi_digits.size() == 10002 && pi_digits.compare(pi_digits.size() - 20, 20, "05600101655256375678") == 0
+        && constants::digits(constants::Constant::Pi, 20) == "3.14159265358979323846" && constants::digits(constants::Constant::Pi, 0) == "3",
+        "pi digits");
+    std::string e_digits = constants::digits(constants::Constant::E, 10000, 4);
+    check(e_digits.compare(e_digits.size() - 20, 20, "87042300179465536788") == 0 && constants::digits(constants::Constant::E, 5) == "2.71828",
+        "e digits");
+    check(constants::scaled(constants::Constant::E, 100000, 1) == constants::scaled(constants::Constant::E, 100000, 3)
+        && constants::scaled(constants::Constant::Pi, 20000, 1) == constants::scaled(constants::Constant::Pi, 20000, 5), "threads split alike");
+
+    // A formula per row of CSV text
+    std::string table_text = "price,qty,\"disc\",note\n";
+    for (int row = 0; row < 500; ++row) table_text += std::to_string(row) + ", 2 ,0.5,n" + std::to_string(row) + "\r\n";
+    table_text += "\n1,x,0\n3\n";
+    auto price_tree = eval::try_parse("price * qty * (1 - disc)").value();
+    for (unsigned threads : {1u, 3u}) {
+        std::ostringstream column;
+        csv::CsvOptions options;
+        options.threads_ = threads;
+        options.block_size_ = 64; // Many blocks, written in order
+        csv::CsvReport report = csv::evaluate(table_text.data(), table_text.size(), *price_tree, column, options);
+        std::string expected = "result\n";
+        for (int row = 0; row < 500; ++row) expected += std::to_string(row) + "\n";
+        check(column.str() == expected + "nan\nnan\n" && report.rows_ == 502 && report.malformed_ == 2,
+            "CSV rows with " + std::to_string(threads) + " threads");
+    }
+    std::ostringstream binary;
+    csv::evaluate(table_text.data(), table_text.size(), *eval::try_parse("qty / 4").value(), binary, {1, csv::OutputFormat::Binary});
+    check(binary.str().size() == 502 * sizeof(double) && reinterpret_cast<const double*>(binary.str().data())[7] == 0.5, "CSV binary column");
+    auto failing_tree = eval::try_parse("1/price + sqrt(1 - price)").value();
+    for (expr::NumericMode mode : {expr::NumericMode::Strict, expr::NumericMode::IEEE}) {
+        std::ostringstream column;
+        csv::CsvOptions options;
+        options.numeric_mode_ = mode;
+        csv::CsvReport report = csv::evaluate(table_text.data(), table_text.size(), *failing_tree, column, options);
+        std::string text = column.str();
+        bool strict = mode == expr::NumericMode::Strict;
+        check(report.failed_ == (strict ? 500u : 0u) && text.compare(0, 10, strict ? "result\nerr" : "result\ninf") == 0
+            && text.find(strict ? "\nerror: Numerical error: Argument outside the domain of 'sqrt' at position 10\n" : "\n-nan\n") != std::string::npos,
+            strict ? "CSV rows failing in strict mode" : "CSV rows propagating inf and nan in IEEE mode");
+    }
+    try {
+        std::ostringstream column;
+        csv::evaluate(table_text.data(), table_text.size(), *eval::try_parse("price * tax").value(), column, {});
+        check(false, "CSV needs a column per symbol");
+    }
+    catch (const std::invalid_argument& err) {
+        check(std::string(err.what()) == "Syntax error: Symbol 'tax' undefined, the input has no such column", "CSV missing column message");
+    }
+
+    // Long expressions parse on several threads into the same tree
+    std::function<bool(const expr::ExprNode&, const expr::ExprNode&)> same_tree = [&same_tree](const expr::ExprNode& a, const expr::ExprNode& b) {
+        if (typeid(a) != typeid(b) || a.getPosition() != b.getPosition() || a.childCount() != b.childCount()) return false;
+        for (std::size_t i = 0; i < a.childCount(); ++i) {
+            if (!same_tree(*a.child(i), *b.child(i))) return false;
+        }
+        return true;
+    };
+    const std::string terms[] = {"sin(x * 1.5) ^ 2 ^ 0.5", "-(x + 3) * 2!", "pow(x, 2) / sq(x)", "if(x < 3, x, -x)", "sqrt x - 1",
+        "(x >= 1 and x != 4) + 1", "- x ^ 2", "x*x-+x", "[x - 1] * {2 + x}"};
+    auto chain = [&terms](std::size_t count, std::size_t seed) {
+        std::string text = terms[seed % 9];
+        for (std::size_t k = 1; k < count; ++k) text += (k % 4 == 0 ? " * " : k % 2 == 0 ? " - " : " + ") + terms[(seed + k) % 9];
+        return text;
+    };
+    std::string sum;
+    for (std::size_t group = 0; group < 240; ++group) {
+        if (group > 0) sum += group % 5 == 0 ? "\n- " : " + ";
+        if (group % 3 == 0) sum += "(" + chain(20, group) + ")";
+        else if (group % 3 == 1) sum += "sin(" + chain(20, group) + ")";
+        else sum += "hyp(" + chain(10, group) + ", " + chain(10, group + 1) + ")";
+    }
+    const std::string long_expression = "hyp(" + sum + ", " + sum + ") - 2 ^ 3 ^ cos(" + sum + ")*" + chain(3000, 7);
+    std::vector<std::size_t> sequential_positions, parallel_positions;
+    auto sequential_tokens = parser::try_tokenize(long_expression, &sequential_positions);
+    auto parallel_tokens = parser::try_tokenize_parallel(long_expression, 7, &parallel_positions);
+    check(sequential_tokens && parallel_tokens && sequential_tokens.value() == parallel_tokens.value()
+        && sequential_positions == parallel_positions, "parallel tokens");
+    for (unsigned threads : {2u, 4u, 16u}) {
+        auto tree = eval::try_parse(long_expression, &registry);
+        auto parallel_tree = eval::try_parse_parallel(long_expression, threads, &registry);
+        check(tree && parallel_tree && same_tree(*tree.value(), *parallel_tree.value()),
+            "parallel tree with " + std::to_string(threads) + " threads");
+        if (!tree || !parallel_tree) continue;
+        auto value = eval::try_evaluate(*tree.value(), symbols);
+        auto parallel_value = eval::try_evaluate(*parallel_tree.value(), symbols);
+        check(value && parallel_value && parallel_value.value() == value.value(),
+            "parallel value with " + std::to_string(threads) + " threads");
+    }
+    for (const std::string& broken : {long_expression + " + (1", long_expression + ")", sum + "+ 1.2.3 +" + sum, long_expression + ", 1",
+        sum + " * sqrt(1, 2)"}) {
+        auto expected = eval::try_parse(broken, &registry);
+        auto parallel = eval::try_parse_parallel(broken, 4, &registry);
+        check(!expected && !parallel && parallel.error().code_ == expected.error().code_ && parallel.error().position_ == expected.error().position_,
+            "parallel parse error at " + std::to_string(expected ? 0 : expected.error().position_));
+    }
+
+    // Worker processes give the batch outputs in order, and survive crashing workers
+    std::vector<std::string> lines;
+    for (int i = 0; i < 3000; ++i) lines.push_back(i % 50 == 0 ? "" : i % 31 == 0 ? "1/" + std::to_string(i % 2) : std::to_string(i) + " * x - sin(x)");
+    std::vector<std::string> thread_outputs, worker_outputs;
+    batch::BatchOptions batch_options;
+    batch::BatchReport thread_report = batch::run(lines, symbols, batch_options, thread_outputs);
+    workers::WorkerOptions worker_options;
+    worker_options.workers_ = 3;
+    worker_options.ring_bytes_ = 4096; // Wraps around often
+    batch::BatchReport worker_report = workers::run(lines, symbols, batch_options, worker_options, worker_outputs);
+    check(worker_outputs == thread_outputs && worker_report.errors_ == thread_report.errors_ && worker_report.restarts_ == 0, "worker outputs");
+    check(worker_report.total_.count() == thread_report.total_.count(), "worker latencies");
+    worker_options.fault_hook_ = [](std::size_t index, unsigned attempt) {
+        if ((index == 101 || index == 2001) && attempt == 0) ::raise(SIGKILL);
+    };
+    worker_report = workers::run(lines, symbols, batch_options, worker_options, worker_outputs);
+    check(worker_outputs == thread_outputs && worker_report.restarts_ == 2, "crashed workers restart");
+    worker_options.fault_hook_ = [](std::size_t index, unsigned) {
+        if (index == 7) std::abort();
+    };
+    worker_report = workers::run(lines, symbols, batch_options, worker_options, worker_outputs);
+    check(worker_outputs[7] == "error: Worker process killed by signal " + std::to_string(SIGABRT) + " evaluating this expression"
+        && worker_report.restarts_ == workers::kMaxAttempts && worker_report.errors_ == thread_report.errors_ + 1, "poison record");
+    worker_outputs[7] = thread_outputs[7];
+    check(worker_outputs == thread_outputs, "records after a poison record");
+
+    // Philox known answers, and summaries of samples that do not depend on the thread count
+    check(prng::philox4x32({0, 0, 0, 0}, {0, 0}) == std::array<std::uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}, "philox zeros");
+    check(prng::philox4x32({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff})
+        == std::array<std::uint32_t, 4>{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}, "philox ones");
+    {
+        std::vector<double> all(1000), part(301);
+        prng::normal(7, 3, 0, all.size(), all.data());
+        prng::normal(7, 3, 333, part.size(), part.data());
+        check(std::equal(part.begin(), part.end(), all.begin() + 333), "random streams start anywhere");
+        prng::uniform(7, 3, 0, all.size(), all.data());
+        check(std::all_of(all.begin(), all.end(), [](double u) { return u > 0 && u < 1; }), "uniform in (0, 1)");
+    }
+    {
+        auto tokens = parser::tokenize("x + y * x");
+        auto tree = eval::build_expr_tree(tokens.begin(), tokens.end());
+        std::vector<std::pair<types::Symbol, sampling::Distribution>> distributions{
+            sampling::parse_distribution("x ~ normal(0, 1)"), sampling::parse_distribution(" y~uniform(-1,3) ")};
+        sampling::SamplingOptions options;
+        options.samples_ = 100003; // Not a whole number of blocks
+        options.seed_ = 42;
+        sampling::SamplingSummary one = sampling::sample(*tree, distributions, {}, options);
+        options.threads_ = 3;
+        sampling::SamplingSummary three = sampling::sample(*tree, distributions, {}, options);
+        check(one.moments_.count() == 100003 && one.moments_.mean() == three.moments_.mean()
+            && one.moments_.variance() == three.moments_.variance() && one.quantiles_.quantile(0.9) == three.quantiles_.quantile(0.9),
+            "sampling reproducible across threads");
+        // x(1 + y) with y uniform on (-1, 3): mean 0, variance E[(1 + y)^2] = 16 / 3
+        check(std::fabs(one.moments_.mean()) < 0.03 && std::fabs(one.moments_.variance() - 16.0 / 3) < 0.1, "sampled moments");
+
+        auto single = parser::tokenize("x");
+        tree = eval::build_expr_tree(single.begin(), single.end());
+        options.samples_ = 200000;
+        sampling::SamplingSummary normal = sampling::sample(*tree, {distributions[0]}, {}, options);
+        check(std::fabs(normal.quantiles_.quantile(0.5)) < 0.01 && std::fabs(normal.quantiles_.quantile(0.975) - 1.95996) < 0.03
+            && std::fabs(normal.moments_.variance() - 1) < 0.02, "normal quantiles");
+        sampling::SamplingSummary uniform = sampling::sample(*tree, {sampling::parse_distribution("x ~ uniform(-1, 3)")}, {}, options);
+        check(std::fabs(uniform.quantiles_.quantile(0.25)) < 0.02 && std::fabs(uniform.quantiles_.quantile(0.75) - 2) < 0.03
+            && uniform.moments_.min() > -1 && uniform.moments_.max() < 3, "uniform quantiles");
+
+        bool threw = false;
+        try { sampling::sample(*tree, {}, {}, options); }
+        catch (const std::invalid_argument&) { threw = true; }
+        check(threw, "sampling an undefined symbol throws");
+        for (const char* text : {"x normal(0, 1)", "1x ~ normal(0, 1)", "x ~ normal(0)", "x ~ uniform(2, 1)", "x ~ gumbel(0, 1)", "x ~ normal(0, a)"}) {
+            threw = false;
+            try { sampling::parse_distribution(text); }
+            catch (const std::invalid_argument&) { threw = true; }
+            check(threw, std::string("malformed distribution ") + text);
+        }
+    }
+    {
+        stats::Moments left, right, all;
+        stats::QuantileSketch sketch;
+        for (int i = 1; i <= 1000; ++i) {
+            (i % 3 ? left : right).add(i);
+            all.add(i);
+            sketch.add(i);
+        }
+        left.merge(right);
+        check(left.count() == 1000 && std::fabs(left.mean() - 500.5) < 1e-9 && std::fabs(left.variance() - all.variance()) < 1e-6,
+            "merged moments");
+        check(std::fabs(sketch.quantile(0.5) - 500) <= 500 * 2 * stats::kQuantileAccuracy, "sketch median within its accuracy");
+    }
+
+    // Exact sums are correctly rounded and the same bits in any order, added one by one, by arrays or merged
+    {
+        auto sum_of = [](std::initializer_list<double> values) {
+            stats::ExactSum sum;
+            for (double value : values) sum.add(value);
+            return sum.value();
+        };
+        const double max = std::numeric_limits<double>::max(), tiny = std::numeric_limits<double>::denorm_min();
+        check(sum_of({1e100, 1, -1e100}) == 1 && sum_of({max, max, -max}) == max && sum_of({max, max}) == HUGE_VAL
+            && sum_of({tiny, tiny, -tiny * 4}) == -2 * tiny && sum_of({}) == 0 && sum_of({0.5, -0.5}) == 0, "exact sums");
+        check(sum_of({1, std::ldexp(1, -53)}) == 1 && sum_of({1, std::ldexp(1, -53), std::ldexp(1, -200)}) == 1 + std::ldexp(1, -52)
+            && sum_of({1 + std::ldexp(1, -52), std::ldexp(1, -53)}) == 1 + std::ldexp(1, -51), "exact sums round to nearest even");
+        check(std::isnan(sum_of({1, std::nan(""), 2})) && std::isnan(sum_of({HUGE_VAL, -HUGE_VAL})) && sum_of({HUGE_VAL, max}) == HUGE_VAL,
+            "exact sums of NaNs and infinities");
+
+        // Multiples of 2^-20 spanning 2^-20 to 2^27, whose exact sum an int64_t holds and its conversion rounds
+        std::uint64_t state = 42;
+        std::vector<double> values;
+        std::int64_t exact = 0;
+        for (int i = 0; i < 20000; ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            std::int64_t units = static_cast<std::int64_t>(state) >> (16 + state % 48);
+            if (i % 1000 == 7) units = 0;
+            exact += units;
+            values.push_back(std::ldexp(static_cast<double>(units), -20));
+        }
+        const double expected = std::ldexp(static_cast<double>(exact), -20);
+        stats::ExactSum one_by_one, by_array;
+        for (double value : values) one_by_one.add(value);
+        std::reverse(values.begin(), values.end());
+        by_array.add(values.data(), values.size());
+        stats::ExactSum wide;
+        const double spread[] = {1e300, 1e-300, 3, -1e300, -3};
+        wide.add(spread, 5);
+        check(one_by_one.value() == expected && by_array.value() == expected && wide.value() == 1e-300, "exact sum of an array");
+        std::vector<double> shuffled = values;
+        for (std::size_t i = shuffled.size(); i-- > 1; ) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            std::swap(shuffled[i], shuffled[static_cast<std::size_t>(state >> 33) % (i + 1)]);
+        }
+        stats::ExactSum merged, part;
+        stats::Moments moments, shuffled_moments, merged_moments, part_moments;
+        moments.add(values.data(), values.size());
+        for (std::size_t i = 0; i < shuffled.size(); ++i) {
+            shuffled_moments.add(shuffled[i]);
+            part.add(shuffled[i]);
+            part_moments.add(shuffled[i]);
+            if (i % 777 == 776 || i + 1 == shuffled.size()) {
+                merged.merge(part);
+                merged_moments.merge(part_moments);
+                part = stats::ExactSum();
+                part_moments = stats::Moments();
+            }
+        }
+        check(merged.value() == expected, "exact sum merged");
+        check(shuffled_moments.mean() == moments.mean() && merged_moments.mean() == moments.mean()
+            && shuffled_moments.variance() == moments.variance() && merged_moments.variance() == moments.variance()
+            && merged_moments.min() == moments.min() && merged_moments.max() == moments.max() && merged_moments.count() == 20000,
+            "moments in any order");
+        double high, low;
+        by_array.value(high, low);
+        check(high == expected && std::fabs(low) <= std::ldexp(std::fabs(high), -53), "exact sum in two parts");
+
+        stats::Moments close;
+        for (double value : {1e9 + 3, 1e9 + 1, 1e9 + 2}) close.add(value);
+        check(close.mean() == 1e9 + 2 && close.variance() == 1, "moments of close values");
+        stats::Moments zeros, reversed;
+        zeros.add(0.0);
+        zeros.add(-0.0);
+        reversed.add(-0.0);
+        reversed.add(0.0);
+        check(std::signbit(zeros.min()) && std::signbit(reversed.min()) && !std::signbit(zeros.max()) && !std::signbit(reversed.max()),
+            "extremes of signed zeros");
+        stats::Moments huge, mixed;
+        huge.add(1e308);
+        const double pair[] = {-1e308, 5};
+        mixed.add(pair, 2);
+        stats::RollingMoments rolling(2);
+        rolling.add(1e308);
+        check(huge.mean() == 1e308 && mixed.mean() == -5e307 && rolling.mean() == 1e308 && std::isinf(mixed.variance()),
+            "means of values past the split limit");
+        double product, error;
+        error_free::two_product(0x1p1000 + 0x1p948, 1 + 0x1p-52, product, error);
+        check(product == 0x1p1000 + 0x1p949 && error == 0x1p896, "products past the split limit");
+    }
+
+    // Rolling statistics agree with recomputing every window, through NaNs and infinities
+    for (std::size_t window : {1, 2, 7, 64}) {
+        stats::RollingMoments moments(window);
+        stats::RollingExtremes extremes(window);
+        stats::RollingMedian median(window);
+        std::vector<double> stream;
+        std::uint64_t state = 12345;
+        bool agree = true;
+        for (int i = 0; i < 3000; ++i) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            double value = 1e9 + static_cast<double>(state >> 40) / 1024; // Far from 0, with ties
+            if (i % 500 == 250) value = std::nan("");
+            else if (i % 700 == 350) value = (i % 1400 == 350 ? 1 : -1) * HUGE_VAL;
+            stream.push_back(value);
+            moments.add(value);
+            extremes.add(value);
+            median.add(value);
+
+            std::vector<double> last(stream.end() - static_cast<std::ptrdiff_t>(std::min(window, stream.size())), stream.end());
+            bool nan = std::any_of(last.begin(), last.end(), [](double v) { return std::isnan(v); });
+            bool infinite = std::any_of(last.begin(), last.end(), [](double v) { return std::isinf(v); });
+            double sum = 0, squares = 0;
+            for (double v : last) sum += v;
+            double mean = sum / static_cast<double>(last.size());
+            for (double v : last) squares += (v - mean) * (v - mean);
+            double variance = last.size() > 1 ? squares / static_cast<double>(last.size() - 1) : 0;
+            std::sort(last.begin(), last.end());
+            double middle = last.size() % 2 ? last[last.size() / 2] : last[last.size() / 2 - 1] / 2 + last[last.size() / 2] / 2;
+            if (nan) {
+                agree = agree && std::isnan(moments.mean()) && std::isnan(extremes.min()) && std::isnan(median.median());
+            }
+            else if (infinite) {
+                agree = agree && moments.mean() == mean && std::isnan(moments.variance())
+                    && extremes.min() == last.front() && extremes.max() == last.back() && median.median() == middle;
+            }
+            else {
+                agree = agree && std::fabs(moments.mean() - mean) <= 1e-15 * mean && std::fabs(moments.variance() - variance) <= 1e-6 * (variance + 1)
+                    && extremes.min() == last.front() && extremes.max() == last.back() && median.median() == middle;
+            }
+        }
+        check(agree, "rolling statistics over a window of " + std::to_string(window));
+    }
+    {
+        stats::Ewma ewma(0.5);
+        for (double value : {4.0, std::nan(""), 8.0, HUGE_VAL, 8.0}) ewma.add(value);
+        check(ewma.count() == 3 && ewma.mean() == 7 && ewma.variance() == 3, "ewma skips non-finite values");
+        bool threw = false;
+        try { stats::RollingMedian empty(0); }
+        catch (const std::invalid_argument&) { threw = true; }
+        check(threw, "empty window throws");
+
+        std::istringstream in("3\n 1 \nx\n2\r\n\n");
+        std::ostringstream out;
+        batch::RollingOptions rolling_options;
+        rolling_options.window_ = 2;
+        rolling_options.alpha_ = 0.5;
+        check(batch::run_rolling(in, out, rolling_options) == 2 && out.str() == "3,3,0,3,3,3,3\n"
+            "1,2,1.4142135623730951,1,3,2,2\n"
+            "error: Syntax error: Expected a number at line 3\n"
+            "2,1.5,0.7071067811865476,1,2,1.5,2\n"
+            "error: Syntax error: Expected a number at line 5\n", "rolling stream");
+    }
+
+    // Incremental evaluation recomputes the paths from the changed symbols only, and agrees with the tree
+    {
+        auto tree = eval::try_parse("fib(18) * y + (x + 1) * (y * 3 + sin(y) - deep(40)) + scale(y) + if(x > 0, y, 1/(x - x))", &registry).value();
+        SymbolTable values{{"x", -1.0}, {"y", 0.5}};
+        incremental::Evaluator evaluator(*tree, values);
+        auto swept = evaluator.sweep("x", -1, 1, 9, expr::NumericMode::Strict);
+        bool agree = swept.size() == 9;
+        for (std::size_t i = 0; i < swept.size() && agree; ++i) {
+            values.insert_or_assign("x", incremental::sweep_point(-1, 1, 9, i));
+            auto expected = eval::try_evaluate(*tree, values);
+            agree = expected ? swept[i] && swept[i].value() == expected.value()
+                : !swept[i] && swept[i].error().code_ == expected.error().code_ && swept[i].error().position_ == expected.error().position_;
+        }
+        check(agree && !swept[0] && swept[8], "sweep agrees with the tree, errors included");
+        check(evaluator.recomputed() > 0 && evaluator.recomputed() * 2 < evaluator.nodes(), "sweep recomputes part of the tree");
+
+        // Other symbols changing, and the throwing path
+        for (double y : {0.25, 2.0}) {
+            evaluator.set("y", y);
+            values.insert_or_assign("y", y);
+            check(evaluator.evaluate() == tree->evaluate(values), "incremental evaluation after another symbol changes");
+        }
+        evaluator.set("x", 0.5);
+        evaluator.set("y", -3);
+        values.insert_or_assign("x", 0.5);
+        values.insert_or_assign("y", -3.0);
+        check(evaluator.evaluate() == tree->evaluate(values), "incremental evaluation after both symbols change");
+        evaluator.set("x", 0);
+        bool threw = false;
+        try { evaluator.evaluate(); }
+        catch (const std::runtime_error&) { threw = true; }
+        check(threw, "incremental evaluation throws as the tree does");
+
+        SymbolTable fixed;
+        incremental::Sweep sweep = incremental::parse_sweep("x=0:2:5,y=3", fixed);
+        check(sweep.symbol_ == "x" && sweep.first_ == 0 && sweep.last_ == 2 && sweep.steps_ == 5 && fixed.at("y") == 3, "parse sweep");
+        for (const char* text : {"x=0:2", "x=0:2:0", "=0:1:2", "x=0:1:2,y"}) {
+            threw = false;
+            try { incremental::parse_sweep(text, fixed); }
+            catch (const std::invalid_argument&) { threw = true; }
+            check(threw, std::string("malformed sweep ") + text);
+        }
+        for (const char* text : {"x=1:2:3,x=4", "x=1:2:3,y=1,y=2"}) {
+            std::string message;
+            try { incremental::parse_sweep(text, fixed); }
+            catch (const std::invalid_argument& err) { message = err.what(); }
+            check(message.rfind("Invalid command line argument: Symbol '", 0) == 0 && message.find("' has two values") != std::string::npos,
+                std::string("repeated symbol in sweep ") + text);
+        }
+    }
+
+    // Streamed evaluation gives the value and the error of the tree, holding values as deep as the nesting only
+    {
+        auto stream_agrees = [&](const std::string& expression, expr::NumericMode mode) {
+            std::istringstream in(expression);
+            auto streamed = eval::evaluate_stream(in, symbols, &registry, mode);
+            auto tree = eval::try_parse(expression, &registry);
+            auto expected = tree ? eval::try_evaluate(*tree.value(), symbols, mode) : types::Expected<types::Numeral>(tree.error());
+            if (expected) return streamed && (streamed.value() == expected.value() || (std::isnan(streamed.value()) && std::isnan(expected.value())));
+            const types::Error& error = expected.error();
+            return !streamed && streamed.error().code_ == error.code_ && streamed.error().position_ == error.position_
+                && streamed.error().detail_ == error.detail_ && streamed.error().received_args_ == error.received_args_;
+        };
+        for (const char* expression : {"1 + 2 * 3 - 4 / 5", "-x^2 + -(3 - x)! * +2", "2^3^2 - (1 - 2 - 3)", "hyp(3, x) + fib(20) * sq(7)",
+            "if(x > 0, 1, 1/0) + and(0, 1/0) + or(1, y)", "scale(3) - inv(x - 2) + inv(4)", "sin(pi / 4) * e + pow(2, binom(5, 2))",
+            "{[x + 1] * (x - 1)} / sqrt(2)", "y * 2 + 1/0", "1/0 + y", "inv(0) + 1", "hyp(1)", "hyp(1, 2, 3)", "sin()", "1, 2",
+            "1 + (2 * 3", "1 + 2) * 3", "(1 + 2]", "1 2", "1 +", "*", "", "  ", "log(0 - x) + 2", "1e999 * 0", "1.5.2 + 1", "--3", "2--3",
+            "2++3"}) {
+            check(stream_agrees(expression, expr::NumericMode::Strict), std::string("streamed ") + expression);
+            check(stream_agrees(expression, expr::NumericMode::IEEE), std::string("streamed in IEEE mode ") + expression);
+        }
+
+        // Long enough for tokens to straddle the buffers
+        std::string expression;
+        while (expression.size() < 3 * eval::kStreamBuffer) expression += "+ sin(x * 0.5) * (1 - x / 3) - hyp(1, x)^2 / 7.25 ";
+        check(stream_agrees(expression, expr::NumericMode::Strict), "streamed across buffers");
+        check(stream_agrees(expression + "+ y", expr::NumericMode::Strict), "streamed error across buffers");
+        std::istringstream in(expression);
+        eval::StreamStats stream_stats;
+        auto value = eval::evaluate_stream(in, symbols, &registry, expr::NumericMode::Strict, &stream_stats);
+        check(value && stream_stats.bytes_ == expression.size() && stream_stats.depth_ <= 10, "streamed in bounded memory");
+        std::string unspaced;
+        while (unspaced.size() < 3 * eval::kStreamBuffer) unspaced += "1-1-1+x*2.5-(x<=2)*5+x!=0==1+--3-";
+        unspaced += "1";
+        check(stream_agrees(unspaced, expr::NumericMode::Strict), "streamed unspaced across buffers");
+        in.clear();
+        in.str(unspaced);
+        value = eval::evaluate_stream(in, symbols, &registry, expr::NumericMode::Strict, &stream_stats);
+        check(value && stream_stats.buffer_ <= eval::kStreamBuffer + 64, "unspaced input cut at operators");
+        std::string nested = std::string(2000, '(') + "x" + std::string(2000, ')');
+        check(stream_agrees(nested, expr::NumericMode::Strict), "streamed nested brackets");
+    }
+
+    // Blocked matrix products agree with the triple loop, for edge tiles, several blocks and threads
+    {
+        auto naive = [](const std::vector<double>& a, const std::vector<double>& b, std::size_t m, std::size_t k, std::size_t n) {
+            std::vector<double> c(m * n, 0.0);
+            for (std::size_t i = 0; i < m; ++i) {
+                for (std::size_t p = 0; p < k; ++p) {
+                    for (std::size_t j = 0; j < n; ++j) c[i * n + j] += a[i * k + p] * b[p * n + j];
+                }
+            }
+            return c;
+        };
+        auto filled = [](std::size_t size, std::size_t seed) {
+            std::vector<double> values(size);
+            for (std::size_t i = 0; i < size; ++i) values[i] = static_cast<double>((i * 7919 + seed * 104729) % 2003) / 1001.0 - 1;
+            return values;
+        };
+        for (auto [m, k, n] : {std::array<std::size_t, 3>{1, 1, 1}, {7, 13, 5}, {130, 300, 37}, {5, 3, 2100}}) {
+            auto a = filled(m * k, 1), b = filled(k * n, 2), expected = naive(a, b, m, k, n);
+            std::vector<double> c(m * n);
+            linalg::multiply(a.data(), b.data(), c.data(), m, k, n);
+            double error = 0;
+            for (std::size_t i = 0; i < c.size(); ++i) error = std::max(error, std::fabs(c[i] - expected[i]));
+            check(error < 1e-12 * k, "blocked product " + std::to_string(m) + "x" + std::to_string(k) + "x" + std::to_string(n));
+        }
+        const std::size_t size = 260; // Past linalg::kParallelWork
+        auto a = filled(size * size, 3), b = filled(size * size, 4);
+        std::vector<double> single(size * size), threaded(size * size);
+        linalg::multiply(a.data(), b.data(), single.data(), size, size, size, 1);
+        linalg::multiply(a.data(), b.data(), threaded.data(), size, size, size, 3);
+        check(single == threaded, "threaded product is the same bits");
+
+        std::vector<double> t(7 * 40), back(40 * 7);
+        auto original = filled(40 * 7, 5);
+        linalg::transpose(original.data(), t.data(), 40, 7);
+        linalg::transpose(t.data(), back.data(), 7, 40);
+        check(t[3 * 40 + 38] == original[38 * 7 + 3] && back == original, "tiled transpose");
+
+        // Past one panel of the blocked factorization
+        const std::size_t order = 150;
+        auto matrix = filled(order * order, 6);
+        for (std::size_t i = 0; i < order; ++i) matrix[i * order + i] += 4;
+        auto rhs = filled(order, 7), x = rhs, lu = matrix;
+        std::vector<std::size_t> pivots(order);
+        check(linalg::lu_factor(lu.data(), order, pivots.data()), "factored");
+        linalg::lu_solve(lu.data(), pivots.data(), order, x.data(), 1);
+        double residual = 0;
+        for (std::size_t i = 0; i < order; ++i) {
+            double row = -rhs[i];
+            for (std::size_t j = 0; j < order; ++j) row += matrix[i * order + j] * x[j];
+            residual = std::max(residual, std::fabs(row));
+        }
+        check(residual < 1e-10, "blocked LU solves");
+        std::vector<double> small = {0, 2, 1, 3}, singular = {1, 2, 2, 4};
+        std::vector<std::size_t> small_pivots(2);
+        check(linalg::lu_factor(small.data(), 2, small_pivots.data()) && linalg::lu_determinant(small.data(), small_pivots.data(), 2) == -2,
+            "determinant with a row swap");
+        check(!linalg::lu_factor(singular.data(), 2, small_pivots.data()), "singular matrix");
+    }
+
+    // Expressions over vectors and matrices
+    {
+        dispatcher::Bindings values = {
+            {"A", types::Matrix(2, 2, {1, 2, 3, 4})}, {"B", types::Matrix(2, 2, {5, 6, 7, 8})},
+            {"C", types::Matrix(2, 3, {1, 2, 3, 4, 5, 6})}, {"u", types::Vector{1, 2}}, {"w", types::Vector{1, 2, 3}},
+            {"k", types::Numeral(3)}};
+        auto value = [&](const std::string& expression) {
+            return matrix_eval::evaluate(*eval::try_parse(expression).value(), symbols, values);
+        };
+        auto fails = [&](const std::string& expression, const std::string& message) {
+            try {
+                value(expression);
+                return false;
+            }
+            catch (const std::runtime_error& err) {
+                return std::string(err.what()) == message;
+            }
+        };
+        check(value("A*2 + B") == dispatcher::Result(types::Matrix(2, 2, {7, 10, 13, 16})), "fused element-wise chain");
+        check(value("A*B - -A") == dispatcher::Result(types::Matrix(2, 2, {20, 24, 46, 54})), "matrix product");
+        check(value("A*u") == dispatcher::Result(types::Vector{5, 11}) && value("u*A") == dispatcher::Result(types::Vector{7, 10}),
+            "matrix-vector products");
+        check(value("C + w*k") == dispatcher::Result(types::Matrix(2, 3, {4, 8, 12, 7, 11, 15})), "row broadcast");
+        check(value("transpose(C) + u") == dispatcher::Result(types::Matrix(3, 2, {2, 6, 3, 7, 4, 8})), "transpose");
+        check(value("dot(u, u*u) + det(A)") == dispatcher::Result(types::Numeral(7)), "dot and det");
+        check(value("solve(A, u)") == dispatcher::Result(types::Vector{0, 0.5}) && value("solve(2, u)") == dispatcher::Result(types::Vector{0.5, 1}),
+            "solve");
+        check(value("sqrt(A*A*0 + 4)^2 / 2") == dispatcher::Result(types::Matrix(2, 2, 2)), "elementary functions element-wise");
+        check(value("if(k > 2, 1, 1/0) + x") == dispatcher::Result(types::Numeral(3)), "scalar expressions");
+        check(fails("C + u", "Numerical error: Cannot apply '+' to a 2x3 matrix and a vector of 2"), "shape mismatch");
+        check(fails("C * A", "Numerical error: Cannot apply '*' to a 2x3 matrix and a 2x2 matrix"), "product shape mismatch");
+        check(fails("A / (A - 1)", "Numerical error: Cannot divide by 0"), "element-wise division by 0");
+        check(fails("log(A - 2)", "Numerical error: Argument outside the domain of 'log'"), "element-wise domain");
+        check(fails("solve(A*0 + 1, u)", "Numerical error: Cannot solve, the matrix is singular"), "singular solve");
+        check(fails("A < B", "Numerical error: The operation at position 2 takes scalars only"), "scalar-only operation");
+    }
+
+    // The throwing path keeps its messages
+    try {
+        auto tokens = parser::tokenize("1/0");
+        eval::build_expr_tree(tokens.begin(), tokens.end())->evaluate(symbols);
+        check(false, "throwing path throws");
+    }
+    catch (const std::runtime_error& err) {
+        check(std::string(err.what()) == "Numerical error: Cannot divide by 0", "throwing path message");
+    }
+
+    // Server framing: pipelined requests over a socketpair come back in order, in the client's framing
+    {
+        auto exchange = [](const std::string& requests, const server::ServerOptions& options, const SymbolTable& table) {
+            int fds[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) return std::string("socketpair failed");
+            std::thread serving(server::serve_connection, fds[1], std::cref(options), std::cref(table));
+            std::thread writing([&requests, fd = fds[0]] {
+                for (std::size_t offset = 0; offset < requests.size();) {
+                    ssize_t written = ::write(fd, requests.data() + offset, std::min<std::size_t>(requests.size() - offset, 1000));
+                    if (written <= 0) break;
+                    offset += static_cast<std::size_t>(written);
+                }
+                ::shutdown(fd, SHUT_WR);
+            });
+            std::string responses;
+            char buffer[4096];
+            for (ssize_t received; (received = ::read(fds[0], buffer, sizeof(buffer))) > 0;) responses.append(buffer, received);
+            writing.join();
+            serving.join();
+            ::close(fds[0]);
+            return responses;
+        };
+        auto frame = [](const std::string& payload) {
+            auto size = static_cast<std::uint32_t>(payload.size());
+            return std::string{static_cast<char>(size >> 24), static_cast<char>(size >> 16), static_cast<char>(size >> 8),
+                static_cast<char>(size)} + payload;
+        };
+
+        functions::FunctionRegistry registry;
+        registry.define("sq(t) = t*t");
+        server::ServerOptions options;
+        options.workers_ = 4;
+        options.evaluation_.functions_ = &registry;
+        SymbolTable table = {{"x", 2.0}};
+        std::string requests = "x*3\r\nsq(x) + 1\n1/0\n(1\n", expected = "6\n5\n" + server::evaluate_request("1/0", table, options.evaluation_)
+            + "\n" + server::evaluate_request("(1", table, options.evaluation_) + "\n";
+        for (int i = 0; i < 2000; ++i) {
+            requests += "sqrt(" + std::to_string(i) + ") + x\n";
+            expected += batch::format_numeral(std::sqrt(i) + 2) + "\n";
+        }
+        check(exchange(requests, options, table) == expected, "newline-delimited pipelined requests");
+
+        // Assignments publish a new version of the symbols, seen by the requests read after them
+        std::string assignments = "y = x + 1\ny*2\n x=y^2 \nx\nsin = 1\nsq = 1\ny = 1/0\nx == 9\n";
+        check(exchange(assignments, options, table) == "3\n6\n9\n9\nerror: Syntax error: Cannot define 'sin' at position 0\n"
+            "error: Syntax error: Cannot define 'sq' at position 0\nerror: Numerical error: Cannot divide by 0 at position 5\n1\n",
+            "assignments");
+        check(table.at("x") == 2.0 && !table.contains("y"), "assignments leave the initial symbols alone");
+        std::string reads, old_values;
+        for (int i = 0; i < 500; ++i) {
+            reads += "x\n";
+            old_values += "2\n";
+        }
+        check(exchange(reads + "x = 5\nx\n", options, table) == old_values + "5\n5\n", "assignments wait for the requests before them");
+
+        // The server replaces a stale socket only, never a file at its path
+        options.socket_path_ = "test_core_not_a_socket.txt";
+        std::ofstream(options.socket_path_) << "keep";
+        std::string refusal;
+        try { server::serve(options, table); }
+        catch (const std::runtime_error& err) { refusal = err.what(); }
+        std::ifstream kept(options.socket_path_);
+        std::string contents((std::istreambuf_iterator<char>(kept)), std::istreambuf_iterator<char>());
+        std::remove(options.socket_path_.c_str());
+        check(refusal == "Server error: 'test_core_not_a_socket.txt' exists and is not a socket" && contents == "keep",
+            "regular file at the socket path");
+
+        options.evaluation_.numeric_type_ = typed::NumericType::Rational;
+        options.evaluation_.polynomials_ = poly::PolynomialMode::Collect;
+        std::string length_prefixed = std::string(1, '\0') + frame("1/3 + x") + frame("") + frame("x^2 + 2*x + 1"),
+            rational = server::evaluate_request("1/3 + x", table, options.evaluation_);
+        check(rational == "7/3", "server honors the numeric type");
+        check(exchange(length_prefixed, options, table) == frame(rational) + frame(server::evaluate_request("", table, options.evaluation_))
+            + frame("9"), "length-prefixed pipelined requests");
+    }
+
+    // Counts and reals on the command line are numbers in range, without trailing characters
+    check(parse_count("8", "-j", 1, kMaxThreads) == 8 && parse_count("0", "--slowest", 0, kMaxSlowest) == 0
+        && parse_count("100000000", "--digits", 1, kMaxDigits) == kMaxDigits && parse_count("20", "--window", 1, kMaxWindow) == 20
+        && parse_count("18446744073709551615", "--seed", 0, std::numeric_limits<std::uint64_t>::max()) == ~std::uint64_t(0), "counts");
+    for (const char* text : {"-1", "+1", "abc", "4x", "", "0", "1025", "99999999999999999999999"}) {
+        try {
+            parse_count(text, "--threads", 1, kMaxThreads);
+            check(false, std::string("count ") + text + " rejected");
+        }
+        catch (const std::invalid_argument& err) {
+            check(std::string(err.what()) == "Invalid command line argument: --threads expects a whole number from 1 to 1024",
+                std::string("count ") + text + " message");
+        }
+    }
+    check(parse_real("1e-6", "--adaptive", "a positive tolerance", 0, std::numeric_limits<double>::max()) == 1e-6
+        && parse_real("0.25", "--adaptive", "a positive tolerance", 0, std::numeric_limits<double>::max()) == 0.25, "reals");
+    for (const char* text : {"1e-6x", "abc", "", " 1", "0", "-1e-6", "inf", "nan", "1e400"}) {
+        try {
+            parse_real(text, "--adaptive", "a positive tolerance", 0, std::numeric_limits<double>::max());
+            check(false, std::string("real ") + text + " rejected");
+        }
+        catch (const std::invalid_argument& err) {
+            check(std::string(err.what()) == "Invalid command line argument: --adaptive expects a positive tolerance",
+                std::string("real ") + text + " message");
+        }
+    }
+    check(parse_real("1", "--ewma", "a weight in (0, 1]", 0, 1) == 1 && parse_real("0.1", "--ewma", "a weight in (0, 1]", 0, 1) == 0.1, "weights");
+    for (const char* text : {"0", "1.0000001", "-0.5", "0.5.5", "0.5 "}) {
+        try {
+            parse_real(text, "--ewma", "a weight in (0, 1]", 0, 1);
+            check(false, std::string("weight ") + text + " rejected");
+        }
+        catch (const std::invalid_argument& err) {
+            check(std::string(err.what()) == "Invalid command line argument: --ewma expects a weight in (0, 1]", std::string("weight ") + text + " message");
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
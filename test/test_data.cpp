@@ -1,5 +1,9 @@
 #include <iostream>
+#include <limits>
+#include <string>
 #include "globals.h"
+#include "data/big_integer.h"
+#include "data/rational.h"
 #include "utils/expr_node.h"
 
 int main(int argc, char* argv[]) {
@@ -26,5 +30,80 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    return 0;
+    int failures = 0;
+    auto check = [&failures](bool condition, const std::string& what) {
+        if (!condition) {
+            std::cout << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    // Rationals stay exact and in lowest terms
+    using types::Rational;
+    check((Rational(1, 3) + Rational(1, 6)).toString() == "1/2", "1/3 + 1/6");
+    check((Rational(2, -4) * Rational(-6, 9)).toString() == "1/3" && (Rational(3, 4) / Rational(-3, 8)).toString() == "-2", "signs");
+    check((Rational(1, 6) - Rational(1, 6)).toString() == "0" && Rational(0, -5) == Rational(), "zero");
+    check(Rational(1, 3) < Rational(34, 100) && Rational(-1, 2) > Rational(-2, 3), "comparison");
+    check(Rational::fromString("-1.25e-1") == Rational(-1, 8) && Rational::fromString("3/4") == Rational(3, 4), "parsing");
+    Rational harmonic;
+    for (std::int64_t k = 1; k <= 20; ++k) harmonic += Rational(1, k);
+    check(harmonic.isInline() && harmonic.toString() == "55835135/15519504", "harmonic 20");
+    for (std::int64_t k = 21; k <= 50; ++k) harmonic += Rational(1, k);
+    check(!harmonic.isInline() && harmonic.toString() == "13943237577224054960759/3099044504245996706400", "harmonic 50");
+
+    // Overflow spills to big integers, and results that fit return inline
+    const std::int64_t max = std::numeric_limits<std::int64_t>::max();
+    Rational spilled = Rational(max) + 1;
+    check(!spilled.isInline() && spilled.toString() == "9223372036854775808", "spill on overflow");
+    check((spilled - 1).isInline() && spilled - 1 == Rational(max), "demotion");
+    check(Rational(std::numeric_limits<std::int64_t>::min(), -1) == spilled, "negating INT64_MIN");
+    Rational a(max / 3 / 2), power = a * a * a * a;
+    check(power.toString() == "5584109241768720839271670391710118425181542299321373161148798839075457201", "big product");
+    check((power / (a * a * a)).isInline() && power / (a * a * a) == a, "big quotient");
+    try {
+        Rational(1) / Rational();
+        check(false, "division by 0 throws");
+    }
+    catch (const std::domain_error&) {}
+
+    // Long division agrees with multiplication
+    types::BigInteger x = types::BigInteger::fromString("-123456789012345678901234567890123456789");
+    types::BigInteger y = types::BigInteger::fromString("98765432109876543210987");
+    types::BigInteger remainder;
+    types::BigInteger quotient = x.divide(y, &remainder);
+    check(quotient * y + remainder == x && remainder.isNegative() && (-remainder) < y, "long division");
+    check(types::gcd(x * y, y * y) == y * types::gcd(x, y), "gcd");
+
+    // Dense vectors and matrices
+    types::Matrix matrix(2, 3, {1, 2, 3, 4, 5, 6});
+    check(matrix(1, 0) == 4 && matrix.size() == 6 && matrix == types::Matrix(2, 3, {1, 2, 3, 4, 5, 6}) && matrix != types::Matrix(3, 2, 1),
+        "matrix layout");
+    check(types::Vector{1, 2}[1] == 2 && types::Vector(3, 1.5) == types::Vector{1.5, 1.5, 1.5}, "vector construction");
+    bool thrown = false;
+    try {
+        types::Matrix(2, 2, {1, 2, 3});
+    }
+    catch (const std::invalid_argument&) {
+        thrown = true;
+    }
+    check(thrown, "matrix of the wrong size");
+
+    // Operands large enough for the Karatsuba, transform and Newton paths
+    std::string digits;
+    for (int i = 0; digits.size() < 30000; ++i) digits += std::to_string(i * 7919 % 100003);
+    types::BigInteger large = types::BigInteger::fromString(digits), small = types::BigInteger::fromString(digits.substr(0, 3000));
+    types::BigInteger sum = large + small;
+    check(sum * sum == large * large + small * large * types::BigInteger(2) + small * small, "large products");
+    quotient = (large * large + small).divide(large, &remainder);
+    check(quotient == large && remainder == small, "Newton division");
+    quotient = (large * small + small).divide(large, &remainder);
+    check(quotient == small && remainder == small, "quotient shorter than the divisor");
+    check(types::isqrt(large * large) == large && types::isqrt(large * large - types::BigInteger(1)) == large - types::BigInteger(1)
+        && types::isqrt(types::BigInteger(99)) == types::BigInteger(9), "integer square root");
+    quotient = large.divide(small, &remainder);
+    check(quotient * small + remainder == large && remainder < small && !remainder.isNegative(), "large long division");
+    check(large.toString() == digits.substr(digits.find_first_not_of('0')) && (-sum).toString() == "-" + sum.toString()
+        && types::BigInteger::fromString(sum.toString()) == sum, "large decimal conversion");
+
+    return failures == 0 ? 0 : 1;
 }
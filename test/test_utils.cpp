@@ -0,0 +1,85 @@
+#include <iostream>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "utils/latency_histogram.h"
+#include "utils/versioned_symbol_table.h"
+
+int main(int argc, char* argv[]) {
+    std::cout << "from test_utils: Hello, world!\n";
+
+    int failures = 0;
+    auto check = [&failures](bool condition, const char* what) {
+        if (!condition) {
+            std::cout << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    };
+
+    // Buckets cover the whole range contiguously, and every value falls into its own bucket
+    for (std::size_t i = 1; i < utils::LatencyHistogram::kBucketCount; ++i) {
+        if (utils::LatencyHistogram::bucket_lowest(i) != utils::LatencyHistogram::bucket_highest(i - 1) + 1) {
+            check(false, "buckets are contiguous");
+            break;
+        }
+    }
+    for (std::uint64_t value : {0ull, 1ull, 255ull, 256ull, 1000ull, 123456789ull, (1ull << 40) + 12345}) {
+        auto index = utils::LatencyHistogram::bucket_index(value);
+        check(utils::LatencyHistogram::bucket_lowest(index) <= value && value <= utils::LatencyHistogram::bucket_highest(index),
+            "value within its bucket");
+    }
+
+    // Percentiles on 1..10000 stay within the 1% relative error
+    utils::LatencyHistogram first, second;
+    for (std::uint64_t value = 1; value <= 10000; ++value) (value % 2 ? first : second).record(value);
+    first.merge(second);
+    check(first.count() == 10000, "merged count");
+    check(first.max() == 10000 && first.min() == 1, "merged min/max");
+    auto p50 = first.value_at_percentile(50.0);
+    auto p99 = first.value_at_percentile(99.0);
+    check(p50 >= 5000 && p50 <= 5050, "p50");
+    check(p99 >= 9900 && p99 <= 9990, "p99");
+    check(first.value_at_percentile(100.0) == 10000, "p100 is the max");
+
+    // The slowest list keeps the N largest
+    utils::SlowestList slowest(3);
+    for (std::uint64_t value = 1; value <= 100; ++value) slowest.offer(value * 7 % 101, value, std::to_string(value));
+    auto sorted = slowest.sorted();
+    check(sorted.size() == 3 && sorted[0].latency_ns_ == 100 && sorted[2].latency_ns_ == 98, "slowest list");
+
+    // Versioned symbol table: snapshots keep their version, updates of several symbols are atomic
+    VersionedSymbolTable versioned({{"a", 0}, {"b", 0}});
+    {
+        auto before = versioned.snapshot();
+        check(versioned.insert_or_assign("a", 1) == 1, "version advances");
+        check(before->at("a") == 0 && before.version() == 0, "snapshot unaffected by later updates");
+        check(versioned.snapshot()->at("a") == 1, "new snapshot sees the update");
+    }
+    check(versioned.reclaim() == 0, "old versions reclaimed once released");
+    versioned.insert_or_assign("b", 1);
+
+    std::atomic<bool> stop{false}, torn{false}, backwards{false};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            std::uint64_t last = 0;
+            while (!stop) {
+                auto snapshot = versioned.snapshot();
+                if (snapshot->at("a") != snapshot->at("b")) torn = true;
+                if (snapshot.version() < last) backwards = true;
+                last = snapshot.version();
+            }
+        });
+    }
+    for (int i = 0; i < 20000; ++i) {
+        versioned.update([i](SymbolTable& table) { table.insert_or_assign("a", i).insert_or_assign("b", i); });
+    }
+    stop = true;
+    for (auto& reader : readers) reader.join();
+    check(!torn, "snapshots are consistent");
+    check(!backwards, "versions never go backwards for a reader");
+    check(versioned.reclaim() == 0, "all versions reclaimed after readers finish");
+
+    return failures == 0 ? 0 : 1;
+}